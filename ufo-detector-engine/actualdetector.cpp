@@ -17,10 +17,15 @@
  */
 
 #include "actualdetector.h"
+#include "workerpool.h"
+
+static const Scalar TRACK_COLORS[] = {Scalar(255,0,0),Scalar(0,255,0),Scalar(0,0,255),Scalar(255,255,0),Scalar(0,255,255),
+                                      Scalar(255,0,255),Scalar(255,127,255),Scalar(127,0,255),Scalar(127,0,127)};
 
 ActualDetector::ActualDetector(Camera* camera, Config* config, DataManager* dataManager, QObject *parent) :
-    QObject(parent), m_camPtr(camera)
+    QObject(parent), m_camPtr(camera), m_workerPool(NULL), m_frameSubscriber(NULL), m_detector(NULL)
 {
+    m_cameraIndex = m_camPtr->index();
     m_config = config;
     m_dataManager = dataManager;
     const QString DETECTION_AREA_FILE = m_config->detectionAreaFile();
@@ -28,21 +33,23 @@ ActualDetector::ActualDetector(Camera* camera, Config* config, DataManager* data
     m_willSaveImages = m_config->saveResultImages();
     m_cameraWidth = m_config->cameraWidth();
     m_cameraHeight = m_config->cameraHeight();
+    m_detectionScale = m_config->detectionDownscale(m_cameraIndex);
     m_willRecordWithRect = m_config->resultVideoWithObjectRectangles();
     m_isMainThreadRunning = false;
     m_showCameraVideo = false;
     m_startedRecording = false;
+    m_frameTaskScheduled = false;
 
     m_detectionAreaFile = DETECTION_AREA_FILE.toStdString();
     m_resultImageDirNameBase = IMAGEPATH.toStdString();
 
-    setNoiseLevel(m_config->noiseFilterPixelSize());
-    setThresholdLevel(m_config->motionThreshold());
+    setNoiseLevel(m_config->noiseFilterPixelSize(m_cameraIndex));
+    setThresholdLevel(m_config->motionThreshold(m_cameraIndex));
 
     m_recorder = new Recorder(m_camPtr, m_config, m_dataManager);
 
     state = new DetectorState(this, m_recorder);
-    state->MIN_POS_REQUIRED = m_config->minPositiveDetections();
+    state->MIN_POS_REQUIRED = m_config->minPositiveDetections(m_cameraIndex);
     connect(state, SIGNAL(sendOutputText(QString)), this, SIGNAL(broadcastOutputText(QString)));
 
     qDebug() << "ActualDetector constructed";
@@ -50,24 +57,42 @@ ActualDetector::ActualDetector(Camera* camera, Config* config, DataManager* data
 
 ActualDetector::~ActualDetector()
 {
-    m_recorder->deleteLater();
+    // not deleteLater(), there may be no event loop anymore to delete the recorder and its spool file
+    delete m_recorder;
     state->deleteLater();
 }
 
 bool ActualDetector::initialize()
 {
-    if (!initDetectionArea()){
+    CameraFramePtr cameraFrame = m_camPtr->latestFrame();
+    if (!cameraFrame)
+    {
+        qWarning() << "ActualDetector: no frames from camera";
+        return false;
+    }
+    // camera may give other than the configured size, area is made for the frames actually received
+    Mat detectionFrame = cameraFrame->lumaScaled(m_detectionScale);
+    if (!initDetectionArea(detectionFrame.size())){
         return false;
     }
+    // object rectangles are cropped from the received frames too
+    Size cameraFrameSize = cameraFrame->size();
+    if (cameraFrameSize.area() == 0)
+    {
+        // size of a JPEG frame is known after decoding it
+        cameraFrameSize = cameraFrame->luma().size();
+    }
+    m_cameraWidth = cameraFrameSize.width;
+    m_cameraHeight = cameraFrameSize.height;
     state->resetState();
 
-    m_prevFrame = m_camPtr->getWebcamFrame();
-    m_resultFrame = m_prevFrame;
-    m_currentFrame = m_camPtr->getWebcamFrame();
-    m_nextFrame = m_camPtr->getWebcamFrame();
-    cvtColor(m_currentFrame, m_currentFrame, CV_RGB2GRAY);
-    cvtColor(m_prevFrame, m_prevFrame, CV_RGB2GRAY);
-    cvtColor(m_nextFrame, m_nextFrame, CV_RGB2GRAY);
+    m_prevCameraFrame = cameraFrame;
+    m_currentCameraFrame = cameraFrame;
+    m_nextCameraFrame = cameraFrame;
+    m_prevFrame = detectionFrame;
+    m_currentFrame = m_prevFrame;
+    m_nextFrame = m_prevFrame;
+    m_resultFrame = cameraFrame->bgrImage();
 
     m_minAmountOfMotion = 2;
     m_maxDeviation = 20;
@@ -75,7 +100,6 @@ bool ActualDetector::initialize()
     m_savedImageExtension =".jpg";
 
 
-    m_willParseRectangle = false;
     if(m_willSaveImages)
     {
         string dateTime=QDateTime::currentDateTime().toString("yyyy-MM-dd--hh-mm-ss").toStdString();
@@ -101,249 +125,297 @@ bool ActualDetector::initialize()
     m_startedRecording = false;
 
 
-    m_rect = Rect(Point(0,0),Point(m_cameraWidth,m_cameraHeight));
-    m_treshImg = m_resultFrame.clone();
-    m_treshImg.setTo(Scalar(0,0,0));
+    m_rect = Rect(Point(0,0),Point(m_nextFrame.cols,m_nextFrame.rows));
+    m_treshImg = Mat::zeros(m_nextFrame.size(), CV_8UC1);
 
     return true;
 }
 
 /*
- * The detection thread
+ * Reset detection state before processing the first frame
  */
-void ActualDetector::detectingThread()
-{    
-    Mat tempImage;
-    int counterNoMotion = 0;
-    int counterBlackDetecor = 0;
-    int counterLight = 0;
-    bool isPositiveRectangle;
-    int threadYieldPauseUsec = 1000;
-    int numberOfChanges = 0;
-    int frameCount = 0;
-    int framesInFpsMeasurement = OUTPUT_FPS * 10;
-    bool fpsMeasurementDone = false;
-    QTime fpsMeasurementTimer;
+void ActualDetector::beginDetection()
+{
+    m_counterNoMotion = 0;
+    m_counterBlackDetector = 0;
+    m_counterLight = 0;
+    m_frameCount = 0;
+    m_fpsMeasurementDone = false;
+    m_centers.clear();
+    m_detector = new CDetector(m_currentFrame);
+    m_recorder->startPreroll();
+}
 
-    CDetector* detector=new CDetector(m_currentFrame);
-    vector<Point2d> centers;
-    Scalar Colors[]={Scalar(255,0,0),Scalar(0,255,0),Scalar(0,0,255),Scalar(255,255,0),Scalar(0,255,255),Scalar(255,0,255),Scalar(255,127,255),Scalar(127,0,255),Scalar(127,0,127)};
-    pair < vector<Point2d>,vector<Rect> > centerAndRectPair;
+/*
+ * Release detection state after processing the last frame
+ */
+void ActualDetector::finishDetection(FrameSubscriber* frameSubscriber)
+{
+    qDebug() << "ActualDetector for camera" << m_cameraIndex << "finished, skipped" << frameSubscriber->droppedFrames()
+             << "of" << (m_frameCount + frameSubscriber->droppedFrames()) << "frames";
+    m_camPtr->unsubscribe(frameSubscriber);
+    m_recorder->stopPreroll();
+    delete m_detector;
+    m_detector = NULL;
+}
 
-    qDebug() << "ActualDetector::detectingThread() started";
+/*
+ * The detection thread, used when there is no worker pool
+ */
+void ActualDetector::detectingThread()
+{
+    CameraFramePtr cameraFrame;
+    beginDetection();
+    // a file read in free running mode is read as fast as the detector takes the frames
+    FrameSubscriber* frameSubscriber = m_camPtr->subscribe(FrameSubscriber::LatestOnly, 1, true);
 
-    fpsMeasurementTimer.start();
+    qDebug() << "ActualDetector::detectingThread() started";
 
     while (m_isMainThreadRunning)
     {
-        m_prevFrame = m_currentFrame;
-        m_currentFrame = m_nextFrame;
-        tempImage = m_camPtr->getWebcamFrame();
-        frameCount++;
-        if (!fpsMeasurementDone && (frameCount >= framesInFpsMeasurement)) {
-            qDebug() << "ActualDetector reading" << ((float)frameCount /
-                         (float)fpsMeasurementTimer.elapsed()) * (float)1000
-                     << "FPS on average";
-            fpsMeasurementDone = true;
+        cameraFrame = frameSubscriber->waitNextFrame(FRAME_WAIT_TIMEOUT_MS);
+        if (!cameraFrame)
+        {
+            continue;
         }
+        processFrame(cameraFrame);
+    }
+    finishDetection(frameSubscriber);
+}
 
-        m_nextFrame = tempImage.clone();
-        m_resultFrame = m_nextFrame;
-        cvtColor(m_nextFrame, m_nextFrame, CV_RGB2GRAY);
+/*
+ * Schedule frame task to the worker pool unless one is already scheduled.
+ * Called from the camera capture thread for each new frame.
+ */
+void ActualDetector::scheduleFrameTask()
+{
+    std::lock_guard<std::mutex> lock(m_frameTaskMutex);
+    if (m_frameTaskScheduled || !m_isMainThreadRunning)
+    {
+        return;
+    }
+    // if the pool is busy, the frame waits in the subscriber and the next frame tries again
+    m_frameTaskScheduled = m_workerPool->post(std::bind(&ActualDetector::frameTask, this), 0);
+}
+
+/*
+ * Worker pool task processing the newest frame. Only one task per detector is
+ * scheduled at a time, so frames of a camera are processed in order.
+ */
+void ActualDetector::frameTask()
+{
+    CameraFramePtr cameraFrame = m_frameSubscriber->waitNextFrame(0);
+    if (cameraFrame && m_isMainThreadRunning)
+    {
+        // night check is done between frames instead of in a thread of its own
+        if (!m_startedRecording && (cameraFrame->m_timestamp >= m_nextNightCheck))
+        {
+            updateNightMode(cameraFrame->lumaScaled(m_detectionScale));
+            m_nextNightCheck = cameraFrame->m_timestamp + std::chrono::seconds(NIGHT_CHECK_INTERVAL_S);
+        }
+        processFrame(cameraFrame);
+    }
+
+    std::lock_guard<std::mutex> lock(m_frameTaskMutex);
+    m_frameTaskScheduled = false;
+    if (m_isMainThreadRunning && (m_frameSubscriber->count() > 0))
+    {
+        m_frameTaskScheduled = m_workerPool->post(std::bind(&ActualDetector::frameTask, this), 0);
+    }
+    m_frameTaskDone.notify_all();
+}
+
+/*
+ * Detect objects in a single frame
+ */
+void ActualDetector::processFrame(const CameraFramePtr& cameraFrame)
+{
+    int numberOfChanges = 0;
+
+    m_prevFrame = m_currentFrame;
+    m_prevCameraFrame = m_currentCameraFrame;
+    m_currentFrame = m_nextFrame;
+    m_currentCameraFrame = m_nextCameraFrame;
+    m_frameCount++;
+    if (m_frameCount == 1) {
+        m_fpsMeasurementStart = cameraFrame->m_timestamp;
+    }
+    if (!m_fpsMeasurementDone && (m_frameCount >= FRAMES_IN_FPS_MEASUREMENT)) {
+        // measured from capture timestamps so that detector load doesn't affect the result
+        std::chrono::duration<float> measurementTime = cameraFrame->m_timestamp - m_fpsMeasurementStart;
+        qDebug() << "ActualDetector reading" << ((float)(m_frameCount - 1) / measurementTime.count())
+                 << "FPS on average";
+        m_fpsMeasurementDone = true;
+    }
 
-        absdiff(m_prevFrame, m_nextFrame, m_d1);
-        absdiff(m_currentFrame, m_nextFrame, m_d2);
-        bitwise_and(m_d1, m_d2, m_motion);
-        threshold(m_motion, m_motion, m_thresholdLevel, 255, CV_THRESH_BINARY);
+    // detection works on (reduced size) luma only, color image is made only when it's needed
+    m_nextCameraFrame = cameraFrame;
+    m_nextFrame = cameraFrame->lumaScaled(m_detectionScale);
 
-        erode(m_motion, m_motion, m_noiseLevel);
+    MotionMask::threeFrameDifference(m_prevFrame, m_currentFrame, m_nextFrame, m_thresholdLevel, m_motion);
 
-        numberOfChanges = detectMotion(m_motion, m_resultFrame, m_resultFrameCropped, m_region, m_maxDeviation);
+    erode(m_motion, m_motion, m_noiseLevel);
 
-        if(numberOfChanges>=m_minAmountOfMotion)
+    numberOfChanges = detectMotion(m_motion, m_nextFrame, m_resultFrameCropped, m_region, m_maxDeviation);
+
+    if(numberOfChanges>=m_minAmountOfMotion)
+    {
+        m_centerAndRectPair = m_detector->Detect(m_treshImg,m_rect);
+        m_centers = m_centerAndRectPair.first;
+        m_detectorRectVec = m_centerAndRectPair.second;
+        m_counterNoMotion=0;
+        if(m_centers.size()>0)
         {
-            centerAndRectPair = detector->Detect(m_treshImg,m_rect);
-            centers = centerAndRectPair.first;
-            m_detectorRectVec = centerAndRectPair.second;
-            counterNoMotion=0;
-            if(centers.size()>0)
-            {
-                state->tracker.Update(centers,m_detectorRectVec,CTracker::RectsDist);
-            }
-            //loop through detected objects
-            if (m_detectorRectVec.size()<  MAX_OBJECTS_IN_FRAME)
+            state->tracker.Update(m_centers,m_detectorRectVec,CTracker::RectsDist);
+        }
+        //loop through detected objects
+        if (m_detectorRectVec.size()<  MAX_OBJECTS_IN_FRAME)
+        {
+            for ( unsigned int i=0;i<m_detectorRectVec.size();i++)
             {
-                isPositiveRectangle=false;
-                for ( unsigned int i=0;i<m_detectorRectVec.size();i++)
+                Rect croppedRectangle = m_detectorRectVec[i];
+                //+++check if there was light in object
+                if(lightDetection(croppedRectangle))
                 {
-                    Rect croppedRectangle = m_detectorRectVec[i];
-                    Mat temp = m_resultFrame(croppedRectangle);
-                    Mat croppedImage = temp.clone();
-                    //+++check if there was light in object
-                    if(lightDetection(croppedRectangle,croppedImage))
+                    //object was bright
+                    if (!m_isInNightMode && checkIfBird())
                     {
-                        //object was bright
-                        if (!m_isInNightMode && checkIfBird())
+                        state->tracker.tracks[i]->birdCounter++;
+                    }
+                    else
+                    {//+++ not in night mode or was not a bird*/
+                        m_counterLight++;
+                        if(m_counterLight>2)m_counterBlackDetector=0;
+                        if(m_counterBlackDetector<5)
                         {
-                            state->tracker.tracks[i]->birdCounter++;
-                        }
-                        else
-                        {//+++ not in night mode or was not a bird*/
-                            counterLight++;
-                            if(counterLight>2)counterBlackDetecor=0;
-                            if(counterBlackDetecor<5)
+                            emit checkPlane();
+                            if(!m_startedRecording)
+                            {
+                                Mat tempImg = cameraFrame->bgrImageCopy();
+                                rectangle(tempImg,toCameraRect(croppedRectangle),Scalar(255,0,0),1);
+                                m_recorder->startRecording(tempImg,
+                                        QDateTime::fromMSecsSinceEpoch(cameraFrame->m_wallClockMsecs));
+                                m_startedRecording=true;
+                                auto output_text = tr("Positive detection - starting video recording");
+                                emit broadcastOutputText(output_text);
+                            }
+                            state->negAndNoMotionCounter=0;
+                            state->posCounter++;
+                            state->tracker.tracks[i]->posCounter++;
+                            emit positiveMessage();
+
+                            if(m_willSaveImages)
                             {
-                                emit checkPlane();
-                                if(!m_startedRecording)
-                                {
-                                    Mat tempImg = m_resultFrame.clone();
-                                    rectangle(tempImg,croppedRectangle,Scalar(255,0,0),1);
-                                    m_recorder->startRecording(tempImg);
-                                    if(m_willRecordWithRect) m_willParseRectangle=true;
-                                    m_startedRecording=true;
-                                    auto output_text = tr("Positive detection - starting video recording");
-                                    emit broadcastOutputText(output_text);
-                                }
-
-                                if(m_willParseRectangle)
-                                {
-                                    isPositiveRectangle=true;
-                                }
-                                state->negAndNoMotionCounter=0;
-                                state->posCounter++;
-                                state->tracker.tracks[i]->posCounter++;
-                                emit positiveMessage();
-
-                                if(m_willSaveImages)
-                                {
-                                    saveImg(m_resultImageDirName, croppedImage);
-                                    m_imageCount++;
-                                    //saveImg(pathnameThresh, treshImg);
-                                }
+                                Mat croppedImage = cameraFrame->bgrImage()(toCameraRect(croppedRectangle)).clone();
+                                saveImg(m_resultImageDirName, croppedImage);
+                                m_imageCount++;
+                                //saveImg(pathnameThresh, treshImg);
                             }
                         }
                     }
+                }
 
-                    else { //+++motion has black pixel
-                        counterBlackDetecor++;
-                        counterLight=0;
-                        state->tracker.tracks[i]->negCounter++;
+                else { //+++motion has black pixel
+                    m_counterBlackDetector++;
+                    m_counterLight=0;
+                    state->tracker.tracks[i]->negCounter++;
 
-                        if (m_startedRecording)
-                        {
-                            state->negAndNoMotionCounter++;
-                        }
-                        emit negativeMessage();
+                    if (m_startedRecording)
+                    {
+                        state->negAndNoMotionCounter++;
                     }
+                    emit negativeMessage();
                 }
-                if(m_willParseRectangle)
-                {
-                    m_recorder->setRectangle(m_rect,isPositiveRectangle);
-                }
-
             }
+
         }
-        else
-        { //+++no motion detected
-            counterLight=0;
-            counterBlackDetecor=0;
-            counterNoMotion++;
-            if (m_startedRecording)
-            {
-                state->negAndNoMotionCounter++;
-            }
-            state->tracker.updateEmpty();
-            centers.clear();
-            m_detectorRectVec.clear();
-            if ((m_startedRecording && counterNoMotion > 150) || (state->negAndNoMotionCounter > 700))
-            {
-                state->finishRecording();
-                state->resetState();
-                m_willParseRectangle=false;
-                m_startedRecording=false;
-            }
+    }
+    else
+    { //+++no motion detected
+        m_counterLight=0;
+        m_counterBlackDetector=0;
+        m_counterNoMotion++;
+        if (m_startedRecording)
+        {
+            state->negAndNoMotionCounter++;
         }
-
-        // check if there was a plane
-        if (state->numberOfPlanes && state->numberOfPlanes >= centers.size()){
-            state->wasPlane = true;
+        state->tracker.updateEmpty();
+        m_centers.clear();
+        m_detectorRectVec.clear();
+        if ((m_startedRecording && m_counterNoMotion > 150) || (state->negAndNoMotionCounter > 700))
+        {
+            state->finishRecording();
+            state->resetState();
+            m_startedRecording=false;
         }
+    }
 
-        if (m_showCameraVideo && centers.size() < MAX_OBJECTS_IN_FRAME )
+    if (m_willRecordWithRect)
+    {
+        publishTrackBoxes(cameraFrame->m_sequenceNumber);
+    }
+
+    // check if there was a plane
+    if (state->numberOfPlanes && state->numberOfPlanes >= m_centers.size()){
+        state->wasPlane = true;
+    }
+
+    if (m_showCameraVideo && m_centers.size() < MAX_OBJECTS_IN_FRAME )
+    {
+        m_resultFrame = cameraFrame->bgrImageCopy();
+        for(unsigned int i=0; i<m_centers.size(); i++)
         {
-            for(unsigned int i=0; i<centers.size(); i++)
-            {
-                //rectangle(result,detectorRectVec[i],color,1);
-                circle(m_resultFrame,centers[i],3,Scalar(0,255,0),1,CV_AA);
-                // stringstream ss;
-                // char str[256] = "";
-                // snprintf(str, sizeof(str), "%zu", tracker.tracks[i]->track_id);
-                // ss << str << " P: " << tracker.tracks[i]->posCounter << " N: " << tracker.tracks[i]->negCounter;
-                // putText(result,ss.str(),centers[i],CV_FONT_HERSHEY_PLAIN,2, CV_RGB(250,0,0));
-            }
-            if(centers.size()>0)
+            //rectangle(result,detectorRectVec[i],color,1);
+            circle(m_resultFrame,toCameraPoint(m_centers[i]),3,Scalar(0,255,0),1,CV_AA);
+            // stringstream ss;
+            // char str[256] = "";
+            // snprintf(str, sizeof(str), "%zu", tracker.tracks[i]->track_id);
+            // ss << str << " P: " << tracker.tracks[i]->posCounter << " N: " << tracker.tracks[i]->negCounter;
+            // putText(result,ss.str(),m_centers[i],CV_FONT_HERSHEY_PLAIN,2, CV_RGB(250,0,0));
+        }
+        if(m_centers.size()>0)
+        {
+            for(unsigned int i=0;i<state->tracker.tracks.size();i++)
             {
-                for(unsigned int i=0;i<state->tracker.tracks.size();i++)
+                if(!state->tracker.tracks[i]->trace.empty())
                 {
-                    if(!state->tracker.tracks[i]->trace.empty())
+                    for(unsigned int j=0;j<state->tracker.tracks[i]->trace.size()-1;j++)
                     {
-                        for(unsigned int j=0;j<state->tracker.tracks[i]->trace.size()-1;j++)
-                        {
-                            line(m_resultFrame,state->tracker.tracks[i]->trace[j],state->tracker.tracks[i]->trace[j+1],Colors[state->tracker.tracks[i]->track_id%9],2,CV_AA);
-                        }
+                        line(m_resultFrame,toCameraPoint(state->tracker.tracks[i]->trace[j]),toCameraPoint(state->tracker.tracks[i]->trace[j+1]),TRACK_COLORS[state->tracker.tracks[i]->track_id%9],2,CV_AA);
                     }
                 }
             }
-
-            cv::cvtColor(m_resultFrame, m_resultFrame, CV_BGR2RGB);
-            m_cameraViewImage = QImage((uchar*)m_resultFrame.data, m_resultFrame.cols, m_resultFrame.rows, m_resultFrame.step, QImage::Format_RGB888);
-            emit updatePixmap(m_cameraViewImage.copy());
         }
-        // give chance to other threads to run
-        std::this_thread::yield();
-        std::this_thread::sleep_for(std::chrono::microseconds(threadYieldPauseUsec));
+
+        cv::cvtColor(m_resultFrame, m_resultFrame, CV_BGR2RGB);
+        m_cameraViewImage = QImage((uchar*)m_resultFrame.data, m_resultFrame.cols, m_resultFrame.rows, m_resultFrame.step, QImage::Format_RGB888);
+        emit updatePixmap(m_cameraViewImage.copy());
     }
-    qDebug() << "ActualDetector::detectingThread() finished";
-    delete detector;    
 }
 
 /*
  * Check if there was motion between frames. Return the AmountOfMotion detected
  */
-inline int ActualDetector::detectMotion(const Mat & motion, Mat & result, Mat & result_cropped,vector<Point> & region,int max_deviation)
+inline int ActualDetector::detectMotion(const Mat & motion, Mat & result, Mat & result_cropped,const RegionMask & region,int max_deviation)
 {
     // calculate the standard deviation
-    Scalar mean, stddev;
-    meanStdDev(motion, mean, stddev);
+    const double stddev = MotionMask::binaryStdDev(motion);
     // if not to much changes then the motion is real
-    if(stddev[0] < max_deviation)
+    if(stddev < max_deviation)
     {
-        int number_of_changes = 0;
-        int min_x = motion.cols, max_x = 0;
-        int min_y = motion.rows, max_y = 0;
-        // loop over image and detect changes
-        int x, y, size = region.size();
-
-        for(int i = 0; i < size; i++)
-        { // loop over region
-            x = region[i].x;
-            y = region[i].y;
-            if(static_cast<int>(motion.at<uchar>(y,x)) == 255)
-            {
-                number_of_changes++;
-                if(min_x>x) min_x = x;
-                if(max_x<x) max_x = x;
-                if(min_y>y) min_y = y;
-                if(max_y<y) max_y = y;
-            }
-        }
+        // count changes inside the detection area
+        Rect changes;
+        int number_of_changes = region.countNonZero(motion, changes);
         if(number_of_changes)
         {
+            int min_x = changes.x, max_x = changes.x + changes.width - 1;
+            int min_y = changes.y, max_y = changes.y + changes.height - 1;
+            const int padding = toDetectionPixels(MOTION_RECT_PADDING);
             //check if not out of bounds
-            if(min_x-10 > 0) min_x -= 10;
-            if(min_y-10 > 0) min_y -= 10;
-            if(max_x+10 < result.cols-1) max_x += 10;
-            if(max_y+10 < result.rows-1) max_y += 10;
+            if(min_x-padding > 0) min_x -= padding;
+            if(min_y-padding > 0) min_y -= padding;
+            if(max_x+padding < result.cols-1) max_x += padding;
+            if(max_y+padding < result.rows-1) max_y += padding;
 
             Point x(min_x,min_y);
             Point y(max_x,max_y);
@@ -355,7 +427,7 @@ inline int ActualDetector::detectMotion(const Mat & motion, Mat & result, Mat &
         }
         else
         {
-            m_rect = Rect(Point(0,0),Point(m_cameraWidth,m_cameraHeight));
+            m_rect = Rect(Point(0,0),Point(result.cols,result.rows));
             m_treshImg = result.clone();
             m_treshImg.setTo(Scalar(0,0,0));
         }
@@ -364,16 +436,24 @@ inline int ActualDetector::detectMotion(const Mat & motion, Mat & result, Mat &
     return 0;
 }
 
-bool ActualDetector::initDetectionArea() {
+bool ActualDetector::initDetectionArea(const Size& detectionSize) {
 
     bool readOk = m_dataManager->readDetectionAreaFile(true);
     if (!readOk) {
         return false;
     }
-    int size = 0;
-    QRect cameraRect(0, 0, m_config->cameraWidth(), m_config->cameraHeight());
-
-    QList<QPolygon*> polygonList = m_dataManager->detectionArea();
+    // area must be inside both the configured and the received camera frame
+    QRect cameraRect = QRect(0, 0, m_config->cameraWidth(), m_config->cameraHeight())
+            .intersected(QRect(0, 0, detectionSize.width * m_detectionScale, detectionSize.height * m_detectionScale));
+    Mat area = Mat::zeros(detectionSize, CV_8UC1);
+
+    QList<QPolygon*> polygonList = m_dataManager->detectionArea(m_cameraIndex);
+    if (polygonList.isEmpty()) {
+        QString errorMsg = tr("ERROR: No area of detection selected for camera %1.").arg(m_cameraIndex);
+        emit broadcastOutputText(errorMsg);
+        return false;
+    }
+    m_region.clear();
     QListIterator<QPolygon*> polygonListIt(polygonList);
 
     while (polygonListIt.hasNext()) {
@@ -386,22 +466,42 @@ bool ActualDetector::initDetectionArea() {
             return false;
         }
 
-        for (int bx = boundingRect.x(); bx < boundingRect.width(); bx++) {
-            for (int by = boundingRect.y(); by < boundingRect.height(); by++) {
-                if (polygon->containsPoint(QPoint(bx, by), Qt::OddEvenFill)) {
-                    m_region.push_back(cv::Point2f(bx, by));
-                    size++;
+        // region is in detection image coordinates
+        for (int dx = boundingRect.x() / m_detectionScale; dx * m_detectionScale <= boundingRect.right(); dx++) {
+            for (int dy = boundingRect.y() / m_detectionScale; dy * m_detectionScale <= boundingRect.bottom(); dy++) {
+                if (polygon->containsPoint(QPoint(dx * m_detectionScale, dy * m_detectionScale), Qt::OddEvenFill)) {
+                    area.at<uchar>(dy, dx) = 255;
                 }
             }
         }
     }
+    m_region.setMask(area);
+    m_fullRegion = m_region;
     return true;
 }
 
 /*
- * Check if an object is bright. I.e. object has more bright pixels than dark pixels
+ * Hand the boxes of objects tracked in this frame over to the recorder, which draws them when it writes the frame
  */
-bool ActualDetector::lightDetection(Rect &rectangle, Mat &croppedImage)
+void ActualDetector::publishTrackBoxes(quint64 sequenceNumber)
+{
+    std::vector<TrackOverlay::Box> boxes;
+    for (const std::unique_ptr<CTrack>& track : state->tracker.tracks)
+    {
+        if (track->skipped_frames == 0)
+        {
+            // object was detected in this frame
+            TrackOverlay::Box box;
+            box.m_rect = toCameraRect(track->GetLastRect());
+            box.m_trackId = (int)track->track_id;
+            box.m_positive = (track->posCounter > 0);
+            boxes.push_back(box);
+        }
+    }
+    m_recorder->trackOverlay()->publish(sequenceNumber, boxes);
+}
+
+bool ActualDetector::lightDetection(Rect &rectangle)
 {
     bool objectHasLight=false;
 
@@ -411,16 +511,29 @@ bool ActualDetector::lightDetection(Rect &rectangle, Mat &croppedImage)
     int blackCounter=0;
     Mat croppedImageThreshTemp, croppedImageThresh;
     croppedImageThreshTemp = m_motion(rectangle);
-    croppedImageThreshTemp.copyTo(croppedImageThresh);
-    cvtColor(croppedImage, m_croppedImageGray , CV_RGB2GRAY);
+    if (m_detectionScale > 1)
+    {
+        // object is inspected at full resolution, decoded only for the object area when possible
+        m_croppedImageGray = m_nextCameraFrame->lumaRegion(toCameraRect(rectangle));
+        if (m_croppedImageGray.empty())
+        {
+            return false;
+        }
+        cv::resize(croppedImageThreshTemp, croppedImageThresh, m_croppedImageGray.size(), 0, 0, INTER_NEAREST);
+    }
+    else
+    {
+        croppedImageThreshTemp.copyTo(croppedImageThresh);
+        m_croppedImageGray = m_nextFrame(rectangle);
+    }
 
     int light=0;
     int totalLight=0;
     bool wasDark=false;
 
-    for(int y = 0; y < croppedImage.rows; y++)
+    for(int y = 0; y < m_croppedImageGray.rows; y++)
     {
-        for(int x = 0; x < croppedImage.cols; x++)
+        for(int x = 0; x < m_croppedImageGray.cols; x++)
         {
             light+=static_cast<int>(m_croppedImageGray.at<uchar>(y,x));
             if(static_cast<int>(croppedImageThresh.at<uchar>(y,x)) == 255)
@@ -431,7 +544,7 @@ bool ActualDetector::lightDetection(Rect &rectangle, Mat &croppedImage)
         }
     }
 
-    totalLight=light/(croppedImage.cols*croppedImage.rows);
+    totalLight=light/(m_croppedImageGray.cols*m_croppedImageGray.rows);
     pair<int,int> minAndMaxLight = checkBrightness(totalLight);
 
     int x, y, size = detectionRegion.size();
@@ -514,88 +627,97 @@ pair<int,int> ActualDetector::checkBrightness(int totalLight)
 }
 
 /*
- * Thread that check if it is night every 300 seconds (5mins)
- * If total brightness is less than 100 it is night. In that case we temporary stop the detection process
- * to exclude any area from the detection area which is bright (i.e. the moon and stars) in order to
- * ignore any image noise around that area
+ * Get average brightness of the detection region
  */
-void ActualDetector::checkIfNight()
+int ActualDetector::regionBrightness(const Mat& frame)
 {
-    bool isRunning = true;
-    vector<Point> regionBackup=m_region;
-    vector<Point> regionNew;
-    bool changedRegion=false;
-    int timerSeconds=300;
+    if (m_region.isEmpty())
+    {
+        return 0;
+    }
+    return m_region.sum(frame) / m_region.pixelCount();
+}
 
-    while(isRunning)
+/*
+ * Check if it is night. If total brightness is less than 100 it is night. In that case exclude
+ * any area from the detection area which is bright (i.e. the moon and stars) in order to
+ * ignore any image noise around that area. Detection must not be running in other thread.
+ */
+void ActualDetector::updateNightMode(const Mat& frame)
+{
+    if (frame.empty())
     {
-        //get average brightness of region
-        int total=0;
-        long light=0;
-        Mat temp;
-        temp = m_camPtr->getWebcamFrame();
-        Mat frame = temp.clone();
-        cvtColor(frame, frame , CV_RGB2GRAY);
-
-        for(unsigned int i = 0; i<m_region.size(); i++)
-        {
-            int x = m_region[i].x;
-            int y = m_region[i].y;
-            light+=static_cast<int>(frame.at<uchar>(y,x));
-        }
+        return;
+    }
+    int total = regionBrightness(frame);
 
-        total = light/m_region.size();
+    if (total<100)
+    {
+        m_region=m_fullRegion;
+        m_isInNightMode=true;
+        excludeConstantLights(frame, total);
+    }
+    else if (m_isCascadeFound)
+    {
+        m_isInNightMode=false;
+    }
+}
 
-        if (total<100)
+/*
+ * Remove constant bright objects from the detection region
+ */
+void ActualDetector::excludeConstantLights(const Mat& frame, int totalLight)
+{
+    vector<Rect> constants = getConstantRecs(frame, totalLight);
+    if(constants.size()<=4 && constants.size()>0)
+    {
+        Mat imageBinary(frame.rows,frame.cols,CV_THRESH_BINARY, Scalar(0,0,0));
+        const int maxSize = toDetectionPixels(CONSTANT_LIGHT_MAX_SIZE);
+        //draw white pixel for everything inside rectangles
+        for(std::vector<Rect>::iterator it = constants.begin(); it != constants.end(); ++it)
         {
-            stopOnlyDetecting();
-            m_region=regionBackup;
-            m_isInNightMode=true;
+            Rect rectangleArea = *it;
+            if(rectangleArea.width<maxSize && rectangleArea.height<maxSize)
+            {
+                rectangle(imageBinary,rectangleArea,Scalar(255,255,255),-1);
+            }
+        }
 
+        //remove rectangle areas from region
+        m_region.exclude(imageBinary);
 
-            vector<Rect> constants = getConstantRecs(total);
-            if(constants.size()<=4 && constants.size()>0)
-            {
-                Mat imageBinary(frame.rows,frame.cols,CV_THRESH_BINARY, Scalar(0,0,0));
-                //draw white pixel for everything inside rectangles
-                for(std::vector<Rect>::iterator it = constants.begin(); it != constants.end(); ++it)
-                {
-                    Rect rectangleArea = *it;
-                    if(rectangleArea.width<140 && rectangleArea.height<140)
-                    {
-                        rectangle(imageBinary,rectangleArea,Scalar(255,255,255),-1);
-                    }
-                }
+        auto output_text = tr("%1 area(s) being ignored in order to filter the moon and stars").arg(QString::number(constants.size()));
+        emit broadcastOutputText(output_text);
+    }
+}
 
-                //find rectangle coordinates in region and remove them
-                regionNew=m_region;
-                vector<Point>::iterator it = regionNew.begin();
-                for ( ; it != regionNew.end(); )
-                {
-                    if (static_cast<int>(imageBinary.at<uchar>(*it)) != 0)
-                    {
-                        it = regionNew.erase(it);
-                    }
-                    else ++it;
-                }
+/*
+ * Thread that check if it is night every 300 seconds (5mins), used when there is no worker pool.
+ * Detection thread is temporary stopped while the detection area is updated.
+ */
+void ActualDetector::checkIfNight()
+{
+    bool isRunning = true;
+    int timerSeconds=NIGHT_CHECK_INTERVAL_S;
 
-                auto output_text = tr("%1 area(s) being ignored in order to filter the moon and stars").arg(QString::number(constants.size()));
-                emit broadcastOutputText(output_text);
-                changedRegion=true;
+    while(isRunning)
+    {
+        CameraFramePtr cameraFrame = m_camPtr->latestFrame();
+        Mat frame;
+        if (cameraFrame)
+        {
+            frame = cameraFrame->lumaScaled(m_detectionScale);
+        }
 
-            }
+        if (!frame.empty() && regionBrightness(frame)<100)
+        {
+            stopOnlyDetecting();
+            updateNightMode(frame);
             if (!m_mainThread)
             {
-                if(changedRegion)
-                {
-                    m_region=regionNew;
-                    changedRegion=false;
-                }
-                regionNew.clear();
                 m_isMainThreadRunning=true;
                 m_mainThread.reset(new std::thread(&ActualDetector::detectingThread, this));
             }
-
         }
         else if (m_isCascadeFound)
         {
@@ -652,6 +774,7 @@ void ActualDetector::stopOnlyDetecting()
 bool ActualDetector::checkIfBird()
 {
     std::vector<Rect> birds;
+    // full resolution object image of the preceding lightDetection()
     m_birdsCascade.detectMultiScale(m_croppedImageGray, birds, 1.1, 2, 0|CV_HAAR_SCALE_IMAGE, Size(CLASSIFIER_DIMENSION_SIZE, CLASSIFIER_DIMENSION_SIZE) );
 
     return (!birds.empty());
@@ -660,31 +783,19 @@ bool ActualDetector::checkIfBird()
 /*
  * Get vector with the Rect of all constant bright objects
  */
-std::vector<Rect> ActualDetector::getConstantRecs(int totalLight)
+std::vector<Rect> ActualDetector::getConstantRecs(const Mat& imageGray, int totalLight)
 {
     vector<Rect> rectVec;
-    Mat image = m_camPtr->getWebcamFrame();
-    Mat imageGray;
-    cvtColor(image, imageGray , CV_RGB2GRAY);
 
-    int y, x, size;
-    size=m_region.size();
     int minLight = checkBrightness(totalLight).first;
 
-    //find bright pixels in webcam frame and paint pixels in binary image
-    Mat imageBinary(image.rows,image.cols,CV_THRESH_BINARY, Scalar(0,0,0));
-    for(int i = 0; i < size; i++)
-    {
-        x = m_region[i].x;
-        y = m_region[i].y;
-        if(static_cast<int>(imageGray.at<uchar>(y,x)) > minLight+10)
-        {
-            rectangle(imageBinary,Point(x,y),Point(x,y),Scalar(255,255,255),-1);
-        }
-    }
+    //find bright pixels of the region in webcam frame
+    Mat imageBinary;
+    m_region.threshold(imageGray, minLight+10, imageBinary);
 
     //find contours in binary image
-    dilate(imageBinary, imageBinary, getStructuringElement(MORPH_RECT, Size(10,10)));
+    const int dilation = toDetectionPixels(CONSTANT_LIGHT_DILATION);
+    dilate(imageBinary, imageBinary, getStructuringElement(MORPH_RECT, Size(dilation,dilation)));
     Mat temp;
     imageBinary.copyTo(temp);
     vector<vector<Point> > contours;
@@ -703,7 +814,7 @@ std::vector<Rect> ActualDetector::getConstantRecs(int totalLight)
 
         for( unsigned int i = 0; i< contours.size(); i++ )
         {
-            Rect finalRect = enlargeROI(imageBinary,boundRect[i],15);
+            Rect finalRect = enlargeROI(imageBinary,boundRect[i],toDetectionPixels(CONSTANT_LIGHT_PADDING));
             Rect objectRect(finalRect.tl(),finalRect.br());
             rectangle(imageBinary,objectRect,Scalar(255,255,255),1);
             rectVec.push_back(objectRect);
@@ -729,7 +840,21 @@ void ActualDetector::saveImg(string path, Mat & image)
  */
 void ActualDetector::stopThread()
 {
-    m_region.clear();
+    if (m_frameSubscriber)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_frameTaskMutex);
+            m_isMainThreadRunning = false;
+        }
+        // no new tasks after this, wait for the scheduled one
+        m_frameSubscriber->setFrameCallback(nullptr);
+        {
+            std::unique_lock<std::mutex> lock(m_frameTaskMutex);
+            m_frameTaskDone.wait(lock, [this]() { return !m_frameTaskScheduled; });
+        }
+        finishDetection(m_frameSubscriber);
+        m_frameSubscriber = NULL;
+    }
     m_isMainThreadRunning = false;
     m_recorder->stopRecording(true);
     if (m_mainThread)
@@ -739,16 +864,26 @@ void ActualDetector::stopThread()
         this_thread::sleep_for(chrono::seconds(1));
         m_nightCheckerThread->join(); m_nightCheckerThread.reset();
     }
+    m_region.clear();
 }
 
 bool ActualDetector::start()
 {
-    if (!m_mainThread)
+    if (!m_mainThread && !m_frameSubscriber)
     {
         emit progressValueChanged(1);
         if(initialize())
         {
             m_isMainThreadRunning=true;
+            if (m_workerPool)
+            {
+                beginDetection();
+                m_nextNightCheck = FrameClock::time_point::min();
+                m_frameSubscriber = m_camPtr->subscribe(FrameSubscriber::LatestOnly, 1, true);
+                m_frameSubscriber->setFrameCallback(std::bind(&ActualDetector::scheduleFrameTask, this));
+                emit progressValueChanged(100);
+                return true;
+            }
             m_nightCheckerThread.reset(new std::thread(&ActualDetector::checkIfNight, this));
             emit progressValueChanged(90);
             this_thread::sleep_for(chrono::seconds(1));
@@ -765,6 +900,11 @@ bool ActualDetector::start()
     return true;
 }
 
+void ActualDetector::setWorkerPool(WorkerPool* workerPool)
+{
+    m_workerPool = workerPool;
+}
+
 Rect ActualDetector::enlargeROI(Mat &frm, Rect &boundingBox, int padding)
 {
     Rect returnRect = Rect(boundingBox.x - padding, boundingBox.y - padding, boundingBox.width + (padding * 2), boundingBox.height + (padding * 2));
@@ -783,9 +923,28 @@ void ActualDetector::setAmountOfPlanes(int amount)
 
 void ActualDetector::setNoiseLevel(int level)
 {
+    // level is given in camera pixels
+    level = toDetectionPixels(level);
     m_noiseLevel=getStructuringElement(MORPH_RECT, Size(level,level));
 }
 
+Rect ActualDetector::toCameraRect(const Rect& rect)
+{
+    Rect cameraRect(rect.x * m_detectionScale, rect.y * m_detectionScale,
+                    rect.width * m_detectionScale, rect.height * m_detectionScale);
+    return cameraRect & Rect(0, 0, m_cameraWidth, m_cameraHeight);
+}
+
+Point ActualDetector::toCameraPoint(const Point2d& point)
+{
+    return Point(point.x * m_detectionScale, point.y * m_detectionScale);
+}
+
+int ActualDetector::toDetectionPixels(int cameraPixels)
+{
+    return std::max(1, cameraPixels / m_detectionScale);
+}
+
 void ActualDetector::setThresholdLevel(int level)
 {
     m_thresholdLevel=level;
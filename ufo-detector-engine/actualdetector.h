@@ -39,10 +39,13 @@
 #include "Ctracker.h"
 #include "Detector.h"
 #include "detectorstate.h"
+#include "motionmask.h"
+#include "regionmask.h"
 
 using namespace cv;
 
 class Recorder;
+class WorkerPool;
 
 /**
  * @brief Main class to detect moving objects in video stream.
@@ -73,6 +76,13 @@ public:
      */
     void stopThread();
 
+    /**
+     * @brief Process frames in tasks of a shared worker pool instead of detector's own threads.
+     * Must be called before start().
+     * @param workerPool pool, or NULL to use own threads
+     */
+    void setWorkerPool(WorkerPool* workerPool);
+
     void setNoiseLevel(int level);
     void setThresholdLevel(int level);
     void setFilename(std::string msg);
@@ -95,6 +105,22 @@ private:
 #endif
     Recorder* m_recorder;
     Camera* m_camPtr;
+    int m_cameraIndex;
+    WorkerPool* m_workerPool;
+    FrameSubscriber* m_frameSubscriber;     ///< subscriber of worker pool mode
+    std::mutex m_frameTaskMutex;            ///< guards m_frameTaskScheduled and stopping in worker pool mode
+    std::condition_variable m_frameTaskDone;
+    bool m_frameTaskScheduled;              ///< a frame task is in the worker pool queue or running
+    FrameClock::time_point m_nextNightCheck;    ///< frame time of next night check in worker pool mode
+    CDetector* m_detector;
+    std::pair<std::vector<cv::Point2d>, std::vector<cv::Rect> > m_centerAndRectPair;
+    std::vector<cv::Point2d> m_centers;
+    int m_counterNoMotion;
+    int m_counterBlackDetector;
+    int m_counterLight;
+    int m_frameCount;
+    bool m_fpsMeasurementDone;
+    FrameClock::time_point m_fpsMeasurementStart;
     Config* m_config;
     DataManager* m_dataManager;
     cv::Mat m_resultFrame;
@@ -102,10 +128,11 @@ private:
     cv::Mat m_prevFrame;
     cv::Mat m_currentFrame;
     cv::Mat m_nextFrame;
+    CameraFramePtr m_prevCameraFrame;       ///< frame of m_prevFrame, keeps its luma valid
+    CameraFramePtr m_currentCameraFrame;    ///< frame of m_currentFrame
+    CameraFramePtr m_nextCameraFrame;       ///< frame of m_nextFrame
     std::atomic<bool> m_showCameraVideo; ///< whether the camera video is shown (updatePixmap signal emitted)
     QImage m_cameraViewImage;   ///< image to be given out with signal updatePixmap()
-    cv::Mat m_d1;
-    cv::Mat m_d2;
     cv::Mat m_motion;
     cv::Mat m_treshImg;
     cv::Mat m_croppedImageGray;
@@ -119,20 +146,29 @@ private:
     std::string m_savedImageExtension;
     int m_imageCount;
     int m_thresholdLevel;
-    int m_cameraWidth;
-    int m_cameraHeight;
+    int m_cameraWidth;      ///< width of the received camera frames, configured width before initialize()
+    int m_cameraHeight;     ///< height of the received camera frames, configured height before initialize()
+    int m_detectionScale;   ///< detection image size divisor, see Config::detectionDownscale()
     DetectorState *state;
     const unsigned int MAX_OBJECTS_IN_FRAME = 10;
     const int CLASSIFIER_DIMENSION_SIZE = 30;
+    const int FRAME_WAIT_TIMEOUT_MS = 100;   ///< interval at which thread run flag is checked while waiting frames
+    const int FRAMES_IN_FPS_MEASUREMENT = DEFAULT_OUTPUT_FPS * 10;
+    const int NIGHT_CHECK_INTERVAL_S = 300;
+    // sizes in camera pixels, see toDetectionPixels()
+    const int MOTION_RECT_PADDING = 10;     ///< padding around the motion of a frame
+    const int CONSTANT_LIGHT_DILATION = 10; ///< bright pixels closer than this are one constant light
+    const int CONSTANT_LIGHT_PADDING = 15;  ///< padding around a constant light
+    const int CONSTANT_LIGHT_MAX_SIZE = 140;    ///< larger bright areas are not excluded as constant lights
     bool m_willRecordWithRect;
     cv::CascadeClassifier m_birdsCascade;
 
 
-    std::vector<cv::Point> m_region;
+    RegionMask m_region;        ///< detection area in detection image coordinates
+    RegionMask m_fullRegion;    ///< m_region before excluding constant lights
     std::string m_detectionAreaFile;
 
     std::atomic<bool> m_isMainThreadRunning;
-    std::atomic<bool> m_willParseRectangle;
     bool m_isInNightMode;
     std::atomic<bool> m_startedRecording;
     bool m_willSaveImages;
@@ -143,33 +179,90 @@ private:
 
 
     inline int detectMotion(const cv::Mat & m_motion, cv::Mat & m_resultFrame, cv::Mat & m_resultFrameCropped,
-                     std::vector<cv::Point> &m_region,
+                     const RegionMask &m_region,
                      int m_maxDeviation);
 
     /**
      * @brief Initialize detection area.
      * Currently combining all defined detection areas into a single one.
+     * @param detectionSize size of the detection images, fails if the area doesn't fit in
      * @return true on success, false on failure
      */
-    bool initDetectionArea();
+    bool initDetectionArea(const cv::Size& detectionSize);
 
-    bool lightDetection(cv::Rect &rectangle, cv::Mat &croppedImage);
+    /**
+     * @brief Check if object in the newest frame is bright. Object image is kept in
+     * m_croppedImageGray at full resolution.
+     * @param rectangle object area in detection image coordinates
+     * @return true if object has more bright than dark pixels
+     */
+    bool lightDetection(cv::Rect &rectangle);
     void detectingThread();
+
+    /**
+     * @brief Reset detection state. Called before the first processFrame().
+     */
+    void beginDetection();
+
+    /**
+     * @brief Detect objects in the next frame.
+     */
+    void processFrame(const CameraFramePtr& cameraFrame);
+
+    /**
+     * @brief Release detection state and the frame subscriber.
+     */
+    void finishDetection(FrameSubscriber* frameSubscriber);
+
+    /**
+     * @brief Post frame task to the worker pool if there is none scheduled.
+     */
+    void scheduleFrameTask();
+
+    /**
+     * @brief Worker pool task processing the pending frame.
+     */
+    void frameTask();
     void detectingThreadHigh();
     void saveImg(std::string path, cv::Mat &image);
     std::pair<int, int> checkBrightness(int totalLight);
     void checkIfNight();
+    int regionBrightness(const cv::Mat& frame);
+
+    /**
+     * @brief Check whether it's night and update detection area and night mode accordingly.
+     */
+    void updateNightMode(const cv::Mat& frame);
+    void excludeConstantLights(const cv::Mat& frame, int totalLight);
     void stopOnlyDetecting();
 
     /**
-     * @brief Check if single (!) object is a bird.
+     * @brief Check if single (!) object is a bird. Looks at the object of the preceding lightDetection().
      * @todo Improve to only look for single objects
      */
     bool checkIfBird();
-    std::vector<cv::Rect> getConstantRecs(int totalLight);
+    std::vector<cv::Rect> getConstantRecs(const cv::Mat& imageGray, int totalLight);
 
     cv::Rect enlargeROI(cv::Mat &frm, cv::Rect &boundingBox, int padding);
 
+    /**
+     * @brief Convert rectangle from detection image coordinates into camera frame coordinates.
+     * @return rectangle clipped to the received camera frame size
+     */
+    cv::Rect toCameraRect(const cv::Rect& rect);
+    cv::Point toCameraPoint(const cv::Point2d& point);
+
+    /**
+     * @brief Convert length in camera pixels into detection image pixels, at least 1.
+     */
+    int toDetectionPixels(int cameraPixels);
+
+    /**
+     * @brief Publish boxes of the objects tracked in the frame for the recorder to draw.
+     * @param sequenceNumber CameraFrame sequence number of the frame
+     */
+    void publishTrackBoxes(quint64 sequenceNumber);
+
 signals:
     void positiveMessage();
     void negativeMessage();
@@ -17,13 +17,26 @@
  */
 
 #include "camera.h"
+#include "opencvcapturebackend.h"
+#include "filecapturebackend.h"
+#ifdef Q_OS_LINUX
+#include "v4l2capturebackend.h"
+#endif
+#include <algorithm>
 
-Camera::Camera(int index, int width, int height)
+Camera::Camera(int index, int width, int height, QString backend, QString pixelFormat)
 {
     m_index = index;
     m_width = width;
     m_height = height;
+    m_backendName = backend;
+    m_pixelFormat = pixelFormat;
+    m_inputRealTime = false;
     m_initialized = false;
+    m_backend = NULL;
+    m_capturing = false;
+    m_frameCounter = 0;
+    m_frameIntervalNs = 0;
 
     m_cameraInfo = new CameraInfo(m_index);
     connect(m_cameraInfo, SIGNAL(queryProgressChanged(int)), this, SIGNAL(queryProgressChanged(int)));
@@ -31,31 +44,81 @@ Camera::Camera(int index, int width, int height)
     std::cout << "Constructed camera with index " << m_index <<  std::endl;
 }
 
+Camera::~Camera()
+{
+    release();
+    delete m_backend;
+}
+
+void Camera::setInputFile(QString fileName, bool realTime)
+{
+    m_inputFileName = fileName;
+    m_inputRealTime = realTime;
+}
+
 bool Camera::init()
 {
-    m_webcam = new cv::VideoCapture(m_index);
-    m_webcam->open(m_index);
-    m_webcam->set(CV_CAP_PROP_FRAME_WIDTH, m_width);
-    m_webcam->set(CV_CAP_PROP_FRAME_HEIGHT, m_height);
-    int actualWidth = m_webcam->get(CV_CAP_PROP_FRAME_WIDTH);
-    int actualHeight = m_webcam->get(CV_CAP_PROP_FRAME_HEIGHT);
+    if (m_initialized)
+    {
+        return true;
+    }
+    delete m_backend;
+    m_backend = createBackend();
+    if (!m_backend->open(m_width, m_height))
+    {
+        return false;
+    }
+    cv::Size actualSize = m_backend->frameSize();
 
-    if ((actualWidth != m_width) || (actualHeight != m_height))
+    if ((actualSize.width != m_width) || (actualSize.height != m_height))
     {
         qDebug() << "Warning: requested web camera size" << m_width << "x" << m_height <<
-                    "but got" << actualWidth << "x" << actualHeight;
+                    "but got" << actualSize.width << "x" << actualSize.height;
     }
 
-    if(m_webcam->isOpened())
+    // first frame is available from latestFrame() right away
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    CameraFramePtr unsubscribedFrame;
+    if (m_backend->readFrame(frame.get()))
     {
-        m_webcam->read(videoFrame);
-    } else {
-        return false;
+        frame->m_sequenceNumber = ++m_frameCounter;
+        setCaptureTime(frame.get());
+        publishFrame(frame);
+        if (m_backend->isFreeRunning())
+        {
+            // nobody has subscribed yet, the frame would be lost from the input
+            unsubscribedFrame = frame;
+        }
     }
+
+    m_capturing = true;
+    m_captureThread.reset(new std::thread(&Camera::captureThread, this, unsubscribedFrame));
     m_initialized = true;
     return true;
 }
 
+CaptureBackend* Camera::createBackend()
+{
+    if (!m_inputFileName.isEmpty())
+    {
+        return new FileCaptureBackend(m_inputFileName, m_inputRealTime);
+    }
+    if (m_backendName == "v4l2")
+    {
+#ifdef Q_OS_LINUX
+        return new V4l2CaptureBackend("/dev/video" + QString::number(m_index),
+                                      V4l2CaptureBackend::fourcc(m_pixelFormat));
+#else
+        qWarning() << "V4L2 capture backend is available only in Linux, using OpenCV";
+#endif
+    }
+    else if (m_backendName != "opencv")
+    {
+        qWarning() << "Unknown capture backend" << m_backendName << "- using OpenCV";
+    }
+    return new OpencvCaptureBackend(m_index);
+}
+
 bool Camera::isInitialized()
 {
     return m_initialized;
@@ -63,25 +126,203 @@ bool Camera::isInitialized()
 
 void Camera::release()
 {
-    if (!m_webcam)
+    if (m_captureThread)
+    {
+        m_capturing = false;
+        m_captureThread->join();
+        m_captureThread.reset();
+    }
+    if (!m_backend)
     {
         return;
     }
-    m_webcam->release();
+    m_backend->close();
+    {
+        std::lock_guard<std::mutex> lock(m_latestFrameMutex);
+        m_latestFrame.reset();
+    }
     m_initialized = false;
 }
 
+void Camera::captureThread(CameraFramePtr unsubscribedFrame)
+{
+    qDebug() << "Camera capture thread started";
+    if (m_backend->isFreeRunning())
+    {
+        // frames published before the detector listens would be lost
+        waitPacingSubscriber();
+        if (unsubscribedFrame && m_capturing)
+        {
+            publishFrame(unsubscribedFrame);
+        }
+    }
+    while (m_capturing)
+    {
+        std::shared_ptr<CameraFrame> frame(new CameraFrame);
+        if (!m_backend->readFrame(frame.get()))
+        {
+            if (m_backend->atEnd())
+            {
+                waitSubscribersDrained();
+                qDebug() << "Camera input ended";
+                emit endOfStream();
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(READ_ERROR_PAUSE_MS));
+            continue;
+        }
+        frame->m_sequenceNumber = ++m_frameCounter;
+        setCaptureTime(frame.get());
+        publishFrame(frame);
+    }
+    qDebug() << "Camera capture thread finished," << m_frameCounter << "frames captured";
+}
+
+void Camera::setCaptureTime(CameraFrame* frame)
+{
+    FrameClock::time_point now = FrameClock::now();
+    qint64 wallClockNow = QDateTime::currentMSecsSinceEpoch();
+
+    FrameClock::time_point driverTimestamp = frame->m_timestamp;
+    frame->m_timestamp = now;
+    if (!m_backend->isLive())
+    {
+        // file timestamps follow the file, even when read faster than real time
+        frame->m_timestamp = driverTimestamp;
+    }
+    else if (driverTimestamp != FrameClock::time_point())
+    {
+        if ((driverTimestamp <= now) && (driverTimestamp > m_lastTimestamp) &&
+                ((now - driverTimestamp) < std::chrono::milliseconds(MAX_DRIVER_TIMESTAMP_AGE_MS)))
+        {
+            frame->m_timestamp = driverTimestamp;
+        }
+    }
+    frame->m_wallClockMsecs = wallClockNow -
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - frame->m_timestamp).count();
+
+    FrameClock::duration interval = frame->m_timestamp - m_lastTimestamp;
+    if ((interval > FrameClock::duration::zero()) && (interval < std::chrono::milliseconds(MAX_FRAME_INTERVAL_MS)))
+    {
+        qint64 intervalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+        qint64 average = m_frameIntervalNs.load(std::memory_order_relaxed);
+        average = (average == 0) ? intervalNs : average + (intervalNs - average) / FRAME_INTERVAL_SMOOTHING;
+        m_frameIntervalNs.store(average, std::memory_order_relaxed);
+    }
+    m_lastTimestamp = frame->m_timestamp;
+}
+
+double Camera::frameRate()
+{
+    qint64 intervalNs = m_frameIntervalNs.load(std::memory_order_relaxed);
+    return (intervalNs > 0) ? (1e9 / intervalNs) : 0;
+}
+
+void Camera::publishFrame(const CameraFramePtr& frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_latestFrameMutex);
+        m_latestFrame = frame;
+    }
+    m_latestFrameCond.notify_all();
+
+    bool freeRunning = m_backend && m_backend->isFreeRunning();
+    std::lock_guard<std::mutex> lock(m_subscriberMutex);
+    for (FrameSubscriber* subscriber : m_subscribers)
+    {
+        if (freeRunning && subscriber->pacesSource())
+        {
+            while (m_capturing && !subscriber->publish(frame, PUBLISH_WAIT_MS))
+            {
+            }
+        }
+        else
+        {
+            // e.g. pre-roll compressing frames must not slow down reading a file
+            subscriber->publish(frame);
+        }
+    }
+}
+
+void Camera::waitPacingSubscriber()
+{
+    while (m_capturing)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_subscriberMutex);
+            if (std::any_of(m_subscribers.begin(), m_subscribers.end(),
+                            [](FrameSubscriber* subscriber) { return subscriber->pacesSource(); }))
+            {
+                return;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void Camera::waitSubscribersDrained()
+{
+    while (m_capturing)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_subscriberMutex);
+            if (std::all_of(m_subscribers.begin(), m_subscribers.end(),
+                            [](FrameSubscriber* subscriber) {
+                                return !subscriber->pacesSource() || (subscriber->count() == 0); }))
+            {
+                return;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
 /*
- * Get current frame 
+ * Get newest frame
  */
 cv::Mat Camera::getWebcamFrame()
 {
-    if (m_webcam) {
-        mutex.lock();
-        m_webcam->read(videoFrame);
-        mutex.unlock();
+    CameraFramePtr frame = latestFrame();
+    if (!frame)
+    {
+        return cv::Mat();
+    }
+    return frame->bgrImage();
+}
+
+CameraFramePtr Camera::latestFrame()
+{
+    std::unique_lock<std::mutex> lock(m_latestFrameMutex);
+    if (!m_latestFrame && m_initialized)
+    {
+        m_latestFrameCond.wait_for(lock, std::chrono::milliseconds(FIRST_FRAME_TIMEOUT_MS),
+                                   [this]() { return (bool)m_latestFrame; });
+    }
+    return m_latestFrame;
+}
+
+FrameSubscriber* Camera::subscribe(FrameSubscriber::DeliveryMode mode, int capacity, bool pacesSource)
+{
+    FrameSubscriber* subscriber = new FrameSubscriber(mode, capacity, pacesSource);
+    std::lock_guard<std::mutex> lock(m_subscriberMutex);
+    m_subscribers.push_back(subscriber);
+    return subscriber;
+}
+
+void Camera::unsubscribe(FrameSubscriber* subscriber)
+{
+    if (!subscriber)
+    {
+        return;
+    }
+    // stop first, capture thread may be waiting for this subscriber while holding m_subscriberMutex
+    subscriber->stopWait();
+    {
+        std::lock_guard<std::mutex> lock(m_subscriberMutex);
+        m_subscribers.erase(std::remove(m_subscribers.begin(), m_subscribers.end(), subscriber),
+                            m_subscribers.end());
     }
-    return videoFrame;
+    delete subscriber;
 }
 
 /*
@@ -89,11 +330,11 @@ cv::Mat Camera::getWebcamFrame()
  */
 bool Camera::isWebcamOpen()
 {
-    if (!m_webcam)
+    if (!m_backend)
     {
         return false;
     }
-    return m_webcam->isOpened();
+    return m_backend->isOpened();
 }
 
 int Camera::index()
@@ -103,13 +344,14 @@ int Camera::index()
 
 bool Camera::queryAvailableResolutions()
 {
-    if (!m_cameraInfo->isInitialized())
+    if (!m_cameraInfo->isInitialized() && !m_cameraInfo->initFromDeviceInfo())
     {
-        // first release current cv::VideoCapture
+        // no cached or driver given information, resolutions need to be probed:
+        // first release the camera device
         this->release();
-        // CameraInfo::init() will reserve cv::VideoCapture and do the query
+        // CameraInfo::init() will reserve the device with cv::VideoCapture and do the query
         m_cameraInfo->init();
-        // now can continue using own cv::VideoCapture
+        // now can continue using own capture backend
         this->init();
     }
     return true;
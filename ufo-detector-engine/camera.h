@@ -20,18 +20,30 @@
 #define CAMERA_H
 
 #include "camerainfo.h"
+#include "cameraframe.h"
+#include "capturebackend.h"
+#include "framesubscriber.h"
 #include <opencv2/highgui/highgui.hpp>
 #include <mutex>
+#include <condition_variable>
 #include <thread>
 #include <atomic>
 #include <memory>
+#include <vector>
 #include <QObject>
 #include <iostream>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <QDebug>
+#include <QDateTime>
 
 /**
- * @brief Main camera class to handle reading of frames from multiple threads
+ * @brief Main camera class to distribute frames to multiple threads
+ *
+ * A single capture thread reads the camera and publishes each frame once to
+ * all subscribers (see subscribe()), so all consumers see the same frames.
+ * Frames are read with a CaptureBackend: OpenCV VideoCapture by default, or
+ * V4L2 directly in Linux (see V4l2CaptureBackend). Instead of a camera, frames
+ * can also be read from a video file or an image directory, see setInputFile().
  *
  * @todo add setResolution(width, height) method to apply resolution change on-the-fly
  */
@@ -45,13 +57,32 @@ public:
      * @param index camera index as used by OpenCV
      * @param width camera frame width
      * @param height camera frame height
+     * @param backend capture backend: "opencv" or "v4l2" (Linux only)
+     * @param pixelFormat four character code of the pixel format requested by "v4l2" backend
      * Note that given resolution (width * height) may not be supported, but normally
      * you will get nearest supported resolution anyway.
      */
-    Camera(int index, int width, int height);
+    Camera(int index, int width, int height, QString backend = "opencv", QString pixelFormat = "YUYV");
+
+    ~Camera();
+
+    /**
+     * @brief Read frames from a video file or an image directory instead of the camera.
+     * Call before init(). Frames are scaled to camera width and height if needed.
+     *
+     * In free-running mode frames are read as fast as the subscribers pacing the source
+     * (see subscribe()) take them, and those get every frame; capturing starts when the
+     * first of them comes. Other subscribers get the frames they have room for.
+     * In real-time mode frames are read at the frame rate of the file.
+     * endOfStream() is emitted when all frames have been read.
+     *
+     * @param fileName video file or image directory
+     * @param realTime true for real-time mode, false for free-running mode
+     */
+    void setInputFile(QString fileName, bool realTime);
 
     /**
-     * @brief Initialize and open camera.
+     * @brief Initialize and open camera. Starts the capture thread.
      * @return true if initialization was successful, false if it failed
      */
     bool init();
@@ -63,15 +94,47 @@ public:
     bool isInitialized();
 
     /**
-     * @brief Stop and close camera.
+     * @brief Stop capture thread and close camera.
      */
     void release();
 
     /**
-     * @brief Get the current/newest frame from camera.
-     * @return
+     * @brief Get the newest frame from camera. Waits for the first frame after init().
+     * The image is BGR and may be shared with other frame consumers, so clone it before modifying.
+     * Use subscribe() for continuous frame reading.
+     * @return newest frame, or empty image if there is no frame
      */
     cv::Mat getWebcamFrame();
+
+    /**
+     * @brief Get the newest frame from camera. Waits for the first frame after init().
+     * Prefer this over getWebcamFrame() when only luma is needed, see CameraFrame::luma().
+     * @return newest frame, or NULL if there is no frame
+     */
+    CameraFramePtr latestFrame();
+
+    /**
+     * @brief Subscribe to camera frames.
+     * @param mode frame delivery mode
+     * @param capacity frame queue capacity in FrameSubscriber::EveryFrame mode
+     * @param pacesSource whether a free running source waits for the subscriber, e.g. the detector
+     * @return new subscriber which must be removed with unsubscribe()
+     */
+    FrameSubscriber* subscribe(FrameSubscriber::DeliveryMode mode, int capacity = 1, bool pacesSource = false);
+
+    /**
+     * @brief Frame rate measured from recent capture timestamps. Follows changes of the
+     * actual rate, e.g. when exposure time limits it in the dark.
+     * @return frames per second, or 0 if not known yet
+     */
+    double frameRate();
+
+    /**
+     * @brief Remove and delete frame subscriber.
+     * @param subscriber subscriber returned by subscribe()
+     */
+    void unsubscribe(FrameSubscriber* subscriber);
+
     bool isWebcamOpen();
 
     /**
@@ -101,15 +164,74 @@ public:
 #ifndef _UNIT_TEST_
 private:
 #endif
+    const int FIRST_FRAME_TIMEOUT_MS = 1000;   ///< how long latestFrame() waits for the first frame
+    const int READ_ERROR_PAUSE_MS = 100;        ///< pause after failed frame read
+    const int MAX_DRIVER_TIMESTAMP_AGE_MS = 1000;   ///< older driver timestamps are considered bogus
+    const int PUBLISH_WAIT_MS = 100;            ///< interval at which run flag is checked while waiting subscribers
+    const int MAX_FRAME_INTERVAL_MS = 2000;     ///< longer gaps between frames are not counted in frame rate
+    const int FRAME_INTERVAL_SMOOTHING = 16;    ///< frame interval average follows 1/N of each change
+
     int m_index;    ///< camera index as used by OpenCV
     int m_width;
     int m_height;
-    cv::VideoCapture* m_webcam;
-    cv::Mat videoFrame;
-    std::mutex mutex;
+    QString m_backendName;  ///< capture backend name given to constructor
+    QString m_pixelFormat;  ///< pixel format given to constructor
+    QString m_inputFileName;    ///< video file or image directory to read instead of camera, if not empty
+    bool m_inputRealTime;       ///< whether to read input file at its frame rate
+    CaptureBackend* m_backend;
     CameraInfo* m_cameraInfo;
     bool m_initialized;     ///< whether camera is initialized or not
 
+    std::unique_ptr<std::thread> m_captureThread;
+    std::atomic<bool> m_capturing;      ///< capture thread run enabled
+    quint64 m_frameCounter;             ///< number of captured frames, used as frame sequence number
+    FrameClock::time_point m_lastTimestamp; ///< capture time of previous frame
+    std::atomic<qint64> m_frameIntervalNs;  ///< moving average of capture intervals, 0 if not known
+    std::vector<FrameSubscriber*> m_subscribers;
+    std::mutex m_subscriberMutex;       ///< guards m_subscribers
+    CameraFramePtr m_latestFrame;       ///< newest captured frame
+    std::mutex m_latestFrameMutex;      ///< guards m_latestFrame
+    std::condition_variable m_latestFrameCond;
+
+    /**
+     * @brief Create capture backend according to m_backendName.
+     * @return new backend, falls back to OpenCV backend if the requested one is not available
+     */
+    CaptureBackend* createBackend();
+
+    /**
+     * @brief Capture thread: the only place reading frames from the camera device.
+     * @param unsubscribedFrame frame read before there were subscribers, published when the
+     * first subscriber pacing a free running source comes. May be empty.
+     */
+    void captureThread(CameraFramePtr unsubscribedFrame);
+
+    /**
+     * @brief Set capture timestamps of a frame which was just read.
+     * Uses the buffer timestamp given by the capture backend when it's available
+     * and plausible, otherwise the current time of FrameClock.
+     * @param frame
+     */
+    void setCaptureTime(CameraFrame* frame);
+
+    /**
+     * @brief Give frame to all subscribers.
+     * With a free-running source waits until each subscriber pacing it has space for the frame.
+     * @param frame
+     */
+    void publishFrame(const CameraFramePtr& frame);
+
+    /**
+     * @brief Wait until there is at least one subscriber pacing the source, or capturing is stopped.
+     */
+    void waitPacingSubscriber();
+
+    /**
+     * @brief Wait until subscribers pacing the source have taken all published frames,
+     * or capturing is stopped.
+     */
+    void waitSubscribersDrained();
+
 signals:
     /**
      * @brief Emitted when querying available resolutions progresses.
@@ -117,6 +239,11 @@ signals:
      */
     void queryProgressChanged(int percent);
 
+    /**
+     * @brief Emitted from the capture thread when an input file has no more frames.
+     */
+    void endOfStream();
+
 };
 
 #endif // CAMERA_H
@@ -0,0 +1,320 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cameraframe.h"
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#include <cstring>
+#endif
+#include <QDebug>
+
+CameraFrame::CameraFrame()
+{
+    m_pixelFormat = BGR;
+    m_sequenceNumber = 0;
+    m_wallClockMsecs = 0;
+    m_scaledLumaDivisor = 0;
+}
+
+cv::Mat CameraFrame::bgrImage() const
+{
+    if (m_pixelFormat == BGR)
+    {
+        return m_image;
+    }
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    if (!m_bgrCache.empty())
+    {
+        return m_bgrCache;
+    }
+    switch (m_pixelFormat)
+    {
+    case YUYV:
+        cv::cvtColor(m_image, m_bgrCache, CV_YUV2BGR_YUYV);
+        break;
+    case GREY:
+        cv::cvtColor(m_image, m_bgrCache, CV_GRAY2BGR);
+        break;
+    case NV12:
+        cv::cvtColor(m_image, m_bgrCache, CV_YUV2BGR_NV12);
+        break;
+    case MJPEG:
+        m_bgrCache = cv::imdecode(m_image, cv::IMREAD_COLOR);
+        break;
+    default:
+        break;
+    }
+    return m_bgrCache;
+}
+
+cv::Mat CameraFrame::bgrImageCopy() const
+{
+    return bgrImage().clone();
+}
+
+cv::Mat CameraFrame::luma() const
+{
+    switch (m_pixelFormat)
+    {
+    case GREY:
+        return m_image;
+    case NV12:
+        // Y plane is in the first rows
+        return m_image.rowRange(0, m_image.rows * 2 / 3);
+    default:
+        break;
+    }
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    if (!m_lumaCache.empty())
+    {
+        return m_lumaCache;
+    }
+    switch (m_pixelFormat)
+    {
+    case BGR:
+        // same conversion as detection has always used, so that thresholds keep their meaning
+        cv::cvtColor(m_image, m_lumaCache, CV_RGB2GRAY);
+        break;
+    case YUYV:
+        // Y is every other byte
+        cv::extractChannel(m_image, m_lumaCache, 0);
+        break;
+    case MJPEG:
+        // decoder gives Y without making the color image
+        m_lumaCache = cv::imdecode(m_image, cv::IMREAD_GRAYSCALE);
+        break;
+    default:
+        break;
+    }
+    return m_lumaCache;
+}
+
+cv::Mat CameraFrame::lumaScaled(int divisor) const
+{
+    if (divisor <= 1)
+    {
+        return luma();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        if (!m_scaledLumaCache.empty() && (m_scaledLumaDivisor == divisor))
+        {
+            return m_scaledLumaCache;
+        }
+    }
+
+    cv::Mat scaled;
+    if ((m_pixelFormat == MJPEG) && ((divisor == 2) || (divisor == 4) || (divisor == 8)))
+    {
+        scaled = decodeJpegLumaScaled(m_image, divisor);
+    }
+    if (scaled.empty())
+    {
+        cv::Mat fullLuma = luma();
+        if (fullLuma.empty())
+        {
+            return fullLuma;
+        }
+        cv::Size scaledSize((fullLuma.cols + divisor - 1) / divisor, (fullLuma.rows + divisor - 1) / divisor);
+        cv::resize(fullLuma, scaled, scaledSize, 0, 0, cv::INTER_AREA);
+    }
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_scaledLumaCache = scaled;
+    m_scaledLumaDivisor = divisor;
+    return m_scaledLumaCache;
+}
+
+cv::Mat CameraFrame::lumaRegion(const cv::Rect& rect) const
+{
+    if (m_pixelFormat == MJPEG)
+    {
+        bool decoded = false;
+        {
+            std::lock_guard<std::mutex> lock(m_cacheMutex);
+            decoded = !m_lumaCache.empty();
+        }
+        if (!decoded)
+        {
+            cv::Mat region = decodeJpegLumaRegion(m_image, rect);
+            if (!region.empty())
+            {
+                return region;
+            }
+        }
+    }
+    cv::Mat fullLuma = luma();
+    return fullLuma(rect & cv::Rect(0, 0, fullLuma.cols, fullLuma.rows));
+}
+
+#ifdef HAVE_TURBOJPEG
+namespace {
+struct HandleDeleter {
+    void operator()(void* handle) { tjDestroy(handle); }
+};
+
+/**
+ * @brief Decompressor handle of the calling thread, made on first use.
+ */
+tjhandle threadDecompressor()
+{
+    thread_local std::unique_ptr<void, HandleDeleter> handle(tjInitDecompress());
+    return handle.get();
+}
+
+/**
+ * @brief Lossless transformer handle of the calling thread, made on first use.
+ */
+tjhandle threadTransformer()
+{
+    thread_local std::unique_ptr<void, HandleDeleter> handle(tjInitTransform());
+    return handle.get();
+}
+}
+#endif
+
+cv::Mat CameraFrame::decodeJpegLumaScaled(const cv::Mat& jpeg, int divisor)
+{
+    cv::Mat scaled;
+#ifdef HAVE_TURBOJPEG
+    tjhandle decompressor = threadDecompressor();
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    int colorspace = 0;
+    unsigned char* jpegData = const_cast<unsigned char*>(jpeg.ptr<unsigned char>());
+    unsigned long jpegSize = jpeg.total() * jpeg.elemSize();
+
+    if (decompressor &&
+        (tjDecompressHeader3(decompressor, jpegData, jpegSize, &width, &height, &subsampling, &colorspace) == 0))
+    {
+        // scaling happens in the IDCT, so the full size image is never made
+        tjscalingfactor factor = {1, divisor};
+        scaled.create(TJSCALED(height, factor), TJSCALED(width, factor), CV_8UC1);
+        if (tjDecompress2(decompressor, jpegData, jpegSize, scaled.data, scaled.cols, scaled.step,
+                          scaled.rows, TJPF_GRAY, TJFLAG_FASTDCT) == 0)
+        {
+            return scaled;
+        }
+    }
+    qWarning() << "CameraFrame: JPEG decoding failed:" << tjGetErrorStr();
+    scaled.release();
+#elif (CV_MAJOR_VERSION > 3) || ((CV_MAJOR_VERSION == 3) && (CV_MINOR_VERSION >= 2))
+    // OpenCV asks the JPEG decoder to scale as well
+    switch (divisor)
+    {
+    case 2:
+        scaled = cv::imdecode(jpeg, cv::IMREAD_REDUCED_GRAYSCALE_2);
+        break;
+    case 4:
+        scaled = cv::imdecode(jpeg, cv::IMREAD_REDUCED_GRAYSCALE_4);
+        break;
+    case 8:
+        scaled = cv::imdecode(jpeg, cv::IMREAD_REDUCED_GRAYSCALE_8);
+        break;
+    default:
+        break;
+    }
+#else
+    // no reduced decoding in older OpenCV, lumaScaled() decodes the full image and resizes it
+    Q_UNUSED(jpeg);
+    Q_UNUSED(divisor);
+#endif
+    return scaled;
+}
+
+cv::Mat CameraFrame::decodeJpegLumaRegion(const cv::Mat& jpeg, const cv::Rect& rect)
+{
+    cv::Mat region;
+#ifdef HAVE_TURBOJPEG
+    tjhandle decompressor = threadDecompressor();
+    tjhandle transformer = threadTransformer();
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    int colorspace = 0;
+    unsigned char* jpegData = const_cast<unsigned char*>(jpeg.ptr<unsigned char>());
+    unsigned long jpegSize = jpeg.total() * jpeg.elemSize();
+
+    if (!decompressor || !transformer ||
+        (tjDecompressHeader3(decompressor, jpegData, jpegSize, &width, &height, &subsampling, &colorspace) != 0) ||
+        (subsampling < 0) || (subsampling >= TJ_NUMSAMP))
+    {
+        return region;
+    }
+    cv::Rect target = rect & cv::Rect(0, 0, width, height);
+    if (target.area() == 0)
+    {
+        return region;
+    }
+
+    // lossless crop of the compressed image, it must start at a block boundary
+    tjtransform transform;
+    memset(&transform, 0, sizeof(transform));
+    transform.r.x = target.x / tjMCUWidth[subsampling] * tjMCUWidth[subsampling];
+    transform.r.y = target.y / tjMCUHeight[subsampling] * tjMCUHeight[subsampling];
+    transform.r.w = target.x + target.width - transform.r.x;
+    transform.r.h = target.y + target.height - transform.r.y;
+    transform.op = TJXOP_NONE;
+    transform.options = TJXOPT_CROP | TJXOPT_GRAY;
+    unsigned char* croppedData = NULL;
+    unsigned long croppedSize = 0;
+
+    if ((tjTransform(transformer, jpegData, jpegSize, 1, &croppedData, &croppedSize, &transform, 0) == 0) &&
+        (tjDecompressHeader3(decompressor, croppedData, croppedSize, &width, &height, &subsampling, &colorspace) == 0))
+    {
+        // only the blocks of the region go through IDCT
+        cv::Mat cropped(height, width, CV_8UC1);
+        if (tjDecompress2(decompressor, croppedData, croppedSize, cropped.data, cropped.cols, cropped.step,
+                          cropped.rows, TJPF_GRAY, 0) == 0)
+        {
+            region = cropped(cv::Rect(target.x - transform.r.x, target.y - transform.r.y, target.width, target.height)
+                             & cv::Rect(0, 0, cropped.cols, cropped.rows));
+        }
+    }
+    if (region.empty())
+    {
+        qWarning() << "CameraFrame: JPEG region decoding failed:" << tjGetErrorStr();
+    }
+    tjFree(croppedData);
+#else
+    // OpenCV decodes only whole images
+    Q_UNUSED(jpeg);
+    Q_UNUSED(rect);
+#endif
+    return region;
+}
+
+cv::Size CameraFrame::size() const
+{
+    switch (m_pixelFormat)
+    {
+    case NV12:
+        return cv::Size(m_image.cols, m_image.rows * 2 / 3);
+    case MJPEG:
+        return cv::Size();
+    default:
+        return m_image.size();
+    }
+}
@@ -0,0 +1,135 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CAMERAFRAME_H
+#define CAMERAFRAME_H
+
+#include <QtGlobal>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Monotonic clock used for frame capture timestamps.
+ */
+typedef std::chrono::steady_clock FrameClock;
+
+/**
+ * @brief A single frame captured by Camera.
+ *
+ * Each frame is captured once and shared by all frame subscribers through
+ * CameraFramePtr. The image is shared as well, so clone it before modifying.
+ *
+ * Depending on the capture backend the image is either BGR or in the native
+ * pixel format of the camera, and it may point directly into a driver buffer
+ * which is kept reserved by m_buffer. Such an image is valid only as long as
+ * the frame exists, so consumers normally use luma(), bgrImage() or bgrImageCopy().
+ * Detection needs only luma(), so the BGR image is made only when someone asks
+ * for it, and only once per frame.
+ */
+struct CameraFrame {
+    /**
+     * @brief Pixel format of m_image.
+     */
+    enum PixelFormat {
+        BGR = 0,    ///< CV_8UC3, BGR
+        YUYV,       ///< CV_8UC2, packed YUV 4:2:2
+        GREY,       ///< CV_8UC1, luma only
+        NV12,       ///< CV_8UC1 with height * 3 / 2 rows, Y plane followed by interleaved UV plane
+        MJPEG       ///< CV_8UC1 with one row, a compressed JPEG image
+    };
+
+    CameraFrame();
+
+    /**
+     * @brief Frame image in BGR format. Converted on first call if the image isn't BGR already.
+     * @return BGR image, shared with the frame
+     */
+    cv::Mat bgrImage() const;
+
+    /**
+     * @brief Frame image in BGR format, not shared with anyone.
+     * @return BGR image which can be modified freely
+     */
+    cv::Mat bgrImageCopy() const;
+
+    /**
+     * @brief Frame luma (grayscale) image. This is the Y plane of YUV frames,
+     * taken without color conversion. Made on first call when it isn't available as such.
+     * @return CV_8UC1 image, shared with the frame and valid only as long as the frame exists
+     */
+    cv::Mat luma() const;
+
+    /**
+     * @brief Frame luma image reduced in size. JPEG frames are decoded directly to the
+     * reduced size, which is much faster than decoding the full frame.
+     * @param divisor 1, 2, 4 or 8. Result size is frame size divided by this, rounded up.
+     * @return CV_8UC1 image, shared with the frame
+     */
+    cv::Mat lumaScaled(int divisor) const;
+
+    /**
+     * @brief Full resolution luma of a frame region, e.g. of a detected object. With libjpeg-turbo
+     * a JPEG frame is decoded only for the region, extended to whole JPEG blocks.
+     * @param rect region in frame coordinates, clipped to the frame
+     * @return CV_8UC1 image, may be shared with the frame so don't modify it
+     */
+    cv::Mat lumaRegion(const cv::Rect& rect) const;
+
+    /**
+     * @brief Frame width and height in pixels.
+     * @return frame size, or 0x0 for MJPEG frames which haven't been decoded
+     */
+    cv::Size size() const;
+
+    cv::Mat m_image;            ///< captured image, in m_pixelFormat
+    PixelFormat m_pixelFormat;  ///< pixel format of m_image
+    std::shared_ptr<void> m_buffer; ///< capture buffer which m_image refers to, if any; released with the frame
+    quint64 m_sequenceNumber;   ///< running number of the frame, first captured frame is 1
+    FrameClock::time_point m_timestamp; ///< monotonic capture time, from camera driver if available
+    qint64 m_wallClockMsecs;    ///< capture time as milliseconds since epoch, matching m_timestamp
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    mutable std::mutex m_cacheMutex;    ///< guards m_bgrCache, m_lumaCache and m_scaledLumaCache
+    mutable cv::Mat m_bgrCache;         ///< converted BGR image, if m_image is not BGR
+    mutable cv::Mat m_lumaCache;        ///< luma image, if it's not a plane of m_image
+    mutable cv::Mat m_scaledLumaCache;  ///< reduced luma image of lumaScaled()
+    mutable int m_scaledLumaDivisor;    ///< divisor of m_scaledLumaCache
+
+    /**
+     * @brief Decode JPEG image to reduced size grayscale image.
+     * @param divisor 2, 4 or 8
+     * @return decoded image, or empty image on error
+     */
+    static cv::Mat decodeJpegLumaScaled(const cv::Mat& jpeg, int divisor);
+
+    /**
+     * @brief Decode region of JPEG image to grayscale image.
+     * @param rect region, clipped to the image
+     * @return decoded region, or empty image on error or if decoding a region isn't supported
+     */
+    static cv::Mat decodeJpegLumaRegion(const cv::Mat& jpeg, const cv::Rect& rect);
+};
+
+typedef std::shared_ptr<const CameraFrame> CameraFramePtr;
+
+#endif // CAMERAFRAME_H
@@ -17,6 +17,17 @@
  */
 
 #include "camerainfo.h"
+#include <QSettings>
+#include <QStandardPaths>
+#include <QFile>
+#ifdef Q_OS_LINUX
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
 
 CameraInfo::CameraInfo(int cameraIndex, QObject *parent, int openCvBackend) : QObject(parent)
 {
@@ -218,16 +229,24 @@ CameraInfo::CameraInfo(int cameraIndex, QObject *parent, int openCvBackend) : QO
 #endif
 
     m_initialized = false;
+    m_queryMethod = NotQueried;
+    m_cacheFileName = defaultCacheFileName();
     updateAspectRatios();
 }
 
 bool CameraInfo::init() {
+    if (initFromDeviceInfo()) {
+        return true;
+    }
     bool ok = false;
     m_webCamera = new cv::VideoCapture(m_cameraIndex + m_cameraBackend);
     if (m_webCamera && m_webCamera->open(m_cameraIndex)) {
         ok = queryResolutions();
         if (!ok) {
             qDebug() << "Querying web camera resolutions failed";
+        } else {
+            m_queryMethod = Probing;
+            writeCache();
         }
         m_webCamera->release();
     } else {
@@ -239,6 +258,24 @@ bool CameraInfo::init() {
     return ok;
 }
 
+bool CameraInfo::initFromDeviceInfo() {
+    m_deviceKey = queryDeviceKey();
+    if (readCache()) {
+        qDebug() << "Web camera resolutions read from cache" << m_cacheFileName;
+        m_queryMethod = Cache;
+    } else if (enumerateResolutions()) {
+        qDebug() << "Web camera resolutions listed by the driver";
+        m_queryMethod = Enumeration;
+        writeCache();
+    } else {
+        return false;
+    }
+    updateAspectRatios();
+    m_initialized = true;
+    emit queryProgressChanged(100);
+    return true;
+}
+
 bool CameraInfo::isInitialized() {
     return m_initialized;
 }
@@ -247,10 +284,221 @@ QList<QSize> CameraInfo::availableResolutions() {
     return m_availableResolutions;
 }
 
+QList<double> CameraInfo::frameRates(QSize resolution) {
+    return m_frameRates.value(qMakePair(resolution.width(), resolution.height()));
+}
+
+void CameraInfo::setCacheFileName(QString fileName) {
+    m_cacheFileName = fileName;
+}
+
+// static
+QString CameraInfo::defaultCacheFileName() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/camerainfo.ini";
+}
+
 QList<int> CameraInfo::knownAspectRatios() {
     return m_knownAspectRatios;
 }
 
+void CameraInfo::addResolution(QSize resolution, QList<double> frameRates) {
+    if (!m_availableResolutions.contains(resolution)) {
+        m_availableResolutions << resolution;
+    }
+    QList<double>& rates = m_frameRates[qMakePair(resolution.width(), resolution.height())];
+    foreach (double rate, frameRates) {
+        if (!rates.contains(rate)) {
+            rates << rate;
+        }
+    }
+    std::sort(rates.begin(), rates.end(), std::greater<double>());
+}
+
+#ifdef Q_OS_LINUX
+static int xioctl(int fd, unsigned long request, void* arg)
+{
+    int result;
+    do {
+        result = ioctl(fd, request, arg);
+    } while ((result == -1) && (errno == EINTR));
+    return result;
+}
+
+/*
+ * Frame rates of a frame size as listed by VIDIOC_ENUM_FRAMEINTERVALS
+ */
+static QList<double> enumerateFrameRates(int fd, quint32 pixelFormat, int width, int height)
+{
+    QList<double> frameRates;
+    struct v4l2_frmivalenum interval;
+    memset(&interval, 0, sizeof(interval));
+    interval.pixel_format = pixelFormat;
+    interval.width = width;
+    interval.height = height;
+
+    while (xioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0) {
+        if (interval.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+            if (interval.discrete.numerator) {
+                frameRates << (double)interval.discrete.denominator / interval.discrete.numerator;
+            }
+        } else {
+            // continuous or stepwise range: give the limits
+            if (interval.stepwise.min.numerator) {
+                frameRates << (double)interval.stepwise.min.denominator / interval.stepwise.min.numerator;
+            }
+            if (interval.stepwise.max.numerator) {
+                frameRates << (double)interval.stepwise.max.denominator / interval.stepwise.max.numerator;
+            }
+            break;
+        }
+        interval.index++;
+    }
+    return frameRates;
+}
+#endif
+
+bool CameraInfo::enumerateResolutions() {
+#ifdef Q_OS_LINUX
+    QString deviceName = QString("/dev/video%1").arg(m_cameraIndex);
+    int fd = ::open(deviceName.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (fd == -1) {
+        qDebug() << "CameraInfo: cannot open" << deviceName << strerror(errno);
+        return false;
+    }
+
+    struct v4l2_fmtdesc formatDescription;
+    memset(&formatDescription, 0, sizeof(formatDescription));
+    formatDescription.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    // resolutions of all pixel formats are combined
+    while (xioctl(fd, VIDIOC_ENUM_FMT, &formatDescription) == 0) {
+        struct v4l2_frmsizeenum frameSize;
+        memset(&frameSize, 0, sizeof(frameSize));
+        frameSize.pixel_format = formatDescription.pixelformat;
+
+        while (xioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frameSize) == 0) {
+            if (frameSize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                int width = frameSize.discrete.width;
+                int height = frameSize.discrete.height;
+                addResolution(QSize(width, height),
+                              enumerateFrameRates(fd, frameSize.pixel_format, width, height));
+            } else {
+                // continuous or stepwise range: take the common resolutions which fit in it
+                const struct v4l2_frmsize_stepwise& range = frameSize.stepwise;
+                int widthStep = qMax(1, (int)range.step_width);
+                int heightStep = qMax(1, (int)range.step_height);
+                QList<QSize> candidates = m_commonResolutions;
+                candidates << QSize(range.min_width, range.min_height) << QSize(range.max_width, range.max_height);
+                foreach (QSize resolution, candidates) {
+                    if ((resolution.width() >= (int)range.min_width) && (resolution.width() <= (int)range.max_width) &&
+                        (resolution.height() >= (int)range.min_height) && (resolution.height() <= (int)range.max_height) &&
+                        (((resolution.width() - range.min_width) % widthStep) == 0) &&
+                        (((resolution.height() - range.min_height) % heightStep) == 0))
+                    {
+                        addResolution(resolution, enumerateFrameRates(fd, frameSize.pixel_format,
+                                                                      resolution.width(), resolution.height()));
+                    }
+                }
+                break;
+            }
+            frameSize.index++;
+        }
+        formatDescription.index++;
+    }
+    ::close(fd);
+
+    std::sort(m_availableResolutions.begin(), m_availableResolutions.end(), CameraInfo::compareResolutionsWidthFirst);
+    return !m_availableResolutions.isEmpty();
+#else
+    return false;
+#endif
+}
+
+QString CameraInfo::queryDeviceKey() {
+    QString key;
+#ifdef Q_OS_LINUX
+    QString deviceName = QString("/dev/video%1").arg(m_cameraIndex);
+    int fd = ::open(deviceName.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (fd == -1) {
+        return key;
+    }
+    struct v4l2_capability capability;
+    memset(&capability, 0, sizeof(capability));
+    if (xioctl(fd, VIDIOC_QUERYCAP, &capability) == 0) {
+        key = QString::fromLatin1((const char*)capability.bus_info);
+    }
+    ::close(fd);
+    if (key.isEmpty()) {
+        return key;
+    }
+
+    // USB ids are in the USB device directory, above the interface directory of the video device
+    QString usbDeviceDir = QString("/sys/class/video4linux/video%1/device/../").arg(m_cameraIndex);
+    QFile vendorFile(usbDeviceDir + "idVendor");
+    QFile productFile(usbDeviceDir + "idProduct");
+    if (vendorFile.open(QIODevice::ReadOnly) && productFile.open(QIODevice::ReadOnly)) {
+        key += " " + QString::fromLatin1(vendorFile.readAll()).trimmed() + ":"
+                + QString::fromLatin1(productFile.readAll()).trimmed();
+    }
+#endif
+    return key;
+}
+
+bool CameraInfo::readCache() {
+    if (m_cacheFileName.isEmpty() || m_deviceKey.isEmpty() || !QFile::exists(m_cacheFileName)) {
+        return false;
+    }
+    QSettings cache(m_cacheFileName, QSettings::IniFormat);
+    QString group = m_deviceKey;
+    cache.beginGroup(group.replace('/', '_'));
+    // entries like 640x480@30,15
+    QStringList entries = cache.value("resolutions").toStringList();
+    cache.endGroup();
+
+    m_availableResolutions.clear();
+    m_frameRates.clear();
+    foreach (QString entry, entries) {
+        QStringList sizeAndRates = entry.split('@');
+        QStringList size = sizeAndRates.at(0).split('x');
+        if (size.size() != 2) {
+            continue;
+        }
+        QList<double> rates;
+        if (sizeAndRates.size() > 1) {
+            foreach (QString rate, sizeAndRates.at(1).split(',', QString::SkipEmptyParts)) {
+                rates << rate.toDouble();
+            }
+        }
+        addResolution(QSize(size.at(0).toInt(), size.at(1).toInt()), rates);
+    }
+    std::sort(m_availableResolutions.begin(), m_availableResolutions.end(), CameraInfo::compareResolutionsWidthFirst);
+    return !m_availableResolutions.isEmpty();
+}
+
+void CameraInfo::writeCache() {
+    if (m_cacheFileName.isEmpty() || m_deviceKey.isEmpty()) {
+        return;
+    }
+    QStringList entries;
+    foreach (QSize resolution, m_availableResolutions) {
+        QString entry = QString("%1x%2").arg(resolution.width()).arg(resolution.height());
+        QStringList rates;
+        foreach (double rate, frameRates(resolution)) {
+            rates << QString::number(rate);
+        }
+        if (!rates.isEmpty()) {
+            entry += "@" + rates.join(',');
+        }
+        entries << entry;
+    }
+    QSettings cache(m_cacheFileName, QSettings::IniFormat);
+    QString group = m_deviceKey;
+    cache.beginGroup(group.replace('/', '_'));
+    cache.setValue("resolutions", entries);
+    cache.endGroup();
+    cache.sync();
+}
+
 bool CameraInfo::queryResolutions() {
     int width = 0;
     int height = 0;
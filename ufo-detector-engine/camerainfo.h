@@ -25,6 +25,8 @@
 #include <list>     // for std::list::sort
 #include <algorithm>
 #include <QSize>
+#include <QMap>
+#include <QPair>
 #include <QDebug>
 
 /**
@@ -34,6 +36,16 @@ class CameraInfo : public QObject
 {
     Q_OBJECT
 public:
+    /**
+     * @brief How the available resolutions were found out.
+     */
+    enum QueryMethod {
+        NotQueried = 0,
+        Cache,          ///< read from cache file, camera was not accessed
+        Enumeration,    ///< listed by the camera driver (V4L2)
+        Probing         ///< each common resolution tried with OpenCV
+    };
+
     /**
      * @brief CameraInfo constructor.
      * @param cameraIndex index of camera as used by OpenCV
@@ -45,13 +57,21 @@ public:
     /**
      * @brief Initialize object.
      *
-     * NOTE: web camera must not be reserved when calling this method so release
-     * the camera first
+     * Resolutions are read from cache or listed by the camera driver if possible.
+     * Otherwise they are probed, and for that the web camera must not be reserved
+     * when calling this method, so release the camera first.
      *
      * @return true if initialization was successful, false otherwise
      */
     bool init();
 
+    /**
+     * @brief Initialize object from cache or by asking the camera driver, without probing.
+     * The camera can be in use while calling this.
+     * @return true if initialization was successful, false if init() is needed
+     */
+    bool initFromDeviceInfo();
+
     /**
      * @brief Check whether this instance of CameraInfo is initialized.
      * @return true if initialized, false otherwise
@@ -64,6 +84,25 @@ public:
      */
     QList<QSize> availableResolutions();
 
+    /**
+     * @brief Get frame rates supported in given resolution.
+     * @param resolution
+     * @return frame rates in descending order, empty if not known
+     */
+    QList<double> frameRates(QSize resolution);
+
+    /**
+     * @brief Set file for caching query results. Results are cached by the bus
+     * and USB vendor and product id of the camera.
+     * @param fileName file name, or empty to disable caching
+     */
+    void setCacheFileName(QString fileName);
+
+    /**
+     * @brief Default cache file in the cache directory of the application.
+     */
+    static QString defaultCacheFileName();
+
     /**
      * @brief Get list of known web camera aspect ratios.
      * @return
@@ -88,6 +127,10 @@ private:
     QList<QSize> m_commonResolutions;   ///< common resolutions from Wikipedia
     QList<int> m_knownAspectRatios;          ///< aspect ratios (*10,000) for common and available resolutions
     QList<QSize> m_availableResolutions;    ///< results of resolution querying
+    QMap<QPair<int, int>, QList<double> > m_frameRates; ///< frame rates by (width, height), if known
+    QString m_cacheFileName;    ///< query result cache file, empty if not cached
+    QString m_deviceKey;        ///< camera identifier used in the cache, empty if not known
+    QueryMethod m_queryMethod;
     bool m_initialized;
 
     /**
@@ -96,6 +139,26 @@ private:
      */
     bool queryResolutions();
 
+    /**
+     * @brief List resolutions and frame rates supported by the camera driver.
+     * @return true if any were found
+     */
+    bool enumerateResolutions();
+
+    /**
+     * @brief Add resolution and its frame rates to the query results.
+     */
+    void addResolution(QSize resolution, QList<double> frameRates = QList<double>());
+
+    /**
+     * @brief Camera identifier for the cache: bus info and USB VID:PID when available.
+     * @return identifier, or empty if the camera can't be identified
+     */
+    QString queryDeviceKey();
+
+    bool readCache();
+    void writeCache();
+
     /**
      * @brief Update aspect ratio list based on common and available resolutions.
      */
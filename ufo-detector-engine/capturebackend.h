@@ -0,0 +1,83 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CAPTUREBACKEND_H
+#define CAPTUREBACKEND_H
+
+#include "cameraframe.h"
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Interface for reading frames from a camera device.
+ *
+ * Camera owns one backend and calls readFrame() from its capture thread only.
+ */
+class CaptureBackend
+{
+public:
+    virtual ~CaptureBackend() {}
+
+    /**
+     * @brief Open camera device.
+     * @param width requested frame width
+     * @param height requested frame height
+     * @return true if the device was opened, false if it failed
+     */
+    virtual bool open(int width, int height) = 0;
+
+    /**
+     * @brief Close camera device. Frames which were already read stay valid.
+     */
+    virtual void close() = 0;
+
+    virtual bool isOpened() = 0;
+
+    /**
+     * @brief Read next frame from camera. Blocks until a frame is available,
+     * but at most for about one second.
+     * @param frame frame to fill in: image, pixel format, buffer and driver
+     * timestamp if the backend has one (left to zero otherwise)
+     * @return true if a frame was read, false on error or timeout
+     */
+    virtual bool readFrame(CameraFrame* frame) = 0;
+
+    /**
+     * @brief Frame size the device actually uses, which may differ from the requested one.
+     */
+    virtual cv::Size frameSize() = 0;
+
+    /**
+     * @brief Whether frames come from a live camera. Frames of other sources carry
+     * timestamps of their own which Camera uses as such.
+     */
+    virtual bool isLive() { return true; }
+
+    /**
+     * @brief Whether the source gives frames as fast as they are read. Camera then
+     * waits for subscribers to take each frame instead of dropping frames.
+     */
+    virtual bool isFreeRunning() { return false; }
+
+    /**
+     * @brief Whether the source has run out of frames, e.g. at the end of a video file.
+     */
+    virtual bool atEnd() { return false; }
+};
+
+#endif // CAPTUREBACKEND_H
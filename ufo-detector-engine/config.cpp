@@ -26,17 +26,35 @@ Config::Config(QObject *parent) : QObject(parent)
     m_settingKeys[Config::CameraWidth] = "cameraWidth";
     m_settingKeys[Config::CameraHeight] = "cameraHeight";
     m_settingKeys[Config::CheckCameraAspectRatio] = "checkCameraAspectRatio";
+    m_settingKeys[Config::CameraBackend] = "cameraBackend";
+    m_settingKeys[Config::CameraPixelFormat] = "cameraPixelFormat";
+    m_settingKeys[Config::CameraIndexes] = "cameraIndexes";
+    m_settingKeys[Config::WorkerThreads] = "workerThreads";
     m_settingKeys[Config::DetectionAreaFile] = "detectionAreaFile";
     m_settingKeys[Config::DetectionAreaSize] = "detectionAreaSize";
     m_settingKeys[Config::NoiseFilterPixelSize] = "noiseFilterPixelSize";
     m_settingKeys[Config::MotionThreshold] = "motionThreshold";
     m_settingKeys[Config::MinPositiveDetections] = "minPositiveDetections";
+    m_settingKeys[Config::DetectionDownscale] = "detectionDownscale";
     m_settingKeys[Config::BirdClassifierTrainingFile] = "birdClassifierTrainingFile";
     m_settingKeys[Config::ResultDataFile] = "resultDataFile";
     m_settingKeys[Config::ResultVideoDir] = "resultVideoDir";
     m_settingKeys[Config::ResultVideoCodec] = "resultVideoCodec";
     m_settingKeys[Config::ResultVideoWithObjectRectangles] = "resultVideoWithObjectRectangles";
+    m_settingKeys[Config::PrerollSeconds] = "prerollSeconds";
+    m_settingKeys[Config::PrerollMemoryMB] = "prerollMemoryMB";
+    m_settingKeys[Config::VideoBufferOverflowPolicy] = "videoBufferOverflowPolicy";
+    m_settingKeys[Config::VideoSegmentSeconds] = "videoSegmentSeconds";
+    m_settingKeys[Config::VideoFrameRate] = "videoFrameRate";
+    m_settingKeys[Config::VariableFrameRateVideo] = "variableFrameRateVideo";
+    m_settingKeys[Config::VideoSpoolSeconds] = "videoSpoolSeconds";
+    m_settingKeys[Config::VideoSpoolDir] = "videoSpoolDir";
+    m_settingKeys[Config::VideoStagingDir] = "videoStagingDir";
     m_settingKeys[Config::VideoEncoderLocation] = "videoEncoderLocation";
+    m_settingKeys[Config::EncoderMaxJobs] = "encoderMaxJobs";
+    m_settingKeys[Config::EncoderNiceness] = "encoderNiceness";
+    m_settingKeys[Config::EncoderIdleIo] = "encoderIdleIo";
+    m_settingKeys[Config::DeferVideoEncoding] = "deferVideoEncoding";
     m_settingKeys[Config::ResultImageDir] = "resultImageDir";
     m_settingKeys[Config::SaveResultImages] = "saveResultImages";
     m_settingKeys[Config::UserTokenAtUfoId] = "userTokenAtUfoId";
@@ -54,10 +72,14 @@ Config::Config(QObject *parent) : QObject(parent)
     m_defaultCameraWidth = 640;
     m_defaultCameraHeight = 480;
     m_defaultCheckCameraAspectRatio = true;
+    m_defaultCameraBackend = "opencv";
+    m_defaultCameraPixelFormat = "YUYV";
+    m_defaultWorkerThreads = 0;
 
     m_defaultNoiseFilterPixelSize = 2;
     m_defaultMotionThreshold = 10;
     m_defaultMinPositiveDetections = 2;
+    m_defaultDetectionDownscale = 1;
     m_defaultBirdClassifierFileName = QCoreApplication::applicationDirPath() + "/cascade.xml";
 
 #if defined (Q_OS_WIN)
@@ -72,7 +94,8 @@ Config::Config(QObject *parent) : QObject(parent)
 #endif
 
     m_videoCodecSupportInfo = new VideoCodecSupportInfo(m_defaultVideoEncoderLocation);
-    m_videoCodecSupportInfo->init();
+    // probing codecs takes seconds, results are cached for the same OpenCV and encoder
+    m_videoCodecSupportInfo->init(m_defaultDetectionDataDir + "/codecsupport.ini");
 
     m_defaultResultDataFileName = m_defaultDetectionDataDir + "/logs.xml";
     m_defaultResultDocumentDir = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)+"/UFO ID";
@@ -86,6 +109,20 @@ Config::Config(QObject *parent) : QObject(parent)
         m_defaultVideoCodecStr = "FFV1";
     }
     m_defaultResultVideoWithRectangles = false;
+    m_defaultPrerollSeconds = 10;
+    m_defaultPrerollMemoryMB = 64;
+    m_defaultVideoBufferOverflowPolicy = "coalesce";
+    m_defaultVideoSegmentSeconds = 60;
+    m_defaultVideoFrameRate = 0;
+    m_defaultVariableFrameRateVideo = false;
+    m_defaultVideoSpoolSeconds = 0;
+    // not the temp dir, that is often in RAM
+    m_defaultVideoSpoolDir = m_defaultDetectionDataDir;
+    m_defaultVideoStagingDir = "";
+    m_defaultEncoderMaxJobs = 1;
+    m_defaultEncoderNiceness = 10;
+    m_defaultEncoderIdleIo = true;
+    m_defaultDeferVideoEncoding = false;
     m_defaultResultImageDir = m_defaultResultDocumentDir + "/Images";
     m_defaultSaveResultImages = false;
 
@@ -125,6 +162,43 @@ bool Config::checkCameraAspectRatio() {
     return m_settings->value(m_settingKeys[Config::CheckCameraAspectRatio], m_defaultCheckCameraAspectRatio).toBool();
 }
 
+QString Config::cameraBackend() {
+    return m_settings->value(m_settingKeys[Config::CameraBackend], m_defaultCameraBackend).toString();
+}
+
+QString Config::cameraPixelFormat() {
+    return m_settings->value(m_settingKeys[Config::CameraPixelFormat], m_defaultCameraPixelFormat).toString();
+}
+
+QList<int> Config::cameraIndexes() {
+    QList<int> indexes;
+    QStringList indexList = m_settings->value(m_settingKeys[Config::CameraIndexes]).toString()
+            .split(",", QString::SkipEmptyParts);
+    foreach (QString index, indexList) {
+        bool ok = false;
+        int cameraIndex = index.trimmed().toInt(&ok);
+        if (ok && !indexes.contains(cameraIndex)) {
+            indexes << cameraIndex;
+        }
+    }
+    if (indexes.isEmpty()) {
+        indexes << cameraIndex();
+    }
+    return indexes;
+}
+
+int Config::workerThreads() {
+    return m_settings->value(m_settingKeys[Config::WorkerThreads], m_defaultWorkerThreads).toInt();
+}
+
+QVariant Config::cameraValue(int cameraIndex, SettingKeys key, QVariant defaultValue) {
+    QString cameraKey = "camera" + QString::number(cameraIndex) + "/" + m_settingKeys[key];
+    if (m_settings->contains(cameraKey)) {
+        return m_settings->value(cameraKey);
+    }
+    return m_settings->value(m_settingKeys[key], defaultValue);
+}
+
 QString Config::detectionAreaFile() {
     return m_settings->value(m_settingKeys[Config::DetectionAreaFile], m_defaultDetectionAreaFileName).toString();
 }
@@ -133,14 +207,35 @@ int Config::noiseFilterPixelSize() {
     return m_settings->value(m_settingKeys[Config::NoiseFilterPixelSize], m_defaultNoiseFilterPixelSize).toInt();
 }
 
+int Config::noiseFilterPixelSize(int cameraIndex) {
+    return cameraValue(cameraIndex, Config::NoiseFilterPixelSize, m_defaultNoiseFilterPixelSize).toInt();
+}
+
 int Config::motionThreshold() {
     return m_settings->value(m_settingKeys[Config::MotionThreshold], m_defaultMotionThreshold).toInt();
 }
 
+int Config::motionThreshold(int cameraIndex) {
+    return cameraValue(cameraIndex, Config::MotionThreshold, m_defaultMotionThreshold).toInt();
+}
+
 int Config::minPositiveDetections() {
     return m_settings->value(m_settingKeys[Config::MinPositiveDetections], m_defaultMinPositiveDetections).toInt();
 }
 
+int Config::minPositiveDetections(int cameraIndex) {
+    return cameraValue(cameraIndex, Config::MinPositiveDetections, m_defaultMinPositiveDetections).toInt();
+}
+
+int Config::detectionDownscale(int cameraIndex) {
+    int divisor = cameraValue(cameraIndex, Config::DetectionDownscale, m_defaultDetectionDownscale).toInt();
+    if ((divisor != 1) && (divisor != 2) && (divisor != 4) && (divisor != 8)) {
+        qWarning() << "Config: unsupported detectionDownscale" << divisor << ", using" << m_defaultDetectionDownscale;
+        return m_defaultDetectionDownscale;
+    }
+    return divisor;
+}
+
 QString Config::birdClassifierTrainingFile() {
     return m_defaultBirdClassifierFileName;
 }
@@ -158,17 +253,98 @@ QString Config::resultVideoCodecStr() {
 }
 
 int Config::resultVideoCodec() {
-    return m_videoCodecSupportInfo->stringToFourcc(this->resultVideoCodecStr());
+    QString codecStr = this->resultVideoCodecStr();
+    if (codecStr == AUTO_VIDEO_CODEC) {
+        int fps = (videoFrameRate() > 0) ? videoFrameRate() : VideoCodecSupportInfo::BENCHMARK_CAPTURE_FPS;
+        cv::Size frameSize(cameraWidth(), cameraHeight());
+        // benchmarked once for each resolution, the results are cached
+        QList<VideoCodecSupportInfo::CodecBenchmark> results = m_videoCodecSupportInfo->ensureBenchmark(frameSize);
+        int codec = VideoCodecSupportInfo::recommendedCodec(results, fps);
+        if (codec == 0) {
+            qWarning() << "Config: no video codec could be benchmarked at" << frameSize.width << "x"
+                       << frameSize.height << ", automatic codec is" << m_defaultVideoCodecStr;
+            codecStr = m_defaultVideoCodecStr;
+        } else {
+            codecStr = m_videoCodecSupportInfo->fourccToString(codec);
+            foreach (const VideoCodecSupportInfo::CodecBenchmark& result, results) {
+                if (result.m_fourcc == codec) {
+                    qDebug() << "Config: automatic video codec is" << codecStr << "at" << frameSize.width << "x"
+                             << frameSize.height << fps << "fps,"
+                             << ((result.m_fps >= fps * VideoCodecSupportInfo::BENCHMARK_HEADROOM)
+                                 ? "smallest output of the codecs fast enough"
+                                 : "fastest codec, none is fast enough")
+                             << "(" << result.m_fps << "fps," << result.m_bytesPerFrame << "bytes per frame )";
+                }
+            }
+        }
+    }
+    return m_videoCodecSupportInfo->stringToFourcc(codecStr);
 }
 
 bool Config::resultVideoWithObjectRectangles() {
     return m_settings->value(m_settingKeys[Config::ResultVideoWithObjectRectangles], m_defaultResultVideoWithRectangles).toBool();
 }
 
+int Config::prerollSeconds() {
+    return qMax(0, m_settings->value(m_settingKeys[Config::PrerollSeconds], m_defaultPrerollSeconds).toInt());
+}
+
+int Config::prerollMemoryMB() {
+    return qMax(0, m_settings->value(m_settingKeys[Config::PrerollMemoryMB], m_defaultPrerollMemoryMB).toInt());
+}
+
+QString Config::videoBufferOverflowPolicy() {
+    return m_settings->value(m_settingKeys[Config::VideoBufferOverflowPolicy], m_defaultVideoBufferOverflowPolicy).toString();
+}
+
+int Config::videoSegmentSeconds() {
+    return qMax(0, m_settings->value(m_settingKeys[Config::VideoSegmentSeconds], m_defaultVideoSegmentSeconds).toInt());
+}
+
+int Config::videoFrameRate() {
+    return qMax(0, m_settings->value(m_settingKeys[Config::VideoFrameRate], m_defaultVideoFrameRate).toInt());
+}
+
+bool Config::variableFrameRateVideo() {
+    return m_settings->value(m_settingKeys[Config::VariableFrameRateVideo], m_defaultVariableFrameRateVideo).toBool();
+}
+
+int Config::videoSpoolSeconds() {
+    return qMax(0, m_settings->value(m_settingKeys[Config::VideoSpoolSeconds], m_defaultVideoSpoolSeconds).toInt());
+}
+
+QString Config::videoSpoolDir() {
+    return m_settings->value(m_settingKeys[Config::VideoSpoolDir], m_defaultVideoSpoolDir).toString();
+}
+
+QString Config::videoStagingDir() {
+    return m_settings->value(m_settingKeys[Config::VideoStagingDir], m_defaultVideoStagingDir).toString();
+}
+
 QString Config::videoEncoderLocation() {
     return m_defaultVideoEncoderLocation;
 }
 
+int Config::encoderMaxJobs() {
+    return qMax(1, m_settings->value(m_settingKeys[Config::EncoderMaxJobs], m_defaultEncoderMaxJobs).toInt());
+}
+
+int Config::encoderNiceness() {
+    return qBound(0, m_settings->value(m_settingKeys[Config::EncoderNiceness], m_defaultEncoderNiceness).toInt(), 19);
+}
+
+bool Config::encoderIdleIo() {
+    return m_settings->value(m_settingKeys[Config::EncoderIdleIo], m_defaultEncoderIdleIo).toBool();
+}
+
+bool Config::deferVideoEncoding() {
+    return m_settings->value(m_settingKeys[Config::DeferVideoEncoding], m_defaultDeferVideoEncoding).toBool();
+}
+
+QString Config::encodingJobFile() {
+    return m_defaultDetectionDataDir + "/encodingjobs.ini";
+}
+
 QString Config::resultImageDir() {
     return m_settings->value(m_settingKeys[Config::ResultImageDir], m_defaultResultImageDir).toString();
 }
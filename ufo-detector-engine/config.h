@@ -28,6 +28,7 @@
 #include <QDebug>
 
 #define APPLICATION_VERSION "0.7.6"
+#define AUTO_VIDEO_CODEC "auto"     ///< resultVideoCodec setting to pick the codec by benchmark
 
 /**
  * @brief Global configuration variables for UFO-Detector
@@ -46,17 +47,35 @@ public:
         CameraWidth,
         CameraHeight,
         CheckCameraAspectRatio,
+        CameraBackend,
+        CameraPixelFormat,
+        CameraIndexes,
+        WorkerThreads,
         DetectionAreaFile,  // detection parameters
         DetectionAreaSize,
         NoiseFilterPixelSize,
         MotionThreshold,
         MinPositiveDetections,
+        DetectionDownscale,
         BirdClassifierTrainingFile,
         ResultDataFile,     // detection results
         ResultVideoDir,
         ResultVideoCodec,
         ResultVideoWithObjectRectangles,
+        PrerollSeconds,
+        PrerollMemoryMB,
+        VideoBufferOverflowPolicy,
+        VideoSegmentSeconds,
+        VideoFrameRate,
+        VariableFrameRateVideo,
+        VideoSpoolSeconds,
+        VideoSpoolDir,
+        VideoStagingDir,
         VideoEncoderLocation,
+        EncoderMaxJobs,
+        EncoderNiceness,
+        EncoderIdleIo,
+        DeferVideoEncoding,
         ResultImageDir,
         SaveResultImages,
         UserTokenAtUfoId,   // sharing results
@@ -107,6 +126,36 @@ public:
      */
     bool checkCameraAspectRatio();
 
+    /**
+     * @brief Web camera capture backend: "opencv" or "v4l2".
+     * The "v4l2" backend reads Video4Linux2 driver buffers directly and is available only in Linux.
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    QString cameraBackend();
+
+    /**
+     * @brief Four character code of web camera pixel format, e.g. "YUYV", "GREY" or "MJPG".
+     * Used only by the "v4l2" capture backend.
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    QString cameraPixelFormat();
+
+    /**
+     * @brief Indexes of all cameras to use for detection, e.g. "0,1,2" in the settings file.
+     * Settings of an individual camera can be overridden in group "camera<index>",
+     * e.g. camera1/motionThreshold. Only the command line application uses multiple cameras.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return camera indexes, by default only cameraIndex()
+     */
+    QList<int> cameraIndexes();
+
+    /**
+     * @brief Number of threads doing detection work for all cameras.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return thread count, 0 for one thread per CPU core
+     */
+    int workerThreads();
+
     /**
      * @brief Full name of the file containing detection area definition.
      */
@@ -125,6 +174,11 @@ public:
      */
     int noiseFilterPixelSize();
 
+    /**
+     * @brief Pixel size for noise filter of given camera.
+     */
+    int noiseFilterPixelSize(int cameraIndex);
+
     /**
      * @brief Threshold value for motion detection.
      *
@@ -132,11 +186,30 @@ public:
      */
     int motionThreshold();
 
+    /**
+     * @brief Threshold value for motion detection of given camera.
+     */
+    int motionThreshold(int cameraIndex);
+
     /**
      * @brief Minimum number of motion detections to start video recording.
      */
     int minPositiveDetections();
 
+    /**
+     * @brief Minimum number of motion detections to start video recording of given camera.
+     */
+    int minPositiveDetections(int cameraIndex);
+
+    /**
+     * @brief Divisor of image size used in motion detection of given camera. Detection runs
+     * on reduced size luma image, which for JPEG cameras is decoded directly at that size.
+     * Full size images are made only for recording and for inspecting detected objects.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return 1 (full size), 2, 4 or 8
+     */
+    int detectionDownscale(int cameraIndex);
+
     /**
      * @brief Bird classifier training data (using cascade classifier).
      */
@@ -155,13 +228,17 @@ public:
     /**
      * @brief Result video codec string.
      *
-     * @return FOURCC code of the codec as string
+     * @return FOURCC code of the codec as string, or AUTO_VIDEO_CODEC
      */
     QString resultVideoCodecStr();
 
     /**
      * @brief Result video codec. The value is a FOURCC code.
      *
+     * With AUTO_VIDEO_CODEC it's the codec with the smallest output of those which encode
+     * fast enough at the camera resolution, as measured by the codec benchmark. The benchmark
+     * is run when there are no results at the camera resolution, which takes a while. The
+     * default codec is used if no codec could be benchmarked.
      * @return FOURCC code of the codec
      */
     int resultVideoCodec();
@@ -172,12 +249,113 @@ public:
      */
     bool resultVideoWithObjectRectangles();
 
+    /**
+     * @brief How many seconds of video before the detection are included in the result video.
+     * The frames are kept compressed in memory, see prerollMemoryMB().
+     * @return seconds, 0 if disabled
+     */
+    int prerollSeconds();
+
+    /**
+     * @brief Memory limit of compressed frames kept for prerollSeconds(), per camera.
+     * Oldest frames are dropped first when the limit is reached.
+     * @return megabytes
+     */
+    int prerollMemoryMB();
+
+    /**
+     * @brief What to do when video frames come faster than they can be written and the
+     * video buffer is full: "block" (wait, stalls frame reading), "dropOldest", "dropNewest",
+     * or "coalesce" (repeat the previous frame in place of the new one).
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    QString videoBufferOverflowPolicy();
+
+    /**
+     * @brief Duration of video segments. Videos are recorded as segments which are
+     * joined when the recording ends, so a crash loses only the last segment.
+     * Needs the external encoder (ffmpeg) with segment muxer, one video file is
+     * recorded without it.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return seconds, 0 to record one video file
+     */
+    int videoSegmentSeconds();
+
+    /**
+     * @brief Frame rate of recorded videos.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return frames per second, 0 to follow the frame rate measured from the camera
+     */
+    int videoFrameRate();
+
+    /**
+     * @brief Whether to write each video frame once with its capture timestamp instead of
+     * repeating frames to keep a constant frame rate. Videos are then Matroska (.mkv) files.
+     * Needs the external encoder (ffmpeg).
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    bool variableFrameRateVideo();
+
+    /**
+     * @brief How many seconds of video frames are spilled to disk when the video buffer
+     * is full, before videoBufferOverflowPolicy() applies. The spool file is allocated
+     * in full when the detector starts, uncompressed.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return seconds, 0 if disabled
+     */
+    int videoSpoolSeconds();
+
+    /**
+     * @brief Directory of the video spool file, see videoSpoolSeconds().
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    QString videoSpoolDir();
+
+    /**
+     * @brief Directory where videos are written while recording, e.g. on tmpfs. Finished
+     * files are moved to resultVideoDir() in the background, so that a slow disk or network
+     * share doesn't stall recording. Needs room for the videos not yet moved.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return directory, empty to write directly into resultVideoDir()
+     */
+    QString videoStagingDir();
+
     /**
      * @brief Location of video encoder (ffmpeg, avconv).
      * @return
      */
     QString videoEncoderLocation();
 
+    /**
+     * @brief Maximum number of video encoders running at the same time, for all cameras.
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    int encoderMaxJobs();
+
+    /**
+     * @brief Niceness of video encoder processes, to leave CPU time for detection.
+     * This is a developer setting and needs to be added manually into the settings file.
+     * @return niceness added to the encoders, 0 for normal priority
+     */
+    int encoderNiceness();
+
+    /**
+     * @brief Whether video encoders use the disk only when it's otherwise idle (Linux).
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    bool encoderIdleIo();
+
+    /**
+     * @brief Whether to delay encoding videos until no camera is recording.
+     * This is a developer setting and needs to be added manually into the settings file.
+     */
+    bool deferVideoEncoding();
+
+    /**
+     * @brief File where unfinished video encoding jobs are kept, to finish them after restart.
+     */
+    QString encodingJobFile();
+
     /**
      * @brief Directory for result images.
      */
@@ -337,6 +515,12 @@ public:
 #ifndef _UNIT_TEST_
 private:
 #endif
+    /**
+     * @brief Setting value of given camera: value from group "camera<index>" if set there,
+     * otherwise the common value.
+     */
+    QVariant cameraValue(int cameraIndex, SettingKeys key, QVariant defaultValue);
+
     QSettings* m_settings;
     QString m_settingKeys[Config::SETTINGS_COUNT]; ///< setting key strings
 
@@ -348,6 +532,9 @@ private:
     int m_defaultCameraWidth;
     int m_defaultCameraHeight;
     bool m_defaultCheckCameraAspectRatio;
+    QString m_defaultCameraBackend;
+    QString m_defaultCameraPixelFormat;
+    int m_defaultWorkerThreads;
 
     QString m_defaultDetectionDataDir; ///< default directory for data (detection area and result data / log)
     QString m_defaultDetectionAreaFileName; ///< default file name for detection area file
@@ -356,6 +543,7 @@ private:
     int m_defaultNoiseFilterPixelSize;
     int m_defaultMotionThreshold;
     int m_defaultMinPositiveDetections;
+    int m_defaultDetectionDownscale;
     QString m_defaultBirdClassifierFileName;  ///< default file name for bird classifier training data file
 
     QString m_defaultResultDataFileName; ///< default file name for result data file (result database)
@@ -363,7 +551,20 @@ private:
     QString m_defaultResultVideoDir;    ///< default directory for result videos
     QString m_defaultVideoCodecStr;        ///< default video codec as FOURCC string
     bool m_defaultResultVideoWithRectangles; ///< whether to draw rectanges into result video
+    int m_defaultPrerollSeconds;
+    int m_defaultPrerollMemoryMB;
+    QString m_defaultVideoBufferOverflowPolicy;
+    int m_defaultVideoSegmentSeconds;
+    int m_defaultVideoFrameRate;
+    bool m_defaultVariableFrameRateVideo;
+    int m_defaultVideoSpoolSeconds;
+    QString m_defaultVideoSpoolDir;
+    QString m_defaultVideoStagingDir;
     QString m_defaultVideoEncoderLocation;
+    int m_defaultEncoderMaxJobs;
+    int m_defaultEncoderNiceness;
+    bool m_defaultEncoderIdleIo;
+    bool m_defaultDeferVideoEncoding;
     QString m_defaultResultImageDir;    ///< default directory for result images
     bool m_defaultSaveResultImages;     ///< whether to save result images by default
 
@@ -123,6 +123,7 @@ void DataManager::downloadBirdClassifierFile() {
 
 bool DataManager::readResultDataFile() {
     bool ok = false;
+    std::unique_lock<std::mutex> lock(m_resultDataMutex);
     if(m_resultDataFile.exists()) {
         /// @todo only update result data file periodically, no need to read/write all the time?
         ok = m_resultDataFile.open(QIODevice::ReadOnly | QIODevice::Text);
@@ -149,6 +150,7 @@ bool DataManager::readResultDataFile() {
             QTextStream stream(&m_resultDataFile);
             stream << tempFirstTime.toString();
             m_resultDataFile.close();
+            lock.unlock();
             /// @todo refactor result data file creation and reading into separate methods
             return readResultDataFile();
         }
@@ -164,6 +166,7 @@ QDomDocument* DataManager::resultDataDomDocument(bool readFile) {
 }
 
 bool DataManager::removeVideo(QString dateTime) {
+    std::lock_guard<std::mutex> lock(m_resultDataMutex);
     QDomNode node = m_resultDataDomDocument.firstChildElement().firstChild();
     while( !node.isNull())
     {
@@ -274,36 +277,46 @@ void DataManager::handleBirdClassifierReply(QNetworkReply* reply) {
     reply->deleteLater();
 }
 
-void DataManager::saveResultData(QString dateTime, QString videoLength) {
-    /// @todo create root element here if it doesn't exist
-    QDomElement rootElement = m_resultDataDomDocument.firstChildElement();
-    QDomElement node = m_resultDataDomDocument.createElement("Video");
-    node.setAttribute("Pathname", m_config->resultVideoDir());
-    node.setAttribute("DateTime", dateTime);
-    node.setAttribute("Length", videoLength);
-    rootElement.appendChild(node);
-
-    if(!m_resultDataFile.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QString errorMsg = tr("DataManager: failed to open result data file %1").arg(m_resultDataFile.fileName());
-        emit messageBroadcasted(errorMsg);
-        return;
-    }
-    else
+void DataManager::saveResultData(QString videoDir, QString dateTime, QString videoLength) {
+    QString errorMsg;
+    bool opened = false;
     {
-        QTextStream stream(&m_resultDataFile);
-        stream.setCodec("UTF-8");
-        /// @todo find way to append just the latest entry into the file, this is not scalable
-        stream << m_resultDataDomDocument.toString();
-        if (stream.status() != QTextStream::Ok)
+        // recorders of all cameras call this from their own threads
+        std::lock_guard<std::mutex> lock(m_resultDataMutex);
+        /// @todo create root element here if it doesn't exist
+        QDomElement rootElement = m_resultDataDomDocument.firstChildElement();
+        QDomElement node = m_resultDataDomDocument.createElement("Video");
+        node.setAttribute("Pathname", videoDir);
+        node.setAttribute("DateTime", dateTime);
+        node.setAttribute("Length", videoLength);
+        rootElement.appendChild(node);
+
+        if(!m_resultDataFile.open(QIODevice::WriteOnly | QIODevice::Text))
         {
-            QString errorMsg = tr("DataManager: problem writing to result data file %1").arg(m_resultDataFile.fileName());
-            emit messageBroadcasted(errorMsg);
+            errorMsg = tr("DataManager: failed to open result data file %1").arg(m_resultDataFile.fileName());
         }
-        m_resultDataFile.flush();
-        m_resultDataFile.close();
+        else
+        {
+            opened = true;
+            QTextStream stream(&m_resultDataFile);
+            stream.setCodec("UTF-8");
+            /// @todo find way to append just the latest entry into the file, this is not scalable
+            stream << m_resultDataDomDocument.toString();
+            if (stream.status() != QTextStream::Ok)
+            {
+                errorMsg = tr("DataManager: problem writing to result data file %1").arg(m_resultDataFile.fileName());
+            }
+            m_resultDataFile.flush();
+            m_resultDataFile.close();
+        }
+    }
+    if (!errorMsg.isEmpty()) {
+        emit messageBroadcasted(errorMsg);
     }
-    emit resultDataSaved(m_config->resultVideoDir(), dateTime, videoLength);
+    if (!opened) {
+        return;
+    }
+    emit resultDataSaved(videoDir, dateTime, videoLength);
 }
 
 bool DataManager::readDetectionAreaFile(bool clipToCamera) {
@@ -341,10 +354,12 @@ bool DataManager::readDetectionAreaFile(bool clipToCamera) {
     }
     QDomNodeList areaList = root.childNodes();
 
-    if (areaList.count() > 1) {
-        QString errorMsg = tr("More than one detection areas defined, combining all together");
-        emit messageBroadcasted(errorMsg);
+    while (!m_detectionAreaPolygons.isEmpty()) {
+        QPolygon* polygon = m_detectionAreaPolygons.takeLast();
+        delete polygon;
     }
+    m_cameraDetectionAreas.clear();
+    QMap<int, int> cameraAreaCounts;
 
     for (int i = 0; i < areaList.count(); i++) {
         QDomNode area = areaList.at(i);
@@ -372,13 +387,16 @@ bool DataManager::readDetectionAreaFile(bool clipToCamera) {
             }
         }
 
+        cameraRectangle.clear();
         cameraRectangle << QPoint(0, 0) << QPoint(0, cameraHeight - 1)
                         << QPoint(cameraWidth - 1, cameraHeight - 1) << QPoint(cameraWidth - 1, 0);
 
-        while (!m_detectionAreaPolygons.isEmpty()) {
-            QPolygon* polygon = m_detectionAreaPolygons.takeLast();
-            delete polygon;
+        cameraAreaCounts[cameraId]++;
+        if (cameraAreaCounts[cameraId] == 2) {
+            QString errorMsg = tr("More than one detection area defined for camera %1, combining them together").arg(cameraId);
+            emit messageBroadcasted(errorMsg);
         }
+        QList<QPolygon*>& cameraPolygons = m_cameraDetectionAreas[cameraId];
 
         for (int a = 0; a < areaNodes.count(); a++) {
             QDomNode areaSubNode = areaNodes.at(a);
@@ -412,6 +430,7 @@ bool DataManager::readDetectionAreaFile(bool clipToCamera) {
                     }
                 }
                 m_detectionAreaPolygons.append(polygon);
+                cameraPolygons.append(polygon);
             }
         }
     }
@@ -426,6 +445,17 @@ QList<QPolygon*>& DataManager::detectionArea() {
     return m_detectionAreaPolygons;
 }
 
+QList<QPolygon*> DataManager::detectionArea(int cameraId) {
+    if (m_cameraDetectionAreas.contains(cameraId)) {
+        return m_cameraDetectionAreas.value(cameraId);
+    }
+    if (m_cameraDetectionAreas.size() <= 1) {
+        // single camera file, or polygons were given without reading the file
+        return m_detectionAreaPolygons;
+    }
+    return QList<QPolygon*>();
+}
+
 bool DataManager::resetDetectionAreaFile(bool overwrite) {
     QFile detectionAreaFile(m_config->detectionAreaFile());
     if (detectionAreaFile.exists() && !overwrite) {
@@ -26,6 +26,8 @@
 #include <QNetworkReply>
 #include <QPolygon>
 #include <QList>
+#include <QMap>
+#include <mutex>
 #include <queue>
 
 /**
@@ -68,7 +70,13 @@ public:
      */
     void checkForUpdates();
 
-    void saveResultData(QString dateTime, QString videoLength);
+    /**
+     * @brief Add video entry into result data file. Can be called from any thread.
+     * @param videoDir directory of the video, recorders of different cameras have their own
+     * @param dateTime Date and time of video in format "YYYY-MM-DD--hh-mm-ss"
+     * @param videoLength video length "mm:ss"
+     */
+    void saveResultData(QString videoDir, QString dateTime, QString videoLength);
 
     /**
      * @brief Read detection area file.
@@ -77,8 +85,19 @@ public:
      */
     bool readDetectionAreaFile(bool clipToCamera);
 
+    /**
+     * @brief Detection area polygons of all cameras combined.
+     */
     QList<QPolygon*>& detectionArea();
 
+    /**
+     * @brief Detection area polygons of given camera.
+     * If the file has areas of only one camera, those are used for any camera.
+     * @param cameraId camera index
+     * @return polygons owned by DataManager, or empty list if the camera has no detection area
+     */
+    QList<QPolygon*> detectionArea(int cameraId);
+
     /**
      * @brief Reset detection area file.
      * @param overwrite force file overwrite
@@ -95,8 +114,10 @@ private:
     QString m_applicationVersion;   ///< app version   @todo move into UpdateManager
     QFile m_resultDataFile;  ///< result data file (XML)
     QDomDocument m_resultDataDomDocument;   ///< DOM representation of result data file
+    std::mutex m_resultDataMutex;   ///< guards m_resultDataFile and m_resultDataDomDocument
     QNetworkAccessManager* m_networkAccessManager;
     QList<QPolygon*> m_detectionAreaPolygons; ///< detection area polygons (cameras not separated)
+    QMap<int, QList<QPolygon*> > m_cameraDetectionAreas; ///< polygons of m_detectionAreaPolygons by camera id
 
     /**
      * @brief Check that the folders for images, videos, and other files exist
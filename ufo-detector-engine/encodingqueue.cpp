@@ -0,0 +1,326 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encodingqueue.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTimer>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Encoder process which lowers its own priority before the encoder is executed.
+ */
+class EncoderProcess : public QProcess
+{
+public:
+    EncoderProcess(int niceness, bool idleIo) : m_niceness(niceness), m_idleIo(idleIo) {
+    }
+
+protected:
+    // runs in the child process, between fork and exec
+    void setupChildProcess() override {
+#ifdef Q_OS_UNIX
+        if (m_niceness > 0) {
+            if (nice(m_niceness) == -1) {
+                // stays at normal priority
+            }
+        }
+#endif
+#ifdef Q_OS_LINUX
+        if (m_idleIo) {
+            const int IOPRIO_WHO_PROCESS = 1;
+            const int IOPRIO_CLASS_IDLE = 3;
+            const int IOPRIO_CLASS_SHIFT = 13;
+            syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+        }
+#endif
+    }
+
+private:
+    int m_niceness;
+    bool m_idleIo;
+};
+
+}
+
+EncodingQueue::EncodingQueue(QString encoderLocation, QString jobFileName, int maxJobs, QObject* parent) :
+    QObject(parent), m_encoderLocation(encoderLocation), m_jobFileName(jobFileName)
+{
+    m_maxJobs = qMax(1, maxJobs);
+    m_niceness = 0;
+    m_idleIo = false;
+    m_deferWhileRecording = false;
+    m_recordingCount = 0;
+    m_nextSequence = 0;
+    loadJobs();
+    QTimer::singleShot(0, this, SLOT(startJobs()));
+}
+
+EncodingQueue::~EncodingQueue() {
+    for (Job& job : m_jobs) {
+        if (job.m_encoder) {
+            job.m_encoder->disconnect(this);
+            job.m_encoder->kill();
+            job.m_encoder->waitForFinished();
+            delete job.m_encoder;
+        }
+    }
+}
+
+void EncodingQueue::setNiceness(int niceness) {
+    m_niceness = niceness;
+}
+
+void EncodingQueue::setIdleIo(bool idleIo) {
+    m_idleIo = idleIo;
+}
+
+void EncodingQueue::setDeferWhileRecording(bool defer) {
+    m_deferWhileRecording = defer;
+    startJobs();
+}
+
+int EncodingQueue::maxJobs() {
+    return m_maxJobs;
+}
+
+int EncodingQueue::pendingCount() {
+    return m_jobs.size() - runningCount();
+}
+
+int EncodingQueue::failedCount() {
+    return m_failedJobs.size();
+}
+
+int EncodingQueue::runningCount() {
+    int running = 0;
+    for (const Job& job : m_jobs) {
+        if (job.m_encoder) {
+            running++;
+        }
+    }
+    return running;
+}
+
+QStringList EncodingQueue::encoderArguments(QString tempFileName, QString codecStr, QString targetFileName) {
+    QStringList args;
+    // these video encoder parameters are ok only for ffmpeg and avconv (which are more or less compatible)
+    args << "-y";
+    if (tempFileName.endsWith(".ffconcat")) {
+        // listed paths are absolute or relative to the list
+        args << "-f" << "concat" << "-safe" << "0";
+    }
+    args << "-i" << tempFileName << "-vcodec" << codecStr << targetFileName;
+    return args;
+}
+
+QStringList EncodingQueue::concatListFiles(QString listFileName) {
+    QStringList files;
+    QFile listFile(listFileName);
+    if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return files;
+    }
+    QDir listDir = QFileInfo(listFileName).absoluteDir();
+    while (!listFile.atEnd()) {
+        QString line = QString::fromUtf8(listFile.readLine()).trimmed();
+        if (!line.startsWith("file ")) {
+            continue;
+        }
+        QString fileName = line.mid(5).trimmed();
+        if (fileName.startsWith('\'') && fileName.endsWith('\'') && (fileName.size() >= 2)) {
+            fileName = fileName.mid(1, fileName.size() - 2).replace("'\\''", "'");
+        }
+        files << QDir::cleanPath(listDir.absoluteFilePath(fileName));
+    }
+    return files;
+}
+
+void EncodingQueue::enqueue(QString tempFileName, QString targetFileName, QString codecStr, int priority) {
+    Job job;
+    job.m_tempFileName = tempFileName;
+    job.m_targetFileName = targetFileName;
+    job.m_codecStr = codecStr;
+    job.m_priority = priority;
+    job.m_inputSize = QFileInfo(tempFileName).size();
+    job.m_sequence = m_nextSequence++;
+    job.m_queueTimer.start();
+    job.m_waitMsecs = 0;
+    job.m_failures = 0;
+    job.m_encoder = NULL;
+    m_jobs.push_back(job);
+    saveJobs();
+    startJobs();
+}
+
+void EncodingQueue::recordingStarted() {
+    m_recordingCount++;
+}
+
+void EncodingQueue::recordingFinished() {
+    m_recordingCount = qMax(0, m_recordingCount - 1);
+    startJobs();
+}
+
+void EncodingQueue::startJobs() {
+    if (m_deferWhileRecording && (m_recordingCount > 0)) {
+        return;
+    }
+    while (runningCount() < m_maxJobs) {
+        std::list<Job>::iterator job = nextJob();
+        if (job == m_jobs.end()) {
+            break;
+        }
+        startJob(*job);
+    }
+}
+
+void EncodingQueue::onEncoderFinished() {
+    for (std::list<Job>::iterator job = m_jobs.begin(); job != m_jobs.end(); ++job) {
+        QProcess* encoder = job->m_encoder;
+        if (!encoder || (encoder->state() != QProcess::NotRunning)) {
+            continue;
+        }
+        const qint64 encodeMsecs = job->m_encodeTimer.elapsed();
+        const bool success = (encoder->error() != QProcess::FailedToStart) && (encoder->exitStatus() == QProcess::NormalExit)
+                && (encoder->exitCode() == 0);
+        if (success) {
+            if (job->m_tempFileName.endsWith(".ffconcat")) {
+                foreach (QString joinedFile, concatListFiles(job->m_tempFileName)) {
+                    QFile::remove(joinedFile);
+                }
+            }
+            QFile::remove(job->m_tempFileName);
+            qDebug() << "Encoded" << job->m_targetFileName << "in" << encodeMsecs << "ms, waited"
+                     << job->m_waitMsecs << "ms," << job->m_inputSize << "->" << QFileInfo(job->m_targetFileName).size() << "bytes";
+        } else {
+            // keep the input, it's the only copy of the video
+            qDebug() << "ERROR: Failed to encode" << job->m_tempFileName << "in" << encodeMsecs << "ms:"
+                     << encoder->errorString() << encoder->readAllStandardError().right(500);
+        }
+        encoder->deleteLater();
+        job->m_encoder = NULL;
+        QString targetFileName = job->m_targetFileName;
+        qint64 waitMsecs = job->m_waitMsecs;
+        if (success) {
+            m_jobs.erase(job);
+        } else {
+            // not retried right away, a missing or broken encoder would fail again
+            job->m_failures++;
+            m_failedJobs.splice(m_failedJobs.end(), m_jobs, job);
+        }
+        saveJobs();
+        emit jobFinished(targetFileName, success, waitMsecs, encodeMsecs);
+        break;
+    }
+    startJobs();
+}
+
+std::list<EncodingQueue::Job>::iterator EncodingQueue::nextJob() {
+    std::list<Job>::iterator next = m_jobs.end();
+    for (std::list<Job>::iterator job = m_jobs.begin(); job != m_jobs.end(); ++job) {
+        if (job->m_encoder) {
+            continue;
+        }
+        if ((next == m_jobs.end()) || (job->m_priority > next->m_priority)
+                || ((job->m_priority == next->m_priority) && ((job->m_inputSize < next->m_inputSize)
+                    || ((job->m_inputSize == next->m_inputSize) && (job->m_sequence < next->m_sequence))))) {
+            next = job;
+        }
+    }
+    return next;
+}
+
+void EncodingQueue::startJob(Job& job) {
+    job.m_waitMsecs = job.m_queueTimer.elapsed();
+    job.m_encoder = new EncoderProcess(m_niceness, m_idleIo);
+    // encoder progress isn't needed, errors are shown if encoding fails
+    job.m_encoder->setStandardOutputFile(QProcess::nullDevice());
+    connect(job.m_encoder, SIGNAL(finished(int)), this, SLOT(onEncoderFinished()));
+    connect(job.m_encoder, SIGNAL(error(QProcess::ProcessError)), this, SLOT(onEncoderFinished()));
+    job.m_encodeTimer.start();
+    job.m_encoder->start(m_encoderLocation, encoderArguments(job.m_tempFileName, job.m_codecStr, job.m_targetFileName));
+}
+
+void EncodingQueue::loadJobs() {
+    if (m_jobFileName.isEmpty()) {
+        return;
+    }
+    QSettings jobFile(m_jobFileName, QSettings::IniFormat);
+    int count = jobFile.beginReadArray("jobs");
+    for (int i = 0; i < count; i++) {
+        jobFile.setArrayIndex(i);
+        Job job;
+        job.m_tempFileName = jobFile.value("tempFile").toString();
+        job.m_targetFileName = jobFile.value("targetFile").toString();
+        job.m_codecStr = jobFile.value("codec").toString();
+        job.m_priority = jobFile.value("priority", 0).toInt();
+        job.m_failures = jobFile.value("failures", 0).toInt();
+        if (!QFile::exists(job.m_tempFileName)) {
+            continue;
+        }
+        job.m_inputSize = QFileInfo(job.m_tempFileName).size();
+        job.m_sequence = m_nextSequence++;
+        job.m_queueTimer.start();
+        job.m_waitMsecs = 0;
+        job.m_encoder = NULL;
+        if (job.m_failures >= MAX_ATTEMPTS) {
+            // kept in the job file as long as the input exists, it's the only copy of the video
+            qDebug() << "Not retrying encoding of" << job.m_tempFileName << ", it has failed" << job.m_failures << "times";
+            m_failedJobs.push_back(job);
+            continue;
+        }
+        if (job.m_failures > 0) {
+            qDebug() << "Retrying encoding of" << job.m_tempFileName << ", it has failed" << job.m_failures << "times";
+        } else {
+            qDebug() << "Resuming encoding of" << job.m_tempFileName;
+        }
+        m_jobs.push_back(job);
+    }
+    jobFile.endArray();
+}
+
+void EncodingQueue::saveJobs() {
+    if (m_jobFileName.isEmpty()) {
+        return;
+    }
+    QSettings jobFile(m_jobFileName, QSettings::IniFormat);
+    jobFile.remove("jobs");
+    jobFile.beginWriteArray("jobs", m_jobs.size() + m_failedJobs.size());
+    int i = 0;
+    for (const std::list<Job>* jobs : { &m_jobs, &m_failedJobs }) {
+        for (const Job& job : *jobs) {
+            jobFile.setArrayIndex(i++);
+            jobFile.setValue("tempFile", job.m_tempFileName);
+            jobFile.setValue("targetFile", job.m_targetFileName);
+            jobFile.setValue("codec", job.m_codecStr);
+            jobFile.setValue("priority", job.m_priority);
+            jobFile.setValue("failures", job.m_failures);
+        }
+    }
+    jobFile.endArray();
+}
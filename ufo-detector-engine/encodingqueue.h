@@ -0,0 +1,191 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENCODINGQUEUE_H
+#define ENCODINGQUEUE_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <list>
+
+/**
+ * @brief Queue of video encoding jobs for the external encoder (ffmpeg, avconv).
+ *
+ * At most maxJobs encoders run at a time, with lowered CPU and I/O priority so
+ * that they don't take time from detection. Waiting jobs are started by
+ * priority, and the smallest input first among equal priorities. Optionally
+ * jobs wait while any video is being recorded.
+ *
+ * Jobs are saved in a file until they finish, so encoding that was interrupted
+ * by quitting the application is started again by the next queue using the file.
+ * Failed jobs keep their input and stay in the file, the next queue retries them
+ * until they have failed MAX_ATTEMPTS times.
+ * The queue is used from the thread it lives in; enqueue() and the recording
+ * slots can be invoked from other threads through queued connections.
+ */
+class EncodingQueue : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief EncodingQueue constructor. Loads the saved jobs, they are started
+     * when the event loop runs so that the setters can be called first.
+     * @param encoderLocation encoder executable
+     * @param jobFileName file where unfinished jobs are saved
+     * @param maxJobs maximum number of encoders running at the same time
+     * @param parent
+     */
+    EncodingQueue(QString encoderLocation, QString jobFileName, int maxJobs, QObject* parent = 0);
+
+    /**
+     * @brief Stops running encoders. Their jobs stay saved and restart with the next queue.
+     */
+    ~EncodingQueue();
+
+    /**
+     * @brief Niceness added to encoder processes, 0 to run them with normal priority.
+     */
+    void setNiceness(int niceness);
+
+    /**
+     * @brief Whether encoders get disk time only when nothing else uses the disk (Linux).
+     */
+    void setIdleIo(bool idleIo);
+
+    /**
+     * @brief Whether to wait while videos are being recorded, see recordingStarted().
+     */
+    void setDeferWhileRecording(bool defer);
+
+    int maxJobs();
+
+    /**
+     * @brief Number of jobs waiting to be started.
+     */
+    int pendingCount();
+
+    /**
+     * @brief Number of encoders running.
+     */
+    int runningCount();
+
+    /**
+     * @brief Number of failed jobs, retried by the next queue.
+     */
+    int failedCount();
+
+    /**
+     * @brief Encoder command line arguments.
+     * @param tempFileName input video, or ffconcat list of videos to join (file name ends with ".ffconcat")
+     */
+    static QStringList encoderArguments(QString tempFileName, QString codecStr, QString targetFileName);
+
+    /**
+     * @brief Video files in ffconcat list.
+     * @param listFileName
+     * @return file names, relative ones resolved against the list directory
+     */
+    static QStringList concatListFiles(QString listFileName);
+
+public slots:
+    /**
+     * @brief Add encoding job. When the encoder has finished successfully, the input file is removed,
+     * and for ffconcat list input the listed files too. When it fails, the job is kept for the next queue.
+     * @param tempFileName video to encode, or ffconcat list of videos to join
+     * @param targetFileName encoded video, overwritten if it exists
+     * @param codecStr codec as encoder string, see VideoCodecSupportInfo::fourccToEncoderString()
+     * @param priority jobs with higher priority are started first
+     */
+    void enqueue(QString tempFileName, QString targetFileName, QString codecStr, int priority = 0);
+
+    /**
+     * @brief A recorder started recording. Jobs wait until all recordings have finished,
+     * if enabled with setDeferWhileRecording().
+     */
+    void recordingStarted();
+
+    void recordingFinished();
+
+signals:
+    /**
+     * @brief Encoding job finished.
+     * @param targetFileName
+     * @param success whether the encoder finished without errors
+     * @param waitMsecs how long the job waited in the queue
+     * @param encodeMsecs how long the encoder ran
+     */
+    void jobFinished(QString targetFileName, bool success, qint64 waitMsecs, qint64 encodeMsecs);
+
+#ifndef _UNIT_TEST_
+private slots:
+#else
+public slots:
+#endif
+    /**
+     * @brief Start waiting jobs while there's room.
+     */
+    void startJobs();
+
+    void onEncoderFinished();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    struct Job {
+        QString m_tempFileName;
+        QString m_targetFileName;
+        QString m_codecStr;
+        int m_priority;
+        qint64 m_inputSize;     ///< bytes of input file, smaller jobs first
+        quint64 m_sequence;     ///< enqueue order, earlier jobs first
+        QElapsedTimer m_queueTimer;
+        QElapsedTimer m_encodeTimer;
+        qint64 m_waitMsecs;
+        int m_failures;         ///< failed attempts, also those of earlier queues
+        QProcess* m_encoder;    ///< NULL while waiting
+    };
+
+    static const int MAX_ATTEMPTS = 3;  ///< failed jobs are retried until they have failed this many times
+
+    QString m_encoderLocation;
+    QString m_jobFileName;
+    int m_maxJobs;
+    int m_niceness;
+    bool m_idleIo;
+    bool m_deferWhileRecording;
+    int m_recordingCount;       ///< recordings in progress
+    quint64 m_nextSequence;
+    std::list<Job> m_jobs;      ///< waiting and running jobs
+    std::list<Job> m_failedJobs;    ///< failed jobs, saved for the next queue
+
+    /**
+     * @brief Waiting job to start next.
+     * @return m_jobs.end() if none is waiting
+     */
+    std::list<Job>::iterator nextJob();
+
+    void startJob(Job& job);
+
+    void loadJobs();
+    void saveJobs();
+};
+
+#endif // ENCODINGQUEUE_H
@@ -0,0 +1,180 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "filecapturebackend.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+#include <thread>
+
+FileCaptureBackend::FileCaptureBackend(QString fileName, bool realTime)
+{
+    m_fileName = fileName;
+    m_realTime = realTime;
+    m_opened = false;
+    m_atEnd = false;
+    m_isImageDir = false;
+    m_nextImageIndex = 0;
+    m_fps = DEFAULT_FPS;
+    m_frameIndex = 0;
+}
+
+FileCaptureBackend::~FileCaptureBackend()
+{
+    close();
+}
+
+bool FileCaptureBackend::open(int width, int height)
+{
+    close();
+    m_frameSize = cv::Size(width, height);
+    m_atEnd = false;
+    m_frameIndex = 0;
+    m_fps = DEFAULT_FPS;
+
+    QFileInfo fileInfo(m_fileName);
+    m_isImageDir = fileInfo.isDir();
+    if (m_isImageDir)
+    {
+        QDir dir(m_fileName);
+        QStringList nameFilters;
+        nameFilters << "*.jpg" << "*.jpeg" << "*.png" << "*.bmp" << "*.tif" << "*.tiff";
+        QStringList names = dir.entryList(nameFilters, QDir::Files, QDir::Name);
+        m_imageFiles.clear();
+        foreach (QString name, names)
+        {
+            m_imageFiles << dir.filePath(name);
+        }
+        m_nextImageIndex = 0;
+        if (m_imageFiles.isEmpty())
+        {
+            qWarning() << "No images in" << m_fileName;
+            return false;
+        }
+    }
+    else
+    {
+        if (!m_video.open(m_fileName.toStdString()))
+        {
+            qWarning() << "Cannot open video file" << m_fileName;
+            return false;
+        }
+        double fileFps = m_video.get(CV_CAP_PROP_FPS);
+        if ((fileFps > 0) && (fileFps < 1000))
+        {
+            m_fps = fileFps;
+        }
+    }
+    m_startTime = FrameClock::now();
+    m_opened = true;
+    qDebug() << "Reading" << m_fileName << "at" << m_fps << "FPS," << (m_realTime ? "real-time" : "free-running");
+    return true;
+}
+
+void FileCaptureBackend::close()
+{
+    m_video.release();
+    m_imageFiles.clear();
+    m_opened = false;
+}
+
+bool FileCaptureBackend::isOpened()
+{
+    return m_opened;
+}
+
+bool FileCaptureBackend::readFrame(CameraFrame* frame)
+{
+    cv::Mat image;
+
+    if (!m_opened || m_atEnd)
+    {
+        return false;
+    }
+    if (m_isImageDir)
+    {
+        while (image.empty() && (m_nextImageIndex < m_imageFiles.size()))
+        {
+            QString imageFile = m_imageFiles.at(m_nextImageIndex++);
+            image = cv::imread(imageFile.toStdString(), cv::IMREAD_COLOR);
+            if (image.empty())
+            {
+                qWarning() << "Cannot read image" << imageFile;
+            }
+        }
+    }
+    else
+    {
+        m_video.read(image);
+    }
+    if (image.empty())
+    {
+        m_atEnd = true;
+        return false;
+    }
+
+    if (image.size() != m_frameSize)
+    {
+        if (m_frameIndex == 0)
+        {
+            qDebug() << "Scaling" << image.cols << "x" << image.rows << "input frames to"
+                     << m_frameSize.width << "x" << m_frameSize.height;
+        }
+        cv::Mat scaled;
+        cv::resize(image, scaled, m_frameSize, 0, 0, cv::INTER_AREA);
+        image = scaled;
+    }
+
+    std::chrono::duration<double> mediaTime(m_frameIndex / m_fps);
+    frame->m_timestamp = m_startTime + std::chrono::duration_cast<FrameClock::duration>(mediaTime);
+    if (m_realTime)
+    {
+        std::this_thread::sleep_until(frame->m_timestamp);
+    }
+    frame->m_image = image;
+    frame->m_pixelFormat = CameraFrame::BGR;
+    m_frameIndex++;
+    return true;
+}
+
+cv::Size FileCaptureBackend::frameSize()
+{
+    return m_frameSize;
+}
+
+bool FileCaptureBackend::isLive()
+{
+    return false;
+}
+
+bool FileCaptureBackend::isFreeRunning()
+{
+    return !m_realTime;
+}
+
+bool FileCaptureBackend::atEnd()
+{
+    return m_atEnd;
+}
+
+double FileCaptureBackend::fps()
+{
+    return m_fps;
+}
@@ -0,0 +1,89 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FILECAPTUREBACKEND_H
+#define FILECAPTUREBACKEND_H
+
+#include "capturebackend.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Capture backend replaying a video file or a directory of images.
+ *
+ * Images of a directory are read in file name order. Frames are scaled to the
+ * requested size if needed, so that detection areas made for the camera apply.
+ *
+ * In real-time mode frames are given at the frame rate of the file. Otherwise
+ * the backend is free-running: frames are given as fast as they are consumed,
+ * while their timestamps still follow the frame rate of the file.
+ */
+class FileCaptureBackend : public CaptureBackend
+{
+public:
+    /**
+     * @param fileName video file or image directory
+     * @param realTime true to give frames at the frame rate of the file
+     */
+    FileCaptureBackend(QString fileName, bool realTime);
+
+    ~FileCaptureBackend();
+
+    bool open(int width, int height) override;
+
+    void close() override;
+
+    bool isOpened() override;
+
+    bool readFrame(CameraFrame* frame) override;
+
+    cv::Size frameSize() override;
+
+    bool isLive() override;
+
+    bool isFreeRunning() override;
+
+    bool atEnd() override;
+
+    /**
+     * @brief Frame rate of the file, or DEFAULT_FPS if the file doesn't tell it.
+     */
+    double fps();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    const double DEFAULT_FPS = 25.0;    ///< frame rate of image directories and files without one
+
+    QString m_fileName;
+    bool m_realTime;
+    bool m_opened;
+    bool m_atEnd;
+    cv::VideoCapture m_video;
+    bool m_isImageDir;
+    QStringList m_imageFiles;   ///< full names of image files when reading a directory
+    int m_nextImageIndex;
+    double m_fps;
+    cv::Size m_frameSize;       ///< size of given frames
+    quint64 m_frameIndex;       ///< index of next frame
+    FrameClock::time_point m_startTime; ///< timestamp of the first frame
+};
+
+#endif // FILECAPTUREBACKEND_H
@@ -0,0 +1,130 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framepool.h"
+#include <QDebug>
+
+void FramePool::FrameReturner::operator()(BufferedVideoFrame* frame) const {
+    if (m_pool) {
+        m_pool->giveBack(frame);
+    }
+}
+
+FramePool::FramePool(int capacity, cv::Size frameSize, int type) :
+    m_frameSize(frameSize), m_type(type)
+{
+    const int frameCount = qMax(capacity, 0);
+    const size_t bytes = (size_t)m_frameSize.width * m_frameSize.height * CV_ELEM_SIZE(m_type);
+    m_exhaustedCount = 0;
+    m_frames.resize(frameCount);
+    m_images.resize(frameCount);
+    m_buffers.resize(frameCount);
+    m_freeFrames.reserve(frameCount);
+
+    for (int i = 0; i < frameCount; i++) {
+        m_buffers[i] = static_cast<uchar*>(qMallocAligned(qMax(bytes, (size_t)1), BUFFER_ALIGNMENT));
+        if (!m_buffers[i]) {
+            qDebug() << "ERROR: failed to allocate" << frameCount << "video frames of" << bytes << "bytes";
+            for (int j = 0; j < i; j++) {
+                qFreeAligned(m_buffers[j]);
+            }
+            // empty pool, every acquire() fails
+            m_frames.clear();
+            m_images.clear();
+            m_buffers.clear();
+            return;
+        }
+    }
+    for (int i = 0; i < frameCount; i++) {
+        m_images[i] = bufferImage(i);
+        m_frames[i].m_frame = &m_images[i];
+        m_frames[i].m_duplicateCount = 0;
+        m_frames[i].m_sequenceNumber = 0;
+    }
+    // first frames are on top of the stack, so they get reused most
+    for (int i = frameCount - 1; i >= 0; i--) {
+        m_freeFrames.push_back(&m_frames[i]);
+    }
+}
+
+FramePool::~FramePool() {
+    if (available() != capacity()) {
+        qDebug() << "ERROR: frame pool destroyed while" << (capacity() - available()) << "frames are borrowed";
+    }
+    for (size_t i = 0; i < m_buffers.size(); i++) {
+        m_images[i].release();
+        qFreeAligned(m_buffers[i]);
+    }
+}
+
+PooledFrame FramePool::acquire() {
+    BufferedVideoFrame* frame = NULL;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_freeFrames.empty()) {
+            frame = m_freeFrames.back();
+            m_freeFrames.pop_back();
+        }
+    }
+    if (frame) {
+        frame->m_duplicateCount = 0;
+        frame->m_sequenceNumber = 0;
+    } else {
+        m_exhaustedCount++;
+    }
+    return PooledFrame(frame, FrameReturner{this});
+}
+
+PooledFrame FramePool::adopt(BufferedVideoFrame* frame) {
+    return PooledFrame(frame, FrameReturner{this});
+}
+
+int FramePool::capacity() const {
+    return m_frames.size();
+}
+
+int FramePool::available() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_freeFrames.size();
+}
+
+cv::Size FramePool::frameSize() const {
+    return m_frameSize;
+}
+
+quint64 FramePool::exhaustedCount() const {
+    return m_exhaustedCount;
+}
+
+void FramePool::giveBack(BufferedVideoFrame* frame) {
+    const ptrdiff_t index = frame - m_frames.data();
+    if ((index < 0) || (index >= (ptrdiff_t)m_frames.size())) {
+        qDebug() << "ERROR: frame doesn't belong to the pool";
+        return;
+    }
+    if (m_images[index].data != m_buffers[index]) {
+        // user made the image reallocate itself, point it back to the pool buffer
+        m_images[index] = bufferImage(index);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_freeFrames.push_back(frame);
+}
+
+cv::Mat FramePool::bufferImage(int index) const {
+    return cv::Mat(m_frameSize, m_type, m_buffers[index], (size_t)m_frameSize.width * CV_ELEM_SIZE(m_type));
+}
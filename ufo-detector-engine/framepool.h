@@ -0,0 +1,121 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include "videobuffer.h"
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Fixed set of reusable video frames for the recording path.
+ *
+ * All frame buffers are allocated once, page aligned, when the pool is created.
+ * Frames are borrowed with acquire() and go back to the pool when their
+ * PooledFrame handle is destroyed. When all frames are borrowed, acquire()
+ * fails and exhaustedCount() grows instead of allocating more memory.
+ *
+ * Free frames are reused last in, first out, so the same few buffers stay hot
+ * and pages of buffers that are never needed aren't touched at all.
+ */
+class FramePool
+{
+public:
+    /**
+     * @brief Returns a borrowed frame back to its pool, used as PooledFrame deleter.
+     */
+    struct FrameReturner {
+        FramePool* m_pool;
+        void operator()(BufferedVideoFrame* frame) const;
+    };
+
+    typedef std::unique_ptr<BufferedVideoFrame, FrameReturner> PooledFrame;
+
+    /**
+     * @brief FramePool constructor. Allocates all frame buffers. If that fails, the pool
+     * is left without frames and capacity() is 0.
+     * @param capacity number of frames
+     * @param frameSize size of each frame image
+     * @param type OpenCV type of each frame image
+     */
+    FramePool(int capacity, cv::Size frameSize, int type = CV_8UC3);
+
+    /**
+     * @brief Frees the frame buffers. All frames must have been returned.
+     */
+    ~FramePool();
+
+    /**
+     * @brief Borrow a free frame. Frame image has the pool frame size and type,
+     * its content is what the previous user left there.
+     * @return frame handle, or empty handle if all frames are borrowed
+     */
+    PooledFrame acquire();
+
+    /**
+     * @brief Take ownership of a frame which was released from its handle, e.g.
+     * to pass it through VideoBuffer.
+     * @param frame frame of this pool, or NULL
+     * @return handle which returns the frame to the pool
+     */
+    PooledFrame adopt(BufferedVideoFrame* frame);
+
+    int capacity() const;
+
+    /**
+     * @brief Number of frames which are currently not borrowed.
+     */
+    int available() const;
+
+    cv::Size frameSize() const;
+
+    /**
+     * @brief Number of times acquire() failed because all frames were borrowed.
+     */
+    quint64 exhaustedCount() const;
+
+    static const size_t BUFFER_ALIGNMENT = 4096;   ///< page size
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    cv::Size m_frameSize;
+    int m_type;
+    std::vector<BufferedVideoFrame> m_frames;
+    std::vector<cv::Mat> m_images;  ///< headers over m_buffers, pointed by m_frames
+    std::vector<uchar*> m_buffers;  ///< aligned frame buffers
+    std::vector<BufferedVideoFrame*> m_freeFrames;  ///< used as a stack
+    mutable std::mutex m_mutex;     ///< guards m_freeFrames
+    std::atomic<quint64> m_exhaustedCount;
+
+    void giveBack(BufferedVideoFrame* frame);
+
+    /**
+     * @brief Image header over frame buffer at index.
+     */
+    cv::Mat bufferImage(int index) const;
+};
+
+typedef FramePool::PooledFrame PooledFrame;
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,128 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framespool.h"
+#include <QDebug>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+FrameSpool::FrameSpool(QString fileName, int capacity, cv::Size frameSize, int type) :
+    m_file(fileName), m_map(NULL), m_capacity(qMax(capacity, 0)), m_frameSize(frameSize), m_type(type)
+{
+    m_imageSize = (size_t)m_frameSize.width * m_frameSize.height * CV_ELEM_SIZE(m_type);
+    m_slotSize = ((IMAGE_OFFSET + m_imageSize + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT) * SLOT_ALIGNMENT;
+    m_head = 0;
+    m_tail = 0;
+
+    const qint64 fileSize = (qint64)m_slotSize * m_capacity;
+    if ((fileSize <= 0) || !m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qDebug() << "ERROR: failed to create video spool file" << fileName;
+        return;
+    }
+#ifdef Q_OS_LINUX
+    // reserve the disk blocks, writing to a sparse mapping on a full disk would crash
+    bool allocated = (posix_fallocate(m_file.handle(), 0, fileSize) == 0);
+#else
+    bool allocated = m_file.resize(fileSize);
+#endif
+    if (allocated) {
+        m_map = m_file.map(0, fileSize);
+    }
+    if (!m_map) {
+        qDebug() << "ERROR: failed to allocate" << fileSize << "bytes for video spool file" << fileName;
+        m_file.close();
+        m_file.remove();
+    }
+}
+
+FrameSpool::~FrameSpool() {
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_file.close();
+        m_file.remove();
+    }
+}
+
+bool FrameSpool::isOpen() {
+    return (m_map != NULL);
+}
+
+bool FrameSpool::write(const BufferedVideoFrame& frame) {
+    const quint32 tail = m_tail.load(std::memory_order_relaxed);
+    if (!m_map || ((tail - m_head.load(std::memory_order_acquire)) >= (quint32)m_capacity)) {
+        return false;
+    }
+    const cv::Mat& image = *(frame.m_frame);
+    if ((image.size() != m_frameSize) || (image.type() != m_type)) {
+        return false;
+    }
+    uchar* data = slot(tail);
+    SlotHeader* header = reinterpret_cast<SlotHeader*>(data);
+    header->m_timestamp = frame.m_timestamp.time_since_epoch().count();
+    header->m_duplicateCount = frame.m_duplicateCount;
+    header->m_sequenceNumber = frame.m_sequenceNumber;
+    // copy row by row, the image may be a part of a larger one
+    cv::Mat slotImage(m_frameSize, m_type, data + IMAGE_OFFSET);
+    image.copyTo(slotImage);
+    // release publishes the slot before the new tail
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool FrameSpool::read(BufferedVideoFrame& frame) {
+    const quint32 head = m_head.load(std::memory_order_relaxed);
+    if (!m_map || (m_tail.load(std::memory_order_acquire) == head)) {
+        return false;
+    }
+    uchar* data = slot(head);
+    const SlotHeader* header = reinterpret_cast<const SlotHeader*>(data);
+    frame.m_timestamp = FrameClock::time_point(FrameClock::duration(header->m_timestamp));
+    frame.m_duplicateCount = header->m_duplicateCount;
+    frame.m_sequenceNumber = header->m_sequenceNumber;
+    cv::Mat(m_frameSize, m_type, data + IMAGE_OFFSET).copyTo(*(frame.m_frame));
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void FrameSpool::clear() {
+    m_head = m_tail.load();
+}
+
+int FrameSpool::count() {
+    quint32 head = m_head.load(std::memory_order_acquire);
+    quint32 tail = m_tail.load(std::memory_order_acquire);
+    return tail - head;
+}
+
+int FrameSpool::capacity() {
+    return m_capacity;
+}
+
+bool FrameSpool::isEmpty() {
+    return (count() == 0);
+}
+
+cv::Size FrameSpool::frameSize() {
+    return m_frameSize;
+}
+
+uchar* FrameSpool::slot(quint32 index) {
+    return m_map + (size_t)(index % m_capacity) * m_slotSize;
+}
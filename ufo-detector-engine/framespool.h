@@ -0,0 +1,106 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMESPOOL_H
+#define FRAMESPOOL_H
+
+#include "videobuffer.h"
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Fixed size ring of video frames in a memory-mapped file.
+ *
+ * Overflow tier of VideoBuffer: when the writer can't keep up, frames are
+ * spilled here instead of being lost, and read back in order when it has
+ * caught up. The file is allocated in full when the spool is created, so
+ * writing into it can't fail for lack of disk space later. Like VideoBuffer,
+ * there is one writer thread and one reader thread.
+ */
+class FrameSpool
+{
+public:
+    /**
+     * @brief FrameSpool constructor. Creates and maps the spool file.
+     * @param fileName spool file, removed when the spool is destroyed
+     * @param capacity number of frames
+     * @param frameSize size of frame images, other sizes can't be spooled
+     * @param type OpenCV type of frame images
+     */
+    FrameSpool(QString fileName, int capacity, cv::Size frameSize, int type = CV_8UC3);
+    ~FrameSpool();
+
+    /**
+     * @brief Whether the spool file could be allocated and mapped.
+     */
+    bool isOpen();
+
+    /**
+     * @brief Copy frame to the end of the spool.
+     * @return false if the spool is full or the frame is not of the spool size
+     */
+    bool write(const BufferedVideoFrame& frame);
+
+    /**
+     * @brief Copy the first frame of the spool to frame and remove it from the spool.
+     * @param frame frame whose image is overwritten
+     * @return false if the spool is empty
+     */
+    bool read(BufferedVideoFrame& frame);
+
+    /**
+     * @brief Remove all frames.
+     */
+    void clear();
+
+    int count();
+    int capacity();
+    bool isEmpty();
+    cv::Size frameSize();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    /**
+     * @brief Beginning of each slot of the spool file, followed by the image at IMAGE_OFFSET.
+     */
+    struct SlotHeader {
+        qint64 m_timestamp;     ///< FrameClock ticks
+        qint32 m_duplicateCount;
+        quint64 m_sequenceNumber;
+    };
+
+    static const size_t IMAGE_OFFSET = 64;
+    static const size_t SLOT_ALIGNMENT = 4096;  ///< page size
+
+    QFile m_file;
+    uchar* m_map;
+    int m_capacity;
+    cv::Size m_frameSize;
+    int m_type;
+    size_t m_imageSize;     ///< bytes of one frame image
+    size_t m_slotSize;      ///< bytes of one slot, multiple of SLOT_ALIGNMENT
+    std::atomic<quint32> m_head;    ///< number of frames read
+    std::atomic<quint32> m_tail;    ///< number of frames written
+
+    uchar* slot(quint32 index);
+};
+
+#endif // FRAMESPOOL_H
@@ -0,0 +1,122 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "framesubscriber.h"
+
+FrameSubscriber::FrameSubscriber(DeliveryMode mode, int capacity, bool pacesSource) {
+    m_mode = mode;
+    m_capacity = (m_mode == FrameSubscriber::LatestOnly) ? 1 : qMax(1, capacity);
+    m_pacesSource = pacesSource;
+    m_waitingEnabled = true;
+    m_droppedFrames = 0;
+}
+
+CameraFramePtr FrameSubscriber::waitNextFrame(int timeoutMs) {
+    CameraFramePtr frame;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto frameOrStop = [this]() { return !m_frames.empty() || !m_waitingEnabled; };
+
+    if (timeoutMs < 0) {
+        m_frameAvailable.wait(lock, frameOrStop);
+    } else {
+        m_frameAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs), frameOrStop);
+    }
+    if (m_waitingEnabled && !m_frames.empty()) {
+        frame = m_frames.front();
+        m_frames.pop_front();
+        m_spaceAvailable.notify_one();
+    }
+    return frame;
+}
+
+bool FrameSubscriber::publish(const CameraFramePtr& frame, int timeoutMs) {
+    if (!frame) {
+        return true;
+    }
+    bool published = true;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (timeoutMs > 0) {
+            m_spaceAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+                return ((int)m_frames.size() < m_capacity) || !m_waitingEnabled;
+            });
+            if (!m_waitingEnabled) {
+                // nobody is reading, pretend the frame was given so that publisher won't wait
+                return true;
+            }
+            published = ((int)m_frames.size() < m_capacity);
+        }
+        if (published) {
+            while ((int)m_frames.size() >= m_capacity) {
+                m_frames.pop_front();
+                m_droppedFrames++;
+            }
+            m_frames.push_back(frame);
+        }
+    }
+    if (published) {
+        m_frameAvailable.notify_one();
+    }
+    // also when the queue stayed full: the reader may have missed scheduling for the waiting frame
+    std::lock_guard<std::mutex> callbackLock(m_callbackMutex);
+    if (m_frameCallback) {
+        m_frameCallback();
+    }
+    return published;
+}
+
+void FrameSubscriber::setFrameCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(m_callbackMutex);
+    m_frameCallback = callback;
+    // frames published before the callback was set would wait for the next frame
+    if (m_frameCallback && (count() > 0)) {
+        m_frameCallback();
+    }
+}
+
+void FrameSubscriber::stopWait() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_waitingEnabled = false;
+        m_frames.clear();
+    }
+    m_frameAvailable.notify_all();
+    m_spaceAvailable.notify_all();
+}
+
+FrameSubscriber::DeliveryMode FrameSubscriber::deliveryMode() {
+    return m_mode;
+}
+
+bool FrameSubscriber::pacesSource() {
+    return m_pacesSource;
+}
+
+int FrameSubscriber::capacity() {
+    return m_capacity;
+}
+
+int FrameSubscriber::count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frames.size();
+}
+
+quint64 FrameSubscriber::droppedFrames() {
+    return m_droppedFrames;
+}
@@ -0,0 +1,126 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef FRAMESUBSCRIBER_H
+#define FRAMESUBSCRIBER_H
+
+#include "cameraframe.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief Receiving end of camera frame distribution.
+ *
+ * Camera publishes each captured frame once to all of its subscribers. Create
+ * subscribers with Camera::subscribe() and remove them with Camera::unsubscribe().
+ */
+class FrameSubscriber
+{
+public:
+    /**
+     * @brief How frames are delivered to the subscriber.
+     */
+    enum DeliveryMode {
+        LatestOnly = 0, ///< only the newest frame is kept, unread older frames are dropped
+        EveryFrame      ///< frames are queued; when the queue is full the oldest frame is dropped
+    };
+
+    /**
+     * @brief FrameSubscriber constructor.
+     * @param mode delivery mode
+     * @param capacity queue capacity in EveryFrame mode. LatestOnly mode always has capacity of one frame.
+     * @param pacesSource whether a free running source waits for this subscriber to take each frame.
+     * Frames which other subscribers don't take in time are dropped.
+     */
+    FrameSubscriber(DeliveryMode mode, int capacity = 1, bool pacesSource = false);
+
+    /**
+     * @brief Wait next frame and take it from the queue.
+     * @param timeoutMs maximum waiting time in milliseconds, negative value waits forever
+     * @return next frame, or NULL on timeout or if stopWait() was called
+     */
+    CameraFramePtr waitNextFrame(int timeoutMs = -1);
+
+    /**
+     * @brief Give new frame to the subscriber.
+     * @param frame
+     * @param timeoutMs 0: never block, drop the oldest frame if the queue is full.
+     * Otherwise wait at most timeoutMs milliseconds for the queue to have space.
+     * @return false if the queue stayed full and the frame was not given. The frame callback is
+     * called then too, so that a reader scheduled by it gets another chance to take the waiting frame.
+     */
+    bool publish(const CameraFramePtr& frame, int timeoutMs = 0);
+
+    /**
+     * @brief Set function to be called after each published frame, e.g. to schedule
+     * frame processing instead of waiting frames in a thread of its own.
+     * The callback is called in the publishing thread, so it must return quickly.
+     * If frames are already waiting, the new callback is called once right away.
+     * When this returns, the previous callback is no longer running.
+     * @param callback function to call, or nullptr to remove the callback
+     */
+    void setFrameCallback(std::function<void()> callback);
+
+    /**
+     * @brief Stop waiting in waitNextFrame() and publish(). Also future calls will return immediately.
+     */
+    void stopWait();
+
+    DeliveryMode deliveryMode();
+
+    /**
+     * @brief Whether a free running source waits for this subscriber.
+     */
+    bool pacesSource();
+
+    /**
+     * @brief Maximum number of frames waiting in the queue.
+     */
+    int capacity();
+
+    /**
+     * @brief The current number of frames waiting in the queue.
+     */
+    int count();
+
+    /**
+     * @brief Number of frames dropped because the subscriber didn't read them in time.
+     */
+    quint64 droppedFrames();
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    DeliveryMode m_mode;
+    int m_capacity;
+    bool m_pacesSource;     ///< whether a free running source waits for this subscriber
+    std::deque<CameraFramePtr> m_frames;    ///< frames waiting to be read
+    std::mutex m_mutex;
+    std::condition_variable m_frameAvailable;
+    std::condition_variable m_spaceAvailable;   ///< for publish() waiting for space in the queue
+    bool m_waitingEnabled;                  ///< blocking enabled on empty queue
+    std::atomic<quint64> m_droppedFrames;
+    std::function<void()> m_frameCallback;
+    std::mutex m_callbackMutex;             ///< guards m_frameCallback and its calls
+};
+
+#endif // FRAMESUBSCRIBER_H
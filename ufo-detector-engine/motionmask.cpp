@@ -0,0 +1,102 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motionmask.h"
+#include <opencv2/core/version.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#if CV_MAJOR_VERSION >= 3
+#include <opencv2/core/hal/intrin.hpp>
+#endif
+
+// universal intrinsics compile to SSE2 or NEON, whichever is the baseline of the target
+#if defined(CV_SIMD128) && CV_SIMD128
+#define MOTION_MASK_SIMD
+#endif
+
+void MotionMask::threeFrameDifference(const cv::Mat& prev, const cv::Mat& current, const cv::Mat& next,
+                                      int threshold, cv::Mat& mask)
+{
+    CV_Assert(next.type() == CV_8UC1);
+    CV_Assert((prev.type() == next.type()) && (prev.size() == next.size()));
+    CV_Assert((current.type() == next.type()) && (current.size() == next.size()));
+
+    mask.create(next.size(), CV_8UC1);
+    // as in cv::threshold(), difference of 8-bit values is always or never above these
+    if (threshold < 0)
+    {
+        mask.setTo(255);
+        return;
+    }
+    if (threshold >= 255)
+    {
+        mask.setTo(0);
+        return;
+    }
+
+    cv::Size size = next.size();
+    if (prev.isContinuous() && current.isContinuous() && next.isContinuous() && mask.isContinuous())
+    {
+        size.width *= size.height;
+        size.height = 1;
+    }
+    const uchar limit = (uchar)threshold;
+#ifdef MOTION_MASK_SIMD
+    const cv::v_uint8x16 limits = cv::v_setall_u8(limit);
+#endif
+
+    for (int y = 0; y < size.height; y++)
+    {
+        const uchar* prevRow = prev.ptr<uchar>(y);
+        const uchar* currentRow = current.ptr<uchar>(y);
+        const uchar* nextRow = next.ptr<uchar>(y);
+        uchar* maskRow = mask.ptr<uchar>(y);
+        int x = 0;
+#ifdef MOTION_MASK_SIMD
+        for (; x <= size.width - cv::v_uint8x16::nlanes; x += cv::v_uint8x16::nlanes)
+        {
+            const cv::v_uint8x16 nextPixels = cv::v_load(nextRow + x);
+            const cv::v_uint8x16 change = cv::v_absdiff(cv::v_load(prevRow + x), nextPixels)
+                    & cv::v_absdiff(cv::v_load(currentRow + x), nextPixels);
+            // comparison gives all bits set, which is 255
+            cv::v_store(maskRow + x, change > limits);
+        }
+#endif
+        for (; x < size.width; x++)
+        {
+            const int change = std::abs(prevRow[x] - nextRow[x]) & std::abs(currentRow[x] - nextRow[x]);
+            maskRow[x] = (change > limit) ? 255 : 0;
+        }
+    }
+}
+
+double MotionMask::binaryStdDev(const cv::Mat& mask)
+{
+    CV_Assert(mask.type() == CV_8UC1);
+    if (mask.empty())
+    {
+        return 0;
+    }
+    // same arithmetic as in cv::meanStdDev(), so that results compare equal
+    const double scale = 1.0 / (double)mask.total();
+    const double changed = cv::countNonZero(mask);
+    const double mean = 255.0 * changed * scale;
+    return std::sqrt(std::max(255.0 * 255.0 * changed * scale - mean * mean, 0.0));
+}
@@ -0,0 +1,56 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOTIONMASK_H
+#define MOTIONMASK_H
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Motion mask of three consecutive grayscale frames.
+ *
+ * Replaces the absdiff/absdiff/bitwise_and/threshold chain of the detector with a
+ * single pass over the frames, without temporary images. The result is the same as
+ * with the OpenCV chain, pixel for pixel.
+ */
+class MotionMask
+{
+public:
+    /**
+     * @brief Mark pixels which changed more than threshold in both of the two latest frame pairs.
+     *
+     * Same as threshold(absdiff(prev, next) & absdiff(current, next), threshold, 255, THRESH_BINARY).
+     * @param prev oldest frame, CV_8UC1
+     * @param current middle frame, same size and type as prev
+     * @param next newest frame, same size and type as prev
+     * @param threshold pixel value difference which is not yet motion
+     * @param mask result, 255 where there's motion and 0 elsewhere, must not be one of the frames
+     */
+    static void threeFrameDifference(const cv::Mat& prev, const cv::Mat& current, const cv::Mat& next,
+                                     int threshold, cv::Mat& mask);
+
+    /**
+     * @brief Standard deviation of a mask containing only values 0 and 255.
+     *
+     * Counted from the number of non-zero pixels, giving the same value as cv::meanStdDev().
+     * @param mask CV_8UC1
+     */
+    static double binaryStdDev(const cv::Mat& mask);
+};
+
+#endif // MOTIONMASK_H
@@ -0,0 +1,79 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "opencvcapturebackend.h"
+#include <QDebug>
+
+OpencvCaptureBackend::OpencvCaptureBackend(int index)
+{
+    m_index = index;
+}
+
+OpencvCaptureBackend::~OpencvCaptureBackend()
+{
+    close();
+}
+
+bool OpencvCaptureBackend::open(int width, int height)
+{
+    m_webcam.open(m_index);
+    if (!m_webcam.isOpened())
+    {
+        return false;
+    }
+    m_webcam.set(CV_CAP_PROP_FRAME_WIDTH, width);
+    m_webcam.set(CV_CAP_PROP_FRAME_HEIGHT, height);
+    return true;
+}
+
+void OpencvCaptureBackend::close()
+{
+    m_webcam.release();
+}
+
+bool OpencvCaptureBackend::isOpened()
+{
+    return m_webcam.isOpened();
+}
+
+bool OpencvCaptureBackend::readFrame(CameraFrame* frame)
+{
+    cv::Mat image;
+
+    if (!m_webcam.read(image) || image.empty())
+    {
+        return false;
+    }
+    // image is a new buffer on every read, so the frame can own it
+    frame->m_image = image;
+    frame->m_pixelFormat = CameraFrame::BGR;
+    // V4L2 drivers give buffer timestamps in CLOCK_MONOTONIC which is the clock of FrameClock in Linux.
+    // Other backends may give something else here, Camera checks the value before using it.
+    double driverTimestampMs = m_webcam.get(CV_CAP_PROP_POS_MSEC);
+    if (driverTimestampMs > 0)
+    {
+        frame->m_timestamp = FrameClock::time_point(std::chrono::microseconds((qint64)(driverTimestampMs * 1000)));
+    }
+    return true;
+}
+
+cv::Size OpencvCaptureBackend::frameSize()
+{
+    return cv::Size(m_webcam.get(CV_CAP_PROP_FRAME_WIDTH), m_webcam.get(CV_CAP_PROP_FRAME_HEIGHT));
+}
@@ -0,0 +1,56 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef OPENCVCAPTUREBACKEND_H
+#define OPENCVCAPTUREBACKEND_H
+
+#include "capturebackend.h"
+#include <opencv2/highgui/highgui.hpp>
+
+/**
+ * @brief Capture backend using OpenCV VideoCapture. Frames are BGR.
+ */
+class OpencvCaptureBackend : public CaptureBackend
+{
+public:
+    /**
+     * @param index camera index as used by OpenCV
+     */
+    explicit OpencvCaptureBackend(int index);
+
+    ~OpencvCaptureBackend();
+
+    bool open(int width, int height) override;
+
+    void close() override;
+
+    bool isOpened() override;
+
+    bool readFrame(CameraFrame* frame) override;
+
+    cv::Size frameSize() override;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    int m_index;
+    cv::VideoCapture m_webcam;
+};
+
+#endif // OPENCVCAPTUREBACKEND_H
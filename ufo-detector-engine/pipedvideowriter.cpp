@@ -0,0 +1,296 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipedvideowriter.h"
+#include <QDebug>
+
+namespace {
+
+// Matroska element IDs, including their length marker bits
+const quint32 EBML_ID = 0x1A45DFA3;
+const quint32 EBML_VERSION_ID = 0x4286;
+const quint32 EBML_READ_VERSION_ID = 0x42F7;
+const quint32 EBML_MAX_ID_LENGTH_ID = 0x42F2;
+const quint32 EBML_MAX_SIZE_LENGTH_ID = 0x42F3;
+const quint32 DOC_TYPE_ID = 0x4282;
+const quint32 DOC_TYPE_VERSION_ID = 0x4287;
+const quint32 DOC_TYPE_READ_VERSION_ID = 0x4285;
+const quint32 SEGMENT_ID = 0x18538067;
+const quint32 INFO_ID = 0x1549A966;
+const quint32 TIMECODE_SCALE_ID = 0x2AD7B1;
+const quint32 MUXING_APP_ID = 0x4D80;
+const quint32 WRITING_APP_ID = 0x5741;
+const quint32 TRACKS_ID = 0x1654AE6B;
+const quint32 TRACK_ENTRY_ID = 0xAE;
+const quint32 TRACK_NUMBER_ID = 0xD7;
+const quint32 TRACK_UID_ID = 0x73C5;
+const quint32 TRACK_TYPE_ID = 0x83;
+const quint32 CODEC_ID_ID = 0x86;
+const quint32 DEFAULT_DURATION_ID = 0x23E383;
+const quint32 VIDEO_ID = 0xE0;
+const quint32 PIXEL_WIDTH_ID = 0xB0;
+const quint32 PIXEL_HEIGHT_ID = 0xBA;
+const quint32 COLOUR_SPACE_ID = 0x2EB524;
+const quint32 CLUSTER_ID = 0x1F43B675;
+const quint32 TIMECODE_ID = 0xE7;
+const quint32 SIMPLE_BLOCK_ID = 0xA3;
+
+const int SIZE_LENGTH = 8;                  ///< all element sizes are written in the longest form
+const quint64 UNKNOWN_SIZE = 0x00FFFFFFFFFFFFFFULL;    ///< size of a live stream, all value bits set
+const int SIMPLE_BLOCK_HEADER_LENGTH = 4;   ///< track number, relative timecode, flags
+
+void appendId(QByteArray& data, quint32 id) {
+    int length = (id > 0xFFFFFF) ? 4 : (id > 0xFFFF) ? 3 : (id > 0xFF) ? 2 : 1;
+    for (int i = length - 1; i >= 0; i--) {
+        data.append((char)((id >> (8 * i)) & 0xFF));
+    }
+}
+
+void appendSize(QByteArray& data, quint64 size) {
+    data.append((char)0x01);
+    for (int i = SIZE_LENGTH - 2; i >= 0; i--) {
+        data.append((char)((size >> (8 * i)) & 0xFF));
+    }
+}
+
+void appendElement(QByteArray& data, quint32 id, const QByteArray& payload) {
+    appendId(data, id);
+    appendSize(data, payload.size());
+    data.append(payload);
+}
+
+void appendUInt(QByteArray& data, quint32 id, quint64 value) {
+    QByteArray payload;
+    for (int i = 7; i >= 0; i--) {
+        payload.append((char)((value >> (8 * i)) & 0xFF));
+    }
+    appendElement(data, id, payload);
+}
+
+void appendString(QByteArray& data, quint32 id, const char* value) {
+    appendElement(data, id, QByteArray(value));
+}
+
+}
+
+PipedVideoWriter::PipedVideoWriter() {
+    m_segmentSeconds = 0;
+    m_variableFrameRate = false;
+    m_fps = 0;
+    m_lastTimestampMsecs = -1;
+    m_failed = false;
+    m_writeTimeoutMs = ENCODER_WRITE_TIMEOUT_MS;
+}
+
+PipedVideoWriter::~PipedVideoWriter() {
+    release();
+}
+
+void PipedVideoWriter::setSegmenting(int segmentSeconds, QString segmentListFileName) {
+    m_segmentSeconds = qMax(0, segmentSeconds);
+    m_segmentListFileName = segmentListFileName;
+}
+
+void PipedVideoWriter::setVariableFrameRate(bool enabled) {
+    m_variableFrameRate = enabled;
+}
+
+bool PipedVideoWriter::open(QString encoderLocation, QString encoderCodecStr, QString fileName, double fps, cv::Size frameSize) {
+    release();
+    m_frameSize = frameSize;
+    m_fps = fps;
+    m_lastTimestampMsecs = -1;
+    m_failed = false;
+    m_encoder.reset(new QProcess());
+    // progress output isn't read while recording, it would only fill the buffer
+    m_encoder->setStandardOutputFile(QProcess::nullDevice());
+    m_encoder->start(encoderLocation, encoderArguments(encoderCodecStr, fileName, fps, frameSize,
+                                                       m_segmentSeconds, m_segmentListFileName, m_variableFrameRate));
+    if (!m_encoder->waitForStarted(ENCODER_START_TIMEOUT_MS)) {
+        qDebug() << "ERROR: Failed to start video encoder" << encoderLocation << m_encoder->errorString();
+        m_encoder.reset();
+        return false;
+    }
+    if (m_variableFrameRate) {
+        QByteArray header = matroskaHeader(frameSize, fps);
+        pipe(header.constData(), header.size(), false);
+    }
+    return true;
+}
+
+bool PipedVideoWriter::isOpened() {
+    return (m_encoder != nullptr);
+}
+
+bool PipedVideoWriter::write(const cv::Mat& frame, qint64 timestampMsecs) {
+    if (!m_encoder || m_failed) {
+        return false;
+    }
+    if ((frame.size() != m_frameSize) || (frame.type() != CV_8UC3)) {
+        return false;
+    }
+    // rows must follow each other in the pipe
+    cv::Mat continuousFrame = frame.isContinuous() ? frame : frame.clone();
+    const qint64 frameBytes = (qint64)continuousFrame.total() * continuousFrame.elemSize();
+    if (m_variableFrameRate) {
+        if ((timestampMsecs < 0) || (timestampMsecs <= m_lastTimestampMsecs)) {
+            timestampMsecs = (m_lastTimestampMsecs < 0) ? 0 : m_lastTimestampMsecs + qMax(1, qRound(1000.0 / m_fps));
+        }
+        m_lastTimestampMsecs = timestampMsecs;
+        QByteArray header = matroskaFrameHeader(timestampMsecs, frameBytes);
+        pipe(header.constData(), header.size(), false);
+    }
+    // QProcess buffers all of it; wait until the pipe has taken the frame to keep memory bounded
+    pipe(reinterpret_cast<const char*>(continuousFrame.data), frameBytes, true);
+    if (m_failed) {
+        qDebug() << "ERROR: Video encoder quit while recording:" << m_encoder->readAllStandardError();
+    }
+    return !m_failed;
+}
+
+bool PipedVideoWriter::pipe(const char* data, qint64 size, bool waitWritten) {
+    if (m_encoder->write(data, size) != size) {
+        m_failed = true;
+    }
+    while (waitWritten && !m_failed && (m_encoder->bytesToWrite() > 0)) {
+        if (!m_encoder->waitForBytesWritten(m_writeTimeoutMs)) {
+            m_failed = true;
+            if (m_encoder->state() != QProcess::NotRunning) {
+                // stalled encoder would block the recording for good
+                qDebug() << "ERROR: Video encoder didn't take a frame in" << m_writeTimeoutMs << "ms, killing it";
+                m_encoder->kill();
+                m_encoder->waitForFinished();
+            }
+        }
+    }
+    return !m_failed;
+}
+
+bool PipedVideoWriter::release() {
+    if (!m_encoder) {
+        return false;
+    }
+    m_encoder->closeWriteChannel();
+    if ((m_encoder->state() != QProcess::NotRunning) && !m_encoder->waitForFinished(ENCODER_FINISH_TIMEOUT_MS)) {
+        qDebug() << "ERROR: Video encoder didn't finish, killing it";
+        m_encoder->kill();
+        m_encoder->waitForFinished();
+        m_failed = true;
+    }
+    bool success = !m_failed && (m_encoder->exitStatus() == QProcess::NormalExit) && (m_encoder->exitCode() == 0);
+    if (!success) {
+        qDebug() << "ERROR: Video encoding failed:" << m_encoder->readAllStandardError();
+    }
+    m_encoder.reset();
+    return success;
+}
+
+QStringList PipedVideoWriter::encoderArguments(QString encoderCodecStr, QString fileName, double fps, cv::Size frameSize,
+                                               int segmentSeconds, QString segmentListFileName, bool variableFrameRate) {
+    QStringList args;
+    // these parameters are ok only for ffmpeg and avconv (which are more or less compatible)
+    args << "-y" << "-loglevel" << "error";
+    if (variableFrameRate) {
+        // size, pixel format and nominal frame rate are in the stream header
+        args << "-f" << "matroska" << "-i" << "-";
+    } else {
+        args << "-f" << "rawvideo" << "-pix_fmt" << "bgr24"
+             << "-s" << QString("%1x%2").arg(frameSize.width).arg(frameSize.height)
+             << "-r" << QString::number(fps) << "-i" << "-";
+    }
+    // encoder picks the number of frame/slice threads
+    args << "-vcodec" << encoderCodecStr << "-threads" << "0";
+    if (variableFrameRate) {
+        // keep the timestamps instead of duplicating frames to constant frame rate
+        args << "-vsync" << "vfr";
+    }
+    if (segmentSeconds > 0) {
+        // segments can only start at key frames; each segment plays on its own from time 0
+        args << "-force_key_frames" << QString("expr:gte(t,n_forced*%1)").arg(segmentSeconds)
+             << "-f" << "segment" << "-segment_time" << QString::number(segmentSeconds)
+             << "-segment_format" << "matroska" << "-reset_timestamps" << "1"
+             << "-segment_list" << segmentListFileName << "-segment_list_type" << "ffconcat";
+    }
+    args << fileName;
+    return args;
+}
+
+QByteArray PipedVideoWriter::matroskaHeader(cv::Size frameSize, double fps) {
+    QByteArray header;
+
+    QByteArray ebml;
+    appendUInt(ebml, EBML_VERSION_ID, 1);
+    appendUInt(ebml, EBML_READ_VERSION_ID, 1);
+    appendUInt(ebml, EBML_MAX_ID_LENGTH_ID, 4);
+    appendUInt(ebml, EBML_MAX_SIZE_LENGTH_ID, 8);
+    appendString(ebml, DOC_TYPE_ID, "matroska");
+    appendUInt(ebml, DOC_TYPE_VERSION_ID, 2);
+    appendUInt(ebml, DOC_TYPE_READ_VERSION_ID, 2);
+    appendElement(header, EBML_ID, ebml);
+
+    // segment goes on until the end of the stream
+    appendId(header, SEGMENT_ID);
+    appendSize(header, UNKNOWN_SIZE);
+
+    QByteArray info;
+    appendUInt(info, TIMECODE_SCALE_ID, 1000000);   // nanoseconds per timestamp unit
+    appendString(info, MUXING_APP_ID, "UFO Detector");
+    appendString(info, WRITING_APP_ID, "UFO Detector");
+    appendElement(header, INFO_ID, info);
+
+    QByteArray video;
+    appendUInt(video, PIXEL_WIDTH_ID, frameSize.width);
+    appendUInt(video, PIXEL_HEIGHT_ID, frameSize.height);
+    // raw pixel format as fourcc: BGR, 24 bits per pixel
+    QByteArray colourSpace;
+    colourSpace.append('B').append('G').append('R').append((char)24);
+    appendElement(video, COLOUR_SPACE_ID, colourSpace);
+
+    QByteArray trackEntry;
+    appendUInt(trackEntry, TRACK_NUMBER_ID, 1);
+    appendUInt(trackEntry, TRACK_UID_ID, 1);
+    appendUInt(trackEntry, TRACK_TYPE_ID, 1);   // video
+    appendString(trackEntry, CODEC_ID_ID, "V_UNCOMPRESSED");
+    if (fps > 0) {
+        // nominal frame rate, used by the encoder for its time base
+        appendUInt(trackEntry, DEFAULT_DURATION_ID, (quint64)qRound64(1e9 / fps));
+    }
+    appendElement(trackEntry, VIDEO_ID, video);
+    QByteArray tracks;
+    appendElement(tracks, TRACK_ENTRY_ID, trackEntry);
+    appendElement(header, TRACKS_ID, tracks);
+    return header;
+}
+
+QByteArray PipedVideoWriter::matroskaFrameHeader(qint64 timestampMsecs, qint64 frameBytes) {
+    // one frame per cluster, so the block timecode relative to the cluster is always 0
+    QByteArray timecode;
+    appendUInt(timecode, TIMECODE_ID, timestampMsecs);
+    const qint64 blockSize = SIMPLE_BLOCK_HEADER_LENGTH + frameBytes;
+
+    QByteArray header;
+    appendId(header, CLUSTER_ID);
+    appendSize(header, timecode.size() + 1 + SIZE_LENGTH + blockSize);
+    header.append(timecode);
+    appendId(header, SIMPLE_BLOCK_ID);
+    appendSize(header, blockSize);
+    header.append((char)0x81);  // track number 1
+    header.append((char)0).append((char)0);     // relative timecode
+    header.append((char)0x80);  // key frame
+    return header;
+}
@@ -0,0 +1,143 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPEDVIDEOWRITER_H
+#define PIPEDVIDEOWRITER_H
+
+#include <QByteArray>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Video writer which encodes with the external encoder (ffmpeg, avconv) while
+ * frames are written.
+ *
+ * Frames are piped to the standard input of the encoder as raw BGR video, so
+ * codecs which OpenCV doesn't support can be recorded without a raw temporary
+ * video and a second encoding pass. Use from a single thread; the encoder
+ * process is driven with the blocking QProcess functions and needs no event loop.
+ *
+ * With segmenting, the encoder writes fixed-duration Matroska files and lists
+ * each one when it's finished, so only the current segment is lost if the
+ * application or the encoder is killed.
+ *
+ * With variable frame rate, each frame is written once with its timestamp. The raw
+ * frames are then wrapped in a minimal Matroska stream, which carries the timestamps
+ * to the encoder, and the video file must be of a container with timestamps (.mkv).
+ */
+class PipedVideoWriter
+{
+public:
+    PipedVideoWriter();
+
+    /**
+     * @brief Stops the encoder, see release().
+     */
+    ~PipedVideoWriter();
+
+    /**
+     * @brief Write segments instead of one video file. Call before open().
+     * @param segmentSeconds segment duration, 0 to write one file
+     * @param segmentListFileName list of finished segments, in ffconcat format
+     */
+    void setSegmenting(int segmentSeconds, QString segmentListFileName);
+
+    /**
+     * @brief Write frames with timestamps instead of at constant frame rate. Call before open().
+     * @param enabled
+     */
+    void setVariableFrameRate(bool enabled);
+
+    /**
+     * @brief Start the encoder.
+     * @param encoderLocation encoder executable
+     * @param encoderCodecStr codec as encoder string, see VideoCodecSupportInfo::fourccToEncoderString()
+     * @param fileName video file, overwritten if it exists. With segmenting, a pattern with %03d for the segment number.
+     * @param fps frame rate, with variable frame rate the nominal (highest) one
+     * @param frameSize size of all frames
+     * @return true if the encoder started
+     */
+    bool open(QString encoderLocation, QString encoderCodecStr, QString fileName, double fps, cv::Size frameSize);
+
+    bool isOpened();
+
+    /**
+     * @brief Pipe one frame to the encoder. Blocks while the encoder is behind.
+     * @param frame 8-bit BGR image of the frame size given to open()
+     * @param timestampMsecs presentation time from the beginning of the video, used with
+     * variable frame rate. Negative or not increasing time is one frame period after the previous frame.
+     * @return false if the frame is of wrong size or type, or the encoder has quit
+     */
+    bool write(const cv::Mat& frame, qint64 timestampMsecs = -1);
+
+    /**
+     * @brief End the input and wait until the encoder has finished the video file.
+     * @return true if the encoder finished successfully
+     */
+    bool release();
+
+    /**
+     * @brief Encoder command line arguments for raw BGR frames from standard input.
+     * @param segmentSeconds segment duration, 0 to write one file
+     * @param segmentListFileName list of segments, used with segmentSeconds
+     * @param variableFrameRate frames come in a Matroska stream with timestamps
+     */
+    static QStringList encoderArguments(QString encoderCodecStr, QString fileName, double fps, cv::Size frameSize,
+                                        int segmentSeconds = 0, QString segmentListFileName = QString(),
+                                        bool variableFrameRate = false);
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const int ENCODER_START_TIMEOUT_MS = 5000;
+    static const int ENCODER_FINISH_TIMEOUT_MS = 60000;    ///< encoding what's left in the pipe, killed after that
+    static const int ENCODER_WRITE_TIMEOUT_MS = 30000;     ///< encoder is killed if it doesn't take a frame in this time
+
+    std::unique_ptr<QProcess> m_encoder;
+    cv::Size m_frameSize;
+    int m_segmentSeconds;
+    QString m_segmentListFileName;
+    bool m_variableFrameRate;
+    double m_fps;
+    qint64 m_lastTimestampMsecs;    ///< timestamp of previous frame with variable frame rate, -1 before first
+    bool m_failed;      ///< encoder quit or couldn't take a frame
+    int m_writeTimeoutMs;   ///< ENCODER_WRITE_TIMEOUT_MS, shorter in tests
+
+    /**
+     * @brief Pipe data to the encoder.
+     * @param waitWritten wait until the pipe has taken all of it
+     */
+    bool pipe(const char* data, qint64 size, bool waitWritten);
+
+    /**
+     * @brief Beginning of Matroska stream with one raw BGR video track, timestamps in milliseconds.
+     */
+    static QByteArray matroskaHeader(cv::Size frameSize, double fps);
+
+    /**
+     * @brief Matroska cluster of one frame, without the frame data which follows it.
+     * @param timestampMsecs
+     * @param frameBytes size of the frame data
+     */
+    static QByteArray matroskaFrameHeader(qint64 timestampMsecs, qint64 frameBytes);
+};
+
+#endif // PIPEDVIDEOWRITER_H
@@ -0,0 +1,184 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipelinestats.h"
+#include <QDebug>
+
+Histogram::Histogram() {
+    reset();
+}
+
+void Histogram::add(quint64 value) {
+    m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    quint64 previousMax = m_max.load(std::memory_order_relaxed);
+    while ((value > previousMax) && !m_max.compare_exchange_weak(previousMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        m_buckets[i].fetch_add(other.bucketCount(i), std::memory_order_relaxed);
+    }
+    m_count.fetch_add(other.count(), std::memory_order_relaxed);
+    m_sum.fetch_add(other.sum(), std::memory_order_relaxed);
+    quint64 otherMax = other.max();
+    quint64 previousMax = m_max.load(std::memory_order_relaxed);
+    while ((otherMax > previousMax) && !m_max.compare_exchange_weak(previousMax, otherMax, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::reset() {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        m_buckets[i] = 0;
+    }
+    m_count = 0;
+    m_sum = 0;
+    m_max = 0;
+}
+
+quint64 Histogram::count() const {
+    return m_count.load(std::memory_order_relaxed);
+}
+
+quint64 Histogram::sum() const {
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+quint64 Histogram::max() const {
+    return m_max.load(std::memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+    quint64 samples = count();
+    return samples ? ((double)sum() / samples) : 0.0;
+}
+
+quint64 Histogram::percentile(double fraction) const {
+    quint64 samples = count();
+    if (samples == 0) {
+        return 0;
+    }
+    quint64 limit = qMax((quint64)1, (quint64)(fraction * samples + 0.5));
+    quint64 cumulative = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        cumulative += bucketCount(i);
+        if (cumulative >= limit) {
+            return (i == 0) ? 0 : qMin(((quint64)1 << i) - 1, max());
+        }
+    }
+    return max();
+}
+
+quint64 Histogram::bucketCount(int index) const {
+    if ((index < 0) || (index >= BUCKET_COUNT)) {
+        return 0;
+    }
+    return m_buckets[index].load(std::memory_order_relaxed);
+}
+
+int Histogram::bucketIndex(quint64 value) {
+    int index = 0;
+    while (value && (index < (BUCKET_COUNT - 1))) {
+        value >>= 1;
+        index++;
+    }
+    return index;
+}
+
+
+VideoBufferStats::VideoBufferStats() {
+    reset();
+}
+
+void VideoBufferStats::reset() {
+    m_occupancy.reset();
+    m_highWaterMark = 0;
+    m_producerWaitUs.reset();
+    m_consumerWaitUs.reset();
+    m_rejectedFrames = 0;
+    m_blockedPushes = 0;
+    m_droppedOldestFrames = 0;
+    m_droppedNewestFrames = 0;
+    m_coalescedFrames = 0;
+    m_spilledFrames = 0;
+    m_spoolHighWaterMark = 0;
+}
+
+void VideoBufferStats::merge(const VideoBufferStats& other) {
+    m_occupancy.merge(other.m_occupancy);
+    m_highWaterMark = qMax((int)m_highWaterMark, (int)other.m_highWaterMark);
+    m_producerWaitUs.merge(other.m_producerWaitUs);
+    m_consumerWaitUs.merge(other.m_consumerWaitUs);
+    m_rejectedFrames += other.m_rejectedFrames;
+    m_blockedPushes += other.m_blockedPushes;
+    m_droppedOldestFrames += other.m_droppedOldestFrames;
+    m_droppedNewestFrames += other.m_droppedNewestFrames;
+    m_coalescedFrames += other.m_coalescedFrames;
+    m_spilledFrames += other.m_spilledFrames;
+    m_spoolHighWaterMark = qMax((int)m_spoolHighWaterMark, (int)other.m_spoolHighWaterMark);
+}
+
+
+RecordingStats::RecordingStats() {
+    m_videoBufferCapacity = 0;
+    m_videoSpoolCapacity = 0;
+    reset();
+}
+
+void RecordingStats::reset() {
+    m_cameraFrames = 0;
+    m_cameraDroppedFrames = 0;
+    m_skippedFrames = 0;
+    m_poolDroppedFrames = 0;
+    m_bufferDroppedFrames = 0;
+    m_duplicatedFrames = 0;
+    m_prerollFrames = 0;
+    m_writtenFrames = 0;
+    m_bytesWritten = 0;
+    m_flushBacklogBytes = 0;
+    m_writeLatencyUs.reset();
+    m_videoBuffer.reset();
+}
+
+void RecordingStats::print() const {
+    qDebug() << "Recording statistics:";
+    qDebug() << "  camera:" << m_cameraFrames << "frames received," << m_cameraDroppedFrames << "dropped by camera,"
+             << m_skippedFrames << "skipped over video frame rate";
+    qDebug() << "  video buffer: high-water mark" << m_videoBuffer.m_highWaterMark << "of" << m_videoBufferCapacity
+             << "frames, mean occupancy" << m_videoBuffer.m_occupancy.mean()
+             << "," << m_poolDroppedFrames << "dropped on exhausted frame pool,"
+             << m_bufferDroppedFrames << "left unwritten";
+    qDebug() << "  buffer overflow:" << m_videoBuffer.m_blockedPushes << "blocked pushes,"
+             << m_videoBuffer.m_droppedOldestFrames << "oldest frames dropped,"
+             << m_videoBuffer.m_droppedNewestFrames << "newest frames dropped,"
+             << m_videoBuffer.m_coalescedFrames << "frames coalesced";
+    qDebug() << "  disk spool:" << m_videoBuffer.m_spilledFrames << "frames spilled, high-water mark"
+             << m_videoBuffer.m_spoolHighWaterMark << "of" << m_videoSpoolCapacity << "frames";
+    qDebug() << "  producer wait (us): mean" << m_videoBuffer.m_producerWaitUs.mean()
+             << "p99 <=" << m_videoBuffer.m_producerWaitUs.percentile(0.99) << "max" << m_videoBuffer.m_producerWaitUs.max();
+    qDebug() << "  consumer wait (us): mean" << m_videoBuffer.m_consumerWaitUs.mean()
+             << "p99 <=" << m_videoBuffer.m_consumerWaitUs.percentile(0.99) << "max" << m_videoBuffer.m_consumerWaitUs.max();
+    qDebug() << "  writer:" << m_writtenFrames << "frames written," << m_prerollFrames << "from pre-roll,"
+             << m_duplicatedFrames << "duplicates," << m_bytesWritten << "bytes";
+    qDebug() << "  staging:" << m_flushBacklogBytes << "bytes waiting to be moved to the result directory";
+    qDebug() << "  write latency (us): mean" << m_writeLatencyUs.mean()
+             << "p50 <=" << m_writeLatencyUs.percentile(0.5) << "p99 <=" << m_writeLatencyUs.percentile(0.99)
+             << "max" << m_writeLatencyUs.max();
+}
@@ -0,0 +1,126 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINESTATS_H
+#define PIPELINESTATS_H
+
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @brief Histogram of non-negative values in power of two buckets.
+ *
+ * Can be updated and read from different threads at the same time. Values
+ * read while being updated may be off by the samples being added.
+ */
+class Histogram
+{
+public:
+    Histogram();
+
+    void add(quint64 value);
+
+    /**
+     * @brief Add all samples of another histogram to this one.
+     */
+    void merge(const Histogram& other);
+
+    void reset();
+
+    quint64 count() const;
+    quint64 sum() const;
+    quint64 max() const;
+    double mean() const;
+
+    /**
+     * @brief Upper bound of values below which given fraction of the samples are.
+     * @param fraction 0.0 ... 1.0, e.g. 0.99 for 99th percentile
+     * @return upper bound of the bucket, or 0 if there are no samples
+     */
+    quint64 percentile(double fraction) const;
+
+    /**
+     * @brief Number of samples in bucket.
+     * @param index 0 for value 0, otherwise values from 2^(index-1) to 2^index - 1.
+     * The last bucket also holds all greater values.
+     */
+    quint64 bucketCount(int index) const;
+
+    static int bucketIndex(quint64 value);
+
+    static const int BUCKET_COUNT = 32;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    std::atomic<quint64> m_buckets[BUCKET_COUNT];
+    std::atomic<quint64> m_count;
+    std::atomic<quint64> m_sum;
+    std::atomic<quint64> m_max;
+};
+
+/**
+ * @brief VideoBuffer counters
+ */
+struct VideoBufferStats {
+    VideoBufferStats();
+    void reset();
+    void merge(const VideoBufferStats& other);
+
+    Histogram m_occupancy;          ///< frames in buffer after each push
+    std::atomic<int> m_highWaterMark;   ///< maximum number of frames in buffer
+    Histogram m_producerWaitUs;     ///< how long each push waited for free space, microseconds
+    Histogram m_consumerWaitUs;     ///< how long each pop waited for a frame, microseconds
+    std::atomic<quint64> m_rejectedFrames;  ///< pushes that failed because waiting was stopped
+    std::atomic<quint64> m_blockedPushes;   ///< pushes that waited for free space (Block)
+    std::atomic<quint64> m_droppedOldestFrames; ///< buffered frames removed to make room (DropOldest)
+    std::atomic<quint64> m_droppedNewestFrames; ///< pushed frames not buffered (DropNewest)
+    std::atomic<quint64> m_coalescedFrames;     ///< pushed frames replaced by a repeat of the previous frame (Coalesce)
+    std::atomic<quint64> m_spilledFrames;       ///< pushed frames written to the disk spool
+    std::atomic<int> m_spoolHighWaterMark;      ///< maximum number of frames in the disk spool
+};
+
+/**
+ * @brief Recorder counters of one recording, from camera to video file.
+ */
+struct RecordingStats {
+    RecordingStats();
+    void reset();
+
+    /**
+     * @brief Print the counters with qDebug().
+     */
+    void print() const;
+
+    std::atomic<quint64> m_cameraFrames;        ///< frames received from camera
+    std::atomic<quint64> m_cameraDroppedFrames; ///< frames camera dropped because recorder was late to read them
+    std::atomic<quint64> m_skippedFrames;       ///< frames not needed because camera is faster than video frame rate
+    std::atomic<quint64> m_poolDroppedFrames;   ///< frames dropped because frame pool was exhausted
+    std::atomic<quint64> m_bufferDroppedFrames; ///< buffered frames not written because the video was discarded
+    std::atomic<quint64> m_duplicatedFrames;    ///< extra copies of frames written to fill gaps
+    std::atomic<quint64> m_prerollFrames;       ///< video frames written from pre-roll
+    std::atomic<quint64> m_writtenFrames;       ///< all video frames written
+    std::atomic<quint64> m_bytesWritten;        ///< size of the video file
+    std::atomic<quint64> m_flushBacklogBytes;   ///< bytes waiting in the staging directory when the recording ended
+    Histogram m_writeLatencyUs;     ///< duration of each video frame write, microseconds
+    VideoBufferStats m_videoBuffer;
+    int m_videoBufferCapacity;
+    int m_videoSpoolCapacity;      ///< 0 when spilling to disk is disabled
+};
+
+#endif // PIPELINESTATS_H
@@ -0,0 +1,91 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prerollbuffer.h"
+#include <opencv2/highgui/highgui.hpp>
+
+PrerollBuffer::PrerollBuffer(qint64 durationMs, size_t memoryLimit) :
+    m_durationMs(durationMs), m_memoryLimit(memoryLimit), m_memoryUsage(0)
+{
+}
+
+bool PrerollBuffer::push(const CameraFrame& frame) {
+    Frame compressed;
+    if (!compress(frame, compressed.m_jpeg) || (compressed.m_jpeg.size() > m_memoryLimit)) {
+        return false;
+    }
+    compressed.m_wallClockMsecs = frame.m_wallClockMsecs;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_frames.empty()
+           && (((m_memoryUsage + compressed.m_jpeg.size()) > m_memoryLimit)
+               || ((compressed.m_wallClockMsecs - m_frames.front().m_wallClockMsecs) > m_durationMs))) {
+        m_memoryUsage -= m_frames.front().m_jpeg.size();
+        m_frames.pop_front();
+    }
+    m_memoryUsage += compressed.m_jpeg.size();
+    m_frames.push_back(std::move(compressed));
+    return true;
+}
+
+std::deque<PrerollBuffer::Frame> PrerollBuffer::takeFrames(qint64 beforeMsecs) {
+    std::deque<Frame> frames;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        frames.swap(m_frames);
+        m_memoryUsage = 0;
+    }
+    while (!frames.empty() && (frames.back().m_wallClockMsecs >= beforeMsecs)) {
+        frames.pop_back();
+    }
+    return frames;
+}
+
+void PrerollBuffer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frames.clear();
+    m_memoryUsage = 0;
+}
+
+int PrerollBuffer::count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frames.size();
+}
+
+size_t PrerollBuffer::memoryUsage() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryUsage;
+}
+
+bool PrerollBuffer::decode(const Frame& frame, cv::Mat& image) {
+    cv::imdecode(frame.m_jpeg, cv::IMREAD_COLOR, &image);
+    return !image.empty();
+}
+
+bool PrerollBuffer::compress(const CameraFrame& frame, std::vector<uchar>& jpeg) {
+    if (frame.m_pixelFormat == CameraFrame::MJPEG) {
+        // already compressed by camera
+        const uchar* data = frame.m_image.ptr<uchar>();
+        jpeg.assign(data, data + frame.m_image.total() * frame.m_image.elemSize());
+        return !jpeg.empty();
+    }
+    std::vector<int> params;
+    params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    params.push_back(JPEG_QUALITY);
+    return cv::imencode(".jpg", frame.bgrImage(), jpeg, params);
+}
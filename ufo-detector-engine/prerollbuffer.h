@@ -0,0 +1,104 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREROLLBUFFER_H
+#define PREROLLBUFFER_H
+
+#include "cameraframe.h"
+#include <QtGlobal>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Ring of the most recent camera frames, kept as JPEG images.
+ *
+ * Holds frames from before a detection so that they can be written at the
+ * beginning of the result video. The ring is bounded both by duration and by
+ * memory: when either limit is reached, the oldest frames are dropped.
+ * JPEG frames from camera are stored as such, other frames are compressed.
+ */
+class PrerollBuffer
+{
+public:
+    /**
+     * @brief Compressed frame.
+     */
+    struct Frame {
+        std::vector<uchar> m_jpeg;  ///< JPEG image
+        qint64 m_wallClockMsecs;    ///< capture time as milliseconds since epoch
+    };
+
+    /**
+     * @brief PrerollBuffer constructor
+     * @param durationMs how much video to keep, in milliseconds
+     * @param memoryLimit maximum total size of compressed frames, in bytes
+     */
+    PrerollBuffer(qint64 durationMs, size_t memoryLimit);
+
+    /**
+     * @brief Compress frame and add it to the ring, dropping old frames as needed.
+     * @param frame
+     * @return false if the frame couldn't be compressed or it alone exceeds the memory limit
+     */
+    bool push(const CameraFrame& frame);
+
+    /**
+     * @brief Take all frames out of the ring.
+     * @param beforeMsecs take only frames captured before this, later ones are dropped
+     * @return frames, oldest first
+     */
+    std::deque<Frame> takeFrames(qint64 beforeMsecs);
+
+    void clear();
+
+    int count();
+
+    /**
+     * @brief Total size of compressed frames in bytes.
+     */
+    size_t memoryUsage();
+
+    /**
+     * @brief Decode compressed frame.
+     * @param frame
+     * @param image decoded BGR image, reusing its buffer if possible
+     * @return false if decoding failed
+     */
+    static bool decode(const Frame& frame, cv::Mat& image);
+
+    static const int JPEG_QUALITY = 90;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    qint64 m_durationMs;
+    size_t m_memoryLimit;
+    std::mutex m_mutex;         ///< guards m_frames and m_memoryUsage
+    std::deque<Frame> m_frames;
+    size_t m_memoryUsage;
+
+    /**
+     * @brief JPEG image of frame.
+     * @return false if frame couldn't be compressed
+     */
+    static bool compress(const CameraFrame& frame, std::vector<uchar>& jpeg);
+};
+
+#endif // PREROLLBUFFER_H
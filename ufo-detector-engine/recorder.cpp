@@ -17,52 +17,158 @@
  */
 
 #include "recorder.h"
+#include <QRegularExpression>
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <signal.h>
+#endif
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
 
 Recorder::Recorder(Camera* cameraPtr, Config* configPtr, DataManager* dataManager) :
-    m_camera(cameraPtr), m_config(configPtr), m_dataManager(dataManager)
+    m_camera(cameraPtr), m_config(configPtr), m_dataManager(dataManager),
+    // boxes are needed for as many frames as the writer can be behind
+    m_trackOverlay(VIDEO_BUFFER_CAPACITY + qMax(0, configPtr->videoSpoolSeconds()) * DEFAULT_OUTPUT_FPS)
 {
     qDebug() << "Creating recorder";
     const int width = m_config->cameraWidth();
     const int height  = m_config->cameraHeight();
     m_drawRectangles = m_config->resultVideoWithObjectRectangles();
-    m_resultVideoDirName = m_config->resultVideoDir();
     m_thumbnailDirName = "thumbnails";
     m_thumbnailExtension = ".jpg";
 
-    QDir dir(QString(m_resultVideoDirName + "/" + m_thumbnailDirName));
-    if (!dir.exists())
-    {
-        dir.mkpath(".");
-    }
+    setResultVideoDir(m_config->resultVideoDir());
 
     m_videoFileExtension = ".avi";
+    m_configuredFps = m_config->videoFrameRate();
+    m_variableFrameRate = m_config->variableFrameRateVideo();
+    m_outputFps = DEFAULT_OUTPUT_FPS;
+    m_videoIsVariableFrameRate = false;
+    m_videoMsecs = 0;
     m_objectPositiveColor = Scalar(255, 0, 0);
     m_objectNegativeColor = Scalar(0, 0, 255);
-    m_objectRectangleColor = m_objectPositiveColor;
     m_videoResolution = Size(width, height);
     m_videoBuffer = NULL;
+    m_pipedVideoWriter = NULL;
+    m_framePool = NULL;
+    m_videoSpool = NULL;
+    if (m_config->videoSpoolSeconds() > 0)
+    {
+        QString spoolDir = m_config->videoSpoolDir();
+        QDir().mkpath(spoolDir);
+        removeStaleSpoolFiles(spoolDir);
+        QString spoolFileName = QString("%1/videospool-%2-%3.tmp").arg(spoolDir)
+                .arg(QCoreApplication::applicationPid()).arg((quintptr)this, 0, 16);
+        m_videoSpool = new FrameSpool(spoolFileName, m_config->videoSpoolSeconds() * DEFAULT_OUTPUT_FPS, m_videoResolution);
+        if (!m_videoSpool->isOpen())
+        {
+            delete m_videoSpool;
+            m_videoSpool = NULL;
+        }
+    }
+    m_preroll = NULL;
+    if (m_config->prerollSeconds() > 0)
+    {
+        m_preroll = new PrerollBuffer(m_config->prerollSeconds() * 1000LL,
+                (size_t)m_config->prerollMemoryMB() * 1024 * 1024);
+    }
+    m_prerollRunning = false;
+
+    bool policyOk = false;
+    m_overflowPolicy = VideoBuffer::overflowPolicyFromString(m_config->videoBufferOverflowPolicy(), &policyOk);
+    if (!policyOk)
+    {
+        qDebug() << "Unknown video buffer overflow policy" << m_config->videoBufferOverflowPolicy() << ", using coalesce";
+        m_overflowPolicy = VideoBuffer::Coalesce;
+    }
 
-    double aspectRatio = (double)width / (double)height;
-    m_defaultThumbnailSideLength = 80;
-    int thumbnailWidth = m_defaultThumbnailSideLength;
-    int thumbnailHeight = qBound(m_defaultThumbnailSideLength / 2,
-            (int)(thumbnailWidth / aspectRatio), m_defaultThumbnailSideLength);
-    m_thumbnailResolution = Size(thumbnailWidth, thumbnailHeight);
+    m_thumbnailWriter = new ThumbnailWriter(Size(width, height));
+    m_writeBehind = NULL;
+    if (!m_config->videoStagingDir().isEmpty())
+    {
+        // own directory, other recorders may use the same staging directory
+        m_stagingDirName = QString("%1/recorder-%2-%3").arg(m_config->videoStagingDir())
+                .arg(QCoreApplication::applicationPid()).arg((quintptr)this, 0, 16);
+        if (QDir().mkpath(m_stagingDirName))
+        {
+            m_writeBehind = new WriteBehindStage();
+            m_adoptedStagingDirNames = adoptStaleStagingDirs(m_config->videoStagingDir(), m_stagingDirName,
+                                                             m_resultVideoDirName, m_writeBehind);
+        }
+        else
+        {
+            qDebug() << "ERROR: Failed to create video staging directory" << m_stagingDirName;
+        }
+    }
 
     m_recording = false;
+    m_willSaveVideo = false;
+    m_encodingQueue = NULL;
+    setEncodingQueue(NULL);
     connect(this, SIGNAL(videoEncodingRequested(QString,QString)), this, SLOT(startEncodingVideo(QString,QString)));
     qDebug() << "Recorder created";
 }
 
+Recorder::~Recorder()
+{
+    stopPreroll();
+    stopRecording(false);
+    // a stopped video may still be written
+    finishRecordThread();
+    delete m_thumbnailWriter;
+    if (m_writeBehind)
+    {
+        // moves the videos still waiting, files which couldn't be moved are kept
+        m_writeBehind->waitForIdle();
+        delete m_writeBehind;
+        foreach (const QString& adoptedDirName, m_adoptedStagingDirNames)
+        {
+            QDir().rmdir(adoptedDirName + "/segments");
+            QDir().rmdir(adoptedDirName);
+        }
+        QDir().rmdir(m_stagingDirName + "/segments");
+        QDir().rmdir(m_stagingDirName);
+    }
+    delete m_framePool;
+    delete m_videoSpool;
+    delete m_preroll;
+}
+
 /*
  * Called from ActualDetector to start recording. Mat &firstFrame is the frame that caused the positive detection
  */
-void Recorder::startRecording(Mat &firstFrame)
+void Recorder::startRecording(Mat &firstFrame, QDateTime eventTime)
 {
     if (!m_recording)
     {
+        // previous video must be written before its buffers are reused
+        finishRecordThread();
+        // frames are reserved only while recording, they take hundreds of megabytes at high resolutions
+        m_framePool = new FramePool(FRAME_POOL_CAPACITY, m_videoResolution);
+        if (m_framePool->capacity() == 0)
+        {
+            qDebug() << "ERROR: Not enough memory for video frames, not recording";
+            delete m_framePool;
+            m_framePool = NULL;
+            return;
+        }
         m_firstFrame = firstFrame;
-        m_videoBuffer = new VideoBuffer(VIDEO_BUFFER_CAPACITY);
+        m_eventTime = eventTime.isValid() ? eventTime : QDateTime::currentDateTime();
+        m_stats.reset();
+        if (m_preroll)
+        {
+            m_prerollFrames = m_preroll->takeFrames(m_eventTime.toMSecsSinceEpoch());
+        }
+        m_outputFps = outputFrameRate();
+        m_videoBuffer = new VideoBuffer(VIDEO_BUFFER_CAPACITY, m_overflowPolicy);
+        m_videoBuffer->setSpool(m_videoSpool, m_framePool);
+        // queue lives in the main thread
+        QMetaObject::invokeMethod(m_encodingQueue, "recordingStarted", Qt::QueuedConnection);
+        m_willSaveVideo = false;
         m_recording = true;
         //m_currentFrame = m_camera->getWebcamFrame();
         if (!m_frameUpdateThread)
@@ -80,59 +186,169 @@ void Recorder::recordThread(){
     qDebug() << "++++++++recorder thread called+++";
     emit recordingStarted();
 
-    QString dateTime = QDateTime::currentDateTime().toString("yyyy-MM-dd--hh-mm-ss");
-    QString filenameTemp = m_resultVideoDirName + "/Capture--" + dateTime + "temp" + m_videoFileExtension;
-    QString filenameFinal = m_resultVideoDirName + "/Capture--" + dateTime + m_videoFileExtension;
+    QString dateTime = m_eventTime.toString("yyyy-MM-dd--hh-mm-ss");
     int recordCodec = m_config->resultVideoCodec();
     bool recordCodecIsFinal = true;
     VideoCodecSupportInfo* codecInfo = m_config->videoCodecSupportInfo();
+    const int fps = m_outputFps;
+    const int segmentSeconds = m_config->videoSegmentSeconds();
+    QString segmentListFileName;
+    QStringList segments;   // finished segments of the segment list
+
+    // frame timestamps need the encoder and a container which has them
+    m_videoIsVariableFrameRate = m_variableFrameRate && codecInfo->isEncoderSupported(recordCodec);
+    m_videoMsecs = 0;
+    QString videoFileExtension = m_videoIsVariableFrameRate ? ".mkv" : m_videoFileExtension;
+    // when staging, videos are written to fast storage and moved to the result directory afterwards
+    const QString writeDirName = m_writeBehind ? m_stagingDirName : m_resultVideoDirName;
+    const QString resultSegmentDirName = m_resultVideoDirName + "/segments";
+    QString filenameTemp = writeDirName + "/Capture--" + dateTime + "temp" + videoFileExtension;
+    QString filenameFinal = m_resultVideoDirName + "/Capture--" + dateTime + videoFileExtension;
+
+    if (segmentSeconds > 0 && codecInfo->isEncoderSupported(recordCodec))
+    {
+        // encode to segments in final codec, a crash loses only the segment being written
+        QString segmentDirName = writeDirName + "/segments";
+        QDir().mkpath(segmentDirName);
+        QDir().mkpath(resultSegmentDirName);
+        segmentListFileName = segmentDirName + "/Capture--" + dateTime + ".ffconcat";
+        m_pipedVideoWriter = new PipedVideoWriter();
+        m_pipedVideoWriter->setSegmenting(segmentSeconds, segmentListFileName);
+        m_pipedVideoWriter->setVariableFrameRate(m_videoIsVariableFrameRate);
+        if (!m_pipedVideoWriter->open(m_config->videoEncoderLocation(), codecInfo->fourccToEncoderString(recordCodec),
+                                      segmentDirName + "/Capture--" + dateTime + "--%03d.mkv", fps, m_videoResolution))
+        {
+            qDebug() << "ERROR: Failed to record video segments, recording one video file";
+            delete m_pipedVideoWriter;
+            m_pipedVideoWriter = NULL;
+            segmentListFileName.clear();
+        }
+    }
+
+    if (!m_pipedVideoWriter && m_videoIsVariableFrameRate)
+    {
+        m_pipedVideoWriter = new PipedVideoWriter();
+        m_pipedVideoWriter->setVariableFrameRate(true);
+        if (!m_pipedVideoWriter->open(m_config->videoEncoderLocation(), codecInfo->fourccToEncoderString(recordCodec),
+                                      filenameTemp, fps, m_videoResolution))
+        {
+            qDebug() << "ERROR: Failed to record variable frame rate video, using constant frame rate";
+            delete m_pipedVideoWriter;
+            m_pipedVideoWriter = NULL;
+            m_videoIsVariableFrameRate = false;
+            filenameTemp = writeDirName + "/Capture--" + dateTime + "temp" + m_videoFileExtension;
+            filenameFinal = m_resultVideoDirName + "/Capture--" + dateTime + m_videoFileExtension;
+        }
+    }
 
     // record temporary video directly with OpenCV if it supports the final codec
-    if (!codecInfo->isOpencvSupported(recordCodec))
+    if (!m_pipedVideoWriter && !codecInfo->isOpencvSupported(recordCodec))
     {
-        // no support in OpenCV -> record with raw video codec
-        recordCodec = codecInfo->stringToFourcc(codecInfo->rawVideoCodecStr());
-        if (codecInfo->isEncoderSupported(m_config->resultVideoCodec()))
+        if (codecInfo->isEncoderSupported(recordCodec))
         {
-            // encode only when encoder supports codec, otherwise video will be left raw video
-            recordCodecIsFinal = false;
+            // encode while recording, without raw video and a second pass
+            m_pipedVideoWriter = new PipedVideoWriter();
+            if (!m_pipedVideoWriter->open(m_config->videoEncoderLocation(), codecInfo->fourccToEncoderString(recordCodec),
+                                          filenameTemp, fps, m_videoResolution))
+            {
+                delete m_pipedVideoWriter;
+                m_pipedVideoWriter = NULL;
+                // encode only when encoder supports codec, otherwise video will be left raw video
+                recordCodecIsFinal = false;
+            }
         }
+        // no support in OpenCV -> record with raw video codec
+        recordCodec = codecInfo->stringToFourcc(codecInfo->rawVideoCodecStr());
+    }
+    if (!m_pipedVideoWriter)
+    {
+        m_videoWriter.open(filenameTemp.toStdString(), recordCodec, fps, m_videoResolution, true);
     }
-    m_videoWriter.open(filenameTemp.toStdString(), recordCodec, OUTPUT_FPS, m_videoResolution, true);
 
     qDebug() << "Video timestamp" << dateTime;
 
-    if (!m_videoWriter.isOpened())
+    if (!m_pipedVideoWriter && !m_videoWriter.isOpened())
     {
         qDebug() << "ERROR: Failed to write temporary video" << filenameTemp;
+        QMetaObject::invokeMethod(m_encodingQueue, "recordingFinished", Qt::QueuedConnection);
         return;
     }
 
-    QTime timer;
-    timer.start();
+    // preview samples one frame per second until the video gets long
+    m_thumbnailWriter->startPreview(fps);
+    long long writtenFrames = writePrerollFrames(m_eventTime.toMSecsSinceEpoch());
     if (m_firstFrame.data)
     {
-        m_videoWriter.write(m_firstFrame);
+        writeVideoFrame(m_firstFrame, m_videoMsecs);
+        writtenFrames++;
+        m_videoMsecs += 1000 / fps;
     }
 
-    while(m_recording)
+    const qint64 liveStartMsecs = m_videoMsecs;
+    FrameClock::time_point liveStartTimestamp;
+    bool hasLiveFrames = false;
+    // after recording stops, frames still in the buffer and spool are written if the video is saved
+    while(m_recording || m_willSaveVideo)
     {
-        BufferedVideoFrame* frame = m_videoBuffer->waitNextFrame();
-        if (frame) {
-            if (frame->m_frame && frame->m_frame->data) {
+        PooledFrame frame = m_framePool->adopt(m_videoBuffer->waitNextFrame());
+        if (!frame && !m_recording) {
+            // buffer and spool are empty after stopWait()
+            break;
+        }
+        if (frame && frame->m_frame->data) {
+            if (m_drawRectangles) {
+                drawTrackBoxes(*(frame->m_frame), frame->m_sequenceNumber);
+            }
+            const qint64 previousVideoMsecs = m_videoMsecs;
+            if (m_videoIsVariableFrameRate) {
+                // written once at its capture time, it stays visible until the next frame
+                if (!hasLiveFrames) {
+                    liveStartTimestamp = frame->m_timestamp;
+                    hasLiveFrames = true;
+                }
+                qint64 timestampMsecs = liveStartMsecs +
+                        std::chrono::duration_cast<std::chrono::milliseconds>(frame->m_timestamp - liveStartTimestamp).count();
+                writeVideoFrame(*(frame->m_frame), timestampMsecs);
+                writtenFrames++;
+                m_videoMsecs = timestampMsecs + (1 + frame->m_duplicateCount) * 1000 / fps;
+            } else {
                 for (int i=0; i <= frame->m_duplicateCount; i++) {
-                    m_videoWriter.write(*(frame->m_frame));
+                    writeVideoFrame(*(frame->m_frame));
+                    writtenFrames++;
                 }
-                frame->m_frame->release();
+                m_stats.m_duplicatedFrames += frame->m_duplicateCount;
+                m_videoMsecs = writtenFrames * 1000 / fps;
+            }
+            if (!segmentListFileName.isEmpty() && (m_videoMsecs / 1000 != previousVideoMsecs / 1000))
+            {
+                // about once per second of video
+                announceFinishedSegments(segmentListFileName, segments);
             }
-            delete frame->m_frame;
-            delete frame;
-            frame = NULL;
         }
     }
 
+    if (m_pipedVideoWriter)
+    {
+        // waits for the encoder to finish the video, it's only behind by what's in the pipe
+        if (!m_pipedVideoWriter->release())
+        {
+            qDebug() << "ERROR: Failed to encode video" << filenameTemp;
+        }
+        delete m_pipedVideoWriter;
+        m_pipedVideoWriter = NULL;
+    }
     m_videoWriter.release();
-    int millisec = timer.elapsed();
+    if (!segmentListFileName.isEmpty())
+    {
+        // counts the bytes of each segment
+        announceFinishedSegments(segmentListFileName, segments);
+    }
+    else
+    {
+        m_stats.m_bytesWritten = QFileInfo(filenameTemp).size();
+    }
+    // video length follows from frame timestamps
+    long long millisec = m_videoMsecs;
     QString videoLength = QString("%1:%2").arg( millisec / 60000, 2, 10, QChar('0'))
             .arg((millisec % 60000) / 1000, 2, 10, QChar('0'));
     qDebug() << "Video length" << videoLength;
@@ -140,135 +356,349 @@ void Recorder::recordThread(){
     if(m_willSaveVideo)
     {
         saveVideoThumbnailImage(m_firstFrame, dateTime);
-        m_dataManager->saveResultData(dateTime, videoLength);
-        if(!recordCodecIsFinal)
+        m_dataManager->saveResultData(m_resultVideoDirName, dateTime, videoLength);
+        if (!segmentListFileName.isEmpty())
+        {
+            // join segments to final video, stream copy is quick
+            moveToResultDir(segmentListFileName, resultSegmentDirName + "/" + QFileInfo(segmentListFileName).fileName(),
+                            [this, filenameFinal](QString listFileName) {
+                emit videoEncodingRequested(listFileName, filenameFinal);
+            });
+        }
+        else if(!recordCodecIsFinal)
         {
             // Convert raw video to final codec with external encoder
-            emit videoEncodingRequested(filenameTemp, filenameFinal);
+            moveToResultDir(filenameTemp, m_resultVideoDirName + "/" + QFileInfo(filenameTemp).fileName(),
+                            [this, filenameFinal](QString tempFileName) {
+                emit videoEncodingRequested(tempFileName, filenameFinal);
+            });
         }
         else
         {
             // Rename temp video to final
-            rename(filenameTemp.toLocal8Bit().data(), filenameFinal.toLocal8Bit().data());
-            qDebug() << "Finished recording, saved video";
-            emit recordingFinished();
+            moveToResultDir(filenameTemp, filenameFinal, [this](QString) {
+                qDebug() << "Finished recording, saved video";
+                emit recordingFinished();
+            });
         }
     }
     else
     {
+        if (!segmentListFileName.isEmpty())
+        {
+            foreach (const QString& segment, EncodingQueue::concatListFiles(segmentListFileName))
+            {
+                if (m_writeBehind)
+                {
+                    // after the segment has been moved
+                    m_writeBehind->remove(segment);
+                    m_writeBehind->remove(resultSegmentDirName + "/" + QFileInfo(segment).fileName());
+                }
+                else
+                {
+                    QFile::remove(segment);
+                }
+            }
+            QFile::remove(segmentListFileName);
+        }
+        m_thumbnailWriter->discardPreview();
         remove(filenameTemp.toLocal8Bit().data());
         qDebug() << "Finished recording, discarded video";
         emit recordingFinished();
     }
+    // encoding can start now, also when the recorder is not stopped yet
+    QMetaObject::invokeMethod(m_encodingQueue, "recordingFinished", Qt::QueuedConnection);
+}
+
+void Recorder::announceFinishedSegments(QString segmentListFileName, QStringList& announcedSegments)
+{
+    // encoder adds a segment to the list when it's closed
+    QStringList listedSegments = EncodingQueue::concatListFiles(segmentListFileName);
+    for (int i = announcedSegments.size(); i < listedSegments.size(); i++)
+    {
+        const QString segment = listedSegments.at(i);
+        announcedSegments << segment;
+        m_stats.m_bytesWritten += QFileInfo(segment).size();
+        // announced where it ends up
+        moveToResultDir(segment, m_resultVideoDirName + "/segments/" + QFileInfo(segment).fileName(),
+                        [this](QString fileName) { emit videoSegmentFinished(fileName); });
+    }
+}
+
+void Recorder::moveToResultDir(QString fileName, QString resultFileName, WriteBehindStage::FlushedCallback moved)
+{
+    if (m_writeBehind)
+    {
+        m_writeBehind->flush(fileName, resultFileName, moved);
+        return;
+    }
+    if (fileName != resultFileName)
+    {
+        rename(fileName.toLocal8Bit().data(), resultFileName.toLocal8Bit().data());
+    }
+    moved(resultFileName);
 }
 
 void Recorder::startEncodingVideo(QString tempVideoFileName, QString targetVideoFileName)
 {
-    QProcess* proc = new QProcess();
-    m_encoderProcesses.push_back(proc);
-    m_tempVideoFiles.push_back(tempVideoFileName);
-    QStringList args;
     int codec = m_config->resultVideoCodec();
     QString codecStr = m_config->videoCodecSupportInfo()->fourccToEncoderString(codec);
-    // these video encoder parameters are ok only for ffmpeg and avconv (which are more or less compatible)
-    args << "-i" << tempVideoFileName << "-vcodec" << codecStr << targetVideoFileName;
-    connect(proc, SIGNAL(finished(int)), this, SLOT(onVideoEncodingFinished()));
-    proc->start(m_config->videoEncoderLocation(), args);
+    if (tempVideoFileName.endsWith(".ffconcat"))
+    {
+        // segments are in final codec already
+        codecStr = "copy";
+    }
+    m_encodingTargets << targetVideoFileName;
+    m_encodingQueue->enqueue(tempVideoFileName, targetVideoFileName, codecStr);
 }
 
 /*
- * Called when the ffmpeg encoding finishes.  Removes the temporary video file
- * If no process is running emit recordingFinished()
+ * Called when an encoding job of the queue finishes, also those of other recorders if the queue is shared.
+ * If no video of this recorder is waiting for encoding emit recordingFinished()
  */
-void Recorder::onVideoEncodingFinished()
+void Recorder::onVideoEncodingFinished(QString targetFileName, bool success)
 {
-    QVector<unsigned int> markedForDeletion;
-    unsigned int i = 0;
-
-    for (i = 0; i < m_encoderProcesses.size(); i++)
+    if (!m_encodingTargets.removeOne(targetFileName))
     {
-        QProcess* process = m_encoderProcesses.at(i);
-        if (process && (process->state() == QProcess::NotRunning))
-        {
-            markedForDeletion << i;
-        }
+        return;
     }
-
-    QVectorIterator<unsigned int> delIt(markedForDeletion);
-
-    while (delIt.hasNext())
+    if (!success)
     {
-        i = delIt.next();
-
-        QProcess* process = m_encoderProcesses.at(i);
-        process->deleteLater();
-        m_encoderProcesses.erase(m_encoderProcesses.begin() + i);
-
-        QString tempVideoFile = m_tempVideoFiles.at(i);
-        remove(tempVideoFile.toStdString().c_str());
-        m_tempVideoFiles.erase(m_tempVideoFiles.begin() + i);
+        qDebug() << "ERROR: Failed to encode video" << targetFileName << ", raw video was kept";
     }
-
-    if(m_encoderProcesses.size() == 0)
+    if (m_encodingTargets.isEmpty())
     {
         qDebug() << "Video encoder(s) finished";
         emit recordingFinished();
     }
 }
 
+void Recorder::setEncodingQueue(EncodingQueue* encodingQueue)
+{
+    if (m_encodingQueue)
+    {
+        disconnect(m_encodingQueue, 0, this, 0);
+        if (m_encodingQueue->parent() == this)
+        {
+            delete m_encodingQueue;
+        }
+    }
+    m_encodingQueue = encodingQueue ? encodingQueue : createEncodingQueue(m_config, this);
+    connect(m_encodingQueue, SIGNAL(jobFinished(QString,bool,qint64,qint64)),
+            this, SLOT(onVideoEncodingFinished(QString,bool)));
+}
+
+EncodingQueue* Recorder::createEncodingQueue(Config* config, QObject* parent)
+{
+    EncodingQueue* encodingQueue = new EncodingQueue(config->videoEncoderLocation(), config->encodingJobFile(),
+                                                     config->encoderMaxJobs(), parent);
+    encodingQueue->setNiceness(config->encoderNiceness());
+    encodingQueue->setIdleIo(config->encoderIdleIo());
+    encodingQueue->setDeferWhileRecording(config->deferVideoEncoding());
+    return encodingQueue;
+}
+
 /*
- * Reads frame from Camera while video is recording. Adds rectangle from setRectangle() to video
+ * Reads frames from Camera while video is recording. Frames are only copied here, object
+ * boxes are drawn when the frames are written.
+ *
+ * Frames are placed into output frame slots of the video frame rate by their capture timestamps. A frame is
+ * pushed to the video buffer when the next frame arrives, so that gaps can be filled with
+ * duplicates of the frame which was actually visible during the gap.
  */
 void Recorder::readFrameThread()
 {
-    Mat temp;
-    Rect oldRectangle;
-    chrono::high_resolution_clock::time_point prevTime, nextTime, currentTime;
-    int skippedFrames = 0;    // how many frames were skipped (couldn't be read in time)
-    BufferedVideoFrame* frame = NULL;
-
-    prevTime = chrono::high_resolution_clock::now();
-    nextTime = prevTime + frame_period{1}; /// @todo decrease time from start to here for more accuracy
+    PooledFrame pendingFrame;   // newest frame, waiting for the next one
+    long long pendingSlot = 0;  // output frame slot of pendingFrame
+    long long slot = 0;
+    FrameClock::time_point firstTimestamp;
+    const FrameClock::duration outputFramePeriod = framePeriod(m_outputFps);
+    const FrameClock::duration halfFramePeriod = outputFramePeriod / 2;
+    CameraFramePtr cameraFrame;
+    FrameSubscriber* frameSubscriber = m_camera->subscribe(FrameSubscriber::EveryFrame, VIDEO_BUFFER_CAPACITY);
 
     while(m_recording)
     {
-        skippedFrames = 0;
-        this_thread::sleep_until(nextTime);
+        cameraFrame = frameSubscriber->waitNextFrame(FRAME_WAIT_TIMEOUT_MS);
+        if (!cameraFrame)
+        {
+            continue;
+        }
+        m_stats.m_cameraFrames++;
 
-        temp = m_camera->getWebcamFrame();
-        currentTime = chrono::high_resolution_clock::now();
+        if (!pendingFrame)
+        {
+            firstTimestamp = cameraFrame->m_timestamp;
+            slot = 0;
+        }
+        else
+        {
+            // output frame slot nearest to the capture time
+            slot = (cameraFrame->m_timestamp - firstTimestamp + halfFramePeriod) / outputFramePeriod;
+            if (slot <= pendingSlot)
+            {
+                // camera is faster than video frame rate, frame is not needed
+                m_stats.m_skippedFrames++;
+                continue;
+            }
+        }
 
-        nextTime += frame_period{1};
+        PooledFrame frame = m_framePool->acquire();
+        if (!frame)
+        {
+            m_stats.m_poolDroppedFrames++;
+            // pending frame stays and will be duplicated over this one
+            qDebug() << "Alert: frame pool exhausted, dropping frame. Decrease video frame rate.";
+            continue;
+        }
+        if (pendingFrame)
+        {
+            pendingFrame->m_duplicateCount = slot - pendingSlot - 1;
+            pushVideoFrame(std::move(pendingFrame));
+        }
 
-        // if frame exposure took more than frame_period(1), next time has already gone
-        while (nextTime < currentTime) {
-            skippedFrames++;
-            nextTime += frame_period{1};
+        pendingFrame = std::move(frame);
+        // camera frame is shared with other consumers, so draw only into own copy
+        Mat image = cameraFrame->bgrImage();
+        if (image.size() == m_framePool->frameSize())
+        {
+            image.copyTo(*(pendingFrame->m_frame));
         }
+        else
+        {
+            cv::resize(image, *(pendingFrame->m_frame), m_framePool->frameSize());
+        }
+        pendingFrame->m_timestamp = cameraFrame->m_timestamp;
+        pendingFrame->m_sequenceNumber = cameraFrame->m_sequenceNumber;
+        pendingSlot = slot;
+    }
+    if (pendingFrame)
+    {
+        pushVideoFrame(std::move(pendingFrame));
+    }
+    m_stats.m_cameraDroppedFrames = frameSubscriber->droppedFrames();
+    m_camera->unsubscribe(frameSubscriber);
+}
 
-        if (m_drawRectangles && (m_motionRectangle != oldRectangle))
+/*
+ * Keeps recent frames compressed in the pre-roll buffer while there is no recording.
+ * Frames are taken at most at the frame rate of the next video.
+ */
+void Recorder::prerollThread()
+{
+    FrameClock::time_point lastTimestamp;
+    bool hasFrames = false;
+    CameraFramePtr cameraFrame;
+    FrameSubscriber* frameSubscriber = m_camera->subscribe(FrameSubscriber::LatestOnly);
+
+    while (m_prerollRunning)
+    {
+        cameraFrame = frameSubscriber->waitNextFrame(FRAME_WAIT_TIMEOUT_MS);
+        if (!cameraFrame || m_recording)
+        {
+            hasFrames = false;
+            continue;
+        }
+        if (hasFrames && ((cameraFrame->m_timestamp - lastTimestamp) < framePeriod(outputFrameRate()) / 2))
+        {
+            continue;
+        }
+        if (m_preroll->push(*cameraFrame))
         {
-            rectangle(temp, m_motionRectangle, m_objectRectangleColor);
-            oldRectangle=m_motionRectangle;
+            lastTimestamp = cameraFrame->m_timestamp;
+            hasFrames = true;
         }
+    }
+    m_camera->unsubscribe(frameSubscriber);
+}
 
-        frame = new BufferedVideoFrame;
-        frame->m_frame = new Mat();
-        *(frame->m_frame) = temp.clone();
-        frame->m_duplicateCount = skippedFrames;
+long long Recorder::writePrerollFrames(qint64 endMsecs)
+{
+    long long writtenFrames = 0;
+    Mat image;
+    Mat scaledImage;
+    const double framePeriodMs = 1000.0 / m_outputFps;
 
-        if (m_videoBuffer->count() >= m_videoBuffer->capacity()) {
-            qDebug() << "Alert: video buffer is full. Decrease video frame rate.";
+    for (size_t i = 0; i < m_prerollFrames.size(); i++)
+    {
+        const PrerollBuffer::Frame& frame = m_prerollFrames[i];
+        if (!PrerollBuffer::decode(frame, image))
+        {
+            continue;
+        }
+        if (image.size() != m_videoResolution)
+        {
+            cv::resize(image, scaledImage, m_videoResolution);
+            image = scaledImage;
         }
-        m_videoBuffer->pushFrame(frame);
+        qint64 nextMsecs = (i + 1 < m_prerollFrames.size()) ? m_prerollFrames[i + 1].m_wallClockMsecs : endMsecs;
+        if (m_videoIsVariableFrameRate)
+        {
+            writeVideoFrame(image, m_videoMsecs);
+            writtenFrames++;
+            m_videoMsecs += qMax((qint64)1, nextMsecs - frame.m_wallClockMsecs);
+            continue;
+        }
+        int repeatCount = qMax(1, qRound((nextMsecs - frame.m_wallClockMsecs) / framePeriodMs));
+        for (int j = 0; j < repeatCount; j++)
+        {
+            writeVideoFrame(image);
+            writtenFrames++;
+        }
+        m_videoMsecs = qRound64(writtenFrames * framePeriodMs);
+    }
+    m_stats.m_prerollFrames = writtenFrames;
+    m_prerollFrames.clear();
+    return writtenFrames;
+}
+
+void Recorder::pushVideoFrame(PooledFrame frame)
+{
+    if (m_videoBuffer->count() >= m_videoBuffer->capacity()) {
+        qDebug() << "Alert: video buffer is full. Decrease video frame rate.";
+    }
+    BufferedVideoFrame* droppedFrame = NULL;
+    if (m_videoBuffer->pushFrame(frame.get(), &droppedFrame)) {
+        // owned by the buffer until recordThread() adopts it back
+        frame.release();
+    }
+    // oldest frame removed to make room, back to the pool
+    m_framePool->adopt(droppedFrame);
+}
+
+void Recorder::writeVideoFrame(const Mat& image, qint64 timestampMsecs)
+{
+    FrameClock::time_point writeStart = FrameClock::now();
+    if (m_pipedVideoWriter)
+    {
+        m_pipedVideoWriter->write(image, timestampMsecs);
+    }
+    else
+    {
+        m_videoWriter.write(image);
+    }
+    m_stats.m_writeLatencyUs.add(std::chrono::duration_cast<std::chrono::microseconds>(FrameClock::now() - writeStart).count());
+    m_stats.m_writtenFrames++;
+    m_thumbnailWriter->addPreviewFrame(image);
+}
+
+void Recorder::drawTrackBoxes(Mat& image, quint64 sequenceNumber)
+{
+    if (!m_trackOverlay.boxes(sequenceNumber, m_trackBoxes))
+    {
+        return;
+    }
+    for (const TrackOverlay::Box& box : m_trackBoxes)
+    {
+        const Scalar& color = box.m_positive ? m_objectPositiveColor : m_objectNegativeColor;
+        rectangle(image, box.m_rect, color);
+        putText(image, QString::number(box.m_trackId).toStdString(), Point(box.m_rect.x, box.m_rect.y - 2),
+                FONT_HERSHEY_PLAIN, 1, color);
     }
 }
 
 void Recorder::saveVideoThumbnailImage(Mat& image, QString dateTime) {
-    Mat thumbnail = image.clone();
-    cv::resize(thumbnail, thumbnail, m_thumbnailResolution, 0, 0, INTER_CUBIC);
-    QString thumbnailFileName = m_resultVideoDirName + "/" + m_thumbnailDirName + "/" + dateTime + m_thumbnailExtension;
-    imwrite(thumbnailFileName.toStdString(), thumbnail);
+    m_thumbnailWriter->writeThumbnails(image, m_resultVideoDirName + "/" + m_thumbnailDirName + "/" + dateTime);
 }
 
 /*
@@ -276,30 +706,212 @@ void Recorder::saveVideoThumbnailImage(Mat& image, QString dateTime) {
  */
 void Recorder::stopRecording(bool willSaveVideo)
 {
-    if(m_recorderThread)
+    if (m_recording)
     {
-
         m_willSaveVideo=willSaveVideo;
         m_recording = false;
+        if (!willSaveVideo)
+        {
+            // frames left in the buffer are dropped, release a reader blocked on a full buffer
+            m_videoBuffer->stopWait();
+        }
+        // reader pushes its last frame before it stops
+        m_frameUpdateThread->join(); m_frameUpdateThread.reset();
+        // writer drains the buffer and the spool, then finishes the video
         m_videoBuffer->stopWait();
+        if (m_preroll)
+        {
+            // frames kept during recording would be from the previous event
+            m_preroll->clear();
+        }
+    }
+    if (!m_willSaveVideo)
+    {
+        finishRecordThread();
+    }
+    // otherwise draining can take up to the spool length, the caller isn't kept waiting for it
+}
+
+void Recorder::finishRecordThread()
+{
+    if (m_recorderThread)
+    {
         m_recorderThread->join(); m_recorderThread.reset();
-        m_frameUpdateThread->join(); m_frameUpdateThread.reset();
+    }
+    if (m_videoBuffer)
+    {
+        // return frames which were left unwritten
+        while (m_videoBuffer->count() > 0)
+        {
+            m_framePool->adopt(m_videoBuffer->waitNextFrame());
+            m_stats.m_bufferDroppedFrames++;
+        }
+        m_stats.m_bufferDroppedFrames += m_videoBuffer->spooledCount();
+        m_stats.m_videoBuffer.merge(m_videoBuffer->stats());
+        m_stats.m_videoBufferCapacity = m_videoBuffer->capacity();
+        m_stats.m_videoSpoolCapacity = m_videoSpool ? m_videoSpool->capacity() : 0;
+        m_stats.m_flushBacklogBytes = flushBacklogBytes();
+        m_stats.print();
     }
     delete m_videoBuffer;
     m_videoBuffer = NULL;
+    // all frames are back in the pool
+    delete m_framePool;
+    m_framePool = NULL;
+    if (m_videoSpool)
+    {
+        m_videoSpool->clear();
+    }
+    m_prerollFrames.clear();
 }
 
-/*
- * Called from ActualDetector to pass the rectangle that highlights the detected object and bool isPositive to specify the color of the rectangle
- * Red = positive detection | Blue = negative detection
- */
-void Recorder::setRectangle(Rect &r, bool isPositive)
+void Recorder::startPreroll()
 {
-    m_motionRectangle=r;
-    if(isPositive)
+    if (m_preroll && !m_prerollThread)
     {
-        m_objectRectangleColor = m_objectPositiveColor;
+        m_prerollRunning = true;
+        m_prerollThread.reset(new std::thread(&Recorder::prerollThread, this));
+    }
+}
+
+void Recorder::stopPreroll()
+{
+    if (m_prerollThread)
+    {
+        m_prerollRunning = false;
+        m_prerollThread->join();
+        m_prerollThread.reset();
+        m_preroll->clear();
+    }
+}
+
+int Recorder::outputFrameRate()
+{
+    if (m_configuredFps > 0)
+    {
+        return qBound(MIN_OUTPUT_FPS, m_configuredFps, MAX_OUTPUT_FPS);
+    }
+    double cameraFps = m_camera->frameRate();
+    if (cameraFps <= 0)
+    {
+        return DEFAULT_OUTPUT_FPS;
+    }
+    return qBound(MIN_OUTPUT_FPS, qRound(cameraFps), MAX_OUTPUT_FPS);
+}
+
+qint64 Recorder::flushBacklogBytes()
+{
+    return m_writeBehind ? m_writeBehind->backlogBytes() : 0;
+}
+
+FrameClock::duration Recorder::framePeriod(int fps)
+{
+    return std::chrono::duration_cast<FrameClock::duration>(std::chrono::seconds(1)) / qMax(1, fps);
+}
+
+TrackOverlay* Recorder::trackOverlay()
+{
+    return &m_trackOverlay;
+}
+
+const RecordingStats& Recorder::recordingStats()
+{
+    return m_stats;
+}
+
+void Recorder::removeStaleSpoolFiles(QString spoolDirName)
+{
+    const QRegularExpression spoolFileRegex("^videospool-(\\d+)-[0-9a-f]+\\.tmp$");
+    QDir spoolDir(spoolDirName);
+    foreach (const QString& fileName, spoolDir.entryList(QStringList("videospool-*.tmp"), QDir::Files))
+    {
+        QRegularExpressionMatch match = spoolFileRegex.match(fileName);
+        if (match.hasMatch() && !isProcessRunning(match.captured(1).toLongLong()))
+        {
+            qDebug() << "Removing video spool file left by an earlier run" << fileName;
+            spoolDir.remove(fileName);
+        }
+    }
+}
+
+QStringList Recorder::adoptStaleStagingDirs(QString stagingDirName, QString ownStagingDirName, QString resultDirName,
+                                            WriteBehindStage* stage)
+{
+    const QRegularExpression stagingDirRegex("^recorder-(\\d+)-[0-9a-f]+$");
+    QStringList adoptedDirNames;
+    QDir stagingDir(stagingDirName);
+    foreach (const QString& dirName, stagingDir.entryList(QStringList("recorder-*"), QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QRegularExpressionMatch match = stagingDirRegex.match(dirName);
+        if (!match.hasMatch() || isProcessRunning(match.captured(1).toLongLong()))
+        {
+            continue;
+        }
+        // claimed by moving it, so that other recorders starting now don't adopt it too
+        const QString adoptedDirName = ownStagingDirName + "/" + dirName;
+        if (!stagingDir.rename(dirName, adoptedDirName))
+        {
+            continue;
+        }
+        qDebug() << "Moving videos left in staging directory" << dirName << "to" << resultDirName;
+        adoptedDirNames << adoptedDirName;
+
+        QDir segmentDir(adoptedDirName + "/segments");
+        if (segmentDir.exists())
+        {
+            QDir().mkpath(resultDirName + "/segments");
+            // segments before the lists which join them
+            QStringList segments = segmentDir.entryList(QDir::Files);
+            QStringList segmentLists = segmentDir.entryList(QStringList("*.ffconcat"), QDir::Files);
+            foreach (const QString& segmentList, segmentLists)
+            {
+                segments.removeOne(segmentList);
+            }
+            foreach (const QString& fileName, segments + segmentLists)
+            {
+                stage->flush(segmentDir.filePath(fileName), resultDirName + "/segments/" + fileName);
+            }
+        }
+        QDir adoptedDir(adoptedDirName);
+        foreach (const QString& fileName, adoptedDir.entryList(QDir::Files))
+        {
+            stage->flush(adoptedDir.filePath(fileName), resultDirName + "/" + fileName);
+        }
+    }
+    return adoptedDirNames;
+}
+
+bool Recorder::isProcessRunning(qint64 pid)
+{
+    if (pid == QCoreApplication::applicationPid())
+    {
+        return true;
+    }
+#if defined(Q_OS_UNIX)
+    // signal 0 only checks whether the process exists
+    return (kill((pid_t)pid, 0) == 0) || (errno == EPERM);
+#elif defined(Q_OS_WIN)
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)pid);
+    if (!process)
+    {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    const bool running = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+    CloseHandle(process);
+    return running;
+#else
+    // can't tell, keep the files
+    return true;
+#endif
+}
+
+void Recorder::setResultVideoDir(QString dirName)
+{
+    m_resultVideoDirName = dirName;
+    QDir dir(QString(m_resultVideoDirName + "/" + m_thumbnailDirName));
+    if (!dir.exists())
+    {
+        dir.mkpath(".");
     }
-    else  m_objectRectangleColor = m_objectNegativeColor;
 }
 
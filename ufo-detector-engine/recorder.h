@@ -22,16 +22,27 @@
 #include "config.h"
 #include "camera.h"
 #include "videobuffer.h"
+#include "framepool.h"
+#include "framespool.h"
+#include "prerollbuffer.h"
+#include "pipedvideowriter.h"
+#include "encodingqueue.h"
+#include "thumbnailwriter.h"
+#include "trackoverlay.h"
+#include "writebehindstage.h"
+#include "pipelinestats.h"
 #include "datamanager.h"
 #include <QDomDocument>
 #include <QFile>
 #include <QObject>
 #include <QProcess>
 #include <QTime>
+#include <QDateTime>
 #include <QTextStream>
 #include <QFile>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 #include <QCoreApplication>
 #include <QMutex>
 #include <atomic>
@@ -42,13 +53,12 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
-#define OUTPUT_FPS 25
-#define VIDEO_BUFFER_CAPACITY (OUTPUT_FPS * 5)
+#define DEFAULT_OUTPUT_FPS 25   ///< video frame rate when camera frame rate isn't known yet, buffers are sized by it
+#define VIDEO_BUFFER_CAPACITY (DEFAULT_OUTPUT_FPS * 5)
+#define FRAME_POOL_CAPACITY (VIDEO_BUFFER_CAPACITY + 2)   ///< buffered frames, one being read and one being written
 
 using namespace cv;
 using namespace std;
-using frame_period = std::chrono::duration<long long, std::ratio<1, OUTPUT_FPS>>;
-using hr_duration = std::chrono::high_resolution_clock::duration;
 
 class ActualDetector;
 
@@ -60,28 +70,111 @@ Q_OBJECT
 
 public:
     explicit Recorder(Camera* cameraPtr, Config* configPtr, DataManager* dataManager);
-    void startRecording(cv::Mat &firstFrame);
+    ~Recorder();
+    /**
+     * @brief Start recording video.
+     * @param firstFrame frame which caused the detection, written as the first video frame
+     * @param eventTime capture time of firstFrame, used as video timestamp. Current time if not valid.
+     */
+    void startRecording(cv::Mat &firstFrame, QDateTime eventTime = QDateTime());
+
+    /**
+     * @brief Stop recording video. A saved video is finished in the background from the frames
+     * still buffered and spooled, the next startRecording() waits for it.
+     * @param willSaveVideo whether to save the video or discard it
+     */
     void stopRecording(bool willSaveVideo);
-    void setRectangle(cv::Rect &r, bool isRed);
+
+    /**
+     * @brief Start keeping recent frames in memory, to be included in the beginning of
+     * the next video. Does nothing if pre-roll is disabled in settings.
+     */
+    void startPreroll();
+
+    /**
+     * @brief Stop keeping recent frames and drop the kept ones.
+     */
+    void stopPreroll();
+
+    /**
+     * @brief Boxes of tracked objects which are drawn into the video frames, when enabled.
+     * ActualDetector publishes them for each frame it processes.
+     */
+    TrackOverlay* trackOverlay();
+
+    /**
+     * @brief Set directory for result videos instead of the configured one, e.g. for each camera
+     * to have a directory of its own. Must not be called while recording.
+     * @param dirName
+     */
+    void setResultVideoDir(QString dirName);
+
+    /**
+     * @brief Use encoding queue shared with other recorders instead of an own one, so that
+     * the limit of running encoders holds for all of them. Must not be called while encoding.
+     * @param encodingQueue queue, not owned
+     */
+    void setEncodingQueue(EncodingQueue* encodingQueue);
+
+    /**
+     * @brief Create encoding queue with the encoder settings of config.
+     */
+    static EncodingQueue* createEncodingQueue(Config* config, QObject* parent = 0);
+
+    /**
+     * @brief Counters of the current recording, or of the previous one when not recording.
+     * They are also printed at the end of each recording.
+     */
+    const RecordingStats& recordingStats();
+
+    /**
+     * @brief Frame rate for the next video: the configured one, or the camera frame rate
+     * rounded to whole frames per second. With variable frame rate this is the highest rate.
+     */
+    int outputFrameRate();
+
+    /**
+     * @brief Bytes of finished videos still waiting in the staging directory to be moved
+     * to the result directory, 0 when videos are written there directly.
+     */
+    qint64 flushBacklogBytes();
 
 #ifndef _UNIT_TEST_
 private:
 #endif
     const int DEFAULT_CODEC = 0;
+    const int FRAME_WAIT_TIMEOUT_MS = 100;  ///< interval at which recording flag is checked while waiting frames
+    const int MIN_OUTPUT_FPS = 1;
+    const int MAX_OUTPUT_FPS = 60;
 
     Camera* m_camera;
     Config* m_config;
     DataManager* m_dataManager;
     cv::VideoWriter m_videoWriter;
+    PipedVideoWriter* m_pipedVideoWriter;   ///< used instead of m_videoWriter when encoding with external encoder, otherwise NULL
     cv::Mat m_firstFrame;
+    QDateTime m_eventTime;      ///< capture time of the first frame, used as video timestamp
     VideoBuffer* m_videoBuffer;
-    cv::Rect m_motionRectangle;
-    cv::Scalar m_objectRectangleColor;  ///< color of object rectangle, changes each time
+    VideoBuffer::OverflowPolicy m_overflowPolicy;   ///< what to do when m_videoBuffer is full
+    FramePool* m_framePool;     ///< frames for m_videoBuffer, sized by m_videoResolution, NULL while not recording
+    FrameSpool* m_videoSpool;   ///< disk overflow of m_videoBuffer, NULL if disabled
+    ThumbnailWriter* m_thumbnailWriter;
+    WriteBehindStage* m_writeBehind;    ///< moves videos from m_stagingDirName, NULL if not staging
+    QString m_stagingDirName;   ///< where videos are written while recording when staging
+    QStringList m_adoptedStagingDirNames;   ///< staging directories of earlier runs, moved into m_stagingDirName
+    PrerollBuffer* m_preroll;   ///< recent frames while not recording, NULL if disabled
+    std::deque<PrerollBuffer::Frame> m_prerollFrames;   ///< frames taken from m_preroll for the current video
+    RecordingStats m_stats;
+    int m_configuredFps;        ///< video frame rate from config, 0 to follow camera
+    bool m_variableFrameRate;   ///< whether to record variable frame rate videos, when encoder is available
+    std::atomic<int> m_outputFps;   ///< frame rate of the current video
+    bool m_videoIsVariableFrameRate;    ///< whether the current video has frame timestamps
+    qint64 m_videoMsecs;        ///< presentation time of the next frame of the current video
+    TrackOverlay m_trackOverlay;
+    std::vector<TrackOverlay::Box> m_trackBoxes;    ///< boxes of the frame being written, reused
     cv::Scalar m_objectPositiveColor;   ///< color used to draw rectangle around a positive detection object
     cv::Scalar m_objectNegativeColor;   ///< color used to draw rectangle around a negative detection object
     cv::Size m_videoResolution;     ///< resolution of video to be saved
-    cv::Size m_thumbnailResolution; ///< resolution of video thumbnail image
-    int m_defaultThumbnailSideLength;   ///< bounding square side length for thumbnail image
     QString m_resultVideoDirName;     ///< result data directory name
     QString m_thumbnailDirName;      ///< name of thumbnail folder (without slashes)
     QString m_videoFileExtension;
@@ -89,36 +182,119 @@ private:
 
     std::unique_ptr<std::thread> m_recorderThread;
     std::unique_ptr<std::thread> m_frameUpdateThread;
+    std::unique_ptr<std::thread> m_prerollThread;
+    std::atomic<bool> m_prerollRunning;
     std::atomic<bool> m_recording;
-    bool m_willSaveVideo;       ///< whether to save video or reject it
+    std::atomic<bool> m_willSaveVideo;  ///< whether to save video or reject it, set before m_recording is cleared
     bool m_drawRectangles;      ///< whether or not to draw rectangles around detected objects
 
-    std::vector<QProcess*> m_encoderProcesses;
-    std::vector<QString> m_tempVideoFiles;
+    EncodingQueue* m_encodingQueue;
+    QStringList m_encodingTargets;   ///< videos of this recorder in m_encodingQueue
 
     void recordThread();
 
+    /**
+     * @brief Wait for the record thread to finish the video, then release the buffers of the recording.
+     */
+    void finishRecordThread();
+
     /**
      * @brief camera frame reader thread
-     *
-     * @todo use a single source of frames
      */
     void readFrameThread();
 
     /**
-     * @brief Save video thumbnail image.
+     * @brief Pre-roll thread, keeps frames in m_preroll while not recording
+     */
+    void prerollThread();
+
+    /**
+     * @brief Write m_prerollFrames to video, each frame repeated until the next one was captured.
+     * @param endMsecs capture time of the frame following the last pre-roll frame
+     * @return number of written video frames
+     */
+    long long writePrerollFrames(qint64 endMsecs);
+
+    /**
+     * @brief Duration of one frame at frame rate fps.
+     */
+    static FrameClock::duration framePeriod(int fps);
+
+    /**
+     * @brief Push frame into video buffer. Frame goes back to the pool if it can't be pushed.
+     * @param frame
+     */
+    void pushVideoFrame(PooledFrame frame);
+
+    /**
+     * @brief Write one frame to video, measuring how long it takes.
+     * @param image
+     * @param timestampMsecs presentation time, used in variable frame rate videos
+     */
+    void writeVideoFrame(const Mat& image, qint64 timestampMsecs = -1);
+
+    /**
+     * @brief Draw boxes and IDs of the objects tracked in the frame.
+     * @param image
+     * @param sequenceNumber CameraFrame sequence number of the frame
+     */
+    void drawTrackBoxes(Mat& image, quint64 sequenceNumber);
+
+    /**
+     * @brief Save video thumbnail images and preview in the background.
      * @param image
      * @param dateTime
      */
     void saveVideoThumbnailImage(Mat& image, QString dateTime);
 
+    /**
+     * @brief Emit videoSegmentFinished() for segments of the segment list which were
+     * not yet announced.
+     * @param segmentListFileName list written by the segmenting encoder
+     * @param announcedSegments segments already announced, new ones are appended
+     */
+    void announceFinishedSegments(QString segmentListFileName, QStringList& announcedSegments);
+
+    /**
+     * @brief Move finished file to its place in the result directory: in the background from
+     * the staging directory, otherwise right away.
+     * @param fileName
+     * @param resultFileName
+     * @param moved called with the file name where the file ended up
+     */
+    void moveToResultDir(QString fileName, QString resultFileName, WriteBehindStage::FlushedCallback moved);
+
+    /**
+     * @brief Remove spool files of recorder processes which are no longer running.
+     * @param spoolDirName
+     */
+    static void removeStaleSpoolFiles(QString spoolDirName);
+
+    /**
+     * @brief Queue the videos left in staging directories of recorder processes which are no
+     * longer running to be moved to the result directory.
+     * @param stagingDirName configured staging directory
+     * @param ownStagingDirName staging directory of this recorder, adopted directories are moved into it
+     * @param resultDirName
+     * @param stage
+     * @return adopted directories, to be removed when they are empty
+     */
+    static QStringList adoptStaleStagingDirs(QString stagingDirName, QString ownStagingDirName, QString resultDirName,
+                                             WriteBehindStage* stage);
+
+    /**
+     * @brief Whether a process is running, true for this process.
+     * @param pid process id
+     */
+    static bool isProcessRunning(qint64 pid);
+
 #ifndef _UNIT_TEST_
 private slots:
 #else
 public slots:
 #endif
     /**
-     * @brief Creates a new QProcess that encodes the temporary raw video with ffmpeg/avconv.
+     * @brief Adds a job to the encoding queue to encode the temporary raw video with ffmpeg/avconv.
      *
      * @note this method NEEDS to be called via signal-slot system, I guess in order
      * to run it in the main thread. If this is called from detecting thread via direct
@@ -126,12 +302,18 @@ public slots:
      */
     void startEncodingVideo(QString tempVideoFileName, QString targetVideoFileName);
 
-    void onVideoEncodingFinished();
+    void onVideoEncodingFinished(QString targetFileName, bool success);
 
 signals:
     void recordingStarted();
     void recordingFinished();
     void videoEncodingRequested(QString tempVideoName, QString targetVideoName);
+
+    /**
+     * @brief A video segment of the current recording is completely written, so it can be
+     * e.g. uploaded before the recording ends. Emitted from the recording thread.
+     */
+    void videoSegmentFinished(QString segmentFileName);
 };
 
 #endif // RECORDER_H
@@ -0,0 +1,191 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "regionmask.h"
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+#if CV_MAJOR_VERSION >= 3
+#include <opencv2/core/hal/intrin.hpp>
+#endif
+
+#if defined(CV_SIMD128) && CV_SIMD128
+#define REGION_MASK_SIMD
+#endif
+
+namespace {
+/**
+ * @brief Count non-zero pixels of row from x to end - 1 and update the first and last of them.
+ */
+inline void countRow(const uchar* row, int x, int end, int& count, int& first, int& last)
+{
+    for (; x < end; x++)
+    {
+        if (row[x])
+        {
+            count++;
+            if (first < 0)
+            {
+                first = x;
+            }
+            last = x;
+        }
+    }
+}
+}
+
+RegionMask::RegionMask() :
+    m_pixelCount(0)
+{
+}
+
+void RegionMask::setMask(const cv::Mat& mask)
+{
+    CV_Assert(mask.type() == CV_8UC1);
+    // new buffer, copies of this region keep the old one
+    cv::Mat binary = (mask != 0);
+    m_mask = binary;
+    m_spans.clear();
+    m_pixelCount = 0;
+
+    for (int y = 0; y < m_mask.rows; y++)
+    {
+        const uchar* row = m_mask.ptr<uchar>(y);
+        int x = 0;
+        while (x < m_mask.cols)
+        {
+            while ((x < m_mask.cols) && !row[x])
+            {
+                x++;
+            }
+            const int begin = x;
+            while ((x < m_mask.cols) && row[x])
+            {
+                x++;
+            }
+            if (x > begin)
+            {
+                Span span;
+                span.m_y = y;
+                span.m_begin = begin;
+                span.m_end = x;
+                m_spans.push_back(span);
+                m_pixelCount += x - begin;
+            }
+        }
+    }
+}
+
+void RegionMask::exclude(const cv::Mat& excluded)
+{
+    CV_Assert((excluded.type() == CV_8UC1) && (excluded.size() == m_mask.size()));
+    cv::Mat remaining = m_mask & (excluded == 0);
+    setMask(remaining);
+}
+
+void RegionMask::clear()
+{
+    m_mask.release();
+    m_spans.clear();
+    m_pixelCount = 0;
+}
+
+int RegionMask::countNonZero(const cv::Mat& image, cv::Rect& boundingRect) const
+{
+    if (isEmpty())
+    {
+        return 0;
+    }
+    CV_Assert((image.type() == CV_8UC1) && (image.size() == m_mask.size()));
+    int count = 0;
+    int minX = image.cols;
+    int maxX = -1;
+    int minY = -1;
+    int maxY = -1;
+#ifdef REGION_MASK_SIMD
+    const int lanes = cv::v_uint8x16::nlanes;
+    const cv::v_uint8x16 zero = cv::v_setzero_u8();
+#endif
+
+    for (const Span& span : m_spans)
+    {
+        const uchar* row = image.ptr<uchar>(span.m_y);
+        int first = -1;
+        int last = -1;
+        int x = span.m_begin;
+#ifdef REGION_MASK_SIMD
+        // motion is sparse, blocks without any set pixel are skipped as a whole
+        for (; x <= span.m_end - lanes; x += lanes)
+        {
+            if (cv::v_check_any(cv::v_load(row + x) != zero))
+            {
+                countRow(row, x, x + lanes, count, first, last);
+            }
+        }
+#endif
+        countRow(row, x, span.m_end, count, first, last);
+        if (first >= 0)
+        {
+            minX = std::min(minX, first);
+            maxX = std::max(maxX, last);
+            if (minY < 0)
+            {
+                minY = span.m_y;
+            }
+            maxY = span.m_y;
+        }
+    }
+
+    if (count > 0)
+    {
+        boundingRect = cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+    }
+    return count;
+}
+
+qint64 RegionMask::sum(const cv::Mat& image) const
+{
+    if (isEmpty())
+    {
+        return 0;
+    }
+    CV_Assert((image.type() == CV_8UC1) && (image.size() == m_mask.size()));
+    qint64 total = 0;
+    for (const Span& span : m_spans)
+    {
+        const uchar* row = image.ptr<uchar>(span.m_y);
+        for (int x = span.m_begin; x < span.m_end; x++)
+        {
+            total += row[x];
+        }
+    }
+    return total;
+}
+
+void RegionMask::threshold(const cv::Mat& image, int level, cv::Mat& result) const
+{
+    if (isEmpty())
+    {
+        result = cv::Mat::zeros(image.size(), CV_8UC1);
+        return;
+    }
+    CV_Assert((image.type() == CV_8UC1) && (image.size() == m_mask.size()));
+    cv::threshold(image, result, level, 255, cv::THRESH_BINARY);
+    cv::bitwise_and(result, m_mask, result);
+}
@@ -0,0 +1,108 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REGIONMASK_H
+#define REGIONMASK_H
+
+#include <QtGlobal>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Detection area in detection image coordinates.
+ *
+ * The area is kept as a byte mask and as horizontal runs of area pixels (spans) on
+ * each row, so that the pixels of an image inside the area are read row by row.
+ * Copies are independent of each other.
+ */
+class RegionMask
+{
+public:
+    /**
+     * @brief Run of area pixels on one row, x from m_begin to m_end - 1
+     */
+    struct Span {
+        int m_y;
+        int m_begin;
+        int m_end;
+    };
+
+    RegionMask();
+
+    /**
+     * @brief Replace the area.
+     * @param mask CV_8UC1 image of the detection image size, area pixels are non-zero
+     */
+    void setMask(const cv::Mat& mask);
+
+    /**
+     * @brief Remove pixels from the area.
+     * @param excluded CV_8UC1 image of the area size, pixels to remove are non-zero
+     */
+    void exclude(const cv::Mat& excluded);
+
+    void clear();
+
+    bool isEmpty() const { return m_pixelCount == 0; }
+
+    /**
+     * @brief Number of pixels in the area
+     */
+    int pixelCount() const { return m_pixelCount; }
+
+    /**
+     * @brief Area mask, 255 inside the area and 0 elsewhere
+     */
+    const cv::Mat& mask() const { return m_mask; }
+
+    /**
+     * @brief Area rows, in top to bottom and left to right order
+     */
+    const std::vector<Span>& spans() const { return m_spans; }
+
+    /**
+     * @brief Count non-zero pixels of image inside the area.
+     * @param image CV_8UC1 image of the area size
+     * @param boundingRect result, bounding rectangle of the counted pixels, unchanged if there are none
+     * @return number of pixels
+     */
+    int countNonZero(const cv::Mat& image, cv::Rect& boundingRect) const;
+
+    /**
+     * @brief Sum of the pixel values of image inside the area.
+     * @param image CV_8UC1 image of the area size
+     */
+    qint64 sum(const cv::Mat& image) const;
+
+    /**
+     * @brief Mark pixels of image inside the area which are brighter than level.
+     * @param image CV_8UC1 image of the area size
+     * @param level pixel value which is not yet marked
+     * @param result 255 for marked pixels and 0 elsewhere
+     */
+    void threshold(const cv::Mat& image, int level, cv::Mat& result) const;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    cv::Mat m_mask;
+    std::vector<Span> m_spans;
+    int m_pixelCount;
+};
+
+#endif // REGIONMASK_H
@@ -28,8 +28,12 @@ Recorder::Recorder(Camera* cameraPtr, Config* configPtr, DataManager* dataManage
     Q_UNUSED(dataManager);
 }
 
-void Recorder::startRecording(cv::Mat &firstFrame) {
+Recorder::~Recorder() {
+}
+
+void Recorder::startRecording(cv::Mat &firstFrame, QDateTime eventTime) {
     Q_UNUSED(firstFrame);
+    Q_UNUSED(eventTime);
     m_recording = true;
     mockRecorderStartCount++;
 }
@@ -40,9 +44,22 @@ void Recorder::stopRecording(bool willSaveVideo) {
     mockRecorderStopCount++;
 }
 
-void Recorder::setRectangle(cv::Rect &r, bool isRed) {
-    Q_UNUSED(r);
-    Q_UNUSED(isRed);
+void Recorder::startPreroll() {
+}
+
+void Recorder::stopPreroll() {
+}
+
+TrackOverlay* Recorder::trackOverlay() {
+    return &m_trackOverlay;
+}
+
+const RecordingStats& Recorder::recordingStats() {
+    return m_stats;
+}
+
+void Recorder::setResultVideoDir(QString dirName) {
+    m_resultVideoDirName = dirName;
 }
 
 void Recorder::startEncodingVideo(QString tempVideoFileName, QString targetVideoFileName) {
@@ -50,5 +67,11 @@ void Recorder::startEncodingVideo(QString tempVideoFileName, QString targetVideo
     Q_UNUSED(targetVideoFileName);
 }
 
-void Recorder::onVideoEncodingFinished() {
+void Recorder::onVideoEncodingFinished(QString targetFileName, bool success) {
+    Q_UNUSED(targetFileName);
+    Q_UNUSED(success);
+}
+
+void Recorder::setEncodingQueue(EncodingQueue* encodingQueue) {
+    Q_UNUSED(encodingQueue);
 }
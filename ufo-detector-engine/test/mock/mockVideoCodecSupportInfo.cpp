@@ -25,7 +25,8 @@ VideoCodecSupportInfo::VideoCodecSupportInfo(QString externalVideoEncoderLocatio
     m_isInitialized = false;
 }
 
-bool VideoCodecSupportInfo::init() {
+bool VideoCodecSupportInfo::init(QString cacheFileName) {
+    Q_UNUSED(cacheFileName);
     m_isInitialized = true;
     return true;
 }
@@ -73,3 +74,15 @@ QString VideoCodecSupportInfo::rawVideoCodecStr() {
     return "IYUV";
 }
 
+
+QList<VideoCodecSupportInfo::CodecBenchmark> VideoCodecSupportInfo::benchmarkResults(cv::Size frameSize) {
+    Q_UNUSED(frameSize);
+    return QList<CodecBenchmark>();
+}
+
+int VideoCodecSupportInfo::recommendedCodec(const QList<CodecBenchmark>& results, double fps, double headroom) {
+    Q_UNUSED(results);
+    Q_UNUSED(fps);
+    Q_UNUSED(headroom);
+    return 0;
+}
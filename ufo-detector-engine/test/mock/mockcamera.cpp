@@ -36,6 +36,9 @@
  *
  * There's a usage example of this in ActualDetector unit test, more specifically
  * in TestActualDetector::mockCameraBlockNextFrame().
+ *
+ * FrameSubscriber::waitNextFrame() of the mock FrameSubscriber (mockframesubscriber.cpp)
+ * follows the same blocking rules, giving mockCameraNextFrame to subscribers.
  */
 
 cv::Mat mockCameraNextFrame;    ///< next frame to be given by Camera::getWebcamFrame()
@@ -96,13 +99,23 @@ void startCameraFromVideo(QFile* videoFile){
 }
 
 
-Camera::Camera(int index, int width, int height) {
+Camera::Camera(int index, int width, int height, QString backend, QString pixelFormat) {
     Q_UNUSED(index);
     Q_UNUSED(width);
     Q_UNUSED(height);
+    Q_UNUSED(backend);
+    Q_UNUSED(pixelFormat);
     mockCamera_blockFrameEnabled = false;
 }
 
+Camera::~Camera() {
+}
+
+void Camera::setInputFile(QString fileName, bool realTime) {
+    Q_UNUSED(fileName);
+    Q_UNUSED(realTime);
+}
+
 bool Camera::init() {
     return true;
 }
@@ -125,6 +138,26 @@ cv::Mat Camera::getWebcamFrame() {
     return mockCameraNextFrame;
 }
 
+CameraFramePtr Camera::latestFrame() {
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    frame->m_image = getWebcamFrame();
+    frame->m_timestamp = FrameClock::now();
+    frame->m_wallClockMsecs = QDateTime::currentMSecsSinceEpoch();
+    return frame;
+}
+
+FrameSubscriber* Camera::subscribe(FrameSubscriber::DeliveryMode mode, int capacity, bool pacesSource) {
+    return new FrameSubscriber(mode, capacity, pacesSource);
+}
+
+double Camera::frameRate() {
+    return 0;
+}
+
+void Camera::unsubscribe(FrameSubscriber* subscriber) {
+    delete subscriber;
+}
+
 bool Camera::isWebcamOpen() {
     return true;
 }
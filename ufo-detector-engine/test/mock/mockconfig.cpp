@@ -22,6 +22,8 @@
 QString mockConfigResultDataDir;
 int mockConfigResultVideoCodec;
 QString mockConfigResultVideoCodecStr;
+int mockConfigVideoSegmentSeconds;
+QString mockConfigVideoStagingDir;
 QString testResourceFolder();
 
 
@@ -29,6 +31,8 @@ Config::Config(QObject *parent) {
     Q_UNUSED(parent);
     mockConfigResultVideoCodec = 0;
     mockConfigResultVideoCodecStr = "";
+    mockConfigVideoSegmentSeconds = 0;
+    mockConfigVideoStagingDir = "";
     QString encoderLocation = "";
 #if defined(Q_OS_LINUX) || defined(Q_OS_UNIX)
     encoderLocation = "/usr/bin/avconv";
@@ -67,6 +71,22 @@ bool Config::checkCameraAspectRatio() {
     return false;
 }
 
+QString Config::cameraBackend() {
+    return "opencv";
+}
+
+QString Config::cameraPixelFormat() {
+    return "YUYV";
+}
+
+QList<int> Config::cameraIndexes() {
+    return QList<int>() << cameraIndex();
+}
+
+int Config::workerThreads() {
+    return 0;
+}
+
 QString Config::detectionAreaFile() {
     return "detectionarea.xml";
 }
@@ -79,14 +99,34 @@ int Config::noiseFilterPixelSize() {
     return 2;
 }
 
+int Config::noiseFilterPixelSize(int cameraIndex) {
+    Q_UNUSED(cameraIndex);
+    return noiseFilterPixelSize();
+}
+
 int Config::motionThreshold() {
     return 10;
 }
 
+int Config::motionThreshold(int cameraIndex) {
+    Q_UNUSED(cameraIndex);
+    return motionThreshold();
+}
+
 int Config::minPositiveDetections() {
     return 2;
 }
 
+int Config::minPositiveDetections(int cameraIndex) {
+    Q_UNUSED(cameraIndex);
+    return minPositiveDetections();
+}
+
+int Config::detectionDownscale(int cameraIndex) {
+    Q_UNUSED(cameraIndex);
+    return 1;
+}
+
 QString Config::birdClassifierTrainingFile() {
 
     return testResourceFolder()+"\\cascade.xml";
@@ -125,10 +165,66 @@ bool Config::resultVideoWithObjectRectangles() {
     return false;
 }
 
+int Config::prerollSeconds() {
+    return 0;
+}
+
+int Config::prerollMemoryMB() {
+    return 64;
+}
+
+QString Config::videoBufferOverflowPolicy() {
+    return "coalesce";
+}
+
+int Config::videoSegmentSeconds() {
+    return mockConfigVideoSegmentSeconds;
+}
+
+int Config::videoFrameRate() {
+    return 0;
+}
+
+bool Config::variableFrameRateVideo() {
+    return false;
+}
+
+int Config::videoSpoolSeconds() {
+    return 0;
+}
+
+QString Config::videoSpoolDir() {
+    return QDir::tempPath();
+}
+
+QString Config::videoStagingDir() {
+    return mockConfigVideoStagingDir;
+}
+
 QString Config::videoEncoderLocation() {
     return "/usr/bin/avconv";
 }
 
+int Config::encoderMaxJobs() {
+    return 1;
+}
+
+int Config::encoderNiceness() {
+    return 10;
+}
+
+bool Config::encoderIdleIo() {
+    return true;
+}
+
+bool Config::deferVideoEncoding() {
+    return false;
+}
+
+QString Config::encodingJobFile() {
+    return QDir::tempPath() + "/encodingjobs.ini";
+}
+
 QString Config::resultImageDir() {
     return "./images";
 }
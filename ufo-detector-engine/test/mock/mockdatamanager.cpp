@@ -26,7 +26,8 @@ bool DataManager::readResultDataFile() {
     return true;
 }
 
-void DataManager::saveResultData(QString dateTime, QString videoLength) {
+void DataManager::saveResultData(QString videoDir, QString dateTime, QString videoLength) {
+    Q_UNUSED(videoDir);
     Q_UNUSED(dateTime);
     Q_UNUSED(videoLength);
 }
@@ -47,3 +48,8 @@ bool DataManager::readDetectionAreaFile(bool clipToCamera) {
 QList<QPolygon*>& DataManager::detectionArea() {
     return m_detectionAreaPolygons;
 }
+
+QList<QPolygon*> DataManager::detectionArea(int cameraId) {
+    Q_UNUSED(cameraId);
+    return m_detectionAreaPolygons;
+}
@@ -0,0 +1,102 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "framesubscriber.h"
+#include <condition_variable>
+#include <thread>
+#include <QDateTime>
+
+/*
+ * Mock FrameSubscriber gives mockCameraNextFrame of mock Camera (mockcamera.cpp) as
+ * the next frame. When frame blocking is enabled with mockCamera_setFrameBlockingEnabled(),
+ * waitNextFrame() waits until mockCamera_releaseNextFrame() is called. Otherwise frames
+ * are given at 25 FPS.
+ */
+
+extern cv::Mat mockCameraNextFrame;
+extern std::atomic_bool mockCamera_blockFrameEnabled;
+extern std::mutex mockCamera_blockerMutex;
+extern std::condition_variable_any mockCamera_blockerCond;
+
+std::atomic<quint64> mockFrameSubscriber_sequenceNumber(0);
+
+FrameSubscriber::FrameSubscriber(DeliveryMode mode, int capacity, bool pacesSource) {
+    m_mode = mode;
+    m_capacity = capacity;
+    m_pacesSource = pacesSource;
+    m_waitingEnabled = true;
+    m_droppedFrames = 0;
+}
+
+CameraFramePtr FrameSubscriber::waitNextFrame(int timeoutMs) {
+    if (!m_waitingEnabled) {
+        return CameraFramePtr();
+    }
+    if (mockCamera_blockFrameEnabled) {
+        mockCamera_blockerMutex.lock();
+        std::cv_status status = mockCamera_blockerCond.wait_for(mockCamera_blockerMutex,
+                std::chrono::milliseconds((timeoutMs < 0) ? 1000 : timeoutMs));
+        mockCamera_blockerMutex.unlock();
+        if ((status == std::cv_status::timeout) && (timeoutMs >= 0)) {
+            return CameraFramePtr();
+        }
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 25));
+    }
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    frame->m_image = mockCameraNextFrame;
+    frame->m_sequenceNumber = ++mockFrameSubscriber_sequenceNumber;
+    frame->m_timestamp = FrameClock::now();
+    frame->m_wallClockMsecs = QDateTime::currentMSecsSinceEpoch();
+    return frame;
+}
+
+bool FrameSubscriber::publish(const CameraFramePtr& frame, int timeoutMs) {
+    Q_UNUSED(frame);
+    Q_UNUSED(timeoutMs);
+    return true;
+}
+
+void FrameSubscriber::setFrameCallback(std::function<void()> callback) {
+    m_frameCallback = callback;
+}
+
+void FrameSubscriber::stopWait() {
+    m_waitingEnabled = false;
+}
+
+FrameSubscriber::DeliveryMode FrameSubscriber::deliveryMode() {
+    return m_mode;
+}
+
+bool FrameSubscriber::pacesSource() {
+    return m_pacesSource;
+}
+
+int FrameSubscriber::capacity() {
+    return m_capacity;
+}
+
+int FrameSubscriber::count() {
+    return 0;
+}
+
+quint64 FrameSubscriber::droppedFrames() {
+    return m_droppedFrames;
+}
@@ -18,8 +18,15 @@
 
 #include "videobuffer.h"
 
-VideoBuffer::VideoBuffer(int capacity, QObject *parent) : QObject(parent) {
+VideoBuffer::VideoBuffer(int capacity, OverflowPolicy overflowPolicy, QObject *parent) : QObject(parent),
+    m_slots(capacity), m_extraDuplicates(capacity)
+{
     m_capacity = capacity;
+    m_overflowPolicy = overflowPolicy;
+    m_head = 0;
+    m_tail = 0;
+    m_spool = NULL;
+    m_framePool = NULL;
 }
 
 VideoBuffer::~VideoBuffer()
@@ -28,8 +35,8 @@ VideoBuffer::~VideoBuffer()
 }
 
 BufferedVideoFrame* VideoBuffer::waitNextFrame() {
-    if (!m_buffer.isEmpty()) {
-        return m_buffer.takeFirst();
+    if (m_head != m_tail) {
+        return m_slots[m_head++ % m_capacity];
     }
     return NULL;
 }
@@ -42,12 +49,41 @@ int VideoBuffer::capacity() {
     return m_capacity;
 }
 
-bool VideoBuffer::pushFrame(BufferedVideoFrame *frame) {
-    m_buffer.append(frame);
+bool VideoBuffer::pushFrame(BufferedVideoFrame *frame, BufferedVideoFrame** droppedFrame) {
+    if (droppedFrame) {
+        *droppedFrame = NULL;
+    }
+    if ((m_tail - m_head) >= (quint32)m_capacity) {
+        return false;
+    }
+    m_slots[m_tail++ % m_capacity] = frame;
     return true;
 }
 
-void VideoBuffer::stopWait() {
+VideoBuffer::OverflowPolicy VideoBuffer::overflowPolicy() {
+    return m_overflowPolicy;
 }
 
+VideoBuffer::OverflowPolicy VideoBuffer::overflowPolicyFromString(QString policy, bool* ok) {
+    Q_UNUSED(policy);
+    if (ok) {
+        *ok = true;
+    }
+    return Coalesce;
+}
+
+void VideoBuffer::setSpool(FrameSpool* spool, FramePool* framePool) {
+    m_spool = spool;
+    m_framePool = framePool;
+}
 
+int VideoBuffer::spooledCount() {
+    return 0;
+}
+
+const VideoBufferStats& VideoBuffer::stats() {
+    return m_stats;
+}
+
+void VideoBuffer::stopWait() {
+}
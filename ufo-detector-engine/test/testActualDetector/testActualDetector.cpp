@@ -58,6 +58,7 @@ private Q_SLOTS:
     void detectDarkObjects();
     void testBird();
     void setShowCameraVideo();
+    void toDetectionPixels();
 
 
 private:
@@ -162,6 +163,14 @@ void TestActualDetector::initialize() {
     QVERIFY(!m_actualDetector->m_nextFrame.empty());
     QVERIFY(!m_actualDetector->m_prevFrame.empty());
     QVERIFY(!m_actualDetector->m_resultFrame.empty());
+    // detection area is made for the received frames
+    QCOMPARE(m_actualDetector->m_region.mask().size(), m_actualDetector->m_nextFrame.size());
+    // object rectangles are clipped to the received frames
+    QCOMPARE(m_actualDetector->m_cameraWidth, mockCameraNextFrame.cols);
+    QCOMPARE(m_actualDetector->m_cameraHeight, mockCameraNextFrame.rows);
+    cv::Rect edgeRect(m_actualDetector->m_nextFrame.cols - 2, m_actualDetector->m_nextFrame.rows - 2, 10, 10);
+    QVERIFY((cv::Rect(0, 0, mockCameraNextFrame.cols, mockCameraNextFrame.rows) & m_actualDetector->toCameraRect(edgeRect))
+            == m_actualDetector->toCameraRect(edgeRect));
     QVERIFY(!m_actualDetector->m_startedRecording);
     // must not change m_showCameraVideo
     QVERIFY(m_actualDetector->m_showCameraVideo);
@@ -408,6 +417,20 @@ void TestActualDetector::setShowCameraVideo() {
             SLOT(onActualDetectorCameraFrameUpdated(QImage)));
 }
 
+void TestActualDetector::toDetectionPixels() {
+    const int detectionScale = m_actualDetector->m_detectionScale;
+
+    m_actualDetector->m_detectionScale = 1;
+    QCOMPARE(m_actualDetector->toDetectionPixels(140), 140);
+    // sizes given in camera pixels shrink with the detection image
+    m_actualDetector->m_detectionScale = 4;
+    QCOMPARE(m_actualDetector->toDetectionPixels(140), 35);
+    QCOMPARE(m_actualDetector->toDetectionPixels(10), 2);
+    QCOMPARE(m_actualDetector->toDetectionPixels(2), 1);
+
+    m_actualDetector->m_detectionScale = detectionScale;
+}
+
 void TestActualDetector::makeDetectionAreaFile() {
     QFile detectionAreaFile(m_config->detectionAreaFile());
     QVERIFY(detectionAreaFile.open(QFile::ReadWrite));
@@ -31,7 +31,14 @@ SOURCES += \
     ../../actualdetector.cpp \
     ../mock/mockconfig.cpp \
     ../mock/mockcamera.cpp \
+    ../mock/mockframesubscriber.cpp \
+    ../../cameraframe.cpp \
+    ../../workerpool.cpp \
+    ../../trackoverlay.cpp \
+    ../../motionmask.cpp \
+    ../../regionmask.cpp \
     ../mock/mockRecorder.cpp \
+    ../../pipelinestats.cpp \
     ../../Ctracker.cpp \
     ../../Detector.cpp \
     ../../Kalman.cpp \
@@ -46,7 +53,14 @@ SOURCES += \
 HEADERS += ../../actualdetector.h \
     ../../config.h \
     ../../camera.h \
+    ../../cameraframe.h \
+    ../../framesubscriber.h \
+    ../../workerpool.h \
+    ../../trackoverlay.h \
+    ../../motionmask.h \
+    ../../regionmask.h \
     ../../recorder.h \
+    ../../pipelinestats.h \
     ../../Ctracker.h \
     ../../Detector.h \
     ../../Kalman.h \
@@ -0,0 +1,23 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testcameraframe
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+include(../../turbojpeg.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testcameraframe.cpp \
+    ../../cameraframe.cpp
+HEADERS += ../../cameraframe.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,219 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "cameraframe.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <QtTest>
+
+/**
+ * @brief Unit test for CameraFrame pixel format handling.
+ */
+class TestCameraFrame : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestCameraFrame();
+
+private Q_SLOTS:
+    void lumaFromBgr();
+    void lumaFromYuyv();
+    void lumaFromGrey();
+    void lumaFromNv12();
+    void bgrImageCached();
+    void bgrImageCopy();
+    void lumaScaled();
+    void lumaScaledFromJpeg();
+    void lumaRegion();
+    void lumaRegionFromJpeg();
+
+private:
+    const int WIDTH = 8;
+    const int HEIGHT = 4;
+};
+
+TestCameraFrame::TestCameraFrame()
+{
+}
+
+void TestCameraFrame::lumaFromBgr()
+{
+    CameraFrame frame;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC3, cv::Scalar(50, 100, 150));
+    cv::Mat expected;
+    cv::cvtColor(frame.m_image, expected, CV_RGB2GRAY);
+
+    cv::Mat luma = frame.luma();
+    QCOMPARE(luma.type(), CV_8UC1);
+    QCOMPARE(cv::countNonZero(luma != expected), 0);
+    // converted only once
+    QVERIFY(frame.luma().data == luma.data);
+}
+
+void TestCameraFrame::lumaFromYuyv()
+{
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::YUYV;
+    // Y0 U Y1 V: Y = 100, U = V = 128
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC2, cv::Scalar(100, 128));
+
+    cv::Mat luma = frame.luma();
+    QCOMPARE(luma.type(), CV_8UC1);
+    QCOMPARE(luma.size(), cv::Size(WIDTH, HEIGHT));
+    QCOMPARE(cv::countNonZero(luma != 100), 0);
+    QVERIFY(frame.m_bgrCache.empty());
+}
+
+void TestCameraFrame::lumaFromGrey()
+{
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::GREY;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC1, cv::Scalar(42));
+
+    // no copy
+    QVERIFY(frame.luma().data == frame.m_image.data);
+    QVERIFY(frame.m_lumaCache.empty());
+}
+
+void TestCameraFrame::lumaFromNv12()
+{
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::NV12;
+    frame.m_image = cv::Mat(HEIGHT * 3 / 2, WIDTH, CV_8UC1, cv::Scalar(128));
+    frame.m_image.rowRange(0, HEIGHT).setTo(cv::Scalar(200));
+
+    cv::Mat luma = frame.luma();
+    QCOMPARE(luma.size(), cv::Size(WIDTH, HEIGHT));
+    QCOMPARE(frame.size(), cv::Size(WIDTH, HEIGHT));
+    QVERIFY(luma.data == frame.m_image.data);
+    QCOMPARE(cv::countNonZero(luma != 200), 0);
+}
+
+void TestCameraFrame::bgrImageCached()
+{
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::YUYV;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC2, cv::Scalar(100, 128));
+
+    QVERIFY(frame.m_bgrCache.empty());
+    cv::Mat bgr = frame.bgrImage();
+    QCOMPARE(bgr.type(), CV_8UC3);
+    QCOMPARE(bgr.size(), cv::Size(WIDTH, HEIGHT));
+    QVERIFY(frame.bgrImage().data == bgr.data);
+}
+
+void TestCameraFrame::bgrImageCopy()
+{
+    CameraFrame frame;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC3, cv::Scalar(1, 2, 3));
+
+    QVERIFY(frame.bgrImage().data == frame.m_image.data);
+    cv::Mat copy = frame.bgrImageCopy();
+    QVERIFY(copy.data != frame.m_image.data);
+    QCOMPARE(cv::countNonZero(copy.reshape(1) != frame.m_image.reshape(1)), 0);
+}
+
+void TestCameraFrame::lumaScaled()
+{
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::YUYV;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC2, cv::Scalar(100, 128));
+
+    QVERIFY(frame.lumaScaled(1).data == frame.luma().data);
+    cv::Mat scaled = frame.lumaScaled(2);
+    QCOMPARE(scaled.type(), CV_8UC1);
+    QCOMPARE(scaled.size(), cv::Size(WIDTH / 2, HEIGHT / 2));
+    QCOMPARE(cv::countNonZero(scaled != 100), 0);
+    QVERIFY(frame.lumaScaled(2).data == scaled.data);
+}
+
+void TestCameraFrame::lumaScaledFromJpeg()
+{
+    const int jpegWidth = 64;
+    const int jpegHeight = 48;
+    std::vector<uchar> jpeg;
+    QVERIFY(cv::imencode(".jpg", cv::Mat(jpegHeight, jpegWidth, CV_8UC3, cv::Scalar(90, 90, 90)), jpeg));
+
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::MJPEG;
+    frame.m_image = cv::Mat(1, jpeg.size(), CV_8UC1, jpeg.data());
+
+    cv::Mat scaled = frame.lumaScaled(4);
+    QCOMPARE(scaled.type(), CV_8UC1);
+    QCOMPARE(scaled.size(), cv::Size(jpegWidth / 4, jpegHeight / 4));
+    // decoded directly at reduced size
+    QVERIFY(frame.m_lumaCache.empty());
+    QVERIFY(frame.m_bgrCache.empty());
+    double minValue = 0;
+    double maxValue = 0;
+    cv::minMaxLoc(scaled, &minValue, &maxValue);
+    QVERIFY((minValue >= 85) && (maxValue <= 95));
+}
+
+void TestCameraFrame::lumaRegion()
+{
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::YUYV;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC2, cv::Scalar(100, 128));
+
+    cv::Mat region = frame.lumaRegion(cv::Rect(2, 3, 4, 5));
+    QCOMPARE(region.size(), cv::Size(4, 5));
+    QVERIFY(region.data == frame.luma().ptr(3, 2));
+    // clipped to the frame
+    region = frame.lumaRegion(cv::Rect(WIDTH - 2, HEIGHT - 3, 10, 10));
+    QCOMPARE(region.size(), cv::Size(2, 3));
+}
+
+void TestCameraFrame::lumaRegionFromJpeg()
+{
+    const int jpegWidth = 64;
+    const int jpegHeight = 48;
+    const cv::Rect rect(13, 21, 30, 17);
+    cv::Mat image(jpegHeight, jpegWidth, CV_8UC3);
+    for (int y = 0; y < jpegHeight; y++)
+    {
+        image.row(y).setTo(cv::Scalar(y * 4, y * 4, y * 4));
+    }
+    std::vector<uchar> jpeg;
+    QVERIFY(cv::imencode(".jpg", image, jpeg));
+
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::MJPEG;
+    frame.m_image = cv::Mat(1, jpeg.size(), CV_8UC1, jpeg.data());
+
+    cv::Mat region = frame.lumaRegion(rect);
+    QCOMPARE(region.type(), CV_8UC1);
+    QCOMPARE(region.size(), rect.size());
+#ifdef HAVE_TURBOJPEG
+    // decoded only for the region
+    QVERIFY(frame.m_lumaCache.empty());
+#endif
+    // same pixels as from the full image
+    cv::Mat fullLuma = cv::imdecode(jpeg, cv::IMREAD_GRAYSCALE);
+    cv::Mat difference;
+    cv::absdiff(region, fullLuma(rect), difference);
+    double maxDifference = 0;
+    cv::minMaxLoc(difference, NULL, &maxDifference);
+    QVERIFY(maxDifference <= 2);
+}
+
+QTEST_APPLESS_MAIN(TestCameraFrame)
+
+#include "testcameraframe.moc"
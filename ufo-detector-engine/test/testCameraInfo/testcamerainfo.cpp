@@ -3,6 +3,10 @@
 #include <QString>
 #include <QtTest>
 
+static QString testCacheFileName() {
+    return QDir::currentPath() + "/testcamerainfo.ini";
+}
+
 /**
  * @brief The TestCameraInfo class unit test for CameraInfo class
  * Drawback: needs a real web camera at the moment. If you know how to make
@@ -25,6 +29,7 @@ private Q_SLOTS:
     void compareResolutionsWidthFirst();
     void testListSorting();
     void testQueryPerformance();
+    void cache();
 
 private:
     CameraInfo* m_cameraInfo;
@@ -45,6 +50,8 @@ void TestCameraInfo::initTestCase()
 {
     m_cameraInfo = new CameraInfo(0);
     QVERIFY(NULL != m_cameraInfo);
+    QFile::remove(testCacheFileName());
+    m_cameraInfo->setCacheFileName(testCacheFileName());
     QVERIFY(m_cameraInfo->m_commonResolutions.size() > 0);
     QVERIFY(m_cameraInfo->m_availableResolutions.isEmpty());
     QVERIFY(!m_cameraInfo->m_knownAspectRatios.isEmpty());
@@ -56,6 +63,7 @@ void TestCameraInfo::cleanupTestCase()
     if (m_cameraInfo) {
         m_cameraInfo->deleteLater();
     }
+    QFile::remove(testCacheFileName());
 }
 
 void TestCameraInfo::cameraInfoInit()
@@ -76,8 +84,10 @@ void TestCameraInfo::cameraInfoInit()
     QVERIFY(!m_cameraInfo->knownAspectRatios().isEmpty());
     QVERIFY(m_cameraInfo->m_initialized);
     QVERIFY(m_cameraInfo->isInitialized());
-    QVERIFY(m_queryProgressEmitted.contains(1));    // lowest resolution
-    QVERIFY(m_queryProgressEmitted.contains(2));    // highest resolution
+    if (m_cameraInfo->m_queryMethod == CameraInfo::Probing) {
+        QVERIFY(m_queryProgressEmitted.contains(1));    // lowest resolution
+        QVERIFY(m_queryProgressEmitted.contains(2));    // highest resolution
+    }
     QVERIFY(m_queryProgressEmitted.contains(100));  // query done
 
     /// @todo check aspect ratio is found for each common and available resolution
@@ -194,6 +204,7 @@ void TestCameraInfo::testQueryPerformance() {
         int backend = backendIt.next();
         delete m_cameraInfo;
         m_cameraInfo = new CameraInfo(0, 0, backend);
+        m_cameraInfo->setCacheFileName(QString());
         duration.start();
         m_cameraInfo->init();
         durationMsecList << duration.elapsed();
@@ -208,6 +219,28 @@ void TestCameraInfo::testQueryPerformance() {
     }
 }
 
+void TestCameraInfo::cache() {
+    CameraInfo cameraInfo(0);
+    cameraInfo.setCacheFileName(testCacheFileName());
+    cameraInfo.m_deviceKey = "usb-0000:00:14.0-1/test 046d:0825";
+    cameraInfo.addResolution(QSize(1280, 720), QList<double>() << 10 << 30);
+    cameraInfo.addResolution(QSize(640, 480), QList<double>() << 30 << 15 << 7.5);
+    cameraInfo.addResolution(QSize(320, 240));
+    cameraInfo.writeCache();
+
+    CameraInfo cachedInfo(0);
+    cachedInfo.setCacheFileName(testCacheFileName());
+    cachedInfo.m_deviceKey = "usb-0000:00:14.0-2 046d:0825";
+    QVERIFY(!cachedInfo.readCache());
+    cachedInfo.m_deviceKey = cameraInfo.m_deviceKey;
+    QVERIFY(cachedInfo.readCache());
+    QCOMPARE(cachedInfo.availableResolutions(),
+             QList<QSize>() << QSize(320, 240) << QSize(640, 480) << QSize(1280, 720));
+    QCOMPARE(cachedInfo.frameRates(QSize(640, 480)), QList<double>() << 30 << 15 << 7.5);
+    QCOMPARE(cachedInfo.frameRates(QSize(1280, 720)), QList<double>() << 30 << 10);
+    QVERIFY(cachedInfo.frameRates(QSize(320, 240)).isEmpty());
+}
+
 QTEST_APPLESS_MAIN(TestCameraInfo)
 
 #include "testcamerainfo.moc"
@@ -14,6 +14,7 @@ private Q_SLOTS:
     void cleanup();
     void defaultValues();
     void motionThreshold();
+    void cameraSettings();
     void videoCodecSupportInfo();
 
 private:
@@ -51,6 +52,8 @@ void TestConfig::defaultValues() {
     QVERIFY(m_config->cameraWidth() == 640);
     QVERIFY(m_config->cameraHeight() == 480);
     QVERIFY(m_config->checkCameraAspectRatio() == true);
+    QVERIFY(m_config->cameraBackend() == "opencv");
+    QVERIFY(m_config->cameraPixelFormat() == "YUYV");
 
     //QVERIFY(m_config->detectionAreaFile());
     QVERIFY(m_config->detectionAreaSize() == 0);
@@ -65,7 +68,19 @@ void TestConfig::defaultValues() {
     QVERIFY(m_config->resultVideoCodecStr() == "FFV1");
     //QCOMPARE(m_config->resultVideoCodec(), CV_FOURCC('F', 'F', 'V', '1'));
     QVERIFY(m_config->resultVideoWithObjectRectangles() == false);
+    QVERIFY(m_config->prerollSeconds() == 10);
+    QVERIFY(m_config->prerollMemoryMB() == 64);
+    QVERIFY(m_config->videoBufferOverflowPolicy() == "coalesce");
+    QVERIFY(m_config->videoSegmentSeconds() == 60);
+    QVERIFY(m_config->videoFrameRate() == 0);
+    QVERIFY(m_config->variableFrameRateVideo() == false);
+    QVERIFY(m_config->videoSpoolSeconds() == 0);
+    QVERIFY(m_config->videoStagingDir().isEmpty());
     //QVERIFY(m_config->videoEncoderLocation());
+    QVERIFY(m_config->encoderMaxJobs() == 1);
+    QVERIFY(m_config->encoderNiceness() == 10);
+    QVERIFY(m_config->encoderIdleIo() == true);
+    QVERIFY(m_config->deferVideoEncoding() == false);
     //QVERIFY(m_config->resultImageDir());
     QVERIFY(m_config->saveResultImages() == false);
 
@@ -85,6 +100,25 @@ void TestConfig::motionThreshold() {
     QVERIFY(settingsFile.exists());
 }
 
+void TestConfig::cameraSettings() {
+    QCOMPARE(m_config->cameraIndexes(), QList<int>() << 0);
+    m_config->m_settings->setValue(m_config->m_settingKeys[Config::CameraIndexes], "2, 0,x,2");
+    QCOMPARE(m_config->cameraIndexes(), QList<int>() << 2 << 0);
+
+    // camera specific value overrides the common one
+    m_config->setMotionThreshold(20);
+    m_config->m_settings->setValue("camera2/motionThreshold", 30);
+    QCOMPARE(m_config->motionThreshold(2), 30);
+    QCOMPARE(m_config->motionThreshold(0), 20);
+    QCOMPARE(m_config->noiseFilterPixelSize(2), 2);
+
+    QCOMPARE(m_config->detectionDownscale(0), 1);
+    m_config->m_settings->setValue("camera2/detectionDownscale", 4);
+    QCOMPARE(m_config->detectionDownscale(2), 4);
+    m_config->m_settings->setValue("camera2/detectionDownscale", 3);
+    QCOMPARE(m_config->detectionDownscale(2), 1);
+}
+
 void TestConfig::videoCodecSupportInfo() {
     QVERIFY(m_config->videoCodecSupportInfo() != NULL);
     QVERIFY(m_config->videoCodecSupportInfo()->isInitialized());
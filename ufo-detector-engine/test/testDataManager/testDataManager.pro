@@ -9,7 +9,7 @@ QT       += network testlib xml widgets
 QT       -= gui
 
 TARGET = testdatamanager
-CONFIG += console testcase
+CONFIG += console testcase c++11
 CONFIG -= app_bundle
 
 TEMPLATE = app
@@ -22,6 +22,7 @@
 #include <QtTest>
 #include <QDomDocument>
 #include <QDomNode>
+#include <thread>
 
 class TestDataManager : public QObject
 {
@@ -42,11 +43,13 @@ private Q_SLOTS:
     void resultDataDomDocument();
     void removeVideo();
     void saveResultData();
+    void saveResultData_concurrent();
     void checkFolders();
     void checkDetectionAreaFile();
     void readResultDataFile();
     void readDetectionAreaFile();
     void detectionArea();
+    void detectionArea_perCamera();
     void resetDetectionAreaFile();
 
 public slots:
@@ -147,7 +150,7 @@ void TestDataManager::saveResultData() {
 
     m_dataManager->init();
 
-    m_dataManager->saveResultData(dateTime, videoLength);
+    m_dataManager->saveResultData(m_config->resultVideoDir() + "/camera1", dateTime, videoLength);
 
     QCOMPARE(m_resultDataSavedCounter, 1);
     QVERIFY(!m_dataManager->m_resultDataFile.isOpen());
@@ -160,12 +163,43 @@ void TestDataManager::saveResultData() {
     videoEntry = resultDataDom.firstChild().childNodes().at(0).toElement();
     QCOMPARE(videoEntry.nodeName(), QString("Video"));
     QCOMPARE(videoEntry.attributes().length(), 3);
-    QCOMPARE(videoEntry.attribute("Pathname"), m_config->resultVideoDir());
+    QCOMPARE(videoEntry.attribute("Pathname"), m_config->resultVideoDir() + "/camera1");
     QCOMPARE(videoEntry.attribute("Length"), videoLength);
     QCOMPARE(videoEntry.attribute("DateTime"), dateTime);
     resultDataDom.clear();
 }
 
+void TestDataManager::saveResultData_concurrent() {
+    const int entriesPerCamera = 50;
+    QDomDocument resultDataDom;
+    m_dataManager->init();
+    int entriesBefore = m_dataManager->resultDataDomDocument()->firstChildElement().childNodes().count();
+
+    // recorders of two cameras save their entries at the same time
+    auto saveEntries = [this](QString videoDir) {
+        for (int i = 0; i < entriesPerCamera; i++) {
+            m_dataManager->saveResultData(videoDir, "2017-04-10--12-00-00", "00:10");
+        }
+    };
+    std::thread camera0(saveEntries, m_config->resultVideoDir() + "/camera0");
+    std::thread camera1(saveEntries, m_config->resultVideoDir() + "/camera1");
+    camera0.join();
+    camera1.join();
+
+    QVERIFY(m_resultDataFile.open(QFile::ReadOnly));
+    QVERIFY(resultDataDom.setContent(m_resultDataFile.readAll()));
+    m_resultDataFile.close();
+    QDomNodeList entries = resultDataDom.firstChild().childNodes();
+    QCOMPARE(entries.count(), entriesBefore + 2 * entriesPerCamera);
+    int camera1Entries = 0;
+    for (int i = entriesBefore; i < entries.count(); i++) {
+        if (entries.at(i).toElement().attribute("Pathname").endsWith("/camera1")) {
+            camera1Entries++;
+        }
+    }
+    QCOMPARE(camera1Entries, entriesPerCamera);
+}
+
 void TestDataManager::checkFolders() {
     QSKIP("TODO");
 }
@@ -186,6 +220,36 @@ void TestDataManager::detectionArea() {
     QVERIFY(m_dataManager->detectionArea() == m_dataManager->m_detectionAreaPolygons);
 }
 
+void TestDataManager::detectionArea_perCamera() {
+    QFile areaFile(m_config->detectionAreaFile());
+    QVERIFY(areaFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text));
+    QTextStream out(&areaFile);
+    out << "<detectionarealist>" << endl;
+    for (int cameraId = 0; cameraId < 2; cameraId++) {
+        out << "  <detectionarea>" << endl;
+        out << "    <camera id=\"" << cameraId << "\" width=\"640\" height=\"480\"/>" << endl;
+        out << "    <polygon>" << endl;
+        out << "      <point x=\"" << (cameraId * 10) << "\" y=\"0\"/>" << endl;
+        out << "      <point x=\"" << (cameraId * 10) << "\" y=\"10\"/>" << endl;
+        out << "      <point x=\"20\" y=\"10\"/>" << endl;
+        out << "    </polygon>" << endl;
+        out << "  </detectionarea>" << endl;
+    }
+    out << "</detectionarealist>" << endl;
+    out.flush();
+    areaFile.close();
+
+    QVERIFY(m_dataManager->readDetectionAreaFile(false));
+    QCOMPARE(m_dataManager->detectionArea().size(), 2);
+    QCOMPARE(m_dataManager->detectionArea(0).size(), 1);
+    QCOMPARE(m_dataManager->detectionArea(0).first()->first(), QPoint(0, 0));
+    QCOMPARE(m_dataManager->detectionArea(1).size(), 1);
+    QCOMPARE(m_dataManager->detectionArea(1).first()->first(), QPoint(10, 0));
+    QVERIFY(m_dataManager->detectionArea(2).isEmpty());
+
+    QVERIFY(areaFile.remove());
+}
+
 void TestDataManager::resetDetectionAreaFile() {
     QSKIP("TODO");
 }
@@ -0,0 +1,278 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "encodingqueue.h"
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include <QSignalSpy>
+#include <QString>
+#include <QtTest>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+/**
+ * @brief EncodingQueue unit test class
+ *
+ * A shell script stands in for the encoder: it copies the input to the output,
+ * fails with codec "fail" and writes its niceness with codec "nice".
+ */
+class TestEncodingQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestEncodingQueue();
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void encoderArguments();
+    void encoderArguments_concat();
+    void concatListFiles();
+    void maxJobs();
+    void jobOrder();
+    void failedJob();
+    void failedJob_encoderMissing();
+    void niceness();
+    void resumeSavedJobs();
+
+private:
+    QString m_dirName;
+    QString m_encoderLocation;
+    QString m_jobFileName;
+
+    /**
+     * @brief Create input file of size bytes.
+     * @return file name
+     */
+    QString createInput(QString name, int size);
+    QString targetName(QString name);
+};
+
+TestEncodingQueue::TestEncodingQueue() {
+    m_dirName = QDir::tempPath() + "/testencodingqueue";
+    m_encoderLocation = m_dirName + "/encoder.sh";
+    m_jobFileName = m_dirName + "/encodingjobs.ini";
+}
+
+void TestEncodingQueue::initTestCase() {
+    QVERIFY(QDir().mkpath(m_dirName));
+    QFile encoder(m_encoderLocation);
+    QVERIFY(encoder.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    // arguments: -y -i input -vcodec codec output
+    encoder.write("#!/bin/sh\n"
+                  "sleep 0.2\n"
+                  "[ \"$5\" = fail ] && exit 1\n"
+                  "[ \"$5\" = nice ] && { nice > \"$6\"; exit 0; }\n"
+                  "cp \"$3\" \"$6\"\n");
+    encoder.close();
+    QVERIFY(encoder.setPermissions(QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner));
+}
+
+void TestEncodingQueue::cleanupTestCase() {
+    QVERIFY(QDir(m_dirName).removeRecursively());
+}
+
+void TestEncodingQueue::init() {
+    QFile::remove(m_jobFileName);
+}
+
+QString TestEncodingQueue::createInput(QString name, int size) {
+    QString fileName = m_dirName + "/" + name + "temp.avi";
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(QByteArray(size, 'x'));
+    }
+    return fileName;
+}
+
+QString TestEncodingQueue::targetName(QString name) {
+    return m_dirName + "/" + name + ".avi";
+}
+
+void TestEncodingQueue::encoderArguments() {
+    QStringList args = EncodingQueue::encoderArguments("in.avi", "ffv1", "out.avi");
+    QCOMPARE(args.first(), QString("-y"));
+    QCOMPARE(args.at(args.indexOf("-i") + 1), QString("in.avi"));
+    QCOMPARE(args.at(args.indexOf("-vcodec") + 1), QString("ffv1"));
+    QCOMPARE(args.last(), QString("out.avi"));
+}
+
+void TestEncodingQueue::encoderArguments_concat() {
+    QStringList args = EncodingQueue::encoderArguments("segments/video.ffconcat", "copy", "out.avi");
+    QCOMPARE(args.at(args.indexOf("-f") + 1), QString("concat"));
+    QVERIFY(args.indexOf("-f") < args.indexOf("-i"));
+    QCOMPARE(args.at(args.indexOf("-i") + 1), QString("segments/video.ffconcat"));
+    QCOMPARE(args.at(args.indexOf("-vcodec") + 1), QString("copy"));
+}
+
+void TestEncodingQueue::concatListFiles() {
+    QString listFileName = m_dirName + "/video.ffconcat";
+    QFile listFile(listFileName);
+    QVERIFY(listFile.open(QIODevice::WriteOnly | QIODevice::Text));
+    listFile.write("ffconcat version 1.0\nfile 'video-000.mkv'\nfile '/other/video-001.mkv'\n");
+    listFile.close();
+
+    QStringList files = EncodingQueue::concatListFiles(listFileName);
+    QCOMPARE(files.size(), 2);
+    QCOMPARE(files.at(0), m_dirName + "/video-000.mkv");
+    QCOMPARE(files.at(1), QString("/other/video-001.mkv"));
+    QVERIFY(EncodingQueue::concatListFiles(m_dirName + "/missing.ffconcat").isEmpty());
+}
+
+void TestEncodingQueue::maxJobs() {
+    EncodingQueue queue(m_encoderLocation, m_jobFileName, 2);
+    QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+    QStringList names;
+    names << "a" << "b" << "c";
+    foreach (QString name, names) {
+        queue.enqueue(createInput(name, 100), targetName(name), "copy");
+    }
+    QCOMPARE(queue.runningCount(), 2);
+    QCOMPARE(queue.pendingCount(), 1);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 3, 5000);
+    QCOMPARE(queue.runningCount(), 0);
+    QCOMPARE(queue.pendingCount(), 0);
+    foreach (QString name, names) {
+        QVERIFY(QFile::exists(targetName(name)));
+        QVERIFY(!QFile::exists(m_dirName + "/" + name + "temp.avi"));
+    }
+    for (int i = 0; i < finishedSpy.count(); i++) {
+        QVERIFY(finishedSpy.at(i).at(1).toBool());
+        QVERIFY(finishedSpy.at(i).at(3).toLongLong() >= 200);
+    }
+    // the third job waited for one of the first two
+    QVERIFY(finishedSpy.at(2).at(2).toLongLong() >= 200);
+}
+
+void TestEncodingQueue::jobOrder() {
+    EncodingQueue queue(m_encoderLocation, m_jobFileName, 1);
+    QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+    queue.setDeferWhileRecording(true);
+    queue.recordingStarted();
+    queue.enqueue(createInput("large", 1000), targetName("large"), "copy");
+    queue.enqueue(createInput("small", 10), targetName("small"), "copy");
+    queue.enqueue(createInput("urgent", 1000), targetName("urgent"), "copy", 1);
+    QCOMPARE(queue.runningCount(), 0);
+    QCOMPARE(queue.pendingCount(), 3);
+
+    queue.recordingFinished();
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 3, 5000);
+    // priority first, then smallest input
+    QCOMPARE(finishedSpy.at(0).at(0).toString(), targetName("urgent"));
+    QCOMPARE(finishedSpy.at(1).at(0).toString(), targetName("small"));
+    QCOMPARE(finishedSpy.at(2).at(0).toString(), targetName("large"));
+}
+
+void TestEncodingQueue::failedJob() {
+    EncodingQueue queue(m_encoderLocation, m_jobFileName, 1);
+    QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+    QString input = createInput("failing", 10);
+    queue.enqueue(input, targetName("failing"), "fail");
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 5000);
+    QVERIFY(!finishedSpy.at(0).at(1).toBool());
+    // input is kept when encoding fails
+    QVERIFY(QFile::exists(input));
+    QCOMPARE(queue.failedCount(), 1);
+    QCOMPARE(queue.pendingCount(), 0);
+
+    // and the job is retried by the next queues until it has failed MAX_ATTEMPTS times
+    for (int attempt = 2; attempt <= EncodingQueue::MAX_ATTEMPTS; attempt++) {
+        EncodingQueue retryQueue(m_encoderLocation, m_jobFileName, 1);
+        QSignalSpy retrySpy(&retryQueue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+        QCOMPARE(retryQueue.pendingCount(), 1);
+        QTRY_COMPARE_WITH_TIMEOUT(retrySpy.count(), 1, 5000);
+        QVERIFY(!retrySpy.at(0).at(1).toBool());
+    }
+    EncodingQueue gaveUpQueue(m_encoderLocation, m_jobFileName, 1);
+    QCOMPARE(gaveUpQueue.pendingCount(), 0);
+    QCOMPARE(gaveUpQueue.failedCount(), 1);
+    QSettings jobFile(m_jobFileName, QSettings::IniFormat);
+    QCOMPARE(jobFile.beginReadArray("jobs"), 1);
+    jobFile.setArrayIndex(0);
+    QCOMPARE(jobFile.value("tempFile").toString(), input);
+    QCOMPARE(jobFile.value("failures").toInt(), (int)EncodingQueue::MAX_ATTEMPTS);
+    jobFile.endArray();
+    QVERIFY(QFile::remove(input));
+}
+
+void TestEncodingQueue::failedJob_encoderMissing() {
+    QString input = createInput("missing", 10);
+    {
+        EncodingQueue queue(m_dirName + "/nonexistingEncoder", m_jobFileName, 1);
+        QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+        queue.enqueue(input, targetName("missing"), "copy");
+        QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 5000);
+        QVERIFY(!finishedSpy.at(0).at(1).toBool());
+        QCOMPARE(queue.failedCount(), 1);
+    }
+    // encoder has been installed meanwhile
+    EncodingQueue queue(m_encoderLocation, m_jobFileName, 1);
+    QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+    QCOMPARE(queue.pendingCount(), 1);
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 5000);
+    QVERIFY(finishedSpy.at(0).at(1).toBool());
+    QVERIFY(QFile::exists(targetName("missing")));
+    QVERIFY(!QFile::exists(input));
+    QCOMPARE(queue.failedCount(), 0);
+    QSettings jobFile(m_jobFileName, QSettings::IniFormat);
+    QCOMPARE(jobFile.beginReadArray("jobs"), 0);
+    jobFile.endArray();
+}
+
+void TestEncodingQueue::niceness() {
+#ifdef Q_OS_LINUX
+    EncodingQueue queue(m_encoderLocation, m_jobFileName, 1);
+    QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+    queue.setNiceness(5);
+    queue.enqueue(createInput("nice", 10), targetName("nice"), "nice");
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 5000);
+    QFile output(targetName("nice"));
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QCOMPARE(output.readAll().trimmed().toInt(), nice(0) + 5);
+#endif
+}
+
+void TestEncodingQueue::resumeSavedJobs() {
+    {
+        EncodingQueue queue(m_encoderLocation, m_jobFileName, 1);
+        queue.setDeferWhileRecording(true);
+        queue.recordingStarted();
+        queue.enqueue(createInput("saved1", 10), targetName("saved1"), "copy");
+        queue.enqueue(createInput("saved2", 10), targetName("saved2"), "copy");
+    }
+    EncodingQueue queue(m_encoderLocation, m_jobFileName, 1);
+    QSignalSpy finishedSpy(&queue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+    QCOMPARE(queue.pendingCount(), 2);
+    QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 2, 5000);
+    QVERIFY(QFile::exists(targetName("saved1")));
+    QVERIFY(QFile::exists(targetName("saved2")));
+
+    // finished jobs are removed from the job file
+    QSettings jobFile(m_jobFileName, QSettings::IniFormat);
+    QCOMPARE(jobFile.beginReadArray("jobs"), 0);
+    jobFile.endArray();
+}
+
+QTEST_GUILESS_MAIN(TestEncodingQueue)
+
+#include "testencodingqueue.moc"
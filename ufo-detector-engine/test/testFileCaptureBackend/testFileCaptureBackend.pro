@@ -0,0 +1,25 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testfilecapturebackend
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testfilecapturebackend.cpp \
+    ../../filecapturebackend.cpp \
+    ../../cameraframe.cpp
+HEADERS += ../../filecapturebackend.h \
+    ../../capturebackend.h \
+    ../../cameraframe.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,133 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "filecapturebackend.h"
+#include <QString>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/**
+ * @brief Unit test for FileCaptureBackend class, using a generated image directory.
+ */
+class TestFileCaptureBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFileCaptureBackend();
+
+private Q_SLOTS:
+    void initTestCase();
+    void imageDirectory();
+    void scaling();
+    void realTime();
+    void missingInput();
+
+private:
+    const int IMAGE_COUNT = 5;
+    const int WIDTH = 64;
+    const int HEIGHT = 48;
+
+    QTemporaryDir m_imageDir;
+};
+
+TestFileCaptureBackend::TestFileCaptureBackend()
+{
+}
+
+void TestFileCaptureBackend::initTestCase()
+{
+    QVERIFY(m_imageDir.isValid());
+    // gray level tells the image number; written in reverse to check ordering by name
+    for (int i = IMAGE_COUNT - 1; i >= 0; i--) {
+        cv::Mat image(HEIGHT, WIDTH, CV_8UC3, cv::Scalar(i * 10, i * 10, i * 10));
+        QString fileName = QDir(m_imageDir.path()).filePath(QString("image%1.png").arg(i));
+        QVERIFY(cv::imwrite(fileName.toStdString(), image));
+    }
+    // not an image, ignored
+    QFile otherFile(QDir(m_imageDir.path()).filePath("notes.txt"));
+    QVERIFY(otherFile.open(QIODevice::WriteOnly));
+    otherFile.close();
+}
+
+void TestFileCaptureBackend::imageDirectory()
+{
+    FileCaptureBackend backend(m_imageDir.path(), false);
+    QVERIFY(!backend.isLive());
+    QVERIFY(backend.isFreeRunning());
+    QVERIFY(backend.open(WIDTH, HEIGHT));
+    QCOMPARE(backend.fps(), backend.DEFAULT_FPS);
+
+    FrameClock::time_point firstTimestamp;
+    for (int i = 0; i < IMAGE_COUNT; i++) {
+        CameraFrame frame;
+        QVERIFY(backend.readFrame(&frame));
+        QCOMPARE(frame.m_pixelFormat, CameraFrame::BGR);
+        QCOMPARE(frame.m_image.size(), cv::Size(WIDTH, HEIGHT));
+        QCOMPARE((int)frame.m_image.at<cv::Vec3b>(0, 0)[0], i * 10);
+        if (i == 0) {
+            firstTimestamp = frame.m_timestamp;
+        }
+        // timestamps follow the frame rate even though frames are read faster
+        std::chrono::milliseconds mediaTime =
+                std::chrono::duration_cast<std::chrono::milliseconds>(frame.m_timestamp - firstTimestamp);
+        QVERIFY(qAbs((int)mediaTime.count() - (int)(i * 1000 / backend.DEFAULT_FPS)) <= 1);
+    }
+    QVERIFY(!backend.atEnd());
+    CameraFrame frame;
+    QVERIFY(!backend.readFrame(&frame));
+    QVERIFY(backend.atEnd());
+}
+
+void TestFileCaptureBackend::scaling()
+{
+    FileCaptureBackend backend(m_imageDir.path(), false);
+    QVERIFY(backend.open(WIDTH * 2, HEIGHT * 2));
+    QCOMPARE(backend.frameSize(), cv::Size(WIDTH * 2, HEIGHT * 2));
+    CameraFrame frame;
+    QVERIFY(backend.readFrame(&frame));
+    QCOMPARE(frame.m_image.size(), cv::Size(WIDTH * 2, HEIGHT * 2));
+}
+
+void TestFileCaptureBackend::realTime()
+{
+    FileCaptureBackend backend(m_imageDir.path(), true);
+    QVERIFY(!backend.isFreeRunning());
+    QVERIFY(backend.open(WIDTH, HEIGHT));
+    QTime timer;
+    timer.start();
+    for (int i = 0; i < IMAGE_COUNT; i++) {
+        CameraFrame frame;
+        QVERIFY(backend.readFrame(&frame));
+        QVERIFY(frame.m_timestamp <= FrameClock::now());
+    }
+    QVERIFY(timer.elapsed() >= (int)((IMAGE_COUNT - 1) * 1000 / backend.DEFAULT_FPS) - 10);
+}
+
+void TestFileCaptureBackend::missingInput()
+{
+    FileCaptureBackend backend(QDir(m_imageDir.path()).filePath("missing.mkv"), false);
+    QVERIFY(!backend.open(WIDTH, HEIGHT));
+    QVERIFY(!backend.isOpened());
+}
+
+QTEST_APPLESS_MAIN(TestFileCaptureBackend)
+
+#include "testfilecapturebackend.moc"
@@ -0,0 +1,27 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testframepool
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testframepool.cpp \
+    ../../framepool.cpp
+HEADERS += ../../framepool.h \
+    ../../videobuffer.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
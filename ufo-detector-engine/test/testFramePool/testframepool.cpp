@@ -0,0 +1,140 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framepool.h"
+#include <QString>
+#include <QtTest>
+#include <cstdint>
+
+/**
+ * @brief FramePool unit test class
+ */
+class TestFramePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFramePool();
+
+private Q_SLOTS:
+    void constructor();
+    void acquireAndReturn();
+    void acquire_exhausted();
+    void adopt();
+    void reallocatedImage();
+    void constructor_allocationFails();
+};
+
+TestFramePool::TestFramePool() {
+}
+
+void TestFramePool::constructor() {
+    FramePool pool(3, cv::Size(64, 48));
+    QCOMPARE(pool.capacity(), 3);
+    QCOMPARE(pool.available(), 3);
+    QVERIFY(pool.frameSize() == cv::Size(64, 48));
+    QVERIFY(0 == pool.exhaustedCount());
+    for (int i = 0; i < pool.capacity(); i++) {
+        QVERIFY(0 == ((uintptr_t)pool.m_buffers[i] % FramePool::BUFFER_ALIGNMENT));
+        QVERIFY(pool.m_frames[i].m_frame->data == pool.m_buffers[i]);
+    }
+}
+
+void TestFramePool::acquireAndReturn() {
+    FramePool pool(2, cv::Size(64, 48));
+    uchar* firstData = NULL;
+    {
+        PooledFrame frame = pool.acquire();
+        QVERIFY(frame);
+        QCOMPARE(pool.available(), 1);
+        QCOMPARE(frame->m_frame->cols, 64);
+        QCOMPARE(frame->m_frame->rows, 48);
+        QCOMPARE(frame->m_frame->type(), CV_8UC3);
+        QCOMPARE(frame->m_duplicateCount, 0);
+        frame->m_duplicateCount = 5;
+        firstData = frame->m_frame->data;
+    }
+    QCOMPARE(pool.available(), 2);
+
+    // the most recently returned frame is reused first
+    PooledFrame frame = pool.acquire();
+    QVERIFY(frame->m_frame->data == firstData);
+    QCOMPARE(frame->m_duplicateCount, 0);
+}
+
+void TestFramePool::acquire_exhausted() {
+    FramePool pool(2, cv::Size(64, 48));
+    PooledFrame first = pool.acquire();
+    PooledFrame second = pool.acquire();
+    QVERIFY(first && second);
+    QVERIFY(first->m_frame->data != second->m_frame->data);
+    QCOMPARE(pool.available(), 0);
+
+    PooledFrame third = pool.acquire();
+    QVERIFY(!third);
+    QVERIFY(1 == pool.exhaustedCount());
+    QVERIFY(!pool.acquire());
+    QVERIFY(2 == pool.exhaustedCount());
+
+    second.reset();
+    third = pool.acquire();
+    QVERIFY(third);
+    QVERIFY(2 == pool.exhaustedCount());
+}
+
+void TestFramePool::adopt() {
+    FramePool pool(1, cv::Size(64, 48));
+    BufferedVideoFrame* rawFrame = pool.acquire().release();
+    QVERIFY(NULL != rawFrame);
+    QCOMPARE(pool.available(), 0);
+
+    pool.adopt(rawFrame);
+    QCOMPARE(pool.available(), 1);
+
+    PooledFrame empty = pool.adopt(NULL);
+    QVERIFY(!empty);
+    empty.reset();
+    QCOMPARE(pool.available(), 1);
+}
+
+void TestFramePool::reallocatedImage() {
+    FramePool pool(1, cv::Size(64, 48));
+    {
+        PooledFrame frame = pool.acquire();
+        // writing an image of another size reallocates the Mat
+        cv::Mat(100, 100, CV_8UC3, cv::Scalar(1, 2, 3)).copyTo(*(frame->m_frame));
+        QVERIFY(frame->m_frame->data != pool.m_buffers[0]);
+    }
+    PooledFrame frame = pool.acquire();
+    QVERIFY(frame->m_frame->data == pool.m_buffers[0]);
+    QVERIFY(frame->m_frame->size() == cv::Size(64, 48));
+}
+
+void TestFramePool::constructor_allocationFails() {
+    // terabytes per frame
+    FramePool pool(2, cv::Size(1 << 20, 1 << 20));
+    QCOMPARE(pool.capacity(), 0);
+    QCOMPARE(pool.available(), 0);
+    PooledFrame frame = pool.acquire();
+    QVERIFY(!frame);
+    QVERIFY(1 == pool.exhaustedCount());
+}
+
+QTEST_APPLESS_MAIN(TestFramePool)
+
+#include "testframepool.moc"
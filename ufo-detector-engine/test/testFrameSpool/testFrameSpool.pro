@@ -0,0 +1,27 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testframespool
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testframespool.cpp \
+    ../../framespool.cpp
+HEADERS += ../../framespool.h \
+    ../../videobuffer.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
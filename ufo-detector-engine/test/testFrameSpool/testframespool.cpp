@@ -0,0 +1,169 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "framespool.h"
+#include <QDir>
+#include <QString>
+#include <QtTest>
+
+/**
+ * @brief FrameSpool unit test class
+ */
+class TestFrameSpool : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFrameSpool();
+
+private Q_SLOTS:
+    void constructor();
+    void writeAndRead();
+    void write_full();
+    void write_wrongSize();
+    void read_empty();
+    void wrapAround();
+    void clear();
+    void destructor_removesFile();
+
+private:
+    QString m_fileName;
+
+    /**
+     * @brief Fill image with value and set frame fields.
+     */
+    void setFrame(BufferedVideoFrame& frame, cv::Mat& image, int value);
+};
+
+TestFrameSpool::TestFrameSpool() {
+    m_fileName = QDir::tempPath() + "/testframespool.tmp";
+}
+
+void TestFrameSpool::setFrame(BufferedVideoFrame& frame, cv::Mat& image, int value) {
+    image = cv::Mat(cv::Size(64, 48), CV_8UC3, cv::Scalar(value, value, value));
+    frame.m_frame = &image;
+    frame.m_duplicateCount = value;
+    frame.m_timestamp = FrameClock::time_point(FrameClock::duration(1000 + value));
+    frame.m_sequenceNumber = 100 + value;
+}
+
+void TestFrameSpool::constructor() {
+    FrameSpool spool(m_fileName, 3, cv::Size(64, 48));
+    QVERIFY(spool.isOpen());
+    QVERIFY(QFile::exists(m_fileName));
+    QCOMPARE(spool.capacity(), 3);
+    QCOMPARE(spool.count(), 0);
+    QVERIFY(spool.isEmpty());
+    QVERIFY(spool.frameSize() == cv::Size(64, 48));
+    QVERIFY(spool.m_slotSize >= (FrameSpool::IMAGE_OFFSET + 64 * 48 * 3));
+    QVERIFY(0 == (spool.m_slotSize % FrameSpool::SLOT_ALIGNMENT));
+}
+
+void TestFrameSpool::writeAndRead() {
+    FrameSpool spool(m_fileName, 3, cv::Size(64, 48));
+    cv::Mat image1, image2;
+    BufferedVideoFrame frame1, frame2;
+    setFrame(frame1, image1, 1);
+    setFrame(frame2, image2, 2);
+    QVERIFY(spool.write(frame1));
+    QVERIFY(spool.write(frame2));
+    QCOMPARE(spool.count(), 2);
+
+    cv::Mat image(cv::Size(64, 48), CV_8UC3, cv::Scalar(0, 0, 0));
+    BufferedVideoFrame frame;
+    frame.m_frame = &image;
+    QVERIFY(spool.read(frame));
+    QCOMPARE(frame.m_duplicateCount, 1);
+    QVERIFY(frame.m_timestamp == frame1.m_timestamp);
+    QVERIFY(frame.m_sequenceNumber == frame1.m_sequenceNumber);
+    QVERIFY(0 == cv::norm(image, image1, cv::NORM_INF));
+    QVERIFY(spool.read(frame));
+    QCOMPARE(frame.m_duplicateCount, 2);
+    QVERIFY(0 == cv::norm(image, image2, cv::NORM_INF));
+    QVERIFY(spool.isEmpty());
+}
+
+void TestFrameSpool::write_full() {
+    FrameSpool spool(m_fileName, 2, cv::Size(64, 48));
+    cv::Mat image;
+    BufferedVideoFrame frame;
+    setFrame(frame, image, 1);
+    QVERIFY(spool.write(frame));
+    QVERIFY(spool.write(frame));
+    QVERIFY(!spool.write(frame));
+    QCOMPARE(spool.count(), 2);
+}
+
+void TestFrameSpool::write_wrongSize() {
+    FrameSpool spool(m_fileName, 2, cv::Size(32, 24));
+    cv::Mat image;
+    BufferedVideoFrame frame;
+    setFrame(frame, image, 1);
+    QVERIFY(!spool.write(frame));
+    QVERIFY(spool.isEmpty());
+}
+
+void TestFrameSpool::read_empty() {
+    FrameSpool spool(m_fileName, 2, cv::Size(64, 48));
+    cv::Mat image(cv::Size(64, 48), CV_8UC3);
+    BufferedVideoFrame frame;
+    frame.m_frame = &image;
+    QVERIFY(!spool.read(frame));
+}
+
+void TestFrameSpool::wrapAround() {
+    FrameSpool spool(m_fileName, 2, cv::Size(64, 48));
+    cv::Mat image;
+    BufferedVideoFrame frame;
+    cv::Mat readImage(cv::Size(64, 48), CV_8UC3);
+    BufferedVideoFrame readFrame;
+    readFrame.m_frame = &readImage;
+    for (int i = 0; i < 5; i++) {
+        setFrame(frame, image, i);
+        QVERIFY(spool.write(frame));
+        QVERIFY(spool.read(readFrame));
+        QCOMPARE(readFrame.m_duplicateCount, i);
+        QCOMPARE((int)readImage.at<cv::Vec3b>(47, 63)[2], i);
+    }
+    QVERIFY(spool.isEmpty());
+}
+
+void TestFrameSpool::clear() {
+    FrameSpool spool(m_fileName, 2, cv::Size(64, 48));
+    cv::Mat image;
+    BufferedVideoFrame frame;
+    setFrame(frame, image, 1);
+    QVERIFY(spool.write(frame));
+    spool.clear();
+    QVERIFY(spool.isEmpty());
+    QVERIFY(spool.write(frame));
+    QVERIFY(spool.write(frame));
+    QCOMPARE(spool.count(), 2);
+}
+
+void TestFrameSpool::destructor_removesFile() {
+    {
+        FrameSpool spool(m_fileName, 1, cv::Size(64, 48));
+        QVERIFY(QFile::exists(m_fileName));
+    }
+    QVERIFY(!QFile::exists(m_fileName));
+}
+
+QTEST_APPLESS_MAIN(TestFrameSpool)
+
+#include "testframespool.moc"
@@ -0,0 +1,26 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testframesubscriber
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testframesubscriber.cpp \
+    ../../framesubscriber.cpp \
+    ../../cameraframe.cpp
+HEADERS += ../../framesubscriber.h \
+    ../../cameraframe.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
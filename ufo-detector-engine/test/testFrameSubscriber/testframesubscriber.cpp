@@ -0,0 +1,214 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "framesubscriber.h"
+#include <QString>
+#include <QtTest>
+#include <thread>
+
+#define TEST_SUBSCRIBER_CAPACITY 5
+
+/**
+ * @brief FrameSubscriber unit test class
+ */
+class TestFrameSubscriber : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestFrameSubscriber();
+
+private Q_SLOTS:
+    void latestOnly();
+    void everyFrame();
+    void waitNextFrame_timeout();
+    void waitNextFrame_stopWait();
+    void publish_waitForSpace();
+    void frameCallback();
+    void frameCallback_waitingFrames();
+    void pacesSource();
+
+private:
+    CameraFramePtr makeFrame(quint64 sequenceNumber);
+};
+
+TestFrameSubscriber::TestFrameSubscriber() {
+}
+
+CameraFramePtr TestFrameSubscriber::makeFrame(quint64 sequenceNumber) {
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    frame->m_image = cv::Mat(4, 4, CV_8UC3, cv::Scalar(0, 0, 0));
+    frame->m_sequenceNumber = sequenceNumber;
+    return frame;
+}
+
+void TestFrameSubscriber::latestOnly() {
+    FrameSubscriber subscriber(FrameSubscriber::LatestOnly, TEST_SUBSCRIBER_CAPACITY);
+    QCOMPARE(subscriber.capacity(), 1);
+    QCOMPARE(subscriber.deliveryMode(), FrameSubscriber::LatestOnly);
+
+    for (quint64 i = 1; i <= 3; i++) {
+        subscriber.publish(makeFrame(i));
+        QCOMPARE(subscriber.count(), 1);
+    }
+    QCOMPARE(subscriber.droppedFrames(), (quint64)2);
+
+    CameraFramePtr frame = subscriber.waitNextFrame(0);
+    QVERIFY(frame);
+    QCOMPARE(frame->m_sequenceNumber, (quint64)3);
+    QCOMPARE(subscriber.count(), 0);
+}
+
+void TestFrameSubscriber::everyFrame() {
+    FrameSubscriber subscriber(FrameSubscriber::EveryFrame, TEST_SUBSCRIBER_CAPACITY);
+    QCOMPARE(subscriber.capacity(), TEST_SUBSCRIBER_CAPACITY);
+
+    QVERIFY(!subscriber.waitNextFrame(0));
+    subscriber.publish(CameraFramePtr());
+    QCOMPARE(subscriber.count(), 0);
+
+    // one frame more than capacity: the oldest frame is dropped
+    for (quint64 i = 1; i <= TEST_SUBSCRIBER_CAPACITY + 1; i++) {
+        subscriber.publish(makeFrame(i));
+    }
+    QCOMPARE(subscriber.count(), TEST_SUBSCRIBER_CAPACITY);
+    QCOMPARE(subscriber.droppedFrames(), (quint64)1);
+
+    for (quint64 i = 2; i <= TEST_SUBSCRIBER_CAPACITY + 1; i++) {
+        CameraFramePtr frame = subscriber.waitNextFrame(0);
+        QVERIFY(frame);
+        QCOMPARE(frame->m_sequenceNumber, i);
+    }
+    QCOMPARE(subscriber.count(), 0);
+}
+
+void TestFrameSubscriber::waitNextFrame_timeout() {
+    FrameSubscriber subscriber(FrameSubscriber::EveryFrame, TEST_SUBSCRIBER_CAPACITY);
+    QTime timer;
+    timer.start();
+    QVERIFY(!subscriber.waitNextFrame(100));
+    QVERIFY(timer.elapsed() >= 90);
+
+    // frame published from another thread wakes up the waiting
+    std::thread publisher([&subscriber, this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        subscriber.publish(makeFrame(1));
+    });
+    CameraFramePtr frame = subscriber.waitNextFrame(1000);
+    publisher.join();
+    QVERIFY(frame);
+    QCOMPARE(frame->m_sequenceNumber, (quint64)1);
+}
+
+void TestFrameSubscriber::waitNextFrame_stopWait() {
+    FrameSubscriber subscriber(FrameSubscriber::LatestOnly);
+    QTime timer;
+
+    std::thread stopper([&subscriber]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        subscriber.stopWait();
+    });
+    timer.start();
+    QVERIFY(!subscriber.waitNextFrame());
+    QVERIFY(timer.elapsed() < 1000);
+    stopper.join();
+
+    // no waiting after stopWait()
+    subscriber.publish(makeFrame(1));
+    QVERIFY(!subscriber.waitNextFrame());
+}
+
+void TestFrameSubscriber::publish_waitForSpace() {
+    FrameSubscriber subscriber(FrameSubscriber::LatestOnly);
+    QTime timer;
+
+    QVERIFY(subscriber.publish(makeFrame(1), 100));
+    // queue is full: nothing is dropped, publish gives up after timeout
+    timer.start();
+    QVERIFY(!subscriber.publish(makeFrame(2), 100));
+    QVERIFY(timer.elapsed() >= 90);
+    QCOMPARE(subscriber.droppedFrames(), (quint64)0);
+
+    // reading a frame lets the waiting publish continue
+    std::thread reader([&subscriber]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        subscriber.waitNextFrame(0);
+    });
+    QVERIFY(subscriber.publish(makeFrame(2), 1000));
+    reader.join();
+    CameraFramePtr frame = subscriber.waitNextFrame(0);
+    QVERIFY(frame);
+    QCOMPARE(frame->m_sequenceNumber, (quint64)2);
+
+    // stopWait() releases a waiting publisher
+    QVERIFY(subscriber.publish(makeFrame(3), 100));
+    std::thread stopper([&subscriber]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        subscriber.stopWait();
+    });
+    timer.start();
+    QVERIFY(subscriber.publish(makeFrame(4), 5000));
+    QVERIFY(timer.elapsed() < 1000);
+    stopper.join();
+}
+
+void TestFrameSubscriber::frameCallback() {
+    FrameSubscriber subscriber(FrameSubscriber::EveryFrame, TEST_SUBSCRIBER_CAPACITY);
+    int callCount = 0;
+
+    subscriber.setFrameCallback([&subscriber, &callCount]() {
+        callCount++;
+        // frame is already available in the callback
+        QCOMPARE(subscriber.count(), callCount);
+    });
+    subscriber.publish(makeFrame(1));
+    subscriber.publish(makeFrame(2));
+    QCOMPARE(callCount, 2);
+
+    subscriber.setFrameCallback(nullptr);
+    subscriber.publish(makeFrame(3));
+    QCOMPARE(callCount, 2);
+    QCOMPARE(subscriber.count(), 3);
+}
+
+void TestFrameSubscriber::frameCallback_waitingFrames() {
+    FrameSubscriber subscriber(FrameSubscriber::LatestOnly);
+    int callCount = 0;
+
+    // frame published before the callback was set
+    QVERIFY(subscriber.publish(makeFrame(1), 100));
+    subscriber.setFrameCallback([&callCount]() { callCount++; });
+    QCOMPARE(callCount, 1);
+
+    // queue stays full: the callback is called anyway, the reader may have missed the frame
+    QVERIFY(!subscriber.publish(makeFrame(2), 10));
+    QCOMPARE(callCount, 2);
+    QCOMPARE(subscriber.count(), 1);
+}
+
+void TestFrameSubscriber::pacesSource() {
+    FrameSubscriber subscriber(FrameSubscriber::LatestOnly);
+    QVERIFY(!subscriber.pacesSource());
+    FrameSubscriber pacingSubscriber(FrameSubscriber::LatestOnly, 1, true);
+    QVERIFY(pacingSubscriber.pacesSource());
+}
+
+QTEST_MAIN(TestFrameSubscriber)
+
+#include "testframesubscriber.moc"
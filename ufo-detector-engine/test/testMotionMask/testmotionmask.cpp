@@ -0,0 +1,140 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motionmask.h"
+#include <QString>
+#include <QtTest>
+#include <opencv2/imgproc/imgproc.hpp>
+
+/**
+ * @brief MotionMask unit test class
+ */
+class TestMotionMask : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestMotionMask();
+
+private Q_SLOTS:
+    void threeFrameDifference_data();
+    void threeFrameDifference();
+    void threeFrameDifference_region();
+    void binaryStdDev();
+
+private:
+    static cv::Mat referenceMask(const cv::Mat& prev, const cv::Mat& current, const cv::Mat& next,
+                                 int threshold);
+    static cv::Mat randomFrame(cv::Size size, cv::RNG& rng);
+};
+
+TestMotionMask::TestMotionMask() {
+}
+
+/**
+ * @brief The OpenCV operation chain which MotionMask replaces
+ */
+cv::Mat TestMotionMask::referenceMask(const cv::Mat& prev, const cv::Mat& current, const cv::Mat& next,
+                                      int threshold) {
+    cv::Mat d1, d2, mask;
+    cv::absdiff(prev, next, d1);
+    cv::absdiff(current, next, d2);
+    cv::bitwise_and(d1, d2, mask);
+    cv::threshold(mask, mask, threshold, 255, CV_THRESH_BINARY);
+    return mask;
+}
+
+cv::Mat TestMotionMask::randomFrame(cv::Size size, cv::RNG& rng) {
+    cv::Mat frame(size, CV_8UC1);
+    rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+    return frame;
+}
+
+void TestMotionMask::threeFrameDifference_data() {
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("threshold");
+
+    QTest::newRow("vga") << 640 << 480 << 30;
+    QTest::newRow("odd width") << 643 << 31 << 30;
+    QTest::newRow("narrower than vector") << 7 << 5 << 100;
+    QTest::newRow("zero threshold") << 320 << 240 << 0;
+    QTest::newRow("negative threshold") << 320 << 240 << -1;
+    QTest::newRow("threshold 254") << 320 << 240 << 254;
+    QTest::newRow("threshold 255") << 320 << 240 << 255;
+}
+
+void TestMotionMask::threeFrameDifference() {
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, threshold);
+    cv::RNG rng(width * height + threshold);
+    const cv::Size size(width, height);
+    cv::Mat prev = randomFrame(size, rng);
+    cv::Mat current = randomFrame(size, rng);
+    cv::Mat next = randomFrame(size, rng);
+    // low differences around the threshold
+    cv::Mat nearCurrent = current + cv::Scalar(threshold > 0 ? threshold : 1);
+
+    cv::Mat mask;
+    MotionMask::threeFrameDifference(prev, current, next, threshold, mask);
+    QCOMPARE(mask.type(), CV_8UC1);
+    QCOMPARE(cv::countNonZero(mask != referenceMask(prev, current, next, threshold)), 0);
+
+    MotionMask::threeFrameDifference(current, nearCurrent, current, threshold, mask);
+    QCOMPARE(cv::countNonZero(mask != referenceMask(current, nearCurrent, current, threshold)), 0);
+}
+
+void TestMotionMask::threeFrameDifference_region() {
+    cv::RNG rng(1);
+    const cv::Size size(200, 100);
+    cv::Mat prev = randomFrame(size, rng);
+    cv::Mat current = randomFrame(size, rng);
+    cv::Mat next = randomFrame(size, rng);
+    // rows of a region aren't continuous in memory
+    const cv::Rect region(3, 5, 101, 50);
+    cv::Mat mask;
+    MotionMask::threeFrameDifference(prev(region), current(region), next(region), 40, mask);
+    QCOMPARE(mask.size(), region.size());
+    cv::Mat reference = referenceMask(prev(region), current(region), next(region), 40);
+    QCOMPARE(cv::countNonZero(mask != reference), 0);
+}
+
+void TestMotionMask::binaryStdDev() {
+    cv::Mat mask = cv::Mat::zeros(480, 640, CV_8UC1);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(mask, mean, stddev);
+    QCOMPARE(MotionMask::binaryStdDev(mask), stddev[0]);
+
+    cv::RNG rng(2);
+    cv::Mat noise = randomFrame(mask.size(), rng);
+    const int thresholds[] = {250, 128, 5};
+    for (int threshold : thresholds) {
+        cv::threshold(noise, mask, threshold, 255, CV_THRESH_BINARY);
+        cv::meanStdDev(mask, mean, stddev);
+        QVERIFY(qAbs(MotionMask::binaryStdDev(mask) - stddev[0]) < 1e-9);
+    }
+
+    mask.setTo(255);
+    QCOMPARE(MotionMask::binaryStdDev(mask), 0.0);
+    QCOMPARE(MotionMask::binaryStdDev(cv::Mat()), 0.0);
+}
+
+QTEST_MAIN(TestMotionMask)
+
+#include "testmotionmask.moc"
@@ -0,0 +1,26 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testpipedvideowriter
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testpipedvideowriter.cpp \
+    ../../pipedvideowriter.cpp
+HEADERS += ../../pipedvideowriter.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
@@ -0,0 +1,178 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipedvideowriter.h"
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QtTest>
+#include <opencv2/highgui/highgui.hpp>
+
+/**
+ * @brief PipedVideoWriter unit test class
+ */
+class TestPipedVideoWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestPipedVideoWriter();
+
+private Q_SLOTS:
+    void encoderArguments();
+    void encoderArguments_segments();
+    void encoderArguments_variableFrameRate();
+    void matroskaHeader();
+    void matroskaFrameHeader();
+    void open_missingEncoder();
+    void writeVideo();
+    void write_wrongSize();
+    void write_stalledEncoder();
+
+private:
+    QString m_videoEncoderLocation;
+    QString m_fileName;
+};
+
+TestPipedVideoWriter::TestPipedVideoWriter() {
+#if defined(Q_OS_WIN)
+    m_videoEncoderLocation = QCoreApplication::applicationDirPath() + "/ffmpeg.exe";
+#else
+    m_videoEncoderLocation = "/usr/bin/ffmpeg";
+#endif
+    m_fileName = QDir::tempPath() + "/testpipedvideowriter.avi";
+}
+
+void TestPipedVideoWriter::encoderArguments() {
+    QStringList args = PipedVideoWriter::encoderArguments("ffv1", "video.avi", 25, cv::Size(64, 48));
+    QVERIFY(args.contains("rawvideo"));
+    QVERIFY(args.contains("bgr24"));
+    QCOMPARE(args.at(args.indexOf("-s") + 1), QString("64x48"));
+    QCOMPARE(args.at(args.indexOf("-r") + 1), QString("25"));
+    QCOMPARE(args.at(args.indexOf("-i") + 1), QString("-"));
+    QCOMPARE(args.at(args.indexOf("-vcodec") + 1), QString("ffv1"));
+    QCOMPARE(args.last(), QString("video.avi"));
+}
+
+void TestPipedVideoWriter::encoderArguments_segments() {
+    QStringList args = PipedVideoWriter::encoderArguments("ffv1", "video-%03d.mkv", 25, cv::Size(64, 48),
+                                                          10, "video.ffconcat");
+    QCOMPARE(args.at(args.indexOf("-f", args.indexOf("-i")) + 1), QString("segment"));
+    QCOMPARE(args.at(args.indexOf("-segment_time") + 1), QString("10"));
+    QCOMPARE(args.at(args.indexOf("-segment_list") + 1), QString("video.ffconcat"));
+    QVERIFY(args.contains("-force_key_frames"));
+    QCOMPARE(args.last(), QString("video-%03d.mkv"));
+}
+
+void TestPipedVideoWriter::encoderArguments_variableFrameRate() {
+    QStringList args = PipedVideoWriter::encoderArguments("ffv1", "video.mkv", 25, cv::Size(64, 48),
+                                                          0, QString(), true);
+    QCOMPARE(args.at(args.indexOf("-i") - 1), QString("matroska"));
+    QCOMPARE(args.at(args.indexOf("-i") + 1), QString("-"));
+    QVERIFY(!args.contains("rawvideo"));
+    QCOMPARE(args.at(args.indexOf("-vsync") + 1), QString("vfr"));
+    QCOMPARE(args.last(), QString("video.mkv"));
+}
+
+void TestPipedVideoWriter::matroskaHeader() {
+    QByteArray header = PipedVideoWriter::matroskaHeader(cv::Size(64, 48), 25);
+    QVERIFY(header.startsWith(QByteArray::fromHex("1a45dfa3")));
+    QVERIFY(header.contains("matroska"));
+    QVERIFY(header.contains("V_UNCOMPRESSED"));
+    // segment of unknown size, clusters follow it
+    QVERIFY(header.contains(QByteArray::fromHex("1853806701ffffffffffffff")));
+}
+
+void TestPipedVideoWriter::matroskaFrameHeader() {
+    const qint64 frameBytes = 64 * 48 * 3;
+    QByteArray header = PipedVideoWriter::matroskaFrameHeader(1234, frameBytes);
+    QVERIFY(header.startsWith(QByteArray::fromHex("1f43b675")));
+    // cluster size covers the rest of the header and the frame data
+    QCOMPARE((qint64)header.mid(5, 7).toHex().toLongLong(0, 16), header.size() - 12 + frameBytes);
+    // timecode
+    QVERIFY(header.contains(QByteArray::fromHex("e7") + QByteArray::fromHex("0100000000000008") +
+                            QByteArray::fromHex("00000000000004d2")));
+    // simple block of track 1, key frame
+    QVERIFY(header.endsWith(QByteArray::fromHex("81000080")));
+}
+
+void TestPipedVideoWriter::open_missingEncoder() {
+    PipedVideoWriter writer;
+    QVERIFY(!writer.open("/nonexistent/ffmpeg", "ffv1", m_fileName, 25, cv::Size(64, 48)));
+    QVERIFY(!writer.isOpened());
+    QVERIFY(!writer.write(cv::Mat(48, 64, CV_8UC3)));
+    QVERIFY(!writer.release());
+}
+
+void TestPipedVideoWriter::writeVideo() {
+    QFile::remove(m_fileName);
+    PipedVideoWriter writer;
+    QVERIFY(writer.open(m_videoEncoderLocation, "ffv1", m_fileName, 25, cv::Size(64, 48)));
+    QVERIFY(writer.isOpened());
+    cv::Mat frame(48, 64, CV_8UC3, cv::Scalar(0, 128, 255));
+    for (int i = 0; i < 10; i++) {
+        QVERIFY(writer.write(frame));
+    }
+    // a part of a larger image isn't continuous
+    cv::Mat largerImage(96, 128, CV_8UC3, cv::Scalar(0, 128, 255));
+    QVERIFY(writer.write(largerImage(cv::Rect(0, 0, 64, 48))));
+    QVERIFY(writer.release());
+    QVERIFY(!writer.isOpened());
+
+    cv::VideoCapture video;
+    QVERIFY(video.open(m_fileName.toStdString()));
+    QCOMPARE((int)video.get(CV_CAP_PROP_FOURCC), CV_FOURCC('F', 'F', 'V', '1'));
+    QCOMPARE((int)video.get(CV_CAP_PROP_FRAME_COUNT), 11);
+    video.release();
+    QVERIFY(QFile::remove(m_fileName));
+}
+
+void TestPipedVideoWriter::write_wrongSize() {
+    PipedVideoWriter writer;
+    QVERIFY(writer.open(m_videoEncoderLocation, "ffv1", m_fileName, 25, cv::Size(64, 48)));
+    QVERIFY(!writer.write(cv::Mat(24, 32, CV_8UC3)));
+    QVERIFY(!writer.write(cv::Mat(48, 64, CV_8UC1)));
+    writer.release();
+    QFile::remove(m_fileName);
+}
+
+void TestPipedVideoWriter::write_stalledEncoder() {
+#ifdef Q_OS_UNIX
+    // encoder which never reads its input
+    QString encoderFileName = QDir::tempPath() + "/testpipedvideowriter-stalled.sh";
+    QFile encoder(encoderFileName);
+    QVERIFY(encoder.open(QIODevice::WriteOnly));
+    encoder.write("#!/bin/sh\nexec sleep 60\n");
+    encoder.close();
+    QVERIFY(encoder.setPermissions(encoder.permissions() | QFileDevice::ExeOwner));
+
+    PipedVideoWriter writer;
+    QVERIFY(writer.open(encoderFileName, "ffv1", m_fileName, 25, cv::Size(640, 480)));
+    writer.m_writeTimeoutMs = 200;
+    // frame is larger than the pipe buffer
+    QVERIFY(!writer.write(cv::Mat(480, 640, CV_8UC3, cv::Scalar(1, 2, 3))));
+    QVERIFY(writer.m_encoder->state() == QProcess::NotRunning);
+    QVERIFY(!writer.write(cv::Mat(480, 640, CV_8UC3)));
+    QVERIFY(!writer.release());
+    QVERIFY(QFile::remove(encoderFileName));
+#endif
+}
+
+QTEST_APPLESS_MAIN(TestPipedVideoWriter)
+
+#include "testpipedvideowriter.moc"
@@ -0,0 +1,24 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testpipelinestats
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+INCLUDEPATH += ../..
+
+SOURCES += testpipelinestats.cpp \
+    ../../pipelinestats.cpp
+HEADERS += ../../pipelinestats.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
@@ -0,0 +1,128 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipelinestats.h"
+#include <QString>
+#include <QtTest>
+
+/**
+ * @brief Histogram and pipeline counters unit test class
+ */
+class TestPipelineStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestPipelineStats();
+
+private Q_SLOTS:
+    void bucketIndex();
+    void histogram();
+    void histogram_percentile();
+    void histogram_merge();
+    void recordingStats_reset();
+};
+
+TestPipelineStats::TestPipelineStats() {
+}
+
+void TestPipelineStats::bucketIndex() {
+    QCOMPARE(Histogram::bucketIndex(0), 0);
+    QCOMPARE(Histogram::bucketIndex(1), 1);
+    QCOMPARE(Histogram::bucketIndex(2), 2);
+    QCOMPARE(Histogram::bucketIndex(3), 2);
+    QCOMPARE(Histogram::bucketIndex(4), 3);
+    QCOMPARE(Histogram::bucketIndex(1023), 10);
+    QCOMPARE(Histogram::bucketIndex(1024), 11);
+    QCOMPARE(Histogram::bucketIndex(~(quint64)0), Histogram::BUCKET_COUNT - 1);
+}
+
+void TestPipelineStats::histogram() {
+    Histogram histogram;
+    QVERIFY(0 == histogram.count());
+    QCOMPARE(histogram.mean(), 0.0);
+    QVERIFY(0 == histogram.percentile(0.5));
+
+    histogram.add(0);
+    histogram.add(3);
+    histogram.add(9);
+    QVERIFY(3 == histogram.count());
+    QVERIFY(12 == histogram.sum());
+    QVERIFY(9 == histogram.max());
+    QCOMPARE(histogram.mean(), 4.0);
+    QVERIFY(1 == histogram.bucketCount(0));
+    QVERIFY(1 == histogram.bucketCount(2));
+    QVERIFY(1 == histogram.bucketCount(4));
+    QVERIFY(0 == histogram.bucketCount(-1));
+    QVERIFY(0 == histogram.bucketCount(Histogram::BUCKET_COUNT));
+
+    histogram.reset();
+    QVERIFY(0 == histogram.count());
+    QVERIFY(0 == histogram.max());
+    QVERIFY(0 == histogram.bucketCount(4));
+}
+
+void TestPipelineStats::histogram_percentile() {
+    Histogram histogram;
+    for (int i = 0; i < 99; i++) {
+        histogram.add(10);
+    }
+    histogram.add(5000);
+    // upper bounds of the buckets
+    QVERIFY(15 == histogram.percentile(0.5));
+    QVERIFY(15 == histogram.percentile(0.99));
+    QVERIFY(5000 == histogram.percentile(1.0));
+}
+
+void TestPipelineStats::histogram_merge() {
+    Histogram first;
+    Histogram second;
+    first.add(1);
+    second.add(100);
+    second.add(0);
+    first.merge(second);
+    QVERIFY(3 == first.count());
+    QVERIFY(101 == first.sum());
+    QVERIFY(100 == first.max());
+    QVERIFY(1 == first.bucketCount(0));
+    QVERIFY(2 == second.count());
+}
+
+void TestPipelineStats::recordingStats_reset() {
+    RecordingStats stats;
+    VideoBufferStats bufferStats;
+    bufferStats.m_highWaterMark = 7;
+    bufferStats.m_rejectedFrames = 2;
+    bufferStats.m_occupancy.add(7);
+    stats.m_videoBuffer.merge(bufferStats);
+    stats.m_writtenFrames = 10;
+    stats.m_writeLatencyUs.add(100);
+    QVERIFY(7 == stats.m_videoBuffer.m_highWaterMark);
+    QVERIFY(2 == stats.m_videoBuffer.m_rejectedFrames);
+    QVERIFY(1 == stats.m_videoBuffer.m_occupancy.count());
+
+    stats.reset();
+    QVERIFY(0 == stats.m_writtenFrames);
+    QVERIFY(0 == stats.m_writeLatencyUs.count());
+    QVERIFY(0 == stats.m_videoBuffer.m_highWaterMark);
+    QVERIFY(0 == stats.m_videoBuffer.m_occupancy.count());
+}
+
+QTEST_APPLESS_MAIN(TestPipelineStats)
+
+#include "testpipelinestats.moc"
@@ -0,0 +1,25 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testprerollbuffer
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+include(../../turbojpeg.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testprerollbuffer.cpp \
+    ../../prerollbuffer.cpp \
+    ../../cameraframe.cpp
+HEADERS += ../../cameraframe.h \
+    ../../prerollbuffer.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
@@ -0,0 +1,159 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prerollbuffer.h"
+#include <QString>
+#include <QtTest>
+#include <opencv2/highgui/highgui.hpp>
+
+/**
+ * @brief PrerollBuffer unit test class
+ */
+class TestPrerollBuffer : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestPrerollBuffer();
+
+private Q_SLOTS:
+    void pushAndDecode();
+    void push_jpegFrame();
+    void push_durationLimit();
+    void push_memoryLimit();
+    void takeFrames();
+
+private:
+    const int WIDTH = 64;
+    const int HEIGHT = 48;
+
+    /**
+     * @brief BGR frame of uniform color
+     */
+    void makeFrame(CameraFrame& frame, int value, qint64 wallClockMsecs);
+};
+
+TestPrerollBuffer::TestPrerollBuffer() {
+}
+
+void TestPrerollBuffer::makeFrame(CameraFrame& frame, int value, qint64 wallClockMsecs) {
+    frame.m_pixelFormat = CameraFrame::BGR;
+    frame.m_image = cv::Mat(HEIGHT, WIDTH, CV_8UC3, cv::Scalar(value, value, value));
+    frame.m_wallClockMsecs = wallClockMsecs;
+}
+
+void TestPrerollBuffer::pushAndDecode() {
+    PrerollBuffer buffer(1000, 1024 * 1024);
+    CameraFrame frame;
+    makeFrame(frame, 120, 1000);
+
+    QVERIFY(buffer.push(frame));
+    QCOMPARE(buffer.count(), 1);
+    QVERIFY(buffer.memoryUsage() > 0);
+    // compressed
+    QVERIFY(buffer.memoryUsage() < frame.m_image.total() * frame.m_image.elemSize());
+
+    std::deque<PrerollBuffer::Frame> frames = buffer.takeFrames(2000);
+    QCOMPARE((int)frames.size(), 1);
+    QCOMPARE(frames[0].m_wallClockMsecs, (qint64)1000);
+    cv::Mat image;
+    QVERIFY(PrerollBuffer::decode(frames[0], image));
+    QCOMPARE(image.size(), cv::Size(WIDTH, HEIGHT));
+    QCOMPARE(image.type(), CV_8UC3);
+    double minValue = 0;
+    double maxValue = 0;
+    cv::minMaxLoc(image, &minValue, &maxValue);
+    QVERIFY((minValue >= 115) && (maxValue <= 125));
+}
+
+void TestPrerollBuffer::push_jpegFrame() {
+    PrerollBuffer buffer(1000, 1024 * 1024);
+    std::vector<uchar> jpeg;
+    QVERIFY(cv::imencode(".jpg", cv::Mat(HEIGHT, WIDTH, CV_8UC3, cv::Scalar(90, 90, 90)), jpeg));
+    CameraFrame frame;
+    frame.m_pixelFormat = CameraFrame::MJPEG;
+    frame.m_image = cv::Mat(1, jpeg.size(), CV_8UC1, jpeg.data());
+    frame.m_wallClockMsecs = 1000;
+
+    QVERIFY(buffer.push(frame));
+    // camera JPEG is kept as it is
+    QVERIFY(frame.m_bgrCache.empty());
+    std::deque<PrerollBuffer::Frame> frames = buffer.takeFrames(2000);
+    QCOMPARE((int)frames.size(), 1);
+    QVERIFY(frames[0].m_jpeg == jpeg);
+}
+
+void TestPrerollBuffer::push_durationLimit() {
+    PrerollBuffer buffer(1000, 1024 * 1024);
+    for (int i = 0; i < 30; i++) {
+        CameraFrame frame;
+        makeFrame(frame, i, 10000 + i * 100);
+        QVERIFY(buffer.push(frame));
+    }
+    // frames of the last second
+    std::deque<PrerollBuffer::Frame> frames = buffer.takeFrames(20000);
+    QCOMPARE((int)frames.size(), 11);
+    QCOMPARE(frames.front().m_wallClockMsecs, (qint64)11900);
+    QCOMPARE(frames.back().m_wallClockMsecs, (qint64)12900);
+}
+
+void TestPrerollBuffer::push_memoryLimit() {
+    CameraFrame frame;
+    makeFrame(frame, 50, 1000);
+    PrerollBuffer sizeProbe(1000, 1024 * 1024);
+    QVERIFY(sizeProbe.push(frame));
+    const size_t frameBytes = sizeProbe.memoryUsage();
+
+    PrerollBuffer buffer(100000, frameBytes * 3);
+    for (int i = 0; i < 10; i++) {
+        makeFrame(frame, 50, 1000 + i * 40);
+        QVERIFY(buffer.push(frame));
+        QVERIFY(buffer.memoryUsage() <= frameBytes * 3);
+    }
+    QCOMPARE(buffer.count(), 3);
+
+    // frame which alone is over the limit is not kept
+    PrerollBuffer tinyBuffer(100000, frameBytes - 1);
+    QVERIFY(!tinyBuffer.push(frame));
+    QCOMPARE(tinyBuffer.count(), 0);
+}
+
+void TestPrerollBuffer::takeFrames() {
+    PrerollBuffer buffer(10000, 1024 * 1024);
+    for (int i = 0; i < 5; i++) {
+        CameraFrame frame;
+        makeFrame(frame, 10, 1000 + i * 40);
+        QVERIFY(buffer.push(frame));
+    }
+    // frames from trigger time onwards are not pre-roll
+    std::deque<PrerollBuffer::Frame> frames = buffer.takeFrames(1080);
+    QCOMPARE((int)frames.size(), 2);
+    QCOMPARE(buffer.count(), 0);
+    QCOMPARE(buffer.memoryUsage(), (size_t)0);
+
+    CameraFrame frame;
+    makeFrame(frame, 10, 2000);
+    QVERIFY(buffer.push(frame));
+    buffer.clear();
+    QCOMPARE(buffer.count(), 0);
+    QVERIFY(buffer.takeFrames(3000).empty());
+}
+
+QTEST_APPLESS_MAIN(TestPrerollBuffer)
+
+#include "testprerollbuffer.moc"
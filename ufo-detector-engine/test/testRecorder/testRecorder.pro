@@ -27,9 +27,21 @@ INCLUDEPATH += . \
 
 SOURCES += testrecorder.cpp \
     ../mock/mockcamera.cpp \
+    ../mock/mockframesubscriber.cpp \
+    ../../cameraframe.cpp \
     ../mock/mockconfig.cpp \
     ../mock/mockdatamanager.cpp \
     ../mock/mockvideobuffer.cpp \
+    ../../pipelinestats.cpp \
+    ../../framepool.cpp \
+    ../../framespool.cpp \
+    ../../prerollbuffer.cpp \
+    ../../pipedvideowriter.cpp \
+    ../../encodingqueue.cpp \
+    ../../thumbnailwriter.cpp \
+    ../../workerpool.cpp \
+    ../../trackoverlay.cpp \
+    ../../writebehindstage.cpp \
     ../../videocodecsupportinfo.cpp \
     ../../recorder.cpp \
     ../../camerainfo.cpp
@@ -38,7 +50,19 @@ HEADERS += ../../recorder.h \
     ../../config.h \
     ../../videocodecsupportinfo.h \
     ../../camera.h \
+    ../../cameraframe.h \
+    ../../framesubscriber.h \
     ../../camerainfo.h \
     ../../datamanager.h \
-    ../../videobuffer.h
+    ../../videobuffer.h \
+    ../../pipelinestats.h \
+    ../../framepool.h \
+    ../../framespool.h \
+    ../../prerollbuffer.h \
+    ../../pipedvideowriter.h \
+    ../../encodingqueue.h \
+    ../../thumbnailwriter.h \
+    ../../workerpool.h \
+    ../../trackoverlay.h \
+    ../../writebehindstage.h
 
@@ -29,6 +29,8 @@
 extern cv::Mat mockCameraNextFrame;
 extern int mockConfigResultVideoCodec;
 extern QString mockConfigResultVideoCodecStr;
+extern int mockConfigVideoSegmentSeconds;
+extern QString mockConfigVideoStagingDir;
 
 /**
  * @brief Unit test of Recorder class
@@ -51,12 +53,19 @@ private Q_SLOTS:
      */
     void videoCodecs();
 
+    /*
+     * Record video segments in staging, check they are moved to the result directory and joined to one video.
+     */
+    void videoSegments();
+
     /*
      * Basic mock Camera test. See a blocking Camera::getWebcamFrame() test in ActualDetector unit test.
      */
     void mockCamera();
 
     void saveVideoThumbnailImage();
+    void removeStaleSpoolFiles();
+    void adoptStaleStagingDirs();
 
 private:
     Recorder* m_recorder;
@@ -104,18 +113,11 @@ void TestRecorder::constructor() {
     QCOMPARE(m_config, m_recorder->m_config);
 
     cv::Size expectedVideoResolution(m_config->cameraWidth(), m_config->cameraHeight());
-    double cameraAspectRatio = (double)m_config->cameraWidth() / (double)m_config->cameraHeight();
-    int thumbSideLength = 80;
-    QCOMPARE(m_recorder->m_defaultThumbnailSideLength, thumbSideLength);
-    cv::Size expectedThumbnailResolution(thumbSideLength,
-            qBound(thumbSideLength / 2, (int)(thumbSideLength / cameraAspectRatio), thumbSideLength));
     QCOMPARE(m_recorder->m_videoResolution, expectedVideoResolution);
-    QCOMPARE(m_recorder->m_thumbnailResolution, expectedThumbnailResolution);
 
     QCOMPARE(m_recorder->m_drawRectangles, m_config->resultVideoWithObjectRectangles());
     QCOMPARE(m_recorder->m_objectPositiveColor, cv::Scalar(255, 0, 0));
     QCOMPARE(m_recorder->m_objectNegativeColor, cv::Scalar(0, 0, 255));
-    QCOMPARE(m_recorder->m_objectRectangleColor, m_recorder->m_objectPositiveColor);
 
     QCOMPARE(m_recorder->m_resultVideoDirName, m_config->resultVideoDir());
     QCOMPARE(m_recorder->m_videoFileExtension, QString(".avi"));
@@ -243,15 +245,19 @@ void TestRecorder::videoCodecs()
         QTest::qWait(400);
         m_recorder->stopRecording(true);
         QVERIFY(m_recorder->m_willSaveVideo);
-        // codec only supported by ffmpeg/avconv, not by OpenCV
-        if (!codecInfo->isOpencvSupported(codec) && codecInfo->isEncoderSupported(codec)) {
-            QTest::qWait(2000);
-            QCOMPARE(m_requestEncodingTempFileName, filenameTemp);
-            QCOMPARE(m_requestEncodingTargetFileName, filenameFinal);
-            QCOMPARE(m_requestEncodingCounter, 1);
-        } else {
-            QTest::qWait(500);
-        }
+        // video is finished in the background, not while the detector waits
+        QVERIFY(!m_recorder->m_recording);
+        QVERIFY(m_recorder->m_recorderThread);
+        m_recorder->finishRecordThread();
+        QVERIFY(!m_recorder->m_recorderThread);
+        QVERIFY(NULL == m_recorder->m_videoBuffer);
+        // frames buffered when recording stopped are written too
+        QCOMPARE((quint64)m_recorder->recordingStats().m_bufferDroppedFrames, (quint64)0);
+        QVERIFY(NULL == m_recorder->m_pipedVideoWriter);
+        QTest::qWait(500);
+        // codec only supported by ffmpeg/avconv is encoded while recording, no separate encoding pass.
+        // Segments are disabled by mock config, see videoSegments().
+        QCOMPARE(m_requestEncodingCounter, 0);
 
         QVERIFY(!tempFile.exists());
         QVERIFY(resultVideoFile.exists());
@@ -279,6 +285,76 @@ void TestRecorder::videoCodecs()
     mockCameraNextFrame = cv::Mat();
 }
 
+void TestRecorder::videoSegments()
+{
+    VideoCodecSupportInfo* codecInfo = m_config->videoCodecSupportInfo();
+    const int codec = codecInfo->stringToFourcc("FFV1");
+    if (!codecInfo->isEncoderSupported(codec)) {
+        QSKIP("Encoder doesn't support FFV1, segments are recorded only by the encoder");
+    }
+    mockConfigResultVideoCodecStr = "FFV1";
+    mockConfigResultVideoCodec = codec;
+    mockConfigVideoSegmentSeconds = 1;
+    mockConfigVideoStagingDir = m_config->resultVideoDir() + "/staging";
+    // jobs left by earlier runs would be resumed
+    QFile::remove(m_config->encodingJobFile());
+    Recorder recorder(m_camera, m_config, m_dataManager);
+    QVERIFY(recorder.m_writeBehind);
+    QSignalSpy segmentSpy(&recorder, SIGNAL(videoSegmentFinished(QString)));
+    QSignalSpy encodingSpy(&recorder, SIGNAL(videoEncodingRequested(QString,QString)));
+    QSignalSpy jobSpy(recorder.m_encodingQueue, SIGNAL(jobFinished(QString,bool,qint64,qint64)));
+
+    cv::Mat firstFrame(m_config->cameraHeight(), m_config->cameraWidth(), CV_8UC3, Scalar(0, 0, 0));
+    mockCameraNextFrame = cv::Mat(m_config->cameraHeight(), m_config->cameraWidth(), CV_8UC3, Scalar(0, 0, 0));
+    recorder.startRecording(firstFrame);
+    const QString dateTime = recorder.m_eventTime.toString("yyyy-MM-dd--hh-mm-ss");
+    const QString resultSegmentDirName = m_config->resultVideoDir() + "/segments";
+    const QString stagingSegmentDirName = recorder.m_stagingDirName + "/segments";
+    QTest::qWait(2500);
+    recorder.stopRecording(true);
+    recorder.finishRecordThread();
+    mockConfigVideoSegmentSeconds = 0;
+    mockConfigVideoStagingDir = "";
+    recorder.m_writeBehind->waitForIdle();
+
+    // segments are announced once they have been moved to the result directory
+    QTRY_VERIFY_WITH_TIMEOUT(segmentSpy.count() >= 2, 5000);
+    QStringList segments;
+    for (int i = 0; i < segmentSpy.count(); i++) {
+        segments << segmentSpy.at(i).at(0).toString();
+        QCOMPARE(QFileInfo(segments.last()).absolutePath(), QFileInfo(resultSegmentDirName).absoluteFilePath());
+        QVERIFY(segments.last().contains(dateTime));
+    }
+    QCOMPARE(segments.removeDuplicates(), 0);
+
+    // the list follows the segments and is joined by one stream copy job
+    QTRY_COMPARE_WITH_TIMEOUT(encodingSpy.count(), 1, 5000);
+    const QString listFileName = resultSegmentDirName + "/Capture--" + dateTime + ".ffconcat";
+    const QString finalFileName = m_config->resultVideoDir() + "/Capture--" + dateTime + ".avi";
+    QCOMPARE(encodingSpy.at(0).at(0).toString(), listFileName);
+    QCOMPARE(encodingSpy.at(0).at(1).toString(), finalFileName);
+    QTRY_COMPARE_WITH_TIMEOUT(jobSpy.count(), 1, 10000);
+    QCOMPARE(jobSpy.at(0).at(0).toString(), finalFileName);
+    QVERIFY(jobSpy.at(0).at(1).toBool());
+    QTest::qWait(500);
+    QCOMPARE(jobSpy.count(), 1);
+    QCOMPARE(encodingSpy.count(), 1);
+
+    // joined segments and the list are removed, nothing is left in staging
+    QVERIFY(QFile::exists(finalFileName));
+    foreach (const QString& segment, segments) {
+        QVERIFY(!QFile::exists(segment));
+    }
+    QVERIFY(!QFile::exists(listFileName));
+    QVERIFY(QDir(stagingSegmentDirName).entryList(QDir::Files).isEmpty());
+
+    cv::VideoCapture videoFile;
+    QVERIFY(videoFile.open(finalFileName.toStdString()));
+    QCOMPARE((int)videoFile.get(CV_CAP_PROP_FOURCC), codec);
+    videoFile.release();
+    mockCameraNextFrame = cv::Mat();
+}
+
 void TestRecorder::saveVideoThumbnailImage() {
     QString dateTime = "2017-04-10--12-00-00";
     QString thumbnailFileName = m_config->resultVideoDir() + "/thumbnails/" + dateTime + ".jpg";
@@ -286,12 +362,63 @@ void TestRecorder::saveVideoThumbnailImage() {
     Mat thumbnailImage(100, 200, CV_8UC3);
 
     m_recorder->saveVideoThumbnailImage(thumbnailImage, dateTime);
+    m_recorder->m_thumbnailWriter->waitForIdle();
 
     QVERIFY(thumbnailFile.exists());
     QVERIFY(thumbnailFile.remove());
     QVERIFY(!thumbnailFile.exists());
 }
 
+void TestRecorder::removeStaleSpoolFiles() {
+    QDir spoolDir(m_config->resultVideoDir() + "/spool");
+    QVERIFY(spoolDir.mkpath("."));
+    const QString ownFileName = QString("videospool-%1-1a2b.tmp").arg(QCoreApplication::applicationPid());
+    // pid larger than any real one
+    const QString staleFileName = "videospool-2147483646-1a2b.tmp";
+    const QString otherFileName = "videospool.tmp";
+    foreach (const QString& fileName, QStringList() << ownFileName << staleFileName << otherFileName) {
+        QFile file(spoolDir.filePath(fileName));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    Recorder::removeStaleSpoolFiles(spoolDir.path());
+    QVERIFY(spoolDir.exists(ownFileName));
+    QVERIFY(!spoolDir.exists(staleFileName));
+    QVERIFY(spoolDir.exists(otherFileName));
+    QVERIFY(spoolDir.removeRecursively());
+}
+
+void TestRecorder::adoptStaleStagingDirs() {
+    const QString stagingDirName = m_config->resultVideoDir() + "/staging";
+    const QString ownDirName = QString("%1/recorder-%2-1").arg(stagingDirName).arg(QCoreApplication::applicationPid());
+    const QString staleDirName = stagingDirName + "/recorder-2147483646-1";
+    const QString resultDirName = m_config->resultVideoDir() + "/adopted";
+    QVERIFY(QDir().mkpath(ownDirName));
+    QVERIFY(QDir().mkpath(staleDirName + "/segments"));
+    QVERIFY(QDir().mkpath(resultDirName));
+    foreach (const QString& fileName, QStringList() << "/Capture--2017-04-10--12-00-00temp.avi"
+             << "/segments/Capture--2017-04-10--12-00-00--000.mkv" << "/segments/Capture--2017-04-10--12-00-00.ffconcat") {
+        QFile file(staleDirName + fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+    }
+
+    QStringList adoptedDirNames;
+    {
+        WriteBehindStage stage;
+        adoptedDirNames = Recorder::adoptStaleStagingDirs(stagingDirName, ownDirName, resultDirName, &stage);
+        stage.waitForIdle();
+    }
+    QCOMPARE(adoptedDirNames, QStringList(ownDirName + "/recorder-2147483646-1"));
+    QVERIFY(!QDir(staleDirName).exists());
+    QVERIFY(QFile::exists(resultDirName + "/Capture--2017-04-10--12-00-00temp.avi"));
+    QVERIFY(QFile::exists(resultDirName + "/segments/Capture--2017-04-10--12-00-00--000.mkv"));
+    QVERIFY(QFile::exists(resultDirName + "/segments/Capture--2017-04-10--12-00-00.ffconcat"));
+    // own directory is not adopted
+    QVERIFY(QDir(ownDirName).exists());
+    QVERIFY(QDir(stagingDirName).removeRecursively());
+    QVERIFY(QDir(resultDirName).removeRecursively());
+}
+
 void TestRecorder::fourccToStr(int fourcc, char str[5]) {
     for (int i=0; i < 4; i++) {
         str[i] = (fourcc >> (i*8)) & 0xFF;
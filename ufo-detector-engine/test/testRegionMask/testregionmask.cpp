@@ -0,0 +1,186 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "regionmask.h"
+#include <QString>
+#include <QtTest>
+#include <opencv2/imgproc/imgproc.hpp>
+
+/**
+ * @brief RegionMask unit test class
+ */
+class TestRegionMask : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestRegionMask();
+
+private Q_SLOTS:
+    void setMask_spans();
+    void countNonZero();
+    void countNonZero_none();
+    void sum();
+    void threshold();
+    void exclude();
+    void empty();
+
+private:
+    static cv::Mat circleArea(cv::Size size);
+};
+
+TestRegionMask::TestRegionMask() {
+}
+
+/**
+ * @brief Area which has spans of many different lengths and start positions
+ */
+cv::Mat TestRegionMask::circleArea(cv::Size size) {
+    cv::Mat area = cv::Mat::zeros(size, CV_8UC1);
+    cv::circle(area, cv::Point(size.width / 2, size.height / 2), size.height / 2 - 1, cv::Scalar(1), -1);
+    // second part of the area on the same rows
+    cv::rectangle(area, cv::Rect(size.width - 7, 3, 5, size.height - 6), cv::Scalar(255), -1);
+    return area;
+}
+
+void TestRegionMask::setMask_spans() {
+    cv::Mat area = cv::Mat::zeros(4, 10, CV_8UC1);
+    area.at<uchar>(0, 0) = 1;
+    area.at<uchar>(0, 1) = 1;
+    area.at<uchar>(0, 5) = 1;
+    area.row(2).setTo(200);
+    area.at<uchar>(3, 9) = 255;
+
+    RegionMask region;
+    region.setMask(area);
+    QCOMPARE(region.pixelCount(), 14);
+    QCOMPARE(cv::countNonZero(region.mask() != (area != 0)), 0);
+    QCOMPARE((int)region.spans().size(), 4);
+    QCOMPARE(region.spans()[0].m_y, 0);
+    QCOMPARE(region.spans()[0].m_begin, 0);
+    QCOMPARE(region.spans()[0].m_end, 2);
+    QCOMPARE(region.spans()[1].m_begin, 5);
+    QCOMPARE(region.spans()[1].m_end, 6);
+    QCOMPARE(region.spans()[2].m_y, 2);
+    QCOMPARE(region.spans()[2].m_begin, 0);
+    QCOMPARE(region.spans()[2].m_end, 10);
+    QCOMPARE(region.spans()[3].m_y, 3);
+    QCOMPARE(region.spans()[3].m_begin, 9);
+    QCOMPARE(region.spans()[3].m_end, 10);
+}
+
+void TestRegionMask::countNonZero() {
+    const cv::Size size(641, 201);
+    RegionMask region;
+    region.setMask(circleArea(size));
+
+    cv::RNG rng(1);
+    cv::Mat noise(size, CV_8UC1);
+    rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+    const int thresholds[] = {254, 250, 128};
+    for (int threshold : thresholds) {
+        cv::Mat motion;
+        cv::threshold(noise, motion, threshold, 255, CV_THRESH_BINARY);
+
+        cv::Mat inside = motion & region.mask();
+        std::vector<cv::Point> points;
+        cv::findNonZero(inside, points);
+        cv::Rect boundingRect;
+        QCOMPARE(region.countNonZero(motion, boundingRect), (int)points.size());
+        QCOMPARE(boundingRect, cv::boundingRect(points));
+    }
+}
+
+void TestRegionMask::countNonZero_none() {
+    const cv::Size size(100, 50);
+    RegionMask region;
+    region.setMask(circleArea(size));
+    cv::Mat motion = cv::Mat::zeros(size, CV_8UC1);
+    // outside the area
+    motion.at<uchar>(0, 0) = 255;
+    motion.at<uchar>(49, 99) = 255;
+    cv::Rect boundingRect(1, 2, 3, 4);
+    QCOMPARE(region.countNonZero(motion, boundingRect), 0);
+    QCOMPARE(boundingRect, cv::Rect(1, 2, 3, 4));
+}
+
+void TestRegionMask::sum() {
+    const cv::Size size(99, 40);
+    RegionMask region;
+    region.setMask(circleArea(size));
+    cv::RNG rng(2);
+    cv::Mat image(size, CV_8UC1);
+    rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+    QCOMPARE(region.sum(image), (qint64)cv::sum(image & region.mask())[0]);
+}
+
+void TestRegionMask::threshold() {
+    const cv::Size size(99, 40);
+    RegionMask region;
+    region.setMask(circleArea(size));
+    cv::RNG rng(3);
+    cv::Mat image(size, CV_8UC1);
+    rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+
+    cv::Mat result;
+    region.threshold(image, 100, result);
+    cv::Mat expected = (image > 100) & region.mask();
+    QCOMPARE(cv::countNonZero(result != expected), 0);
+}
+
+void TestRegionMask::exclude() {
+    const cv::Size size(64, 32);
+    RegionMask region;
+    region.setMask(cv::Mat(size, CV_8UC1, cv::Scalar(255)));
+    RegionMask full = region;
+
+    cv::Mat excluded = cv::Mat::zeros(size, CV_8UC1);
+    cv::rectangle(excluded, cv::Rect(10, 5, 20, 10), cv::Scalar(255), -1);
+    region.exclude(excluded);
+    QCOMPARE(region.pixelCount(), 64 * 32 - 20 * 10);
+    QCOMPARE(region.mask().at<uchar>(5, 10), (uchar)0);
+    QCOMPARE(region.mask().at<uchar>(4, 10), (uchar)255);
+    // rows with the excluded part are split in two
+    QCOMPARE((int)region.spans().size(), 32 + 10);
+
+    // copy made before is not changed
+    QCOMPARE(full.pixelCount(), 64 * 32);
+    QCOMPARE(cv::countNonZero(full.mask()), 64 * 32);
+}
+
+void TestRegionMask::empty() {
+    RegionMask region;
+    QVERIFY(region.isEmpty());
+    cv::Mat image(10, 10, CV_8UC1, cv::Scalar(255));
+    cv::Rect boundingRect;
+    QCOMPARE(region.countNonZero(image, boundingRect), 0);
+    QCOMPARE(region.sum(image), (qint64)0);
+    cv::Mat result;
+    region.threshold(image, 0, result);
+    QCOMPARE(cv::countNonZero(result), 0);
+
+    region.setMask(image);
+    QVERIFY(!region.isEmpty());
+    region.clear();
+    QVERIFY(region.isEmpty());
+    QVERIFY(region.spans().empty());
+}
+
+QTEST_MAIN(TestRegionMask)
+
+#include "testregionmask.moc"
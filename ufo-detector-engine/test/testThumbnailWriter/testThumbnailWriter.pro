@@ -0,0 +1,28 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testthumbnailwriter
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testthumbnailwriter.cpp \
+    ../../thumbnailwriter.cpp \
+    ../../workerpool.cpp
+HEADERS += ../../thumbnailwriter.h \
+    ../../workerpool.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
@@ -0,0 +1,147 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thumbnailwriter.h"
+#include <QDir>
+#include <QFile>
+#include <QString>
+#include <QtTest>
+#include <algorithm>
+#include <opencv2/highgui/highgui.hpp>
+
+/**
+ * @brief ThumbnailWriter unit test class
+ */
+class TestThumbnailWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestThumbnailWriter();
+
+private Q_SLOTS:
+    void init();
+    void cleanupTestCase();
+    void thumbnailSize();
+    void fileNames();
+    void writeThumbnails();
+    void writeThumbnails_preview();
+    void discardPreview();
+
+private:
+    QString m_dirName;
+    QString m_baseName;
+    cv::Size m_frameSize;
+};
+
+TestThumbnailWriter::TestThumbnailWriter() {
+    m_dirName = QDir::tempPath() + "/testthumbnailwriter";
+    m_baseName = m_dirName + "/2017-04-10--12-00-00";
+    m_frameSize = cv::Size(640, 360);
+}
+
+void TestThumbnailWriter::init() {
+    QDir(m_dirName).removeRecursively();
+    QVERIFY(QDir().mkpath(m_dirName));
+}
+
+void TestThumbnailWriter::cleanupTestCase() {
+    QDir(m_dirName).removeRecursively();
+}
+
+void TestThumbnailWriter::thumbnailSize() {
+    QCOMPARE(ThumbnailWriter::thumbnailSize(cv::Size(640, 360), 80), cv::Size(80, 45));
+    QCOMPARE(ThumbnailWriter::thumbnailSize(cv::Size(640, 480), 160), cv::Size(160, 120));
+    // very wide and tall frames are bounded
+    QCOMPARE(ThumbnailWriter::thumbnailSize(cv::Size(1000, 100), 80), cv::Size(80, 40));
+    QCOMPARE(ThumbnailWriter::thumbnailSize(cv::Size(100, 1000), 80), cv::Size(80, 80));
+}
+
+void TestThumbnailWriter::fileNames() {
+    std::vector<int> sideLengths{160, 80};
+    QStringList names = ThumbnailWriter::fileNames("dir/video", sideLengths);
+    QCOMPARE(names.size(), 3);
+    QCOMPARE(names.at(0), QString("dir/video.jpg"));
+    QCOMPARE(names.at(1), QString("dir/video-160.jpg"));
+    QCOMPARE(names.at(2), QString("dir/video-preview.jpg"));
+}
+
+void TestThumbnailWriter::writeThumbnails() {
+    ThumbnailWriter writer(m_frameSize);
+    writer.writeThumbnails(cv::Mat(m_frameSize, CV_8UC3, cv::Scalar(10, 20, 30)), m_baseName);
+    writer.waitForIdle();
+
+    std::vector<int> sideLengths = ThumbnailWriter::defaultSideLengths();
+    std::sort(sideLengths.begin(), sideLengths.end());
+    QStringList names = ThumbnailWriter::fileNames(m_baseName);
+    for (size_t i = 0; i < sideLengths.size(); i++) {
+        cv::Mat thumbnail = cv::imread(names.at(i).toStdString());
+        QVERIFY(thumbnail.data);
+        QCOMPARE(thumbnail.size(), ThumbnailWriter::thumbnailSize(m_frameSize, sideLengths[i]));
+    }
+    // no frames were sampled
+    QVERIFY(!QFile::exists(names.last()));
+}
+
+void TestThumbnailWriter::writeThumbnails_preview() {
+    cv::Size tileSize = ThumbnailWriter::thumbnailSize(m_frameSize, ThumbnailWriter::PREVIEW_TILE_SIDE_LENGTH);
+    ThumbnailWriter writer(m_frameSize);
+
+    // few samples fill one row partially
+    writer.startPreview(10);
+    cv::Mat frame(m_frameSize, CV_8UC3, cv::Scalar::all(0));
+    for (int i = 0; i < 30; i++) {
+        writer.addPreviewFrame(frame);
+    }
+    writer.writeThumbnails(frame, m_baseName);
+    writer.waitForIdle();
+    cv::Mat preview = cv::imread((m_baseName + "-preview.jpg").toStdString());
+    QVERIFY(preview.data);
+    QCOMPARE(preview.size(), cv::Size(3 * tileSize.width, tileSize.height));
+
+    // long video fills the whole sheet, sampling gets sparser instead of keeping all frames
+    writer.startPreview(1);
+    for (int i = 0; i < 1000; i++) {
+        writer.addPreviewFrame(frame);
+        // samples aren't dropped because of full queue
+        writer.waitForIdle();
+        QVERIFY(writer.m_previewSampleCount <= 2 * ThumbnailWriter::PREVIEW_COLUMNS * ThumbnailWriter::PREVIEW_ROWS);
+    }
+    QVERIFY(writer.m_previewInterval > 1);
+    writer.writeThumbnails(frame, m_baseName);
+    writer.waitForIdle();
+    preview = cv::imread((m_baseName + "-preview.jpg").toStdString());
+    QVERIFY(preview.data);
+    QCOMPARE(preview.size(), cv::Size(ThumbnailWriter::PREVIEW_COLUMNS * tileSize.width,
+                                      ThumbnailWriter::PREVIEW_ROWS * tileSize.height));
+}
+
+void TestThumbnailWriter::discardPreview() {
+    ThumbnailWriter writer(m_frameSize);
+    cv::Mat frame(m_frameSize, CV_8UC3, cv::Scalar::all(0));
+    writer.startPreview(1);
+    writer.addPreviewFrame(frame);
+    writer.discardPreview();
+    writer.addPreviewFrame(frame);
+    writer.waitForIdle();
+    QVERIFY(writer.m_previewTiles.empty());
+}
+
+QTEST_GUILESS_MAIN(TestThumbnailWriter)
+
+#include "testthumbnailwriter.moc"
@@ -0,0 +1,153 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trackoverlay.h"
+#include <QString>
+#include <QtTest>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief TrackOverlay unit test class
+ */
+class TestTrackOverlay : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestTrackOverlay();
+
+private Q_SLOTS:
+    void boxes_empty();
+    void boxes_bySequenceNumber();
+    void publish_maxBoxes();
+    void boxes_readerTooFarBehind();
+    void snapshotCount();
+    void concurrentPublishAndRead();
+
+private:
+    static std::vector<TrackOverlay::Box> makeBoxes(int count, int value);
+};
+
+TestTrackOverlay::TestTrackOverlay() {
+}
+
+std::vector<TrackOverlay::Box> TestTrackOverlay::makeBoxes(int count, int value) {
+    std::vector<TrackOverlay::Box> boxes(count);
+    for (TrackOverlay::Box& box : boxes) {
+        box.m_rect = cv::Rect(value, value, value, value);
+        box.m_trackId = value;
+        box.m_positive = (value % 2 == 1);
+    }
+    return boxes;
+}
+
+void TestTrackOverlay::boxes_empty() {
+    TrackOverlay overlay;
+    std::vector<TrackOverlay::Box> boxes = makeBoxes(1, 1);
+    QVERIFY(!overlay.boxes(100, boxes));
+    QVERIFY(boxes.empty());
+}
+
+void TestTrackOverlay::boxes_bySequenceNumber() {
+    TrackOverlay overlay;
+    overlay.publish(10, makeBoxes(1, 1));
+    overlay.publish(20, makeBoxes(2, 2));
+    overlay.publish(30, std::vector<TrackOverlay::Box>());
+
+    std::vector<TrackOverlay::Box> boxes;
+    // frame before the first detected one
+    QVERIFY(!overlay.boxes(9, boxes));
+    QVERIFY(overlay.boxes(10, boxes));
+    QCOMPARE((int)boxes.size(), 1);
+    QCOMPARE(boxes[0].m_trackId, 1);
+    QVERIFY(boxes[0].m_positive);
+    // frames which detector skipped get boxes of the previous detected frame
+    QVERIFY(overlay.boxes(25, boxes));
+    QCOMPARE((int)boxes.size(), 2);
+    QCOMPARE(boxes[1].m_rect, cv::Rect(2, 2, 2, 2));
+    QVERIFY(!boxes[1].m_positive);
+    QVERIFY(overlay.boxes(1000, boxes));
+    QVERIFY(boxes.empty());
+}
+
+void TestTrackOverlay::publish_maxBoxes() {
+    TrackOverlay overlay;
+    overlay.publish(1, makeBoxes(TrackOverlay::MAX_BOXES + 5, 3));
+    std::vector<TrackOverlay::Box> boxes;
+    QVERIFY(overlay.boxes(1, boxes));
+    QCOMPARE((int)boxes.size(), (int)TrackOverlay::MAX_BOXES);
+}
+
+void TestTrackOverlay::boxes_readerTooFarBehind() {
+    TrackOverlay overlay;
+    for (int i = 1; i <= TrackOverlay::DEFAULT_SNAPSHOT_COUNT + 1; i++) {
+        overlay.publish(i, makeBoxes(1, i));
+    }
+    std::vector<TrackOverlay::Box> boxes;
+    // snapshot of frame 1 was overwritten
+    QVERIFY(!overlay.boxes(1, boxes));
+    QVERIFY(overlay.boxes(2, boxes));
+    QCOMPARE(boxes[0].m_trackId, 2);
+}
+
+void TestTrackOverlay::snapshotCount() {
+    TrackOverlay overlay(200);
+    QCOMPARE(overlay.snapshotCount(), 200);
+    for (int i = 1; i <= 200; i++) {
+        overlay.publish(i, makeBoxes(1, i));
+    }
+    std::vector<TrackOverlay::Box> boxes;
+    QVERIFY(overlay.boxes(1, boxes));
+    QCOMPARE(boxes[0].m_trackId, 1);
+    overlay.publish(201, makeBoxes(1, 201));
+    QVERIFY(!overlay.boxes(1, boxes));
+}
+
+void TestTrackOverlay::concurrentPublishAndRead() {
+    TrackOverlay overlay;
+    const int snapshotCount = 100000;
+    std::atomic<quint64> newestSequenceNumber(0);
+    std::thread publisher([&overlay, &newestSequenceNumber, snapshotCount]() {
+        for (int i = 1; i <= snapshotCount; i++) {
+            overlay.publish(2 * i, makeBoxes(i % 5, i));
+            newestSequenceNumber = 2 * i;
+        }
+    });
+
+    int inconsistent = 0;
+    std::vector<TrackOverlay::Box> boxes;
+    while (newestSequenceNumber < (quint64)(2 * snapshotCount)) {
+        quint64 sequenceNumber = newestSequenceNumber;
+        if (overlay.boxes(sequenceNumber, boxes)) {
+            for (const TrackOverlay::Box& box : boxes) {
+                // all values of a box come from the same snapshot, which isn't newer than asked
+                if ((box.m_rect.x != box.m_trackId) || (box.m_rect.height != box.m_trackId)
+                        || ((quint64)(2 * box.m_trackId) > sequenceNumber)) {
+                    inconsistent++;
+                }
+            }
+        }
+    }
+    publisher.join();
+    QCOMPARE(inconsistent, 0);
+}
+
+QTEST_MAIN(TestTrackOverlay)
+
+#include "testtrackoverlay.moc"
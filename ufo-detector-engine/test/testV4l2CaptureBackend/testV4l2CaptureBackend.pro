@@ -0,0 +1,25 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testv4l2capturebackend
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+CONFIG += c++11
+
+include(../../opencv.pri)
+
+INCLUDEPATH += ../..
+
+SOURCES += testv4l2capturebackend.cpp \
+    ../../v4l2capturebackend.cpp \
+    ../../cameraframe.cpp
+HEADERS += ../../v4l2capturebackend.h \
+    ../../capturebackend.h \
+    ../../cameraframe.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
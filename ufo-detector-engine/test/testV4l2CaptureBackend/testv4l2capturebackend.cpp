@@ -0,0 +1,182 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "v4l2capturebackend.h"
+#include <QString>
+#include <QDir>
+#include <QtTest>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Unit test for V4l2CaptureBackend class.
+ * Uses the vivid virtual V4L2 driver instead of a real camera: sudo modprobe vivid
+ */
+class TestV4l2CaptureBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestV4l2CaptureBackend();
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void fourcc();
+    void readFrame();
+    void bufferRequeuedOnFrameRelease();
+    void copyWhenBuffersRunOut();
+    void frameValidAfterClose();
+
+private:
+    const int WIDTH = 640;
+    const int HEIGHT = 480;
+
+    QString m_deviceName;   ///< vivid device
+    V4l2CaptureBackend* m_backend;
+
+    /**
+     * @brief Find a video capture device of vivid driver.
+     * @return device name, or empty string if not found
+     */
+    QString findVividDevice();
+};
+
+TestV4l2CaptureBackend::TestV4l2CaptureBackend()
+{
+    qDebug() << "NOTE: THIS UNIT TEST REQUIRES THE VIVID DRIVER (sudo modprobe vivid)";
+    m_backend = NULL;
+}
+
+QString TestV4l2CaptureBackend::findVividDevice()
+{
+    QStringList devices = QDir("/dev").entryList(QStringList() << "video*", QDir::System);
+    foreach (QString device, devices) {
+        QString deviceName = "/dev/" + device;
+        int fd = open(deviceName.toLocal8Bit().constData(), O_RDWR);
+        if (fd == -1) {
+            continue;
+        }
+        struct v4l2_capability capability;
+        memset(&capability, 0, sizeof(capability));
+        bool found = (ioctl(fd, VIDIOC_QUERYCAP, &capability) == 0) &&
+                (QString((const char*)capability.driver) == "vivid") &&
+                (capability.device_caps & V4L2_CAP_VIDEO_CAPTURE);
+        close(fd);
+        if (found) {
+            return deviceName;
+        }
+    }
+    return QString();
+}
+
+void TestV4l2CaptureBackend::initTestCase()
+{
+    m_deviceName = findVividDevice();
+    if (m_deviceName.isEmpty()) {
+        QSKIP("vivid device not found");
+    }
+}
+
+void TestV4l2CaptureBackend::init()
+{
+    m_backend = new V4l2CaptureBackend(m_deviceName, V4l2CaptureBackend::fourcc("YUYV"));
+    QVERIFY(m_backend->open(WIDTH, HEIGHT));
+    QVERIFY(m_backend->isOpened());
+}
+
+void TestV4l2CaptureBackend::cleanup()
+{
+    delete m_backend;
+    m_backend = NULL;
+}
+
+void TestV4l2CaptureBackend::fourcc()
+{
+    QCOMPARE(V4l2CaptureBackend::fourcc("YUYV"), (quint32)V4L2_PIX_FMT_YUYV);
+    QCOMPARE(V4l2CaptureBackend::fourcc("MJPG"), (quint32)V4L2_PIX_FMT_MJPEG);
+    QCOMPARE(V4l2CaptureBackend::fourcc("YUV"), (quint32)0);
+    QVERIFY(V4l2CaptureBackend::isSupportedPixelFormat(V4L2_PIX_FMT_GREY));
+    QVERIFY(!V4l2CaptureBackend::isSupportedPixelFormat(V4L2_PIX_FMT_RGB24));
+}
+
+void TestV4l2CaptureBackend::readFrame()
+{
+    CameraFrame frame;
+    QCOMPARE(m_backend->pixelFormat(), (quint32)V4L2_PIX_FMT_YUYV);
+    QCOMPARE(m_backend->frameSize(), cv::Size(WIDTH, HEIGHT));
+    QVERIFY(m_backend->readFrame(&frame));
+    QCOMPARE(frame.m_pixelFormat, CameraFrame::YUYV);
+    QCOMPARE(frame.m_image.type(), CV_8UC2);
+    QCOMPARE(frame.size(), cv::Size(WIDTH, HEIGHT));
+    QVERIFY(frame.m_buffer);
+    // not copied: image points into the driver buffer
+    QVERIFY(frame.m_image.data == frame.m_buffer.get());
+    QVERIFY(frame.m_timestamp != FrameClock::time_point());
+    QVERIFY(frame.m_timestamp <= FrameClock::now());
+
+    cv::Mat bgr = frame.bgrImage();
+    QCOMPARE(bgr.type(), CV_8UC3);
+    QCOMPARE(bgr.size(), cv::Size(WIDTH, HEIGHT));
+}
+
+void TestV4l2CaptureBackend::bufferRequeuedOnFrameRelease()
+{
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    QVERIFY(m_backend->readFrame(frame.get()));
+    int queuedCount = m_backend->m_bufferSet->m_queuedCount;
+    frame.reset();
+    QCOMPARE(m_backend->m_bufferSet->m_queuedCount, queuedCount + 1);
+}
+
+void TestV4l2CaptureBackend::copyWhenBuffersRunOut()
+{
+    std::vector<std::shared_ptr<CameraFrame>> frames;
+    int bufferCount = m_backend->m_bufferSet->m_buffers.size();
+    for (int i = 0; i < bufferCount; i++) {
+        std::shared_ptr<CameraFrame> frame(new CameraFrame);
+        QVERIFY(m_backend->readFrame(frame.get()));
+        frames.push_back(frame);
+    }
+    // the driver must always have some buffers to capture into
+    QVERIFY(m_backend->m_bufferSet->m_queuedCount >= m_backend->MIN_QUEUED_BUFFERS);
+    QVERIFY(frames.front()->m_buffer);
+    QVERIFY(!frames.back()->m_buffer);
+    QVERIFY(!frames.back()->m_image.empty());
+}
+
+void TestV4l2CaptureBackend::frameValidAfterClose()
+{
+    std::shared_ptr<CameraFrame> frame(new CameraFrame);
+    QVERIFY(m_backend->readFrame(frame.get()));
+    std::weak_ptr<V4l2CaptureBackend::BufferSet> bufferSet = m_backend->m_bufferSet;
+    m_backend->close();
+    QVERIFY(!m_backend->isOpened());
+    QVERIFY(!bufferSet.expired());
+    QCOMPARE(frame->bgrImage().size(), cv::Size(WIDTH, HEIGHT));
+    frame.reset();
+    QVERIFY(bufferSet.expired());
+}
+
+QTEST_APPLESS_MAIN(TestV4l2CaptureBackend)
+
+#include "testv4l2capturebackend.moc"
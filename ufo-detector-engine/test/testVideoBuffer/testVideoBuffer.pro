@@ -19,8 +19,14 @@ include(../../opencv.pri)
 INCLUDEPATH += ../..
 
 SOURCES += testvideobuffer.cpp \
-    ../../videobuffer.cpp
-HEADERS += ../../videobuffer.h
+    ../../videobuffer.cpp \
+    ../../pipelinestats.cpp \
+    ../../framepool.cpp \
+    ../../framespool.cpp
+HEADERS += ../../videobuffer.h \
+    ../../pipelinestats.h \
+    ../../framepool.h \
+    ../../framespool.h
 
 DEFINES += SRCDIR=\\\"$$PWD/\\\" \
     _UNIT_TEST_
@@ -17,10 +17,14 @@
  */
 
 #include "videobuffer.h"
+#include "framepool.h"
+#include "framespool.h"
+#include <QDir>
 #include <QString>
 #include <QThread>
 #include <QtTest>
 #include <QTest>
+#include <thread>
 
 
 #define TEST_VIDEO_BUFFER_CAPACITY 20
@@ -101,6 +105,16 @@ private Q_SLOTS:
     void getAndSetNoBlock();
     void waitNextFrame_emptyBuffer();
     void pushFrame_fullBuffer();
+    void producerConsumerOrder();
+    void waitNextFrame_afterStopWait();
+    void stats();
+    void overflow_dropNewest();
+    void overflow_dropOldest();
+    void overflow_coalesce();
+    void overflow_concurrent();
+    void overflow_coalesceConcurrentPop();
+    void spill();
+    void spill_concurrent();
 
 private:
     VideoBuffer* m_videoBuffer;
@@ -144,35 +158,31 @@ void TestVideoBuffer::getAndSetNoBlock() {
         frame->m_duplicateCount = (i + 1);
 
         QVERIFY(m_videoBuffer->count() == i);
-        QVERIFY(m_videoBuffer->m_buffer.count() == m_videoBuffer->count());
-        QVERIFY(m_videoBuffer->m_freeSlots->available() == (TEST_VIDEO_BUFFER_CAPACITY - i));
-        QVERIFY(m_videoBuffer->m_reservedSlots->available() == i);
+        QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == (TEST_VIDEO_BUFFER_CAPACITY - i));
+        QVERIFY(m_videoBuffer->count() == i);
 
         QVERIFY(m_videoBuffer->pushFrame(frame));
 
         //QVERIFY(m_videoBuffer->m_buffer.at(i) == frame);
         QVERIFY(m_videoBuffer->count() == (i + 1));
-        QVERIFY(m_videoBuffer->m_buffer.count() == m_videoBuffer->count());
-        QVERIFY(m_videoBuffer->m_freeSlots->available() == (TEST_VIDEO_BUFFER_CAPACITY - i - 1));
-        QVERIFY(m_videoBuffer->m_reservedSlots->available() == (i + 1));
+        QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == (TEST_VIDEO_BUFFER_CAPACITY - i - 1));
+        QVERIFY(m_videoBuffer->count() == (i + 1));
     }
 
     for (int i = TEST_VIDEO_BUFFER_CAPACITY; i > 0; i--) {
         QVERIFY(m_videoBuffer->count() == i);
-        QVERIFY(m_videoBuffer->m_buffer.count() == m_videoBuffer->count());
-        QVERIFY(m_videoBuffer->m_freeSlots->available() == (TEST_VIDEO_BUFFER_CAPACITY - i));
-        QVERIFY(m_videoBuffer->m_reservedSlots->available() == i);
+        QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == (TEST_VIDEO_BUFFER_CAPACITY - i));
+        QVERIFY(m_videoBuffer->count() == i);
 
         frame = m_videoBuffer->waitNextFrame();
 
         QVERIFY(NULL != frame);
         //QVERIFY(m_videoBuffer->m_buffer.at(i) == frame);
         QVERIFY(m_videoBuffer->count() == (i - 1));
-        QVERIFY(m_videoBuffer->m_buffer.count() == m_videoBuffer->count());
         QVERIFY(frame->m_frame == NULL);
         QVERIFY(frame->m_duplicateCount == (TEST_VIDEO_BUFFER_CAPACITY - i + 1));
-        QVERIFY(m_videoBuffer->m_freeSlots->available() == (TEST_VIDEO_BUFFER_CAPACITY - i + 1));
-        QVERIFY(m_videoBuffer->m_reservedSlots->available() == i - 1);
+        QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == (TEST_VIDEO_BUFFER_CAPACITY - i + 1));
+        QVERIFY(m_videoBuffer->count() == i - 1);
     }
 }
 
@@ -193,8 +203,8 @@ void TestVideoBuffer::waitNextFrame_emptyBuffer() {
     frameReaderThread.start();
 
     QVERIFY(0 == m_frameCounter);
-    QVERIFY(m_videoBuffer->m_freeSlots->available() == TEST_VIDEO_BUFFER_CAPACITY);
-    QVERIFY(m_videoBuffer->m_reservedSlots->available() == 0);
+    QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == TEST_VIDEO_BUFFER_CAPACITY);
+    QVERIFY(m_videoBuffer->count() == 0);
 
     // waitNextFrame() should block when the buffer is empty
     emit readFrame();
@@ -205,8 +215,8 @@ void TestVideoBuffer::waitNextFrame_emptyBuffer() {
     QTest::qWait(200);  // increase if stopWait() doesn't return in time
     QVERIFY(1 == m_frameCounter);
     QVERIFY(NULL == m_lastFrame);
-    QVERIFY(m_videoBuffer->m_freeSlots->available() == TEST_VIDEO_BUFFER_CAPACITY);
-    QVERIFY(m_videoBuffer->m_reservedSlots->available() == 0);
+    QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == TEST_VIDEO_BUFFER_CAPACITY);
+    QVERIFY(m_videoBuffer->count() == 0);
 
     frameReaderThread.exit();
     frameReaderThread.wait();
@@ -257,14 +267,330 @@ void TestVideoBuffer::pushFrame_fullBuffer() {
     QTest::qWait(200);  // increase if stopWait() doesn't return in time
     QVERIFY((TEST_VIDEO_BUFFER_CAPACITY + 1) == m_frameCounter);
     QVERIFY(!m_bufferEventSuccessful);
-    QVERIFY(m_videoBuffer->m_freeSlots->available() == 0);
-    QVERIFY(m_videoBuffer->m_reservedSlots->available() == TEST_VIDEO_BUFFER_CAPACITY);
+    QVERIFY((m_videoBuffer->capacity() - m_videoBuffer->count()) == 0);
+    QVERIFY(m_videoBuffer->count() == TEST_VIDEO_BUFFER_CAPACITY);
 
     frameWriterThread.exit();
     frameWriterThread.wait();
     delete frameWriter;
 }
 
+void TestVideoBuffer::producerConsumerOrder() {
+    const int frameCount = TEST_VIDEO_BUFFER_CAPACITY * 500;
+    std::vector<BufferedVideoFrame> frames(frameCount);
+
+    // producer runs ahead and keeps wrapping the ring while consumer drains it
+    std::thread producer([this, &frames]() {
+        for (size_t i = 0; i < frames.size(); i++) {
+            frames[i].m_frame = NULL;
+            frames[i].m_duplicateCount = i;
+            if (!m_videoBuffer->pushFrame(&frames[i])) {
+                return;
+            }
+        }
+    });
+
+    int outOfOrder = 0;
+    for (int i = 0; i < frameCount; i++) {
+        BufferedVideoFrame* frame = m_videoBuffer->waitNextFrame();
+        if (!frame || (frame->m_duplicateCount != i)) {
+            outOfOrder++;
+            break;
+        }
+        QVERIFY(m_videoBuffer->count() <= TEST_VIDEO_BUFFER_CAPACITY);
+    }
+    if (outOfOrder) {
+        m_videoBuffer->stopWait();
+    }
+    producer.join();
+
+    QVERIFY(0 == outOfOrder);
+    QVERIFY(0 == m_videoBuffer->count());
+}
+
+void TestVideoBuffer::waitNextFrame_afterStopWait() {
+    BufferedVideoFrame frames[2];
+
+    QVERIFY(m_videoBuffer->pushFrame(&frames[0]));
+    QVERIFY(m_videoBuffer->pushFrame(&frames[1]));
+    m_videoBuffer->stopWait();
+
+    // buffered frames can still be taken out, but nothing can be added
+    QVERIFY(!m_videoBuffer->pushFrame(&frames[0]));
+    QVERIFY(&frames[0] == m_videoBuffer->waitNextFrame());
+    QVERIFY(&frames[1] == m_videoBuffer->waitNextFrame());
+    QVERIFY(NULL == m_videoBuffer->waitNextFrame());
+    QVERIFY(0 == m_videoBuffer->count());
+}
+
+void TestVideoBuffer::stats() {
+    BufferedVideoFrame frames[3];
+    const VideoBufferStats& stats = m_videoBuffer->stats();
+    QVERIFY(0 == stats.m_highWaterMark);
+
+    QVERIFY(m_videoBuffer->pushFrame(&frames[0]));
+    QVERIFY(m_videoBuffer->pushFrame(&frames[1]));
+    QVERIFY(&frames[0] == m_videoBuffer->waitNextFrame());
+    QVERIFY(m_videoBuffer->pushFrame(&frames[2]));
+    QVERIFY(2 == stats.m_highWaterMark);
+    QVERIFY(3 == stats.m_occupancy.count());
+    QVERIFY(5 == stats.m_occupancy.sum());
+    QVERIFY(3 == stats.m_producerWaitUs.count());
+    QVERIFY(1 == stats.m_consumerWaitUs.count());
+    // nothing had to wait
+    QVERIFY(0 == stats.m_producerWaitUs.max());
+    QVERIFY(0 == stats.m_consumerWaitUs.max());
+
+    m_videoBuffer->stopWait();
+    QVERIFY(!m_videoBuffer->pushFrame(&frames[0]));
+    QVERIFY(1 == stats.m_rejectedFrames);
+}
+
+void TestVideoBuffer::overflow_dropNewest() {
+    BufferedVideoFrame frames[3];
+    BufferedVideoFrame* droppedFrame = &frames[0];
+    VideoBuffer buffer(2, VideoBuffer::DropNewest);
+    QVERIFY(VideoBuffer::DropNewest == buffer.overflowPolicy());
+
+    QVERIFY(buffer.pushFrame(&frames[0]));
+    QVERIFY(buffer.pushFrame(&frames[1]));
+    // doesn't block
+    QVERIFY(!buffer.pushFrame(&frames[2], &droppedFrame));
+    QVERIFY(NULL == droppedFrame);
+    QVERIFY(1 == buffer.stats().m_droppedNewestFrames);
+    QVERIFY(&frames[0] == buffer.waitNextFrame());
+    QVERIFY(&frames[1] == buffer.waitNextFrame());
+    QVERIFY(0 == buffer.count());
+}
+
+void TestVideoBuffer::overflow_dropOldest() {
+    BufferedVideoFrame frames[3];
+    BufferedVideoFrame* droppedFrame = NULL;
+    VideoBuffer buffer(2, VideoBuffer::DropOldest);
+
+    QVERIFY(buffer.pushFrame(&frames[0], &droppedFrame));
+    QVERIFY(NULL == droppedFrame);
+    QVERIFY(buffer.pushFrame(&frames[1], &droppedFrame));
+    QVERIFY(buffer.pushFrame(&frames[2], &droppedFrame));
+    // oldest frame is given back to the caller
+    QVERIFY(&frames[0] == droppedFrame);
+    QVERIFY(1 == buffer.stats().m_droppedOldestFrames);
+    QVERIFY(2 == buffer.count());
+    QVERIFY(&frames[1] == buffer.waitNextFrame());
+    QVERIFY(&frames[2] == buffer.waitNextFrame());
+
+    // nowhere to give the dropped frame, so the new one is dropped
+    QVERIFY(buffer.pushFrame(&frames[0]));
+    QVERIFY(buffer.pushFrame(&frames[1]));
+    QVERIFY(!buffer.pushFrame(&frames[2]));
+    QVERIFY(1 == buffer.stats().m_droppedNewestFrames);
+}
+
+void TestVideoBuffer::overflow_coalesce() {
+    BufferedVideoFrame frames[4];
+    VideoBuffer buffer(2, VideoBuffer::Coalesce);
+    for (int i = 0; i < 4; i++) {
+        frames[i].m_duplicateCount = 0;
+    }
+    frames[3].m_duplicateCount = 2;
+
+    QVERIFY(buffer.pushFrame(&frames[0]));
+    QVERIFY(buffer.pushFrame(&frames[1]));
+    QVERIFY(!buffer.pushFrame(&frames[2]));
+    QVERIFY(!buffer.pushFrame(&frames[3]));
+    QVERIFY(2 == buffer.stats().m_coalescedFrames);
+
+    QVERIFY(&frames[0] == buffer.waitNextFrame());
+    QCOMPARE(frames[0].m_duplicateCount, 0);
+    // newest frame is repeated in place of the coalesced frames and their duplicates
+    QVERIFY(&frames[1] == buffer.waitNextFrame());
+    QCOMPARE(frames[1].m_duplicateCount, 1 + 3);
+}
+
+void TestVideoBuffer::overflow_concurrent() {
+    const int frameCount = 20000;
+    const VideoBuffer::OverflowPolicy policies[] = { VideoBuffer::DropOldest, VideoBuffer::Coalesce };
+
+    for (VideoBuffer::OverflowPolicy policy : policies) {
+        VideoBuffer buffer(4, policy);
+        std::vector<BufferedVideoFrame> frames(frameCount);
+        std::atomic<int> producerDropped(0);
+        std::atomic<bool> producerDone(false);
+
+        std::thread producer([&]() {
+            for (int i = 0; i < frameCount; i++) {
+                BufferedVideoFrame* droppedFrame = NULL;
+                frames[i].m_timestamp = FrameClock::time_point(std::chrono::seconds(i));
+                frames[i].m_duplicateCount = 0;
+                if (!buffer.pushFrame(&frames[i], &droppedFrame)) {
+                    producerDropped++;
+                }
+                if (droppedFrame) {
+                    producerDropped++;
+                }
+            }
+            producerDone = true;
+        });
+
+        // every pushed frame is either read once, in order, or accounted as dropped
+        int readFrames = 0;
+        int repeatedFrames = 0;
+        bool inOrder = true;
+        FrameClock::time_point previous = FrameClock::time_point::min();
+        while (!producerDone || (buffer.count() > 0)) {
+            if (buffer.count() == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            BufferedVideoFrame* frame = buffer.waitNextFrame();
+            inOrder = inOrder && (frame->m_timestamp > previous);
+            previous = frame->m_timestamp;
+            readFrames++;
+            repeatedFrames += frame->m_duplicateCount;
+        }
+        producer.join();
+
+        QVERIFY(inOrder);
+        QCOMPARE(readFrames + producerDropped, frameCount);
+        if (policy == VideoBuffer::Coalesce) {
+            // frame timeline is kept
+            QCOMPARE(readFrames + repeatedFrames, frameCount);
+            QVERIFY(producerDropped == (int)buffer.stats().m_coalescedFrames);
+        } else {
+            QCOMPARE(repeatedFrames, 0);
+            QVERIFY(producerDropped == (int)(buffer.stats().m_droppedOldestFrames + buffer.stats().m_droppedNewestFrames));
+        }
+    }
+}
+
+void TestVideoBuffer::overflow_coalesceConcurrentPop() {
+    const int frameCount = 20000;
+    const int capacities[] = { 1, 2, 4 };
+
+    for (int capacity : capacities) {
+        VideoBuffer buffer(capacity, VideoBuffer::Coalesce);
+        std::vector<BufferedVideoFrame> frames(frameCount);
+        std::vector<int> expectedDuplicates(frameCount, 0);
+        std::atomic<bool> producerDone(false);
+
+        std::thread producer([&]() {
+            int newest = -1;
+            for (int i = 0; i < frameCount; i++) {
+                frames[i].m_duplicateCount = 0;
+                if (i % 8 == 0) {
+                    // let the consumer pop between bursts, also on a single core
+                    std::this_thread::yield();
+                }
+                if (buffer.pushFrame(&frames[i])) {
+                    newest = i;
+                } else {
+                    // repeat of the newest frame which the buffer took, the first one always fits
+                    expectedDuplicates[newest]++;
+                }
+            }
+            producerDone = true;
+        });
+
+        // popping frees the slot which the producer reuses and coalesces into right away,
+        // those repeats belong to the new frame, not to the popped one
+        std::vector<int> readDuplicates(frameCount, -1);
+        while (!producerDone || (buffer.count() > 0)) {
+            if (buffer.count() == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            BufferedVideoFrame* frame = buffer.waitNextFrame();
+            readDuplicates[frame - frames.data()] = frame->m_duplicateCount;
+        }
+        producer.join();
+
+        int mismatches = 0;
+        for (int i = 0; i < frameCount; i++) {
+            if ((readDuplicates[i] >= 0) && (readDuplicates[i] != expectedDuplicates[i])) {
+                mismatches++;
+            }
+        }
+        QCOMPARE(mismatches, 0);
+    }
+}
+
+void TestVideoBuffer::spill() {
+    FramePool pool(4, cv::Size(16, 8));
+    FrameSpool spool(QDir::tempPath() + "/testvideobufferspool.tmp", 3, cv::Size(16, 8));
+    VideoBuffer buffer(2, VideoBuffer::Coalesce);
+    buffer.setSpool(&spool, &pool);
+
+    for (int i = 0; i < 5; i++) {
+        PooledFrame frame = pool.acquire();
+        QVERIFY(frame);
+        frame->m_frame->setTo(cv::Scalar(i, i, i));
+        frame->m_timestamp = FrameClock::time_point(std::chrono::seconds(i));
+        QVERIFY(buffer.pushFrame(frame.get()));
+        frame.release();
+    }
+    // the spilled frames are back in the pool
+    QCOMPARE(buffer.count(), 2);
+    QCOMPARE(buffer.spooledCount(), 3);
+    QCOMPARE(pool.available(), 2);
+    QVERIFY(3 == buffer.stats().m_spilledFrames);
+    QVERIFY(3 == buffer.stats().m_spoolHighWaterMark);
+
+    // spool is full, overflow policy applies
+    PooledFrame frame = pool.acquire();
+    QVERIFY(!buffer.pushFrame(frame.get()));
+    QVERIFY(1 == buffer.stats().m_droppedNewestFrames);
+    frame.reset();
+
+    // read back in push order
+    for (int i = 0; i < 5; i++) {
+        frame = pool.adopt(buffer.waitNextFrame());
+        QVERIFY(frame);
+        QVERIFY(frame->m_timestamp == FrameClock::time_point(std::chrono::seconds(i)));
+        QCOMPARE((int)frame->m_frame->at<cv::Vec3b>(7, 15)[0], i);
+        frame.reset();
+    }
+    QCOMPARE(buffer.spooledCount(), 0);
+    QCOMPARE(pool.available(), 4);
+}
+
+void TestVideoBuffer::spill_concurrent() {
+    const int frameCount = 5000;
+    FramePool pool(6, cv::Size(16, 8));
+    FrameSpool spool(QDir::tempPath() + "/testvideobufferspool.tmp", 8, cv::Size(16, 8));
+    VideoBuffer buffer(4, VideoBuffer::Block);
+    buffer.setSpool(&spool, &pool);
+
+    std::thread producer([&]() {
+        for (int i = 0; i < frameCount; i++) {
+            PooledFrame frame;
+            while (!(frame = pool.acquire())) {
+                std::this_thread::yield();
+            }
+            frame->m_timestamp = FrameClock::time_point(std::chrono::seconds(i));
+            if (buffer.pushFrame(frame.get())) {
+                frame.release();
+            }
+        }
+    });
+
+    // with Block, nothing is lost and spilled frames keep their place
+    bool inOrder = true;
+    for (int i = 0; i < frameCount; i++) {
+        PooledFrame frame = pool.adopt(buffer.waitNextFrame());
+        inOrder = inOrder && frame && (frame->m_timestamp == FrameClock::time_point(std::chrono::seconds(i)));
+        if ((i % 16) == 0) {
+            // slow consumer now and then, so that the producer spills
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    producer.join();
+
+    QVERIFY(inOrder);
+    QCOMPARE(buffer.count(), 0);
+    QCOMPARE(buffer.spooledCount(), 0);
+    QVERIFY(0 == buffer.stats().m_droppedNewestFrames);
+}
+
 QTEST_MAIN(TestVideoBuffer)
 
 #include "testvideobuffer.moc"
@@ -18,6 +18,8 @@
 
 #include "videocodecsupportinfo.h"
 #include <QString>
+#include <QDir>
+#include <QSettings>
 #include <QtTest>
 #include <QRegExp>
 #include <opencv2/core/core.hpp>
@@ -38,7 +40,11 @@ private Q_SLOTS:
     void constructor();
     void testOpencvSupport();
     void testEncoderSupport();
+    void encoderCodecs();
     void initialize();  // init() would be called for each test case
+    void initialize_cache();
+    void runBenchmark();
+    void recommendedCodec();
     void isSupportedMethods();
     void codecName();
     void toFromFourcc();
@@ -252,6 +258,13 @@ void TestVideoCodecSupportInfo::testEncoderSupport() {
     //QVERIFY(!lagarithSupported);
 }
 
+void TestVideoCodecSupportInfo::encoderCodecs() {
+    QStringList codecs = VideoCodecSupportInfo::encoderCodecs(m_videoEncoderLocation);
+    QCOMPARE(codecs.contains("rawvideo"), localTestEncoderSupport("rawvideo"));
+    QCOMPARE(codecs.contains("ffv1"), localTestEncoderSupport("ffv1"));
+    QVERIFY(VideoCodecSupportInfo::encoderCodecs("/nonexistingEncoderDir/nonexistingEncoderBin").isEmpty());
+}
+
 void TestVideoCodecSupportInfo::initialize() {
     QListIterator<int> codecIt(m_expectedCodecs.keys());
     int codec = 0;
@@ -276,6 +289,80 @@ void TestVideoCodecSupportInfo::initialize() {
     }
 }
 
+void TestVideoCodecSupportInfo::initialize_cache() {
+    QString cacheFileName = QDir::tempPath() + "/testcodecsupport.ini";
+    QFile::remove(cacheFileName);
+    VideoCodecSupportInfo probed(m_videoEncoderLocation);
+    QVERIFY(!probed.loadCache(cacheFileName));
+    QVERIFY(probed.init(cacheFileName));
+    QVERIFY(QFile::exists(cacheFileName));
+
+    VideoCodecSupportInfo cached(m_videoEncoderLocation);
+    QVERIFY(cached.init(cacheFileName));
+    QCOMPARE(cached.m_codecSupport, probed.m_codecSupport);
+
+    // another encoder may support other codecs
+    VideoCodecSupportInfo otherEncoder("/nonexistingEncoderDir/nonexistingEncoderBin");
+    QVERIFY(!otherEncoder.loadCache(cacheFileName));
+    QFile::remove(cacheFileName);
+}
+
+void TestVideoCodecSupportInfo::runBenchmark() {
+    QString cacheFileName = QDir::tempPath() + "/testcodecsupport.ini";
+    QFile::remove(cacheFileName);
+    cv::Size frameSize(160, 120);
+    VideoCodecSupportInfo benchmarked(m_videoEncoderLocation);
+    QVERIFY(benchmarked.init(cacheFileName));
+    QVERIFY(benchmarked.benchmarkResults(frameSize).isEmpty());
+    QList<VideoCodecSupportInfo::CodecBenchmark> results = benchmarked.runBenchmark(frameSize, 20);
+    QCOMPARE(results.size(), benchmarked.supportedCodecs().size());
+    foreach (const VideoCodecSupportInfo::CodecBenchmark& result, results) {
+        QVERIFY(benchmarked.supportedCodecs().contains(result.m_fourcc));
+        QVERIFY(result.m_fps > 0);
+        QVERIFY(result.m_bytesPerFrame > 0);
+    }
+
+    // results are kept with the probe results
+    VideoCodecSupportInfo cached(m_videoEncoderLocation);
+    QVERIFY(cached.init(cacheFileName));
+    QCOMPARE(cached.benchmarkResults(frameSize).size(), results.size());
+    QVERIFY(cached.benchmarkResults(cv::Size(640, 480)).isEmpty());
+    QCOMPARE(cached.ensureBenchmark(frameSize).size(), results.size());
+
+    // missing results are benchmarked on demand
+    cv::Size otherSize(80, 60);
+    QCOMPARE(cached.ensureBenchmark(otherSize).size(), results.size());
+    QCOMPARE(cached.benchmarkResults(otherSize).size(), results.size());
+
+    // and kept when codecs are probed again, after the encoder or OpenCV has changed
+    {
+        QSettings cache(cacheFileName, QSettings::IniFormat);
+        cache.setValue("key", "changed");
+    }
+    VideoCodecSupportInfo reprobed(m_videoEncoderLocation);
+    QVERIFY(reprobed.init(cacheFileName));
+    QCOMPARE(reprobed.benchmarkResults(frameSize).size(), results.size());
+    QCOMPARE(reprobed.benchmarkResults(otherSize).size(), results.size());
+    QFile::remove(cacheFileName);
+}
+
+void TestVideoCodecSupportInfo::recommendedCodec() {
+    int rawFourcc = CV_FOURCC('I', 'Y', 'U', 'V');
+    int ffv1Fourcc = CV_FOURCC('F', 'F', 'V', '1');
+    int lagarithFourcc = CV_FOURCC('L', 'A', 'G', 'S');
+    QList<VideoCodecSupportInfo::CodecBenchmark> results;
+    results << VideoCodecSupportInfo::CodecBenchmark{rawFourcc, VideoCodecSupportInfo::OpenCv, 1000, 460800}
+            << VideoCodecSupportInfo::CodecBenchmark{ffv1Fourcc, VideoCodecSupportInfo::External, 80, 200000}
+            << VideoCodecSupportInfo::CodecBenchmark{lagarithFourcc, VideoCodecSupportInfo::External, 40, 150000};
+
+    QCOMPARE(VideoCodecSupportInfo::recommendedCodec(results, 25, 1.5), lagarithFourcc);
+    QCOMPARE(VideoCodecSupportInfo::recommendedCodec(results, 30, 1.5), ffv1Fourcc);
+    QCOMPARE(VideoCodecSupportInfo::recommendedCodec(results, 60, 1.5), rawFourcc);
+    // none fast enough, fastest drops the fewest frames
+    QCOMPARE(VideoCodecSupportInfo::recommendedCodec(results, 1000, 1.5), rawFourcc);
+    QCOMPARE(VideoCodecSupportInfo::recommendedCodec(QList<VideoCodecSupportInfo::CodecBenchmark>(), 25), 0);
+}
+
 void TestVideoCodecSupportInfo::isSupportedMethods() {
     QListIterator<int> codecIt(m_expectedCodecs.keys());
 
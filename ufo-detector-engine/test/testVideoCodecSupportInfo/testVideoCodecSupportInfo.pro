@@ -25,8 +25,10 @@ include(../../opencv.pri)
 
 INCLUDEPATH += ../..
 
-HEADERS += ../../videocodecsupportinfo.h
+HEADERS += ../../videocodecsupportinfo.h \
+    ../../pipedvideowriter.h
 
 SOURCES += testVideoCodecSupportInfo.cpp \
-    ../../videocodecsupportinfo.cpp
+    ../../videocodecsupportinfo.cpp \
+    ../../pipedvideowriter.cpp
 
@@ -0,0 +1,115 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+#include <QString>
+#include <QtTest>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief WorkerPool unit test class
+ */
+class TestWorkerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestWorkerPool();
+
+private Q_SLOTS:
+    void threadCount();
+    void runTasks();
+    void post_queueFull();
+    void destructor_runsQueuedTasks();
+};
+
+TestWorkerPool::TestWorkerPool() {
+}
+
+void TestWorkerPool::threadCount() {
+    WorkerPool defaultPool;
+    QVERIFY(defaultPool.threadCount() >= 1);
+    WorkerPool pool(3);
+    QCOMPARE(pool.threadCount(), 3);
+}
+
+void TestWorkerPool::runTasks() {
+    std::atomic<int> counter(0);
+    const int taskCount = 100;
+    WorkerPool pool(4, taskCount);
+    for (int i = 0; i < taskCount; i++) {
+        QVERIFY(pool.post([&counter]() { counter++; }));
+    }
+    for (int i = 0; (i < 100) && (counter < taskCount); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    QCOMPARE((int)counter, taskCount);
+    QCOMPARE(pool.queuedCount(), 0);
+}
+
+void TestWorkerPool::post_queueFull() {
+    std::atomic<bool> blockingTaskStarted(false);
+    std::atomic<bool> blockingTaskReleased(false);
+    WorkerPool pool(1, 2);
+
+    // keep the only worker busy so that tasks stay in the queue
+    QVERIFY(pool.post([&]() {
+        blockingTaskStarted = true;
+        while (!blockingTaskReleased) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }));
+    while (!blockingTaskStarted) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    QVERIFY(pool.post([]() {}, 0));
+    QVERIFY(pool.post([]() {}, 0));
+    QCOMPARE(pool.queuedCount(), 2);
+
+    QVERIFY(!pool.post([]() {}, 0));
+    auto waitStart = std::chrono::steady_clock::now();
+    QVERIFY(!pool.post([]() {}, 50));
+    QVERIFY((std::chrono::steady_clock::now() - waitStart) >= std::chrono::milliseconds(45));
+
+    // waiting post gets in when the worker takes the next task
+    std::thread releaser([&blockingTaskReleased]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        blockingTaskReleased = true;
+    });
+    QVERIFY(pool.post([]() {}, 1000));
+    releaser.join();
+}
+
+void TestWorkerPool::destructor_runsQueuedTasks() {
+    std::atomic<int> counter(0);
+    {
+        WorkerPool pool(1, 10);
+        for (int i = 0; i < 10; i++) {
+            QVERIFY(pool.post([&counter]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                counter++;
+            }));
+        }
+    }
+    QCOMPARE((int)counter, 10);
+}
+
+QTEST_MAIN(TestWorkerPool)
+
+#include "testworkerpool.moc"
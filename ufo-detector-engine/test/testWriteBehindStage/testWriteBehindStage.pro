@@ -0,0 +1,26 @@
+QT       += testlib
+
+QT       -= gui
+
+TARGET = testwritebehindstage
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG += c++11
+
+INCLUDEPATH += ../..
+
+SOURCES += testwritebehindstage.cpp \
+    ../../writebehindstage.cpp \
+    ../../workerpool.cpp
+HEADERS += ../../writebehindstage.h \
+    ../../workerpool.h
+
+DEFINES += SRCDIR=\\\"$$PWD/\\\" \
+    _UNIT_TEST_
+QMAKE_CXXFLAGS += --coverage
+QMAKE_LFLAGS += --coverage
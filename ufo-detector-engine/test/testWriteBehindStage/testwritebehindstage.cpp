@@ -0,0 +1,181 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "writebehindstage.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <QtTest>
+
+/**
+ * @brief WriteBehindStage unit test class
+ */
+class TestWriteBehindStage : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestWriteBehindStage();
+
+private Q_SLOTS:
+    void init();
+    void cleanupTestCase();
+    void copyFile();
+    void copyFile_missingSource();
+    void flush();
+    void flush_failure();
+    void remove_afterFlush();
+    void copyToTarget();
+
+private:
+    QString m_stagingDirName;
+    QString m_resultDirName;
+
+    static QByteArray testData(int size);
+    static bool writeFile(QString fileName, const QByteArray& data);
+    static QByteArray readFile(QString fileName);
+};
+
+TestWriteBehindStage::TestWriteBehindStage() {
+    m_stagingDirName = QDir::tempPath() + "/testwritebehindstage/staging";
+    m_resultDirName = QDir::tempPath() + "/testwritebehindstage/result";
+}
+
+void TestWriteBehindStage::init() {
+    QDir(QDir::tempPath() + "/testwritebehindstage").removeRecursively();
+    QVERIFY(QDir().mkpath(m_stagingDirName));
+    QVERIFY(QDir().mkpath(m_resultDirName));
+}
+
+void TestWriteBehindStage::cleanupTestCase() {
+    QDir(QDir::tempPath() + "/testwritebehindstage").removeRecursively();
+}
+
+void TestWriteBehindStage::copyFile() {
+    // last block is partial
+    QByteArray data = testData(3 * WriteBehindStage::BLOCK_ALIGNMENT + 123);
+    QString source = m_stagingDirName + "/video.avi";
+    QString target = m_resultDirName + "/video.avi";
+    QVERIFY(writeFile(source, data));
+    std::atomic<qint64> written(0);
+    QVERIFY(WriteBehindStage::copyFile(source, target, WriteBehindStage::BLOCK_ALIGNMENT, &written));
+    QCOMPARE((qint64)written, (qint64)data.size());
+    QCOMPARE(readFile(target), data);
+    QVERIFY(QFile::exists(source));
+
+    // empty file
+    QVERIFY(writeFile(source, QByteArray()));
+    QVERIFY(WriteBehindStage::copyFile(source, target, WriteBehindStage::BLOCK_ALIGNMENT));
+    QCOMPARE(QFileInfo(target).size(), 0LL);
+}
+
+void TestWriteBehindStage::copyFile_missingSource() {
+    QString target = m_resultDirName + "/video.avi";
+    QVERIFY(!WriteBehindStage::copyFile(m_stagingDirName + "/missing.avi", target, WriteBehindStage::BLOCK_ALIGNMENT));
+    QVERIFY(!QFile::exists(target));
+}
+
+void TestWriteBehindStage::flush() {
+    QByteArray data = testData(100000);
+    QString staged = m_stagingDirName + "/video.avi";
+    QString target = m_resultDirName + "/video.avi";
+    QVERIFY(writeFile(staged, data));
+    QString flushedFileName;
+    {
+        WriteBehindStage stage;
+        stage.flush(staged, target, [&flushedFileName](QString fileName) { flushedFileName = fileName; });
+        stage.waitForIdle();
+        QCOMPARE(stage.backlogBytes(), 0LL);
+        QCOMPARE(stage.backlogFiles(), 0);
+    }
+    QCOMPARE(flushedFileName, target);
+    QCOMPARE(readFile(target), data);
+    QVERIFY(!QFile::exists(staged));
+}
+
+void TestWriteBehindStage::flush_failure() {
+    QString staged = m_stagingDirName + "/video.avi";
+    QString target = m_resultDirName + "/missing/video.avi";
+    QVERIFY(writeFile(staged, testData(1000)));
+    QString flushedFileName;
+    WriteBehindStage stage;
+    stage.flush(staged, target, [&flushedFileName](QString fileName) { flushedFileName = fileName; });
+    stage.waitForIdle();
+    // the staged file is the only copy
+    QCOMPARE(flushedFileName, staged);
+    QVERIFY(QFile::exists(staged));
+    QCOMPARE(stage.backlogBytes(), 0LL);
+}
+
+void TestWriteBehindStage::remove_afterFlush() {
+    QString staged = m_stagingDirName + "/video.avi";
+    QString target = m_resultDirName + "/video.avi";
+    QVERIFY(writeFile(staged, testData(1000)));
+    WriteBehindStage stage;
+    stage.flush(staged, target);
+    stage.remove(target);
+    stage.waitForIdle();
+    QVERIFY(!QFile::exists(staged));
+    QVERIFY(!QFile::exists(target));
+}
+
+void TestWriteBehindStage::copyToTarget() {
+    QByteArray data = testData(WriteBehindStage::BLOCK_ALIGNMENT * 3 + 5);
+    QString staged = m_stagingDirName + "/video.avi";
+    QString target = m_resultDirName + "/video.avi";
+    QString part = target + WriteBehindStage::PART_SUFFIX;
+    QVERIFY(writeFile(staged, data));
+    QVERIFY(WriteBehindStage::copyToTarget(staged, target, WriteBehindStage::BLOCK_ALIGNMENT, NULL));
+    QCOMPARE(readFile(target), data);
+    QVERIFY(!QFile::exists(part));
+    // source is removed by the caller
+    QVERIFY(QFile::exists(staged));
+    QVERIFY(QFile::remove(staged));
+    QVERIFY(QFile::remove(target));
+
+    // nothing under the target name when the copy fails
+    QVERIFY(!WriteBehindStage::copyToTarget(staged, target, WriteBehindStage::BLOCK_ALIGNMENT, NULL));
+    QVERIFY(!QFile::exists(target));
+    QVERIFY(!QFile::exists(part));
+}
+
+QByteArray TestWriteBehindStage::testData(int size) {
+    QByteArray data(size, 0);
+    for (int i = 0; i < size; i++) {
+        data[i] = (char)(i * 7 + i / 256);
+    }
+    return data;
+}
+
+bool TestWriteBehindStage::writeFile(QString fileName, const QByteArray& data) {
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && (file.write(data) == data.size());
+}
+
+QByteArray TestWriteBehindStage::readFile(QString fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+QTEST_APPLESS_MAIN(TestWriteBehindStage)
+
+#include "testwritebehindstage.moc"
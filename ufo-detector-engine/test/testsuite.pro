@@ -11,8 +11,25 @@ SUBDIRS = \
     testActualDetector \
     testVideoCodecSupportInfo \
     testVideoBuffer \
+    testFramePool \
+    testFrameSpool \
+    testPipedVideoWriter \
+    testEncodingQueue \
+    testThumbnailWriter \
+    testTrackOverlay \
+    testMotionMask \
+    testRegionMask \
+    testWriteBehindStage \
+    testPrerollBuffer \
+    testPipelineStats \
+    testFrameSubscriber \
+    testWorkerPool \
+    testCameraFrame \
+    testFileCaptureBackend \
     testDataManager
 
+linux: SUBDIRS += testV4l2CaptureBackend
+
 LIBS += -lgcov
 
 # borrowed from https://github.com/KDAB/KDSoap/blob/master/unittests/unittests.pro (project is also LGPL)
@@ -0,0 +1,177 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thumbnailwriter.h"
+#include <QDebug>
+#include <QtGlobal>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+ThumbnailWriter::ThumbnailWriter(cv::Size frameSize, std::vector<int> sideLengths) :
+    m_worker(1, PREVIEW_QUEUE_CAPACITY)
+{
+    std::sort(sideLengths.begin(), sideLengths.end(), std::greater<int>());
+    for (int sideLength : sideLengths)
+    {
+        m_thumbnailSizes.push_back(thumbnailSize(frameSize, sideLength));
+    }
+    m_tileSize = thumbnailSize(frameSize, PREVIEW_TILE_SIDE_LENGTH);
+    m_previewFrameCount = 0;
+    m_previewInterval = 0;
+    m_previewSampleCount = 0;
+}
+
+ThumbnailWriter::~ThumbnailWriter()
+{
+    // m_worker writes the queued images when destroyed
+}
+
+void ThumbnailWriter::startPreview(int frameInterval)
+{
+    m_previewFrameCount = 0;
+    m_previewInterval = qMax(1, frameInterval);
+    m_previewSampleCount = 0;
+    m_worker.post([this]() { m_previewTiles.clear(); });
+}
+
+void ThumbnailWriter::addPreviewFrame(const cv::Mat& frame)
+{
+    if ((m_previewInterval <= 0) || (m_previewFrameCount++ % m_previewInterval != 0))
+    {
+        return;
+    }
+    m_previewSampleCount++;
+    if (m_previewSampleCount > 2 * PREVIEW_COLUMNS * PREVIEW_ROWS)
+    {
+        // worker keeps every other tile, sample half as often from now on
+        m_previewSampleCount = m_previewSampleCount / 2 + 1;
+        m_previewInterval *= 2;
+    }
+    cv::Mat copy = frame.clone();
+    // a missing sample only makes the preview a little less even, don't wait for the worker
+    m_worker.post([this, copy]() { addPreviewTile(copy); }, 0);
+}
+
+void ThumbnailWriter::writeThumbnails(const cv::Mat& image, QString baseName)
+{
+    cv::Mat copy = image.clone();
+    m_previewInterval = 0;
+    m_worker.post([this, copy, baseName]() { writeImages(copy, baseName); });
+}
+
+void ThumbnailWriter::discardPreview()
+{
+    m_previewInterval = 0;
+    m_worker.post([this]() { m_previewTiles.clear(); });
+}
+
+void ThumbnailWriter::waitForIdle()
+{
+    std::promise<void> idle;
+    m_worker.post([&idle]() { idle.set_value(); });
+    idle.get_future().wait();
+}
+
+cv::Size ThumbnailWriter::thumbnailSize(cv::Size frameSize, int sideLength)
+{
+    double aspectRatio = (double)frameSize.width / (double)frameSize.height;
+    int height = qBound(sideLength / 2, (int)(sideLength / aspectRatio), sideLength);
+    return cv::Size(sideLength, height);
+}
+
+QStringList ThumbnailWriter::fileNames(QString baseName, std::vector<int> sideLengths)
+{
+    QStringList names;
+    std::sort(sideLengths.begin(), sideLengths.end());
+    for (size_t i = 0; i < sideLengths.size(); i++)
+    {
+        names << ((i == 0) ? baseName + ".jpg" : QString("%1-%2.jpg").arg(baseName).arg(sideLengths[i]));
+    }
+    names << baseName + "-preview.jpg";
+    return names;
+}
+
+std::vector<int> ThumbnailWriter::defaultSideLengths()
+{
+    return std::vector<int>{80, 160, 320};
+}
+
+void ThumbnailWriter::addPreviewTile(cv::Mat frame)
+{
+    cv::Mat tile;
+    cv::resize(frame, tile, m_tileSize, 0, 0, cv::INTER_AREA);
+    m_previewTiles.push_back(tile);
+    if ((int)m_previewTiles.size() > 2 * PREVIEW_COLUMNS * PREVIEW_ROWS)
+    {
+        // keeps the first and the newest tile, so the tiles stay evenly spaced
+        std::vector<cv::Mat> evenTiles;
+        for (size_t i = 0; i < m_previewTiles.size(); i += 2)
+        {
+            evenTiles.push_back(m_previewTiles[i]);
+        }
+        m_previewTiles.swap(evenTiles);
+    }
+}
+
+void ThumbnailWriter::writeImages(cv::Mat image, QString baseName)
+{
+    cv::Mat source = image;
+    for (size_t i = 0; i < m_thumbnailSizes.size(); i++)
+    {
+        cv::Mat thumbnail;
+        cv::resize(source, thumbnail, m_thumbnailSizes[i], 0, 0, cv::INTER_AREA);
+        // names are from smallest to largest
+        QString fileName = (i + 1 == m_thumbnailSizes.size()) ? baseName + ".jpg"
+                : QString("%1-%2.jpg").arg(baseName).arg(m_thumbnailSizes[i].width);
+        if (!cv::imwrite(fileName.toStdString(), thumbnail))
+        {
+            qDebug() << "ERROR: Failed to write thumbnail" << fileName;
+        }
+        source = thumbnail;
+    }
+    if (!m_previewTiles.empty())
+    {
+        QString fileName = baseName + "-preview.jpg";
+        if (!cv::imwrite(fileName.toStdString(), previewImage()))
+        {
+            qDebug() << "ERROR: Failed to write preview" << fileName;
+        }
+        m_previewTiles.clear();
+    }
+}
+
+cv::Mat ThumbnailWriter::previewImage()
+{
+    const int maxTiles = PREVIEW_COLUMNS * PREVIEW_ROWS;
+    const int tileCount = qMin((int)m_previewTiles.size(), maxTiles);
+    const int columns = qMin(tileCount, PREVIEW_COLUMNS);
+    const int rows = (tileCount + columns - 1) / columns;
+    cv::Mat preview(rows * m_tileSize.height, columns * m_tileSize.width, CV_8UC3, cv::Scalar::all(0));
+    for (int i = 0; i < tileCount; i++)
+    {
+        // evenly spaced over the samples, first and last included
+        int tileIndex = (tileCount > 1) ? (int)((long long)i * (m_previewTiles.size() - 1) / (tileCount - 1)) : 0;
+        cv::Rect tileRect((i % columns) * m_tileSize.width, (i / columns) * m_tileSize.height,
+                          m_tileSize.width, m_tileSize.height);
+        m_previewTiles[tileIndex].copyTo(preview(tileRect));
+    }
+    return preview;
+}
@@ -0,0 +1,128 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAILWRITER_H
+#define THUMBNAILWRITER_H
+
+#include "workerpool.h"
+#include <QString>
+#include <QStringList>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Writes video thumbnail images and a preview image on a background thread.
+ *
+ * Thumbnails of all sizes are scaled down from one image with area resampling,
+ * each from the previous larger one. The preview is a contact sheet of frames
+ * sampled evenly over the video while it's being recorded.
+ *
+ * The sampling methods are called from the recording thread, the images are
+ * scaled and written by an own worker thread in the order they were requested.
+ * Files of video named baseName:
+ *  - baseName.jpg: thumbnail fitting the smallest side length
+ *  - baseName-<width>.jpg: thumbnail of each larger side length
+ *  - baseName-preview.jpg: contact sheet, when frames were sampled
+ */
+class ThumbnailWriter
+{
+public:
+    /**
+     * @brief ThumbnailWriter constructor. Starts the worker thread.
+     * @param frameSize size of video frames, for the aspect ratio of the thumbnails
+     * @param sideLengths bounding square side lengths of the thumbnails
+     */
+    ThumbnailWriter(cv::Size frameSize, std::vector<int> sideLengths = defaultSideLengths());
+
+    /**
+     * @brief Writes the already requested images and stops the worker thread.
+     */
+    ~ThumbnailWriter();
+
+    /**
+     * @brief Start sampling preview frames of a new video, discarding earlier samples.
+     * @param frameInterval initial number of video frames between samples, grows
+     * when a long video has too many samples
+     */
+    void startPreview(int frameInterval);
+
+    /**
+     * @brief Offer a video frame for the preview. Only sampled frames are copied.
+     * @param frame
+     */
+    void addPreviewFrame(const cv::Mat& frame);
+
+    /**
+     * @brief Write thumbnails of image and the preview of sampled frames.
+     * @param image
+     * @param baseName path of image files without extension
+     */
+    void writeThumbnails(const cv::Mat& image, QString baseName);
+
+    /**
+     * @brief Stop sampling and drop the samples, when video isn't saved.
+     */
+    void discardPreview();
+
+    /**
+     * @brief Wait until the requested images are written.
+     */
+    void waitForIdle();
+
+    /**
+     * @brief Thumbnail size which fits the bounding square and keeps the aspect ratio
+     * of frameSize, but isn't lower than half of sideLength.
+     */
+    static cv::Size thumbnailSize(cv::Size frameSize, int sideLength);
+
+    /**
+     * @brief All image files written of video, used to remove them with the video.
+     * @param baseName path of image files without extension
+     * @param sideLengths
+     */
+    static QStringList fileNames(QString baseName, std::vector<int> sideLengths = defaultSideLengths());
+
+    static std::vector<int> defaultSideLengths();
+
+    static const int PREVIEW_COLUMNS = 4;
+    static const int PREVIEW_ROWS = 3;
+    static const int PREVIEW_TILE_SIDE_LENGTH = 160;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const int PREVIEW_QUEUE_CAPACITY = 8;
+
+    std::vector<cv::Size> m_thumbnailSizes;     ///< from largest to smallest
+    cv::Size m_tileSize;
+    WorkerPool m_worker;        ///< one thread, so requests are handled in order
+
+    // used only by the sampling thread
+    long long m_previewFrameCount;
+    int m_previewInterval;
+    int m_previewSampleCount;
+
+    // used only by the worker thread
+    std::vector<cv::Mat> m_previewTiles;
+
+    void addPreviewTile(cv::Mat frame);
+    void writeImages(cv::Mat image, QString baseName);
+    cv::Mat previewImage();
+};
+
+#endif // THUMBNAILWRITER_H
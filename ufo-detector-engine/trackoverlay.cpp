@@ -0,0 +1,108 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trackoverlay.h"
+
+TrackOverlay::TrackOverlay(int snapshotCount) :
+    m_snapshotCount(qMax(1, snapshotCount)), m_snapshots(new Snapshot[m_snapshotCount]), m_published(0)
+{
+    for (int i = 0; i < m_snapshotCount; i++)
+    {
+        Snapshot& snapshot = m_snapshots[i];
+        snapshot.m_version.store(0, std::memory_order_relaxed);
+        snapshot.m_sequenceNumber.store(0, std::memory_order_relaxed);
+        snapshot.m_count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void TrackOverlay::publish(quint64 sequenceNumber, const std::vector<Box>& boxes)
+{
+    const quint64 published = m_published.load(std::memory_order_relaxed);
+    Snapshot& snapshot = m_snapshots[published % m_snapshotCount];
+    const quint32 version = snapshot.m_version.load(std::memory_order_relaxed);
+    snapshot.m_version.store(version + 1, std::memory_order_relaxed);
+    // readers see the odd version before any of the new values
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const int count = qMin((int)boxes.size(), (int)MAX_BOXES);
+    snapshot.m_sequenceNumber.store(sequenceNumber, std::memory_order_relaxed);
+    snapshot.m_count.store(count, std::memory_order_relaxed);
+    for (int i = 0; i < count; i++)
+    {
+        std::atomic<int>* values = &snapshot.m_values[i * BOX_VALUES];
+        values[0].store(boxes[i].m_rect.x, std::memory_order_relaxed);
+        values[1].store(boxes[i].m_rect.y, std::memory_order_relaxed);
+        values[2].store(boxes[i].m_rect.width, std::memory_order_relaxed);
+        values[3].store(boxes[i].m_rect.height, std::memory_order_relaxed);
+        values[4].store(boxes[i].m_trackId, std::memory_order_relaxed);
+        values[5].store(boxes[i].m_positive ? 1 : 0, std::memory_order_relaxed);
+    }
+
+    snapshot.m_version.store(version + 2, std::memory_order_release);
+    m_published.store(published + 1, std::memory_order_release);
+}
+
+bool TrackOverlay::boxes(quint64 sequenceNumber, std::vector<Box>& boxes) const
+{
+    const quint64 published = m_published.load(std::memory_order_acquire);
+    // from the newest snapshot backwards
+    for (quint64 n = published; (n > 0) && (published - n < (quint64)m_snapshotCount); n--)
+    {
+        const Snapshot& snapshot = m_snapshots[(n - 1) % m_snapshotCount];
+        quint32 version;
+        quint64 snapshotSequenceNumber;
+        do
+        {
+            version = snapshot.m_version.load(std::memory_order_acquire);
+            if (version & 1)
+            {
+                continue;
+            }
+            snapshotSequenceNumber = snapshot.m_sequenceNumber.load(std::memory_order_relaxed);
+            if (snapshotSequenceNumber <= sequenceNumber)
+            {
+                const int count = snapshot.m_count.load(std::memory_order_relaxed);
+                boxes.resize(count);
+                for (int i = 0; i < count; i++)
+                {
+                    const std::atomic<int>* values = &snapshot.m_values[i * BOX_VALUES];
+                    boxes[i].m_rect = cv::Rect(values[0].load(std::memory_order_relaxed),
+                                               values[1].load(std::memory_order_relaxed),
+                                               values[2].load(std::memory_order_relaxed),
+                                               values[3].load(std::memory_order_relaxed));
+                    boxes[i].m_trackId = values[4].load(std::memory_order_relaxed);
+                    boxes[i].m_positive = (values[5].load(std::memory_order_relaxed) != 0);
+                }
+            }
+            // values are valid only if the version didn't change while reading them
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((version & 1) || (snapshot.m_version.load(std::memory_order_relaxed) != version));
+
+        if (snapshotSequenceNumber <= sequenceNumber)
+        {
+            return true;
+        }
+    }
+    boxes.clear();
+    return false;
+}
+
+int TrackOverlay::snapshotCount() const
+{
+    return m_snapshotCount;
+}
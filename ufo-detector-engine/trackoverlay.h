@@ -0,0 +1,93 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACKOVERLAY_H
+#define TRACKOVERLAY_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Boxes of tracked objects handed from the detector to the video writer.
+ *
+ * The detector publishes a snapshot of the track boxes of each frame it has processed,
+ * keyed by the camera frame sequence number. The writer looks up the newest snapshot
+ * of the frame it writes or of an earlier one, so boxes follow the frame they were
+ * detected in even when the detector and recorder run at different rates.
+ *
+ * Snapshots are kept in a ring, each slot guarded by a sequence lock, so neither side
+ * ever waits for the other. There must be only one publishing thread at a time.
+ * A reader which is more than snapshotCount() snapshots behind finds no boxes, so
+ * the ring must cover as many frames as the writer can fall behind.
+ */
+class TrackOverlay
+{
+public:
+    struct Box {
+        cv::Rect m_rect;    ///< in camera frame coordinates
+        int m_trackId;
+        bool m_positive;    ///< object has been detected positive
+    };
+
+    /**
+     * @brief TrackOverlay constructor.
+     * @param snapshotCount number of snapshots kept
+     */
+    explicit TrackOverlay(int snapshotCount = DEFAULT_SNAPSHOT_COUNT);
+
+    /**
+     * @brief Publish boxes of a frame. Frames must be published in capture order.
+     * @param sequenceNumber CameraFrame sequence number of the frame
+     * @param boxes at most MAX_BOXES are kept
+     */
+    void publish(quint64 sequenceNumber, const std::vector<Box>& boxes);
+
+    /**
+     * @brief Boxes of the newest snapshot published for frame sequenceNumber or an earlier frame.
+     * @param sequenceNumber CameraFrame sequence number of the frame
+     * @param boxes result
+     * @return false if there's no such snapshot
+     */
+    bool boxes(quint64 sequenceNumber, std::vector<Box>& boxes) const;
+
+    int snapshotCount() const;
+
+    static const int DEFAULT_SNAPSHOT_COUNT = 32;
+    static const int MAX_BOXES = 16;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const int BOX_VALUES = 6;    ///< x, y, width, height, track id, positive
+
+    struct Snapshot {
+        std::atomic<quint32> m_version;     ///< odd while being written
+        std::atomic<quint64> m_sequenceNumber;
+        std::atomic<int> m_count;
+        std::atomic<int> m_values[MAX_BOXES * BOX_VALUES];
+    };
+
+    const int m_snapshotCount;
+    std::unique_ptr<Snapshot[]> m_snapshots;
+    std::atomic<quint64> m_published;   ///< number of published snapshots
+};
+
+#endif // TRACKOVERLAY_H
@@ -0,0 +1,11 @@
+
+# libjpeg-turbo is optional: it's used for decoding JPEG frames directly to reduced size.
+# Without it OpenCV decoder is used.
+
+unix {
+    CONFIG += link_pkgconfig
+    packagesExist(libturbojpeg) {
+        PKGCONFIG += libturbojpeg
+        DEFINES += HAVE_TURBOJPEG
+    }
+}
@@ -8,6 +8,7 @@ win64:CONFIG += windows
 
 
 include(opencv.pri)
+include(turbojpeg.pri)
 
 # https://bugreports.qt.io/browse/QTBUG-4329
 INCLUDEPATH += $$PWD
@@ -15,6 +16,11 @@ INCLUDEPATH += $$PWD
 SOURCES += $$PWD/recorder.cpp \
     $$PWD/actualdetector.cpp \
     $$PWD/camera.cpp \
+    $$PWD/cameraframe.cpp \
+    $$PWD/opencvcapturebackend.cpp \
+    $$PWD/filecapturebackend.cpp \
+    $$PWD/framesubscriber.cpp \
+    $$PWD/workerpool.cpp \
     $$PWD/Ctracker.cpp \
     $$PWD/Detector.cpp \
     $$PWD/Kalman.cpp \
@@ -22,6 +28,17 @@ SOURCES += $$PWD/recorder.cpp \
     $$PWD/config.cpp \
     $$PWD/camerainfo.cpp \
     $$PWD/videobuffer.cpp \
+    $$PWD/pipelinestats.cpp \
+    $$PWD/framepool.cpp \
+    $$PWD/framespool.cpp \
+    $$PWD/prerollbuffer.cpp \
+    $$PWD/pipedvideowriter.cpp \
+    $$PWD/encodingqueue.cpp \
+    $$PWD/thumbnailwriter.cpp \
+    $$PWD/trackoverlay.cpp \
+    $$PWD/motionmask.cpp \
+    $$PWD/regionmask.cpp \
+    $$PWD/writebehindstage.cpp \
     $$PWD/videocodecsupportinfo.cpp \
     $$PWD/planechecker.cpp \
     $$PWD/detectorstate.cpp \
@@ -30,6 +47,12 @@ SOURCES += $$PWD/recorder.cpp \
 HEADERS  += $$PWD/recorder.h \
     $$PWD/actualdetector.h \
     $$PWD/camera.h \
+    $$PWD/cameraframe.h \
+    $$PWD/capturebackend.h \
+    $$PWD/opencvcapturebackend.h \
+    $$PWD/filecapturebackend.h \
+    $$PWD/framesubscriber.h \
+    $$PWD/workerpool.h \
     $$PWD/Ctracker.h \
     $$PWD/Detector.h \
     $$PWD/Kalman.h \
@@ -37,7 +60,23 @@ HEADERS  += $$PWD/recorder.h \
     $$PWD/config.h \
     $$PWD/camerainfo.h \
     $$PWD/videobuffer.h \
+    $$PWD/pipelinestats.h \
+    $$PWD/framepool.h \
+    $$PWD/framespool.h \
+    $$PWD/prerollbuffer.h \
+    $$PWD/pipedvideowriter.h \
+    $$PWD/encodingqueue.h \
+    $$PWD/thumbnailwriter.h \
+    $$PWD/trackoverlay.h \
+    $$PWD/motionmask.h \
+    $$PWD/regionmask.h \
+    $$PWD/writebehindstage.h \
     $$PWD/videocodecsupportinfo.h \
     $$PWD/planechecker.h \
     $$PWD/detectorstate.h \
     $$PWD/datamanager.h
+
+linux {
+    SOURCES += $$PWD/v4l2capturebackend.cpp
+    HEADERS += $$PWD/v4l2capturebackend.h
+}
@@ -0,0 +1,362 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "v4l2capturebackend.h"
+#include <QDebug>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+
+/*
+ * ioctl() which is restarted if interrupted by a signal
+ */
+static int xioctl(int fd, unsigned long request, void* arg)
+{
+    int result;
+    do
+    {
+        result = ioctl(fd, request, arg);
+    } while ((result == -1) && (errno == EINTR));
+    return result;
+}
+
+V4l2CaptureBackend::BufferSet::BufferSet()
+{
+    m_fd = -1;
+    m_streaming = false;
+    m_queuedCount = 0;
+}
+
+V4l2CaptureBackend::BufferSet::~BufferSet()
+{
+    for (MappedBuffer& buffer : m_buffers)
+    {
+        munmap(buffer.m_start, buffer.m_length);
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+}
+
+void V4l2CaptureBackend::BufferSet::queueBuffer(unsigned int index)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_streaming)
+    {
+        return;
+    }
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    if (xioctl(m_fd, VIDIOC_QBUF, &buf) == -1)
+    {
+        qWarning() << "V4L2: failed to queue buffer" << index << strerror(errno);
+        return;
+    }
+    m_queuedCount++;
+}
+
+V4l2CaptureBackend::V4l2CaptureBackend(QString deviceName, quint32 pixelFormat)
+{
+    m_deviceName = deviceName;
+    m_requestedPixelFormat = pixelFormat;
+    m_pixelFormat = 0;
+    m_framePixelFormat = CameraFrame::BGR;
+    m_bytesPerLine = 0;
+}
+
+V4l2CaptureBackend::~V4l2CaptureBackend()
+{
+    close();
+}
+
+bool V4l2CaptureBackend::open(int width, int height)
+{
+    close();
+
+    std::shared_ptr<BufferSet> bufferSet(new BufferSet);
+    bufferSet->m_fd = ::open(m_deviceName.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (bufferSet->m_fd == -1)
+    {
+        qWarning() << "V4L2: cannot open" << m_deviceName << strerror(errno);
+        return false;
+    }
+    int fd = bufferSet->m_fd;
+
+    struct v4l2_capability capability;
+    memset(&capability, 0, sizeof(capability));
+    if (xioctl(fd, VIDIOC_QUERYCAP, &capability) == -1)
+    {
+        qWarning() << "V4L2:" << m_deviceName << "is not a V4L2 device";
+        return false;
+    }
+    quint32 caps = (capability.capabilities & V4L2_CAP_DEVICE_CAPS) ? capability.device_caps : capability.capabilities;
+    if (!(caps & V4L2_CAP_VIDEO_CAPTURE) || !(caps & V4L2_CAP_STREAMING))
+    {
+        qWarning() << "V4L2:" << m_deviceName << "does not support video capture streaming";
+        return false;
+    }
+
+    struct v4l2_format format;
+    memset(&format, 0, sizeof(format));
+    format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    format.fmt.pix.width = width;
+    format.fmt.pix.height = height;
+    format.fmt.pix.pixelformat = m_requestedPixelFormat;
+    format.fmt.pix.field = V4L2_FIELD_NONE;
+    if (xioctl(fd, VIDIOC_S_FMT, &format) == -1)
+    {
+        qWarning() << "V4L2: failed to set format" << strerror(errno);
+        return false;
+    }
+    // the driver adjusts the format to the nearest one it supports
+    if (!isSupportedPixelFormat(format.fmt.pix.pixelformat))
+    {
+        qWarning() << "V4L2: requested pixel format is not supported by" << m_deviceName;
+        return false;
+    }
+    if (format.fmt.pix.pixelformat != m_requestedPixelFormat)
+    {
+        qDebug() << "V4L2: requested pixel format is not supported, using another one";
+    }
+    m_pixelFormat = format.fmt.pix.pixelformat;
+    m_frameSize = cv::Size(format.fmt.pix.width, format.fmt.pix.height);
+    m_bytesPerLine = format.fmt.pix.bytesperline;
+    switch (m_pixelFormat)
+    {
+    case V4L2_PIX_FMT_YUYV:
+        m_framePixelFormat = CameraFrame::YUYV;
+        break;
+    case V4L2_PIX_FMT_GREY:
+        m_framePixelFormat = CameraFrame::GREY;
+        break;
+    case V4L2_PIX_FMT_NV12:
+        m_framePixelFormat = CameraFrame::NV12;
+        break;
+    default:
+        m_framePixelFormat = CameraFrame::MJPEG;
+        break;
+    }
+
+    struct v4l2_requestbuffers request;
+    memset(&request, 0, sizeof(request));
+    request.count = BUFFER_COUNT;
+    request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    request.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd, VIDIOC_REQBUFS, &request) == -1)
+    {
+        qWarning() << "V4L2:" << m_deviceName << "does not support memory mapping";
+        return false;
+    }
+    if (request.count < (unsigned int)MIN_QUEUED_BUFFERS + 1)
+    {
+        qWarning() << "V4L2: not enough buffers for" << m_deviceName;
+        return false;
+    }
+
+    for (unsigned int i = 0; i < request.count; i++)
+    {
+        struct v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1)
+        {
+            qWarning() << "V4L2: failed to query buffer" << i << strerror(errno);
+            return false;
+        }
+        MappedBuffer buffer;
+        buffer.m_length = buf.length;
+        buffer.m_start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+        if (buffer.m_start == MAP_FAILED)
+        {
+            qWarning() << "V4L2: failed to map buffer" << i << strerror(errno);
+            return false;
+        }
+        bufferSet->m_buffers.push_back(buffer);
+    }
+
+    bufferSet->m_streaming = true;
+    for (unsigned int i = 0; i < bufferSet->m_buffers.size(); i++)
+    {
+        bufferSet->queueBuffer(i);
+    }
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) == -1)
+    {
+        qWarning() << "V4L2: failed to start streaming" << strerror(errno);
+        return false;
+    }
+
+    m_bufferSet = bufferSet;
+    return true;
+}
+
+void V4l2CaptureBackend::close()
+{
+    if (!m_bufferSet)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_bufferSet->m_mutex);
+        enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        xioctl(m_bufferSet->m_fd, VIDIOC_STREAMOFF, &type);
+        m_bufferSet->m_streaming = false;
+        m_bufferSet->m_queuedCount = 0;
+    }
+    // frames still holding buffers keep the buffer set alive
+    m_bufferSet.reset();
+    m_pixelFormat = 0;
+}
+
+bool V4l2CaptureBackend::isOpened()
+{
+    return (bool)m_bufferSet;
+}
+
+bool V4l2CaptureBackend::readFrame(CameraFrame* frame)
+{
+    if (!m_bufferSet)
+    {
+        return false;
+    }
+    int fd = m_bufferSet->m_fd;
+
+    struct pollfd pollFd;
+    pollFd.fd = fd;
+    pollFd.events = POLLIN;
+    pollFd.revents = 0;
+    int pollResult;
+    do
+    {
+        pollResult = poll(&pollFd, 1, READ_TIMEOUT_MS);
+    } while ((pollResult == -1) && (errno == EINTR));
+    if (pollResult <= 0)
+    {
+        return false;
+    }
+
+    struct v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    int queuedCount;
+    {
+        std::lock_guard<std::mutex> lock(m_bufferSet->m_mutex);
+        if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1)
+        {
+            return false;
+        }
+        queuedCount = --m_bufferSet->m_queuedCount;
+    }
+
+    if (buf.flags & V4L2_BUF_FLAG_ERROR)
+    {
+        m_bufferSet->queueBuffer(buf.index);
+        return false;
+    }
+
+    void* data = m_bufferSet->m_buffers[buf.index].m_start;
+    cv::Mat image;
+    switch (m_framePixelFormat)
+    {
+    case CameraFrame::YUYV:
+        image = cv::Mat(m_frameSize, CV_8UC2, data, m_bytesPerLine);
+        break;
+    case CameraFrame::NV12:
+        image = cv::Mat(m_frameSize.height * 3 / 2, m_frameSize.width, CV_8UC1, data, m_bytesPerLine);
+        break;
+    case CameraFrame::MJPEG:
+        image = cv::Mat(1, buf.bytesused, CV_8UC1, data);
+        break;
+    default:
+        image = cv::Mat(m_frameSize, CV_8UC1, data, m_bytesPerLine);
+        break;
+    }
+
+    if (queuedCount < MIN_QUEUED_BUFFERS)
+    {
+        // frame consumers are holding most of the buffers: copy this frame so that the driver can keep capturing
+        frame->m_image = image.clone();
+        m_bufferSet->queueBuffer(buf.index);
+    }
+    else
+    {
+        std::shared_ptr<BufferSet> bufferSet = m_bufferSet;
+        unsigned int index = buf.index;
+        frame->m_image = image;
+        frame->m_buffer = std::shared_ptr<void>(data, [bufferSet, index](void*) {
+            bufferSet->queueBuffer(index);
+        });
+    }
+    frame->m_pixelFormat = m_framePixelFormat;
+
+    // monotonic driver timestamps are in the clock of FrameClock
+    if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC)
+    {
+        frame->m_timestamp = FrameClock::time_point(std::chrono::seconds(buf.timestamp.tv_sec) +
+                                                    std::chrono::microseconds(buf.timestamp.tv_usec));
+    }
+    return true;
+}
+
+cv::Size V4l2CaptureBackend::frameSize()
+{
+    return m_frameSize;
+}
+
+quint32 V4l2CaptureBackend::pixelFormat()
+{
+    return m_pixelFormat;
+}
+
+quint32 V4l2CaptureBackend::fourcc(QString fourccStr)
+{
+    QByteArray chars = fourccStr.toLatin1();
+    if (chars.size() != 4)
+    {
+        return 0;
+    }
+    return v4l2_fourcc(chars[0], chars[1], chars[2], chars[3]);
+}
+
+bool V4l2CaptureBackend::isSupportedPixelFormat(quint32 pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_GREY:
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_MJPEG:
+    case V4L2_PIX_FMT_JPEG:
+        return true;
+    default:
+        return false;
+    }
+}
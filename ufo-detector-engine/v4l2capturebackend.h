@@ -0,0 +1,124 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef V4L2CAPTUREBACKEND_H
+#define V4L2CAPTUREBACKEND_H
+
+#include "capturebackend.h"
+#include <QString>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Capture backend using Video4Linux2 memory mapped streaming I/O.
+ *
+ * Frames are given in the native pixel format of the camera and they point
+ * directly into the mmap'd driver buffers, so nothing is copied or converted
+ * while capturing. A driver buffer is given back to the driver when the last
+ * reference to its frame is dropped. If frame consumers hold on to so many
+ * buffers that the driver is about to run out of them, the newest frame is
+ * copied and its buffer is given back at once.
+ *
+ * Can be tested without a camera using the vivid virtual driver (modprobe vivid).
+ */
+class V4l2CaptureBackend : public CaptureBackend
+{
+public:
+    /**
+     * @param deviceName device file name, e.g. /dev/video0
+     * @param pixelFormat requested V4L2 pixel format, see fourcc()
+     */
+    V4l2CaptureBackend(QString deviceName, quint32 pixelFormat);
+
+    ~V4l2CaptureBackend();
+
+    bool open(int width, int height) override;
+
+    void close() override;
+
+    bool isOpened() override;
+
+    bool readFrame(CameraFrame* frame) override;
+
+    cv::Size frameSize() override;
+
+    /**
+     * @brief Pixel format the device actually uses.
+     * @return V4L2 pixel format, or 0 if device is not open
+     */
+    quint32 pixelFormat();
+
+    /**
+     * @brief Convert four character code string like "YUYV" to V4L2 pixel format.
+     * @return pixel format, or 0 if the string is not four characters long
+     */
+    static quint32 fourcc(QString fourccStr);
+
+    /**
+     * @brief Whether frames in given V4L2 pixel format can be used.
+     */
+    static bool isSupportedPixelFormat(quint32 pixelFormat);
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    const int BUFFER_COUNT = 8;         ///< number of driver buffers to request
+    const int MIN_QUEUED_BUFFERS = 2;   ///< copy frames instead of holding buffers when less are queued
+    const int READ_TIMEOUT_MS = 1000;   ///< how long readFrame() waits for a frame
+
+    /**
+     * @brief A driver buffer mapped to memory.
+     */
+    struct MappedBuffer {
+        void* m_start;
+        size_t m_length;
+    };
+
+    /**
+     * @brief Device file and its buffers. Shared by the backend and frames
+     * holding driver buffers, so it's destroyed only after the last frame.
+     */
+    struct BufferSet {
+        BufferSet();
+        ~BufferSet();
+
+        /**
+         * @brief Give buffer back to the driver, if still streaming.
+         * @param index buffer index
+         */
+        void queueBuffer(unsigned int index);
+
+        int m_fd;
+        std::vector<MappedBuffer> m_buffers;
+        std::mutex m_mutex;     ///< guards m_streaming, m_queuedCount and QBUF
+        bool m_streaming;
+        int m_queuedCount;      ///< number of buffers owned by the driver
+    };
+
+    QString m_deviceName;
+    quint32 m_requestedPixelFormat;
+    quint32 m_pixelFormat;      ///< actual pixel format
+    CameraFrame::PixelFormat m_framePixelFormat;
+    cv::Size m_frameSize;
+    unsigned int m_bytesPerLine;
+    std::shared_ptr<BufferSet> m_bufferSet;
+};
+
+#endif // V4L2CAPTUREBACKEND_H
@@ -17,50 +17,199 @@
  */
 
 #include "videobuffer.h"
+#include "framepool.h"
+#include "framespool.h"
+#ifdef Q_OS_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
 
-VideoBuffer::VideoBuffer(int capacity, QObject *parent) : QObject(parent) {
-    m_buffer.clear();
+VideoBuffer::VideoBuffer(int capacity, OverflowPolicy overflowPolicy, QObject *parent) : QObject(parent),
+    m_slots(capacity), m_extraDuplicates(capacity)
+{
     m_capacity = capacity;
-    m_freeSlots = new QSemaphore(m_capacity);
-    m_reservedSlots = new QSemaphore(0);
+    m_overflowPolicy = overflowPolicy;
+    for (int i = 0; i < m_capacity; i++) {
+        m_slots[i] = NULL;
+        m_extraDuplicates[i] = 0;
+    }
+    m_head = 0;
+    m_tail = 0;
+    m_pushSequence = 0;
+    m_popSequence = 0;
+    m_consumerWaiting = 0;
+    m_producerWaiting = 0;
     m_waitingEnabled = true;
-    m_waitTimeoutMs = 100;
+    m_spool = NULL;
+    m_framePool = NULL;
 }
 
 VideoBuffer::~VideoBuffer()
 {
-    delete m_freeSlots;
-    delete m_reservedSlots;
 }
 
 BufferedVideoFrame* VideoBuffer::waitNextFrame() {
     BufferedVideoFrame* frame = NULL;
-    bool slotAcquired = false;
-    while (m_waitingEnabled && !slotAcquired) {
-        slotAcquired = m_reservedSlots->tryAcquire(1, m_waitTimeoutMs);
-    }
-    if (slotAcquired && !m_buffer.isEmpty()) {
-        frame = m_buffer.dequeue();
-        m_freeSlots->release(1);
+    FrameClock::time_point waitStart;
+    bool waited = false;
+
+    while (true) {
+        quint32 head = m_head.load();
+        // acquire pairs with the producer's release, making the slot content visible
+        if (m_tail.load(std::memory_order_acquire) != head) {
+            frame = m_slots[head % m_capacity].load(std::memory_order_relaxed);
+            // Take the repeats while the slot is still ours. Once head moves, the producer
+            // may reuse the slot and coalesce repeats of its next frame into it.
+            int extraDuplicates = m_extraDuplicates[head % m_capacity].fetch_or(POPPING) & ~POPPING;
+            if (!m_head.compare_exchange_strong(head, head + 1)) {
+                // producer dropped the frame, try the next one
+                continue;
+            }
+            frame->m_duplicateCount += extraDuplicates;
+            m_popSequence.fetch_add(1);
+            if (m_producerWaiting.load()) {
+                wake(m_popSequence);
+            }
+            m_stats.m_consumerWaitUs.add(waited ? elapsedMicroseconds(waitStart) : 0);
+            break;
+        }
+        // Spooled frames are newer than buffered ones. Check the buffer again after
+        // seeing the spool non-empty, frames pushed before the spill may have arrived.
+        bool spooled = m_spool && !m_spool->isEmpty();
+        if (spooled && (m_tail.load(std::memory_order_acquire) != head)) {
+            continue;
+        }
+        if (spooled && (frame = unspool())) {
+            m_popSequence.fetch_add(1);
+            if (m_producerWaiting.load()) {
+                wake(m_popSequence);
+            }
+            m_stats.m_consumerWaitUs.add(waited ? elapsedMicroseconds(waitStart) : 0);
+            break;
+        }
+        if (!m_waitingEnabled) {
+            break;
+        }
+        if (!waited) {
+            waitStart = FrameClock::now();
+            waited = true;
+        }
+        // announce waiting before checking again so that producer won't miss us
+        m_consumerWaiting.store(1);
+        quint32 sequence = m_pushSequence.load();
+        // a spooled frame which couldn't be read waits for the pool, i.e. the next push
+        if ((m_tail.load(std::memory_order_acquire) == head) && (spooled || !m_spool || m_spool->isEmpty())
+                && m_waitingEnabled) {
+            waitWhileEqual(m_pushSequence, sequence);
+        }
+        m_consumerWaiting.store(0);
     }
     return frame;
 }
 
-bool VideoBuffer::pushFrame(BufferedVideoFrame* frame) {
-    bool ok = false;
-    bool slotAcquired = false;
+bool VideoBuffer::pushFrame(BufferedVideoFrame* frame, BufferedVideoFrame** droppedFrame) {
+    if (droppedFrame) {
+        *droppedFrame = NULL;
+    }
     if (!frame) {
         return false;
     }
-    while (m_waitingEnabled && !slotAcquired) {
-        slotAcquired = m_freeSlots->tryAcquire(1, m_waitTimeoutMs);
+    quint32 tail = m_tail.load(std::memory_order_relaxed);
+    FrameClock::time_point waitStart;
+    bool waited = false;
+
+    while (m_waitingEnabled) {
+        quint32 head = m_head.load();
+        // once spilling, keep spilling until the consumer has read the spool empty to keep frame order
+        bool spilling = m_spool && !m_spool->isEmpty();
+        if (!spilling && ((tail - head) < (quint32)m_capacity)) {
+            m_slots[tail % m_capacity].store(frame, std::memory_order_relaxed);
+            m_extraDuplicates[tail % m_capacity].store(0, std::memory_order_relaxed);
+            // release publishes the slot before the new tail
+            m_tail.store(tail + 1, std::memory_order_release);
+            m_pushSequence.fetch_add(1);
+            if (m_consumerWaiting.load()) {
+                wake(m_pushSequence);
+            }
+            m_stats.m_producerWaitUs.add(waited ? elapsedMicroseconds(waitStart) : 0);
+            int occupancy = tail + 1 - m_head.load();
+            m_stats.m_occupancy.add(occupancy);
+            if (occupancy > m_stats.m_highWaterMark) {
+                m_stats.m_highWaterMark = occupancy;
+            }
+            return true;
+        }
+
+        if (m_spool) {
+            if (spill(frame)) {
+                m_stats.m_producerWaitUs.add(waited ? elapsedMicroseconds(waitStart) : 0);
+                return true;
+            }
+            if (m_overflowPolicy != Block) {
+                // spool is full and buffered frames can't be dropped or repeated without reordering
+                m_stats.m_droppedNewestFrames++;
+                return false;
+            }
+        } else if ((m_overflowPolicy == DropOldest) && droppedFrame) {
+            *droppedFrame = dropOldest(head);
+            continue;
+        } else if ((m_overflowPolicy == DropOldest) || (m_overflowPolicy == DropNewest)) {
+            m_stats.m_droppedNewestFrames++;
+            return false;
+        } else if (m_overflowPolicy == Coalesce) {
+            if (coalesce(frame, tail)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (!waited) {
+            waitStart = FrameClock::now();
+            waited = true;
+            m_stats.m_blockedPushes++;
+        }
+        m_producerWaiting.store(1);
+        quint32 sequence = m_popSequence.load();
+        bool full = m_spool ? (m_spool->count() >= m_spool->capacity())
+                            : ((tail - m_head.load()) >= (quint32)m_capacity);
+        if (full && m_waitingEnabled) {
+            waitWhileEqual(m_popSequence, sequence);
+        }
+        m_producerWaiting.store(0);
     }
-    if (slotAcquired && (m_buffer.count() < m_capacity)) {
-        m_buffer.enqueue(frame);
-        ok = true;
-        m_reservedSlots->release(1);
+    m_stats.m_rejectedFrames++;
+    return false;
+}
+
+VideoBuffer::OverflowPolicy VideoBuffer::overflowPolicy() {
+    return m_overflowPolicy;
+}
+
+void VideoBuffer::setSpool(FrameSpool* spool, FramePool* framePool) {
+    // a frame the spool can't take would block the producer forever
+    m_spool = (spool && framePool && (spool->frameSize() == framePool->frameSize())) ? spool : NULL;
+    m_framePool = framePool;
+}
+
+VideoBuffer::OverflowPolicy VideoBuffer::overflowPolicyFromString(QString policy, bool* ok) {
+    if (ok) {
+        *ok = true;
+    }
+    if (policy == "block") {
+        return Block;
+    } else if (policy == "dropOldest") {
+        return DropOldest;
+    } else if (policy == "dropNewest") {
+        return DropNewest;
+    } else if (policy == "coalesce") {
+        return Coalesce;
+    }
+    if (ok) {
+        *ok = false;
     }
-    return ok;
+    return Block;
 }
 
 int VideoBuffer::capacity() {
@@ -68,9 +217,103 @@ int VideoBuffer::capacity() {
 }
 
 int VideoBuffer::count() {
-    return m_buffer.size();
+    // head first: it only grows towards tail, so the difference can't go negative
+    quint32 head = m_head.load(std::memory_order_acquire);
+    quint32 tail = m_tail.load(std::memory_order_acquire);
+    return tail - head;
+}
+
+int VideoBuffer::spooledCount() {
+    return m_spool ? m_spool->count() : 0;
+}
+
+const VideoBufferStats& VideoBuffer::stats() {
+    return m_stats;
 }
 
 void VideoBuffer::stopWait() {
     m_waitingEnabled = false;
+    m_pushSequence.fetch_add(1);
+    m_popSequence.fetch_add(1);
+    wake(m_pushSequence);
+    wake(m_popSequence);
+}
+
+BufferedVideoFrame* VideoBuffer::dropOldest(quint32 head) {
+    BufferedVideoFrame* oldest = m_slots[head % m_capacity].load(std::memory_order_relaxed);
+    // consumer may be taking the same frame, whoever moves head owns it
+    if (!m_head.compare_exchange_strong(head, head + 1)) {
+        return NULL;
+    }
+    // repeats of the dropped frame are lost with it
+    m_extraDuplicates[head % m_capacity].exchange(0);
+    m_stats.m_droppedOldestFrames++;
+    return oldest;
+}
+
+bool VideoBuffer::coalesce(BufferedVideoFrame* frame, quint32 tail) {
+    const int repeats = 1 + frame->m_duplicateCount;
+    std::atomic<int>& extraDuplicates = m_extraDuplicates[(tail - 1) % m_capacity];
+    int duplicates = extraDuplicates.load();
+    do {
+        if (duplicates & POPPING) {
+            // consumer is taking the newest frame, there'll be room for this one
+            return false;
+        }
+    } while (!extraDuplicates.compare_exchange_weak(duplicates, duplicates + repeats));
+    m_stats.m_coalescedFrames++;
+    return true;
+}
+
+bool VideoBuffer::spill(BufferedVideoFrame* frame) {
+    if (!m_spool->write(*frame)) {
+        return false;
+    }
+    // the spool has a copy, the frame can be reused right away
+    m_framePool->adopt(frame);
+    m_pushSequence.fetch_add(1);
+    if (m_consumerWaiting.load()) {
+        wake(m_pushSequence);
+    }
+    m_stats.m_spilledFrames++;
+    int spooled = m_spool->count();
+    if (spooled > m_stats.m_spoolHighWaterMark) {
+        m_stats.m_spoolHighWaterMark = spooled;
+    }
+    return true;
+}
+
+BufferedVideoFrame* VideoBuffer::unspool() {
+    PooledFrame frame = m_framePool->acquire();
+    if (!frame || !m_spool->read(*frame)) {
+        return NULL;
+    }
+    return frame.release();
+}
+
+quint64 VideoBuffer::elapsedMicroseconds(FrameClock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(FrameClock::now() - since).count();
+}
+
+void VideoBuffer::waitWhileEqual(std::atomic<quint32>& word, quint32 expected) {
+#ifdef Q_OS_LINUX
+    // returns immediately if the word has already changed
+    syscall(SYS_futex, reinterpret_cast<quint32*>(&word), FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+#else
+    std::unique_lock<std::mutex> lock(m_waitMutex);
+    m_waitCondition.wait(lock, [&word, expected]() { return word.load() != expected; });
+#endif
+}
+
+void VideoBuffer::wake(std::atomic<quint32>& word) {
+#ifdef Q_OS_LINUX
+    syscall(SYS_futex, reinterpret_cast<quint32*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    Q_UNUSED(word);
+    {
+        // waiter checks the word under the lock, so it can't miss this
+        std::lock_guard<std::mutex> lock(m_waitMutex);
+    }
+    m_waitCondition.notify_all();
+#endif
 }
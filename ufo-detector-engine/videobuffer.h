@@ -20,41 +20,96 @@
 #define VIDEOBUFFER_H
 
 #include <QObject>
-#include <QQueue>
-#include <QSemaphore>
+#include <QString>
+#include <atomic>
+#include <vector>
+#ifndef Q_OS_LINUX
+#include <mutex>
+#include <condition_variable>
+#endif
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
+#include "cameraframe.h"
+#include "pipelinestats.h"
 
 struct BufferedVideoFrame {
     cv::Mat* m_frame;       ///< pointer to video frame
     int m_duplicateCount;   ///< number of following frames that are duplicates of this frame
+    FrameClock::time_point m_timestamp; ///< capture time of the frame
+    quint64 m_sequenceNumber;   ///< CameraFrame sequence number, 0 if not from camera
 };
 
+class FramePool;
+class FrameSpool;
+
 /**
  * @brief Video buffer class with thread-safe access
+ *
+ * Bounded ring buffer for one producer thread and one consumer thread. Frames are
+ * handed over through preallocated slots with acquire/release ordering, and blocking
+ * threads sleep on a futex (Linux) so that they wake up right when there's
+ * something to do or stopWait() is called.
+ *
+ * What happens when a frame is pushed into a full buffer is selected with
+ * OverflowPolicy. Only Block stalls the producer, the others keep capture
+ * cadence and lose frames instead.
+ *
+ * With a spool set, frames that don't fit are first spilled to disk and read
+ * back after the buffered frames, so a slow consumer falls behind by up to the
+ * spool capacity before the overflow policy applies.
  */
 class VideoBuffer : public QObject
 {
     Q_OBJECT
 public:
-    explicit VideoBuffer(int capacity, QObject *parent = 0);
+    /**
+     * @brief What pushFrame() does when the buffer is full.
+     */
+    enum OverflowPolicy {
+        Block = 0,      ///< wait for free space
+        DropOldest,     ///< remove the oldest buffered frame and give it back to the producer
+        DropNewest,     ///< don't buffer the pushed frame
+        Coalesce        ///< don't buffer the pushed frame but repeat the newest buffered frame in its place
+    };
+
+    explicit VideoBuffer(int capacity, OverflowPolicy overflowPolicy = Block, QObject *parent = 0);
     ~VideoBuffer();
     /**
      * @brief Wait next frame and pop it from the buffer. Will block in case of empty buffer.
-     * Call to stopWait() method will stop the waiting. In that case, this method
-     * will return NULL.
+     * Call to stopWait() method will stop the waiting. After that, this method
+     * returns the frames left in the buffer without blocking, and NULL when it's empty.
      * @return pointer to BufferedVideoFrame
      */
     BufferedVideoFrame* waitNextFrame();
 
     /**
-     * @brief Push frame to the tail of buffer. Will block in case of full buffer.
-     * Call to stopWait() method will stop the blocking. In that case, this method
-     * will return false.
+     * @brief Push frame to the tail of buffer. In case of full buffer, what happens depends
+     * on the overflow policy. With Block, call to stopWait() method will stop the blocking.
+     * In that case, this method will return false.
      * @param frame pointer to frame
-     * @return true if succeeded, false if not (was interrupted by stopWait())
+     * @param droppedFrame set to the oldest frame if it was removed to make room (DropOldest),
+     * otherwise to NULL. The caller owns the dropped frame. If not given, DropOldest works like DropNewest.
+     * @return true if the buffer took the frame, false if not and the caller still owns it
      */
-    bool pushFrame(BufferedVideoFrame* frame);
+    bool pushFrame(BufferedVideoFrame* frame, BufferedVideoFrame** droppedFrame = NULL);
+
+    OverflowPolicy overflowPolicy();
+
+    /**
+     * @brief Set disk overflow tier. Call before frames are pushed.
+     * @param spool where frames are spilled when the buffer is full, or NULL to disable spilling
+     * @param framePool pool of the pushed frames, with the frame size of the spool. Spilled
+     * frames are given back to it and frames read from the spool are taken from it.
+     */
+    void setSpool(FrameSpool* spool, FramePool* framePool);
+
+    /**
+     * @brief Overflow policy from its setting string: "block", "dropOldest", "dropNewest" or "coalesce".
+     * @param policy
+     * @param ok set to false if the string is unknown
+     * @return policy, Block if the string is unknown
+     */
+    static OverflowPolicy overflowPolicyFromString(QString policy, bool* ok = NULL);
 
     /**
      * @brief Capacity of buffer.
@@ -63,11 +118,17 @@ public:
     int capacity();
 
     /**
-     * @brief The current number of frames in the buffer.
+     * @brief The current number of frames in the buffer, not counting spooled frames.
      * @return
      */
     int count();
 
+    /**
+     * @brief The current number of frames spilled to the spool.
+     * @return
+     */
+    int spooledCount();
+
     /**
      * @brief Stop all waiting in case of empty or full buffer
      * This method will stop execution of waitNextFrame() if it's currently blocked,
@@ -76,15 +137,71 @@ public:
      */
     void stopWait();
 
+    /**
+     * @brief Occupancy and wait time counters, updated by pushFrame() and waitNextFrame().
+     */
+    const VideoBufferStats& stats();
+
 #ifndef _UNIT_TEST_
 private:
 #endif
-    QQueue<BufferedVideoFrame*> m_buffer;
+    std::vector<std::atomic<BufferedVideoFrame*>> m_slots;  ///< ring buffer slots
+    std::vector<std::atomic<int>> m_extraDuplicates;    ///< coalesced frames to add to m_duplicateCount of the frame in slot, or'ed with POPPING
     int m_capacity;         ///< capacity of buffer
-    QSemaphore* m_freeSlots; ///< free slots in buffer
-    QSemaphore* m_reservedSlots; ///< reserved slots in buffer
-    bool m_waitingEnabled;  ///< blocking enabled on full/empty buffer
-    int m_waitTimeoutMs;    ///< interval at which waiting enabled flag is checked
+    OverflowPolicy m_overflowPolicy;
+    std::atomic<quint32> m_head;    ///< number of frames popped or dropped, by the consumer or by DropOldest
+    std::atomic<quint32> m_tail;    ///< number of frames pushed, written only by the producer
+    std::atomic<quint32> m_pushSequence;    ///< futex word, changes on push and stopWait()
+    std::atomic<quint32> m_popSequence;     ///< futex word, changes on pop and stopWait()
+    std::atomic<int> m_consumerWaiting;     ///< consumer is (about to be) sleeping on m_pushSequence
+    std::atomic<int> m_producerWaiting;     ///< producer is (about to be) sleeping on m_popSequence
+    std::atomic<bool> m_waitingEnabled;  ///< blocking enabled on full/empty buffer
+    FrameSpool* m_spool;    ///< disk overflow tier, may be NULL
+    FramePool* m_framePool; ///< pool of frames moved to and from m_spool
+    VideoBufferStats m_stats;
+    static const int POPPING = 1 << 30;     ///< m_extraDuplicates flag: consumer has taken the count, no more repeats
+#ifndef Q_OS_LINUX
+    std::mutex m_waitMutex;             ///< emulates futex where it's not available
+    std::condition_variable m_waitCondition;
+#endif
+
+    /**
+     * @brief Sleep while word has the expected value. May return spuriously.
+     */
+    void waitWhileEqual(std::atomic<quint32>& word, quint32 expected);
+
+    /**
+     * @brief Wake threads sleeping on word.
+     */
+    void wake(std::atomic<quint32>& word);
+
+    /**
+     * @brief Remove the oldest frame from full buffer, for DropOldest.
+     * @param head value of m_head when the buffer was seen full
+     * @return removed frame, or NULL if consumer took it first
+     */
+    BufferedVideoFrame* dropOldest(quint32 head);
+
+    /**
+     * @brief Add frame as duplicates of the newest buffered frame, for Coalesce.
+     * @param tail value of m_tail
+     * @return false if consumer is popping the newest frame, so there's room in the buffer
+     */
+    bool coalesce(BufferedVideoFrame* frame, quint32 tail);
+
+    /**
+     * @brief Write frame to the spool and give it back to the pool.
+     * @return false if the spool is full
+     */
+    bool spill(BufferedVideoFrame* frame);
+
+    /**
+     * @brief Read the oldest spooled frame into a frame from the pool.
+     * @return frame, or NULL if the spool is empty or the pool is exhausted
+     */
+    BufferedVideoFrame* unspool();
+
+    static quint64 elapsedMicroseconds(FrameClock::time_point since);
 
 signals:
 
@@ -17,12 +17,22 @@
  */
 
 #include "videocodecsupportinfo.h"
+#include "pipedvideowriter.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSettings>
+#include <future>
+#include <opencv2/imgproc/imgproc.hpp>
 
 VideoCodecSupportInfo::VideoCodecSupportInfo(QString externalVideoEncoderLocation, QObject* parent)
     : QObject(parent)
 {
     m_videoEncoderLocation = externalVideoEncoderLocation;
-    m_testFileName = "dummy_Wa8F7bVL3lmF4ngfD0894u32Nd.avi";
+    m_testFileName = QString("%1/dummy_Wa8F7bVL3lmF4ngfD0894u32Nd-%2").arg(QDir::tempPath())
+            .arg(QCoreApplication::applicationPid());
     m_isInitialized = false;
 
     m_rawVideoCodecStr = "IYUV";
@@ -42,31 +52,131 @@ VideoCodecSupportInfo::VideoCodecSupportInfo(QString externalVideoEncoderLocatio
     m_fourccToCodecName.insert(stringToFourcc("LAGS"), tr("Lagarith Lossless Video"));
 }
 
-bool VideoCodecSupportInfo::init() {
+bool VideoCodecSupportInfo::init(QString cacheFileName) {
     if (m_isInitialized) {
         return false;
     }
-    int codec = 0;
-    QListIterator<int> codecIt(m_codecSupport.keys());
-    QList<int> encoderList;
+    m_cacheFileName = cacheFileName;
+    if (!cacheFileName.isEmpty() && loadCache(cacheFileName)) {
+        m_isInitialized = true;
+        return true;
+    }
 
-    while (codecIt.hasNext()) {
-        codec = codecIt.next();
-        if (testOpencvSupport(codec)) {
-            encoderList = m_codecSupport.value(codec);
+    // each probe mostly waits for a video file, run them all at once while the encoder
+    // lists its codecs once for all of them
+    QList<int> codecs = m_codecSupport.keys();
+    QList<std::shared_future<bool>> opencvResults;
+    foreach (int codec, codecs) {
+        opencvResults << std::async(std::launch::async, &VideoCodecSupportInfo::testOpencvSupport, this, codec).share();
+    }
+    QStringList supportedEncoderCodecs = encoderCodecs(m_videoEncoderLocation);
+
+    for (int i = 0; i < codecs.size(); i++) {
+        int codec = codecs.at(i);
+        QList<int> encoderList;
+        if (opencvResults.at(i).get()) {
             encoderList.append(VideoCodecSupportInfo::OpenCv);
-            m_codecSupport.insert(codec, encoderList);
         }
-        if (testEncoderSupport(codec)) {
-            encoderList = m_codecSupport.value(codec);
+        QString encoderCodecStr = m_fourccToEncoderStr.value(codec);
+        if (!encoderCodecStr.isEmpty() && supportedEncoderCodecs.contains(encoderCodecStr)) {
             encoderList.append(VideoCodecSupportInfo::External);
-            m_codecSupport.insert(codec, encoderList);
         }
+        m_codecSupport.insert(codec, encoderList);
+    }
+    if (!cacheFileName.isEmpty()) {
+        // benchmarks take a while, keep those of codecs which are still supported
+        {
+            QSettings cache(cacheFileName, QSettings::IniFormat);
+            loadBenchmarkResults(cache);
+        }
+        saveCache(cacheFileName);
     }
     m_isInitialized = true;
     return true;
 }
 
+QString VideoCodecSupportInfo::cacheKey() {
+    QFileInfo encoderInfo(m_videoEncoderLocation);
+    QStringList codecs;
+    foreach (int codec, m_codecSupport.keys()) {
+        codecs << fourccToString(codec) + "=" + m_fourccToEncoderStr.value(codec);
+    }
+    // a changed encoder binary or OpenCV library may support other codecs
+    return QString("opencv %1; encoder %2 %3 %4; codecs %5").arg(CV_VERSION).arg(m_videoEncoderLocation)
+            .arg(encoderInfo.exists() ? encoderInfo.lastModified().toMSecsSinceEpoch() : 0)
+            .arg(encoderInfo.size()).arg(codecs.join(","));
+}
+
+bool VideoCodecSupportInfo::loadCache(QString cacheFileName) {
+    QSettings cache(cacheFileName, QSettings::IniFormat);
+    if (cache.value("key").toString() != cacheKey()) {
+        return false;
+    }
+    cache.beginGroup("codecs");
+    foreach (int codec, m_codecSupport.keys()) {
+        QList<int> encoderList;
+        foreach (const QString& encoder, cache.value(fourccToString(codec)).toStringList()) {
+            encoderList.append(encoder.toInt());
+        }
+        m_codecSupport.insert(codec, encoderList);
+    }
+    cache.endGroup();
+    loadBenchmarkResults(cache);
+    qDebug() << "Video codec support read from" << cacheFileName;
+    return true;
+}
+
+void VideoCodecSupportInfo::saveCache(QString cacheFileName) {
+    QSettings cache(cacheFileName, QSettings::IniFormat);
+    cache.clear();
+    cache.setValue("key", cacheKey());
+    cache.beginGroup("codecs");
+    foreach (int codec, m_codecSupport.keys()) {
+        QStringList encoders;
+        foreach (int encoder, m_codecSupport.value(codec)) {
+            encoders << QString::number(encoder);
+        }
+        cache.setValue(fourccToString(codec), encoders);
+    }
+    cache.endGroup();
+    cache.beginGroup("benchmark");
+    foreach (const QString& sizeKey, m_benchmarkResults.keys()) {
+        cache.beginGroup(sizeKey);
+        foreach (const CodecBenchmark& result, m_benchmarkResults.value(sizeKey)) {
+            cache.setValue(fourccToString(result.m_fourcc), QStringList() << QString::number(result.m_encoder)
+                           << QString::number(result.m_fps) << QString::number(result.m_bytesPerFrame));
+        }
+        cache.endGroup();
+    }
+    cache.endGroup();
+    cache.sync();
+}
+
+void VideoCodecSupportInfo::loadBenchmarkResults(QSettings& cache) {
+    cache.beginGroup("benchmark");
+    m_benchmarkResults.clear();
+    foreach (const QString& sizeKey, cache.childGroups()) {
+        cache.beginGroup(sizeKey);
+        QList<CodecBenchmark> results;
+        foreach (const QString& codecStr, cache.childKeys()) {
+            QStringList values = cache.value(codecStr).toStringList();
+            if (values.size() == 3) {
+                CodecBenchmark result;
+                result.m_fourcc = stringToFourcc(codecStr);
+                result.m_encoder = values.at(0).toInt();
+                result.m_fps = values.at(1).toDouble();
+                result.m_bytesPerFrame = values.at(2).toDouble();
+                if (m_codecSupport.value(result.m_fourcc).contains(result.m_encoder)) {
+                    results << result;
+                }
+            }
+        }
+        m_benchmarkResults.insert(sizeKey, results);
+        cache.endGroup();
+    }
+    cache.endGroup();
+}
+
 bool VideoCodecSupportInfo::isInitialized() {
     return m_isInitialized;
 }
@@ -134,7 +244,9 @@ bool VideoCodecSupportInfo::testOpencvSupport(int fourcc) {
     cv::Mat frame;
     bool supported = false;
     int writtenFourcc = 0;
-    std::string testFileNameStd(m_testFileName.toLocal8Bit().data());
+    // own file for each codec, they are tested in parallel
+    QString testFileName = m_testFileName + "-" + QString::number((uint)fourcc, 16) + ".avi";
+    std::string testFileNameStd(testFileName.toLocal8Bit().data());
 
     // try opening & writing file
     try {
@@ -153,43 +265,175 @@ bool VideoCodecSupportInfo::testOpencvSupport(int fourcc) {
 
     // check result
     cv::VideoCapture reader;
-    if (!reader.open(testFileNameStd)) {
-        return false;
-    }
-    writtenFourcc = (int)reader.get(CV_CAP_PROP_FOURCC);
-    if (writtenFourcc == fourcc) {
-        supported = true;
+    if (reader.open(testFileNameStd)) {
+        writtenFourcc = (int)reader.get(CV_CAP_PROP_FOURCC);
+        if (writtenFourcc == fourcc) {
+            supported = true;
+        }
     }
-    QFile testFile(m_testFileName);
+    QFile testFile(testFileName);
     testFile.remove();
     return supported;
 }
 
 bool VideoCodecSupportInfo::testEncoderSupport(int fourcc) {
-    QProcess encoder;
-    QStringList encoderOutput;
-    QStringList args;
     QString encoderCodecStr = m_fourccToEncoderStr.value(fourcc);
 
     if (encoderCodecStr.isEmpty()) {
         return false;
     }
+    return encoderCodecs(m_videoEncoderLocation).contains(encoderCodecStr);
+}
+
+QStringList VideoCodecSupportInfo::encoderCodecs(QString encoderLocation) {
+    QProcess encoder;
+    QStringList codecs;
+    QStringList args;
 
     args << "-codecs";
-    encoder.start(m_videoEncoderLocation, args);
+    encoder.start(encoderLocation, args);
     encoder.waitForFinished();
+    // Codec lines start with capability flags, E = encode, V = video.
+    const QRegularExpression regex("^ *.EV... +(\\S+)");
     while (encoder.canReadLine()) {
-        encoderOutput << encoder.readLine();
+        QRegularExpressionMatch match = regex.match(QString::fromLocal8Bit(encoder.readLine()));
+        if (match.hasMatch()) {
+            codecs << match.captured(1);
+        }
     }
-    QStringListIterator listIt(encoderOutput);
-    while (listIt.hasNext()) {
-        QString line = listIt.next();
-        // Find encoder name and verify it can encode videos.
-        QRegularExpression regex("^ *.EV...\\ " + encoderCodecStr + ".*$");
-        if (regex.match(line).hasMatch()) {
-            return true;
+    return codecs;
+}
+
+
+QList<VideoCodecSupportInfo::CodecBenchmark> VideoCodecSupportInfo::runBenchmark(cv::Size frameSize, int frameCount) {
+    std::lock_guard<std::mutex> lock(m_benchmarkMutex);
+    return benchmark(frameSize, frameCount);
+}
+
+QList<VideoCodecSupportInfo::CodecBenchmark> VideoCodecSupportInfo::benchmark(cv::Size frameSize, int frameCount) {
+    QList<CodecBenchmark> results;
+    std::vector<cv::Mat> frames = benchmarkFrames(frameSize, qMin(frameCount, (int)BENCHMARK_DISTINCT_FRAMES));
+    foreach (int codec, supportedCodecs()) {
+        // measure the encoder which records the codec: segments and frame timestamps need
+        // the external one, OpenCV writes directly only when it's the only choice
+        int encoder = isEncoderSupported(codec) ? VideoCodecSupportInfo::External : VideoCodecSupportInfo::OpenCv;
+        CodecBenchmark result;
+        if (benchmarkCodec(codec, encoder, frames, frameCount, result)) {
+            qDebug() << "Benchmark" << fourccToString(codec) << frameSize.width << "x" << frameSize.height << ":"
+                     << result.m_fps << "fps," << result.m_bytesPerFrame << "bytes per frame";
+            results << result;
         }
     }
-    return false;
+    m_benchmarkResults.insert(frameSizeKey(frameSize), results);
+    if (!m_cacheFileName.isEmpty()) {
+        saveCache(m_cacheFileName);
+    }
+    return results;
 }
 
+QList<VideoCodecSupportInfo::CodecBenchmark> VideoCodecSupportInfo::benchmarkResults(cv::Size frameSize) {
+    std::lock_guard<std::mutex> lock(m_benchmarkMutex);
+    return m_benchmarkResults.value(frameSizeKey(frameSize));
+}
+
+QList<VideoCodecSupportInfo::CodecBenchmark> VideoCodecSupportInfo::ensureBenchmark(cv::Size frameSize) {
+    std::lock_guard<std::mutex> lock(m_benchmarkMutex);
+    if (m_benchmarkResults.contains(frameSizeKey(frameSize))) {
+        return m_benchmarkResults.value(frameSizeKey(frameSize));
+    }
+    qDebug() << "No codec benchmark at" << frameSize.width << "x" << frameSize.height << ", running it";
+    return benchmark(frameSize, BENCHMARK_FRAME_COUNT);
+}
+
+int VideoCodecSupportInfo::recommendedCodec(const QList<CodecBenchmark>& results, double fps, double headroom) {
+    const CodecBenchmark* smallest = NULL;
+    const CodecBenchmark* fastest = NULL;
+    foreach (const CodecBenchmark& result, results) {
+        if (!fastest || (result.m_fps > fastest->m_fps)) {
+            fastest = &result;
+        }
+        if ((result.m_fps >= fps * headroom) && (!smallest || (result.m_bytesPerFrame < smallest->m_bytesPerFrame))) {
+            smallest = &result;
+        }
+    }
+    if (smallest) {
+        return smallest->m_fourcc;
+    }
+    // dropping frames is worse than big files
+    return fastest ? fastest->m_fourcc : 0;
+}
+
+bool VideoCodecSupportInfo::benchmarkCodec(int fourcc, int encoder, const std::vector<cv::Mat>& frames, int frameCount,
+                                           CodecBenchmark& result) {
+    if (frames.empty()) {
+        return false;
+    }
+    const cv::Size frameSize = frames.front().size();
+    QString fileName = m_testFileName + "-benchmark-" + QString::number((uint)fourcc, 16)
+            + ((encoder == VideoCodecSupportInfo::External) ? ".mkv" : ".avi");
+    bool success = true;
+    QElapsedTimer timer;
+    timer.start();
+    // encoding is done when the file is closed
+    if (encoder == VideoCodecSupportInfo::External) {
+        PipedVideoWriter writer;
+        success = writer.open(m_videoEncoderLocation, fourccToEncoderString(fourcc), fileName,
+                              BENCHMARK_CAPTURE_FPS, frameSize);
+        for (int i = 0; success && (i < frameCount); i++) {
+            success = writer.write(frames.at(i % frames.size()));
+        }
+        success = writer.release() && success;
+    } else {
+        cv::VideoWriter writer;
+        try {
+            success = writer.open(fileName.toLocal8Bit().data(), fourcc, BENCHMARK_CAPTURE_FPS, frameSize);
+        } catch (cv::Exception& e) {
+            success = false;
+        }
+        for (int i = 0; success && (i < frameCount); i++) {
+            writer.write(frames.at(i % frames.size()));
+        }
+        writer.release();
+    }
+    const qint64 elapsedMsecs = qMax((qint64)1, timer.elapsed());
+
+    const qint64 fileSize = QFileInfo(fileName).size();
+    QFile::remove(fileName);
+    if (!success || (fileSize <= 0)) {
+        return false;
+    }
+    result.m_fourcc = fourcc;
+    result.m_encoder = encoder;
+    result.m_fps = frameCount * 1000.0 / elapsedMsecs;
+    result.m_bytesPerFrame = (double)fileSize / frameCount;
+    return true;
+}
+
+std::vector<cv::Mat> VideoCodecSupportInfo::benchmarkFrames(cv::Size frameSize, int count) {
+    std::vector<cv::Mat> frames;
+    cv::Mat sky(frameSize, CV_8UC3);
+    for (int y = 0; y < frameSize.height; y++) {
+        // lighter towards the horizon
+        double position = (double)y / qMax(1, frameSize.height - 1);
+        sky.row(y).setTo(cv::Scalar(200 - 40 * position, 150 - 30 * position, 90 + 60 * position));
+    }
+    cv::RNG rng(0x5eed);
+    const int objectRadius = qMax(2, frameSize.height / 40);
+    for (int i = 0; i < count; i++) {
+        // sensor noise is what makes lossless codecs work hard
+        cv::Mat noise(frameSize, CV_16SC3);
+        rng.fill(noise, cv::RNG::NORMAL, 0, 3);
+        cv::Mat frame;
+        sky.convertTo(frame, CV_16SC3);
+        frame += noise;
+        frame.convertTo(frame, CV_8UC3);
+        cv::Point center(frameSize.width * (i + 1) / (count + 1), frameSize.height / 3);
+        cv::circle(frame, center, objectRadius, cv::Scalar(40, 40, 40), -1);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+QString VideoCodecSupportInfo::frameSizeKey(cv::Size frameSize) {
+    return QString("%1x%2").arg(frameSize.width).arg(frameSize.height);
+}
@@ -26,9 +26,13 @@
 #include <QFile>
 #include <QDebug>
 #include <QRegularExpression>
+#include <mutex>
+#include <vector>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+class QSettings;
+
 /**
  * @brief Support info about video codecs.
  *
@@ -48,6 +52,16 @@ public:
         VIDEO_ENCODER_COUNT
     };
 
+    /**
+     * @brief Encoding speed and output size of a codec, measured on this host.
+     */
+    struct CodecBenchmark {
+        int m_fourcc;
+        int m_encoder;          ///< VideoEncoders, the one used for recording with the codec
+        double m_fps;           ///< frames encoded per second
+        double m_bytesPerFrame; ///< mean size of an encoded frame
+    };
+
     /**
      * @brief Constructor.
      * @param externalVideoEncoderLocation full path to external video encoder
@@ -57,8 +71,12 @@ public:
 
     /**
      * @brief This method does the work for actually collecting info about supported codecs.
+     *
+     * Codecs are probed in parallel, unless the results are found in the cache. The cache
+     * is valid for the same OpenCV version and encoder executable.
+     * @param cacheFileName file of cached probe results, empty to always probe
      */
-    bool init();
+    bool init(QString cacheFileName = QString());
 
     /**
      * @brief Whether this object is initialized.
@@ -125,6 +143,43 @@ public:
      */
     void removeSupport(int fourcc, int encoder);
 
+    /**
+     * @brief Encode a synthetic sky clip with each supported codec, measuring encoding speed
+     * and output size. The results are kept with the cached probe results, also when the
+     * codecs are probed again. Takes a while, is not run by init().
+     * @param frameSize video resolution
+     * @param frameCount length of the clip
+     * @return results of each supported codec
+     */
+    QList<CodecBenchmark> runBenchmark(cv::Size frameSize, int frameCount = BENCHMARK_FRAME_COUNT);
+
+    /**
+     * @brief Results of an earlier runBenchmark() at frameSize.
+     * @return results, empty if not benchmarked
+     */
+    QList<CodecBenchmark> benchmarkResults(cv::Size frameSize);
+
+    /**
+     * @brief Results at frameSize, running runBenchmark() first if it hasn't been run at
+     * that size. Callers at the same time wait for the same benchmark.
+     * @return results, empty if no codec could be benchmarked
+     */
+    QList<CodecBenchmark> ensureBenchmark(cv::Size frameSize);
+
+    /**
+     * @brief Codec with the smallest output of those which encode fast enough.
+     * @param results benchmark results
+     * @param fps capture frame rate which must be sustained
+     * @param headroom how many times faster than fps the codec must encode, room for
+     * detection and other cameras running at the same time
+     * @return FOURCC code, the fastest codec if none is fast enough, 0 if no results
+     */
+    static int recommendedCodec(const QList<CodecBenchmark>& results, double fps, double headroom = BENCHMARK_HEADROOM);
+
+    static const int BENCHMARK_FRAME_COUNT = 100;
+    static const int BENCHMARK_CAPTURE_FPS = 30;    ///< capture frame rate assumed when not configured
+    static constexpr double BENCHMARK_HEADROOM = 1.5;
+
 #ifndef _UNIT_TEST_
 private:
 #endif
@@ -135,11 +190,63 @@ private:
     QHash<int, QString> m_fourccToEncoderStr;   ///< encoder fourcc -> encoder ID string used by encoder
     QHash<int, QString> m_fourccToCodecName;    ///< clear text name of codec (max. few words)
 
-    QString m_testFileName;     ///< file name used in support tests -- @todo must not collide with existing files
+    QString m_testFileName;     ///< base of file names used in support tests, in temp directory
+    QString m_cacheFileName;    ///< probe and benchmark results, empty if not cached
+    QHash<QString, QList<CodecBenchmark> > m_benchmarkResults;  ///< frame size as "WxH" -> results
+    std::mutex m_benchmarkMutex;    ///< guards m_benchmarkResults and the cache file against concurrent benchmarks
     QString m_rawVideoCodecStr; ///< raw video codec FOURCC string
 
+    /**
+     * @brief Probe results which identify the OpenCV version and encoder executable.
+     */
+    QString cacheKey();
+
+    /**
+     * @brief Read probe results from cache.
+     * @return false if not cached or the cache is not of this OpenCV and encoder
+     */
+    bool loadCache(QString cacheFileName);
+
+    void saveCache(QString cacheFileName);
+
+    /**
+     * @brief Read benchmark results from cache, dropping those of codecs which are no longer
+     * supported by the benchmarked encoder.
+     */
+    void loadBenchmarkResults(QSettings& cache);
+
+    /**
+     * @brief runBenchmark() with m_benchmarkMutex locked.
+     */
+    QList<CodecBenchmark> benchmark(cv::Size frameSize, int frameCount);
+
+    /**
+     * @brief Names of the video codecs the encoder can encode, from its -codecs output.
+     * @param encoderLocation
+     * @return codec names, empty if the encoder didn't run
+     */
+    static QStringList encoderCodecs(QString encoderLocation);
+
+    /**
+     * @brief Encode frames with codec, measuring how long it takes.
+     * @param frames frames of the clip, repeated to frameCount
+     * @return false if the codec couldn't encode them
+     */
+    bool benchmarkCodec(int fourcc, int encoder, const std::vector<cv::Mat>& frames, int frameCount,
+                        CodecBenchmark& result);
+
+    /**
+     * @brief Frames of a synthetic clip: sky gradient with sensor noise and a moving object.
+     */
+    static std::vector<cv::Mat> benchmarkFrames(cv::Size frameSize, int count);
+
+    static QString frameSizeKey(cv::Size frameSize);
+
+    static const int BENCHMARK_DISTINCT_FRAMES = 10;    ///< generated frames, repeated to the length of the clip
+
     /**
      * @brief Test whether OpenCV supports the specified codec.
+     * Can be called from several threads at the same time.
      * @param fourcc FOURCC code for codec
      * @return
      */
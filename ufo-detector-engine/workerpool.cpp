@@ -0,0 +1,104 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "workerpool.h"
+#include <QtGlobal>
+
+WorkerPool::WorkerPool(int threadCount, int queueCapacity)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = qMax(1, (int)std::thread::hardware_concurrency());
+    }
+    m_queueCapacity = qMax(1, queueCapacity);
+    m_running = true;
+    for (int i = 0; i < threadCount; i++)
+    {
+        m_threads.push_back(std::unique_ptr<std::thread>(new std::thread(&WorkerPool::workerThread, this)));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_taskAvailable.notify_all();
+    m_spaceAvailable.notify_all();
+    for (std::unique_ptr<std::thread>& thread : m_threads)
+    {
+        thread->join();
+    }
+}
+
+bool WorkerPool::post(Task task, int timeoutMs)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto spaceOrStop = [this]() { return ((int)m_tasks.size() < m_queueCapacity) || !m_running; };
+        if (timeoutMs < 0)
+        {
+            m_spaceAvailable.wait(lock, spaceOrStop);
+        }
+        else if (timeoutMs > 0)
+        {
+            m_spaceAvailable.wait_for(lock, std::chrono::milliseconds(timeoutMs), spaceOrStop);
+        }
+        if (!m_running || ((int)m_tasks.size() >= m_queueCapacity))
+        {
+            return false;
+        }
+        m_tasks.push_back(task);
+    }
+    m_taskAvailable.notify_one();
+    return true;
+}
+
+int WorkerPool::threadCount()
+{
+    return m_threads.size();
+}
+
+int WorkerPool::queuedCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void WorkerPool::workerThread()
+{
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this]() { return !m_tasks.empty() || !m_running; });
+            if (m_tasks.empty())
+            {
+                // stopping and nothing left to do
+                return;
+            }
+            task = m_tasks.front();
+            m_tasks.pop_front();
+        }
+        m_spaceAvailable.notify_one();
+        task();
+    }
+}
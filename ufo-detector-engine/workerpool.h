@@ -0,0 +1,85 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Fixed set of worker threads running tasks from a bounded queue.
+ *
+ * Shared by all detectors of a process, so that the number of threads doing
+ * image processing doesn't grow with the number of cameras.
+ */
+class WorkerPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * @brief WorkerPool constructor. Starts the worker threads.
+     * @param threadCount number of worker threads, 0 for one per CPU core
+     * @param queueCapacity maximum number of tasks waiting to be run
+     */
+    explicit WorkerPool(int threadCount = 0, int queueCapacity = DEFAULT_QUEUE_CAPACITY);
+
+    /**
+     * @brief Runs the already queued tasks and stops the worker threads.
+     */
+    ~WorkerPool();
+
+    /**
+     * @brief Add task to the queue.
+     * @param task
+     * @param timeoutMs how long to wait when the queue is full: 0 doesn't wait, negative waits forever
+     * @return false if the queue stayed full or the pool is stopping
+     */
+    bool post(Task task, int timeoutMs = -1);
+
+    int threadCount();
+
+    /**
+     * @brief Number of tasks waiting to be run.
+     */
+    int queuedCount();
+
+    static const int DEFAULT_QUEUE_CAPACITY = 64;
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    int m_queueCapacity;
+    std::vector<std::unique_ptr<std::thread>> m_threads;
+    std::deque<Task> m_tasks;
+    std::mutex m_mutex;         ///< guards m_tasks and m_running
+    std::condition_variable m_taskAvailable;
+    std::condition_variable m_spaceAvailable;
+    bool m_running;
+
+    void workerThread();
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,186 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "writebehindstage.h"
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QtGlobal>
+#include <cstdio>
+#include <future>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+WriteBehindStage::WriteBehindStage(int blockSize) :
+    m_blockSize(qMax(BLOCK_ALIGNMENT, blockSize / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT)),
+    m_backlogBytes(0), m_flushingWritten(0), m_backlogFiles(0),
+    m_worker(1, FLUSH_QUEUE_CAPACITY)
+{
+}
+
+WriteBehindStage::~WriteBehindStage()
+{
+    // m_worker flushes the queued files when destroyed
+}
+
+void WriteBehindStage::flush(QString stagedFileName, QString targetFileName, FlushedCallback flushed)
+{
+    const qint64 size = QFileInfo(stagedFileName).size();
+    m_backlogBytes += size;
+    m_backlogFiles++;
+    m_worker.post([this, stagedFileName, targetFileName, size, flushed]() {
+        flushFile(stagedFileName, targetFileName, size, flushed);
+    });
+}
+
+void WriteBehindStage::remove(QString fileName)
+{
+    m_worker.post([fileName]() { QFile::remove(fileName); });
+}
+
+qint64 WriteBehindStage::backlogBytes()
+{
+    return qMax((qint64)0, m_backlogBytes - m_flushingWritten);
+}
+
+int WriteBehindStage::backlogFiles()
+{
+    return m_backlogFiles;
+}
+
+void WriteBehindStage::waitForIdle()
+{
+    std::promise<void> idle;
+    m_worker.post([&idle]() { idle.set_value(); });
+    idle.get_future().wait();
+}
+
+void WriteBehindStage::flushFile(QString stagedFileName, QString targetFileName, qint64 size, FlushedCallback flushed)
+{
+    QString fileName = targetFileName;
+    // rename fails across file systems, the staging directory is usually on another one
+    if (rename(stagedFileName.toLocal8Bit().data(), targetFileName.toLocal8Bit().data()) != 0)
+    {
+        if (copyToTarget(stagedFileName, targetFileName, m_blockSize, &m_flushingWritten))
+        {
+            QFile::remove(stagedFileName);
+        }
+        else
+        {
+            // keep the staged file, it's the only copy
+            qDebug() << "ERROR: Failed to flush" << stagedFileName << "to" << targetFileName;
+            fileName = stagedFileName;
+        }
+    }
+    m_backlogBytes -= size;
+    m_flushingWritten = 0;
+    m_backlogFiles--;
+    if (flushed)
+    {
+        flushed(fileName);
+    }
+}
+
+bool WriteBehindStage::copyToTarget(QString sourceFileName, QString targetFileName, int blockSize,
+                                    std::atomic<qint64>* written)
+{
+    // the target name appears only when the whole file is on disk, a partial copy
+    // mustn't look like a finished video
+    const QString partFileName = targetFileName + PART_SUFFIX;
+    if (!copyFile(sourceFileName, partFileName, blockSize, written))
+    {
+        return false;
+    }
+    if (rename(partFileName.toLocal8Bit().data(), targetFileName.toLocal8Bit().data()) != 0)
+    {
+        QFile::remove(partFileName);
+        return false;
+    }
+    return true;
+}
+
+bool WriteBehindStage::copyFile(QString sourceFileName, QString targetFileName, int blockSize,
+                                std::atomic<qint64>* written)
+{
+    QFile source(sourceFileName);
+    QFile target(targetFileName);
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Unbuffered) ||
+            !target.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        return false;
+    }
+    const qint64 size = source.size();
+#ifdef Q_OS_LINUX
+    // reserve the space up front, the file system can then allocate it contiguously
+    // and a full disk is noticed before writing anything
+    if ((size > 0) && (posix_fallocate(target.handle(), 0, size) != 0))
+    {
+        target.close();
+        target.remove();
+        return false;
+    }
+    posix_fadvise(source.handle(), 0, size, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    char* block = static_cast<char*>(qMallocAligned(blockSize, BLOCK_ALIGNMENT));
+    bool success = (block != NULL);
+    qint64 copied = 0;
+    while (success && (copied < size))
+    {
+        // fill the whole block, so that every write but the last is full and aligned
+        qint64 blockBytes = 0;
+        while (blockBytes < blockSize)
+        {
+            qint64 bytes = source.read(block + blockBytes, blockSize - blockBytes);
+            if (bytes <= 0)
+            {
+                break;
+            }
+            blockBytes += bytes;
+        }
+        if ((blockBytes == 0) || (target.write(block, blockBytes) != blockBytes))
+        {
+            success = false;
+            break;
+        }
+        copied += blockBytes;
+        if (written)
+        {
+            *written += blockBytes;
+        }
+    }
+    qFreeAligned(block);
+
+#ifdef Q_OS_LINUX
+    // the staged copy is removed after this, the data must be on the disk by then
+    success = success && (fdatasync(target.handle()) == 0);
+    if (success)
+    {
+        // the video won't be read soon, don't keep it in the page cache
+        posix_fadvise(target.handle(), 0, copied, POSIX_FADV_DONTNEED);
+    }
+#endif
+    target.close();
+    if (!success)
+    {
+        target.remove();
+    }
+    return success;
+}
@@ -0,0 +1,122 @@
+/*
+ * UFO Detector | www.UFOID.net
+ *
+ * Copyright (C) 2016 UFOID
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WRITEBEHINDSTAGE_H
+#define WRITEBEHINDSTAGE_H
+
+#include "workerpool.h"
+#include <QString>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief Moves finished files from a fast staging directory to their final place
+ * on a background thread.
+ *
+ * Videos are written into the staging directory, e.g. on tmpfs, so that a slow
+ * disk or network share can't stall the recording. Each staged file is then
+ * written next to its target in large aligned blocks, into space preallocated for the
+ * whole file, renamed to the target once the copy is on disk and then removed from
+ * staging. A file on the same file system as its target is only renamed.
+ *
+ * Files are flushed one at a time in the order they were queued, so that e.g.
+ * video segments are in place before the list which joins them.
+ */
+class WriteBehindStage
+{
+public:
+    /**
+     * @brief Called on the flushing thread when a file has been flushed.
+     * @param fileName the target file, or the staged file if it couldn't be flushed
+     */
+    typedef std::function<void(QString fileName)> FlushedCallback;
+
+    /**
+     * @brief WriteBehindStage constructor. Starts the flushing thread.
+     * @param blockSize size of each write to the target, multiple of BLOCK_ALIGNMENT
+     */
+    explicit WriteBehindStage(int blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * @brief Flushes the already queued files and stops the flushing thread.
+     */
+    ~WriteBehindStage();
+
+    /**
+     * @brief Queue staged file to be moved to target.
+     * @param stagedFileName
+     * @param targetFileName
+     * @param flushed called when done, may be empty
+     */
+    void flush(QString stagedFileName, QString targetFileName, FlushedCallback flushed = FlushedCallback());
+
+    /**
+     * @brief Queue removal of file, after the files queued before it have been flushed.
+     * @param fileName staged or target file
+     */
+    void remove(QString fileName);
+
+    /**
+     * @brief Bytes queued for flushing but not yet written to their targets.
+     */
+    qint64 backlogBytes();
+
+    /**
+     * @brief Files queued for flushing and not yet in place.
+     */
+    int backlogFiles();
+
+    /**
+     * @brief Wait until the queued files are flushed.
+     */
+    void waitForIdle();
+
+    /**
+     * @brief Copy file in blocks of blockSize into preallocated target, and sync the target.
+     * @param written counter increased by the number of bytes written so far, may be NULL
+     * @return false if the copy failed, the target is removed then
+     */
+    static bool copyFile(QString sourceFileName, QString targetFileName, int blockSize,
+                         std::atomic<qint64>* written = NULL);
+
+    static const int BLOCK_ALIGNMENT = 4096;
+    static const int DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+    static constexpr const char* PART_SUFFIX = ".part";    ///< added to the target name while copying
+
+#ifndef _UNIT_TEST_
+private:
+#endif
+    static const int FLUSH_QUEUE_CAPACITY = 1024;
+
+    int m_blockSize;
+    std::atomic<qint64> m_backlogBytes;    ///< size of the queued files
+    std::atomic<qint64> m_flushingWritten; ///< bytes of the file being flushed already written
+    std::atomic<int> m_backlogFiles;
+    WorkerPool m_worker;        ///< one thread, so files are flushed in order
+
+    void flushFile(QString stagedFileName, QString targetFileName, qint64 size, FlushedCallback flushed);
+
+    /**
+     * @brief Copy file next to the target with PART_SUFFIX and rename it to the target when synced.
+     * @return false if the copy failed, nothing is left at the target then
+     */
+    static bool copyToTarget(QString sourceFileName, QString targetFileName, int blockSize,
+                             std::atomic<qint64>* written);
+};
+
+#endif // WRITEBEHINDSTAGE_H
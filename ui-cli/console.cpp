@@ -18,41 +18,55 @@
 
 #include "console.h"
 
-Console::Console(Config* config, ActualDetector* detector, Camera* camera,
+Console::Console(Config* config, QList<ActualDetector*> detectors, QList<Camera*> cameras,
                  DataManager* dataManager, QObject* parent) : QObject(parent)
 {
     m_config = config;
-    m_actualDetector = detector;
-    m_camera = camera;
+    m_actualDetectors = detectors;
+    m_cameras = cameras;
     m_dataManager = dataManager;
     m_initialized = false;
+    m_startedDetectors = 0;
 }
 
 Console::~Console() {
     logMessage("Console quitting");
     m_dataManager->deleteLater();
-    m_actualDetector->deleteLater();
-    m_camera->deleteLater();
+    foreach (ActualDetector* detector, m_actualDetectors) {
+        detector->deleteLater();
+    }
+    foreach (Camera* camera, m_cameras) {
+        camera->deleteLater();
+    }
     m_config->deleteLater();
 }
 
 bool Console::init() {
-    logMessage("Noise filter pixel size: " + QString::number(m_config->noiseFilterPixelSize()));
-    logMessage("Motion threshold size: " + QString::number(m_config->motionThreshold()));
+    foreach (Camera* camera, m_cameras) {
+        int index = camera->index();
+        logMessage("Camera " + QString::number(index) + " noise filter pixel size: "
+                   + QString::number(m_config->noiseFilterPixelSize(index)));
+        logMessage("Camera " + QString::number(index) + " motion threshold size: "
+                   + QString::number(m_config->motionThreshold(index)));
+    }
 
-    connect(m_actualDetector, SIGNAL(positiveMessage()), this, SLOT(onPositiveMessage()));
-    connect(m_actualDetector, SIGNAL(negativeMessage()), this, SLOT(onNegativeMessage()));
-    connect(m_actualDetector, SIGNAL(errorReadingDetectionAreaFile()), this, SLOT(onDetectionAreaFileReadError()));
     connect(m_dataManager, SIGNAL(resultDataSaved(QString,QString,QString)), this, SLOT(onVideoSaved(QString,QString,QString)));
-    connect(m_actualDetector->getRecorder(), SIGNAL(recordingStarted()), this, SLOT(onRecordingStarted()));
-    connect(m_actualDetector->getRecorder(), SIGNAL(recordingFinished()), this, SLOT(onRecordingFinished()));
-    connect(m_actualDetector, SIGNAL(progressValueChanged(int)), this, SLOT(onDetectorStartProgressChanged(int)));
-    connect(m_actualDetector, SIGNAL(broadcastOutputText(QString)), this, SLOT(logMessage(QString)));
-
     if (m_config->checkAirplanes()) {
         m_planeChecker = new PlaneChecker(this, m_config->coordinates());
-        connect(m_planeChecker, SIGNAL(foundNumberOfPlanes(int)), m_actualDetector, SLOT(setAmountOfPlanes(int)));
-        connect(m_actualDetector, SIGNAL(checkPlane()), m_planeChecker, SLOT(callApi()));
+    }
+    foreach (ActualDetector* detector, m_actualDetectors) {
+        connect(detector, SIGNAL(positiveMessage()), this, SLOT(onPositiveMessage()));
+        connect(detector, SIGNAL(negativeMessage()), this, SLOT(onNegativeMessage()));
+        connect(detector, SIGNAL(errorReadingDetectionAreaFile()), this, SLOT(onDetectionAreaFileReadError()));
+        connect(detector->getRecorder(), SIGNAL(recordingStarted()), this, SLOT(onRecordingStarted()));
+        connect(detector->getRecorder(), SIGNAL(recordingFinished()), this, SLOT(onRecordingFinished()));
+        connect(detector, SIGNAL(progressValueChanged(int)), this, SLOT(onDetectorStartProgressChanged(int)));
+        connect(detector, SIGNAL(broadcastOutputText(QString)), this, SLOT(logMessage(QString)));
+
+        if (m_config->checkAirplanes()) {
+            connect(m_planeChecker, SIGNAL(foundNumberOfPlanes(int)), detector, SLOT(setAmountOfPlanes(int)));
+            connect(detector, SIGNAL(checkPlane()), m_planeChecker, SLOT(callApi()));
+        }
     }
     m_initialized = true;
     return true;
@@ -62,7 +76,12 @@ bool Console::start() {
     if (!m_initialized) {
         return false;
     }
-    return m_actualDetector->start();
+    foreach (ActualDetector* detector, m_actualDetectors) {
+        if (!detector->start()) {
+            return false;
+        }
+    }
+    return true;
 }
 
 void Console::onRecordingStarted() {
@@ -73,7 +92,13 @@ void Console::onRecordingFinished() {
 
 void Console::onDetectorStartProgressChanged(int progress) {
     if (100 == progress) {
-        logMessage("Detector started");
+        m_startedDetectors++;
+        if (m_actualDetectors.size() > 1) {
+            logMessage("Detector " + QString::number(m_startedDetectors) + "/"
+                       + QString::number(m_actualDetectors.size()) + " started");
+        } else {
+            logMessage("Detector started");
+        }
     }
 }
 
@@ -98,5 +123,7 @@ void Console::onVideoSaved(QString filename, QString dateTime, QString length) {
 }
 
 void Console::onApplicationAboutToQuit() {
-    m_actualDetector->stopThread();
+    foreach (ActualDetector* detector, m_actualDetectors) {
+        detector->stopThread();
+    }
 }
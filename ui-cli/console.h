@@ -34,7 +34,15 @@ class Console : public QObject
 {
     Q_OBJECT
 public:
-    explicit Console(Config* config, ActualDetector* detector, Camera* camera,
+    /**
+     * @brief Console constructor.
+     * @param config
+     * @param detectors detector of each camera
+     * @param cameras cameras, in the same order as detectors
+     * @param dataManager
+     * @param parent
+     */
+    explicit Console(Config* config, QList<ActualDetector*> detectors, QList<Camera*> cameras,
                      DataManager* dataManager, QObject *parent = 0);
 
     ~Console();
@@ -55,11 +63,12 @@ public:
 private:
 #endif
     Config* m_config;
-    ActualDetector* m_actualDetector;
+    QList<ActualDetector*> m_actualDetectors;
     PlaneChecker* m_planeChecker;
-    Camera* m_camera;
+    QList<Camera*> m_cameras;
     DataManager* m_dataManager;
     bool m_initialized;
+    int m_startedDetectors;     ///< number of detectors reported started
 
 signals:
 
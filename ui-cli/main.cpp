@@ -21,6 +21,9 @@
 #include "actualdetector.h"
 #include "datamanager.h"
 #include "console.h"
+#include "workerpool.h"
+#include "recorder.h"
+#include "encodingqueue.h"
 #include <iostream>
 #include <QCoreApplication>
 #include <csignal>
@@ -58,9 +61,27 @@ int main(int argc, char *argv[])
         QCoreApplication::translate("ufo-detector-cli", "Reset detection area file."));
     parser.addOption(resetDetectionAreaFileOption);
 
+    QCommandLineOption inputOption("input",
+        QCoreApplication::translate("ufo-detector-cli",
+            "Read video file or image directory <file> instead of web camera. Quits at the end of input."),
+        QCoreApplication::translate("ufo-detector-cli", "file"));
+    parser.addOption(inputOption);
+
+    QCommandLineOption realTimeOption("realtime",
+        QCoreApplication::translate("ufo-detector-cli",
+            "Read --input at its frame rate. By default it's read as fast as the detector can process it."));
+    parser.addOption(realTimeOption);
+
+    QCommandLineOption benchmarkCodecsOption("benchmark-codecs",
+        QCoreApplication::translate("ufo-detector-cli",
+            "Measure encoding speed and video size of the supported codecs at camera resolution, and quit. "
+            "Video codec \"" AUTO_VIDEO_CODEC "\" uses the results."));
+    parser.addOption(benchmarkCodecsOption);
+
     parser.process(a);
 
     bool m_resetDetectionAreaFile = parser.isSet(resetDetectionAreaFileOption);
+    QString inputFileName = parser.value(inputOption);
 
     try {
         Config config;
@@ -75,27 +96,88 @@ int main(int argc, char *argv[])
                 return -1;
             }
         }
+        if (parser.isSet(benchmarkCodecsOption)) {
+            VideoCodecSupportInfo* codecInfo = config.videoCodecSupportInfo();
+            int fps = (config.videoFrameRate() > 0) ? config.videoFrameRate() : VideoCodecSupportInfo::BENCHMARK_CAPTURE_FPS;
+            std::cout << "Benchmarking codecs at " << config.cameraWidth() << "x" << config.cameraHeight() << std::endl;
+            QList<VideoCodecSupportInfo::CodecBenchmark> results =
+                    codecInfo->runBenchmark(cv::Size(config.cameraWidth(), config.cameraHeight()));
+            foreach (const VideoCodecSupportInfo::CodecBenchmark& result, results) {
+                std::cout << codecInfo->fourccToString(result.m_fourcc).toStdString() << ": "
+                          << result.m_fps << " fps, " << (qint64)result.m_bytesPerFrame << " bytes per frame" << std::endl;
+            }
+            int codec = VideoCodecSupportInfo::recommendedCodec(results, fps);
+            if (codec == 0) {
+                std::cerr << "No codec could be benchmarked" << std::endl;
+                return -1;
+            }
+            std::cout << "Recommended codec for " << fps << " fps: " << codecInfo->fourccToString(codec).toStdString()
+                      << " (" << codecInfo->codecName(codec).toStdString() << ")" << std::endl;
+            return 0;
+        }
         if (!dataManager.init()) {
             std::cerr << "Problems in data manager initialization, continuing" << std::endl;
         }
-
-        Camera camera(config.cameraIndex(), config.cameraWidth(), config.cameraHeight());
-        if (!camera.init()) {
-            std::cerr << "Couldn't initialize web camera, quitting" << std::endl;
-            return -1;
+        if (config.resultVideoCodecStr() == AUTO_VIDEO_CODEC) {
+            // benchmark now if needed, rather than when the first video is recorded
+            config.resultVideoCodec();
         }
 
-        ActualDetector actualDetector(&camera, &config, &dataManager, &a);
+        // detection of all cameras runs in the same worker threads
+        WorkerPool workerPool(config.workerThreads());
+        // and their videos are encoded within one limit of running encoders
+        EncodingQueue* encodingQueue = Recorder::createEncodingQueue(&config, &a);
+        QList<int> cameraIndexes = config.cameraIndexes();
+        QList<Camera*> cameras;
+        QList<ActualDetector*> detectors;
 
-        Console console(&config, &actualDetector, &camera, &dataManager, &a);
-        console.init();
-        a.connect(&a, SIGNAL(aboutToQuit()), &console, SLOT(onApplicationAboutToQuit()));
+        foreach (int cameraIndex, cameraIndexes) {
+            Camera* camera = new Camera(cameraIndex, config.cameraWidth(), config.cameraHeight(),
+                                        config.cameraBackend(), config.cameraPixelFormat());
+            cameras << camera;
+            // input file replaces the first camera only
+            if (!inputFileName.isEmpty() && (cameras.size() == 1)) {
+                camera->setInputFile(inputFileName, parser.isSet(realTimeOption));
+                a.connect(camera, SIGNAL(endOfStream()), &a, SLOT(quit()));
+            }
+            if (!camera->init()) {
+                if (inputFileName.isEmpty() || (cameras.size() > 1)) {
+                    std::cerr << "Couldn't initialize web camera " << cameraIndex << ", quitting" << std::endl;
+                } else {
+                    std::cerr << "Couldn't read " << inputFileName.toStdString() << ", quitting" << std::endl;
+                }
+                return -1;
+            }
+
+            ActualDetector* actualDetector = new ActualDetector(camera, &config, &dataManager, &a);
+            actualDetector->setWorkerPool(&workerPool);
+            actualDetector->getRecorder()->setEncodingQueue(encodingQueue);
+            if (cameraIndexes.size() > 1) {
+                actualDetector->getRecorder()->setResultVideoDir(
+                        config.resultVideoDir() + "/camera" + QString::number(cameraIndex));
+            }
+            detectors << actualDetector;
+        }
+        std::cout << "Detecting " << cameras.size() << " camera(s) with " << workerPool.threadCount()
+                  << " worker threads" << std::endl;
+
+        int result = -1;
+        {
+            Console console(&config, detectors, cameras, &dataManager, &a);
+            console.init();
+            a.connect(&a, SIGNAL(aboutToQuit()), &console, SLOT(onApplicationAboutToQuit()));
 
-        if (!console.start()) {
-            std::cerr << "Error starting Console" << std::endl;
-            return -1;
+            if (!console.start()) {
+                std::cerr << "Error starting Console" << std::endl;
+                console.onApplicationAboutToQuit();
+            } else {
+                result = a.exec();
+            }
         }
-        return a.exec();
+        // detectors are stopped, delete them before the worker pool and cameras
+        qDeleteAll(detectors);
+        qDeleteAll(cameras);
+        return result;
     } catch (std::exception &e) {
         std::cout << e.what() << std::endl;
     }
@@ -178,8 +178,8 @@ void GraphicsScene::clearPolygon()
 
 bool GraphicsScene::takePicture() {
     Mat src;
-    src = m_camera->getWebcamFrame();
-    cv::cvtColor(src, src, CV_BGR2RGB);
+    // camera frame is shared, convert into own image
+    cv::cvtColor(m_camera->getWebcamFrame(), src, CV_BGR2RGB);
     QImage imgToDisplay = QImage((uchar*)src.data, src.cols, src.rows, src.step, QImage::Format_RGB888);
     if (items().contains((QGraphicsItem*)m_picture)) {
         removeItem((QGraphicsItem*)m_picture);
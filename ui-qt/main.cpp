@@ -44,7 +44,8 @@ int main(int argc, char *argv[])
         DataManager dataManager(&myConfig);
         dataManager.init();
 
-        Camera myCam(myConfig.cameraIndex(), myConfig.cameraWidth(), myConfig.cameraHeight());
+        Camera myCam(myConfig.cameraIndex(), myConfig.cameraWidth(), myConfig.cameraHeight(),
+                     myConfig.cameraBackend(), myConfig.cameraPixelFormat());
         myCam.init();
 
         MainWindow mainWindow(&myCam, &myConfig, &dataManager, NULL);
@@ -18,6 +18,7 @@
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "thumbnailwriter.h"
 
 MainWindow::MainWindow(Camera* cameraPtr, Config* configPtr, DataManager* dataManager, QWidget* parent) :
     QMainWindow(parent), ui(new Ui::MainWindow)
@@ -118,15 +119,23 @@ MainWindow::MainWindow(Camera* cameraPtr, Config* configPtr, DataManager* dataMa
 void MainWindow::updateWebcamFrame()
 {
     cv::Mat frame;
+    CameraFramePtr cameraFrame;
     int availableFrameTime = 1000/24;   // ms per frame
+    int frameWaitTimeout = 100;         // ms, interval at which m_showCameraVideo is checked
     qint64 frameStartTime;
     qint64 frameEndTime;
     int frameTimeLeft;
+    FrameSubscriber* frameSubscriber = m_camera->subscribe(FrameSubscriber::LatestOnly);
     while (m_showCameraVideo)
     {
         frameStartTime = QDateTime::currentMSecsSinceEpoch();
 
-        m_webcamFrame = m_camera->getWebcamFrame();
+        cameraFrame = frameSubscriber->waitNextFrame(frameWaitTimeout);
+        if (!cameraFrame)
+        {
+            continue;
+        }
+        m_webcamFrame = cameraFrame->bgrImage();
         cv::cvtColor(m_webcamFrame, frame, CV_BGR2RGB);
         m_cameraViewImage = QImage((uchar*)frame.data, frame.cols, frame.rows, frame.step, QImage::Format_RGB888);
         emit updatePixmap(m_cameraViewImage);
@@ -140,6 +149,7 @@ void MainWindow::updateWebcamFrame()
         }
         std::this_thread::yield();
     }
+    m_camera->unsubscribe(frameSubscriber);
 }
 
 void MainWindow::displayPixmap(QImage image)
@@ -315,9 +325,14 @@ void MainWindow::removeVideo(QString dateTime) {
         {
             QListWidgetItem *itemToRemove = ui->videoList->takeItem(row);
             ui->videoList->removeItemWidget(itemToRemove);
-            qDebug() << "Removing" << widget->videoFileName() << "and its thumbnail";
+            qDebug() << "Removing" << widget->videoFileName() << "and its thumbnails";
             QFile::remove(widget->videoFileName());
-            QFile::remove(widget->thumbnailFileName());
+            QString thumbnailBaseName = widget->thumbnailFileName();
+            thumbnailBaseName.chop(QString(".jpg").size());
+            foreach (QString thumbnailFileName, ThumbnailWriter::fileNames(thumbnailBaseName))
+            {
+                QFile::remove(thumbnailFileName);
+            }
             m_dataManager->removeVideo(dateTime);
         }
     }
@@ -18,6 +18,7 @@
 
 #include "settingsdialog.h"
 #include "ui_settingsdialog.h"
+#include <QApplication>
 #include <QFileDialog>
 #include <iostream>
 #include <opencv2/highgui/highgui.hpp>
@@ -60,6 +61,8 @@ SettingsDialog::SettingsDialog(QWidget* parent, Camera* camera, Config* config,
         int codec = supportedCodecsIt.next();
         ui->comboBoxCodec->addItem(codecInfo->codecName(codec), QVariant(codecInfo->fourccToString(codec)));
     }
+    // picked by the codec benchmark, run when settings are saved
+    ui->comboBoxCodec->addItem(tr("Automatic"), QVariant(AUTO_VIDEO_CODEC));
     ui->comboBoxCodec->setCurrentIndex(ui->comboBoxCodec->findData(
         QVariant(m_config->resultVideoCodecStr())));
     if (ui->comboBoxCodec->currentIndex() < 0) {
@@ -128,6 +131,13 @@ void SettingsDialog::on_buttonSave_clicked()
         }
     }
     saveSettings();
+    if (m_config->resultVideoCodecStr() == AUTO_VIDEO_CODEC)
+    {
+        // benchmark at the saved resolution now rather than when the first video is recorded
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        m_config->resultVideoCodec();
+        QApplication::restoreOverrideCursor();
+    }
     m_wasSaved = true;
     /// @todo apply settings on-the-fly
     QMessageBox::information(this, tr("Information"), tr("Settings saved successfully. Restart the application to apply the changes."));
@@ -25,6 +25,7 @@ SOURCES += ./main.cpp\
     ../../../ufo-detector-engine/camera.cpp \
     ../../../ufo-detector-engine/camerainfo.cpp \
     ../../../ufo-detector-engine/videocodecsupportinfo.cpp \
+    ../../../ufo-detector-engine/pipedvideowriter.cpp \
     ../../polygonnode.cpp \
     ../../polygonedge.cpp
 
@@ -36,6 +37,7 @@ HEADERS  += ./mainwindow.h \
     ../../../ufo-detector-engine/camera.h \
     ../../../ufo-detector-engine/camerainfo.h \
     ../../../ufo-detector-engine/videocodecsupportinfo.h \
+    ../../../ufo-detector-engine/pipedvideowriter.h \
     ../../polygonnode.h \
     ../../polygonedge.h
 
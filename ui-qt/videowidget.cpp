@@ -28,6 +28,7 @@
 #include <clickablelabel.h>
 #include "mainwindow.h"
 #include <QDebug>
+#include <QFile>
 
 using namespace std;
 
@@ -39,6 +40,12 @@ VideoWidget::VideoWidget(QWidget *parent, QString filepath, QString theDateTime,
     myParent = qobject_cast<MainWindow*>(parent);
     m_dateTime = theDateTime;
     m_videoFileName = filepath + QString("/Capture--") + m_dateTime + QString(".avi");
+    QString variableFrameRateFileName = filepath + QString("/Capture--") + m_dateTime + QString(".mkv");
+    if (!QFile::exists(m_videoFileName) && QFile::exists(variableFrameRateFileName))
+    {
+        // variable frame rate videos are recorded into Matroska
+        m_videoFileName = variableFrameRateFileName;
+    }
     m_thumbnailFileName=filepath + QString("/thumbnails/") + m_dateTime + QString(".jpg");
 
     QLabel *thumbnailLabel = new QLabel(this);
@@ -49,6 +56,12 @@ VideoWidget::VideoWidget(QWidget *parent, QString filepath, QString theDateTime,
     thumbnail.load(m_thumbnailFileName);
     thumbnailLabel->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
     thumbnailLabel->setPixmap(QPixmap::fromImage(thumbnail));
+    QString previewFileName = filepath + QString("/thumbnails/") + m_dateTime + QString("-preview.jpg");
+    if (QFile::exists(previewFileName))
+    {
+        // contact sheet of frames sampled during recording
+        thumbnailLabel->setToolTip(QString("<img src=\"%1\">").arg(previewFileName));
+    }
 
     QVBoxLayout *vLayout = new QVBoxLayout;
     vLayout->addWidget(lbl1);